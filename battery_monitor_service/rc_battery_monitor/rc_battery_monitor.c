@@ -56,11 +56,13 @@ int main(int argc, char *argv[]){
 	int chg_leds = 0;
 	int charging = 0;
 	int pack_connected = 0;
-	int c;
+	int c, i;
 	float stddev;
+	float v_raw;	// unfiltered pack voltage
 	rc_bb_model_t model;
 	rc_filter_t filterB = rc_empty_filter();
 	rc_filter_t filterJ = rc_empty_filter(); // battery and jack filters
+	rc_stats_ringbuf_t statsB = rc_empty_stats_ringbuf(); // raw pack voltage
 
 	// ensure root privaleges until we sort out udev rules
 	if(geteuid()!=0){
@@ -142,6 +144,12 @@ int main(int argc, char *argv[]){
 	}
 	rc_prefill_filter_outputs(&filterB, v_pack);
 	rc_prefill_filter_inputs(&filterB, v_pack);
+	if(rc_alloc_stats_ringbuf(&statsB, FITLER_SAMPLES)){
+		fprintf(stderr,"ERROR in rc_battery_monitor, failed to create ring buffer\n");
+		remove(PID_FILE);
+		return -1;
+	}
+	for(i=0;i<FITLER_SAMPLES;i++) rc_insert_new_stats_ringbuf_value(&statsB, v_pack);
 	v_jack = rc_dc_jack_voltage();
 	if(rc_moving_average(&filterJ, FITLER_SAMPLES, 1000000.0/LOOP_HZ)){
 		fprintf(stderr,"ERROR in rc_battery_monitor, failed to create filter\n");
@@ -163,7 +171,9 @@ int main(int argc, char *argv[]){
 	while(running){
 		charging = 0;
 		// read in the voltage of the 2S pack and DC jack
-		v_pack = rc_march_filter(&filterB, rc_battery_voltage());
+		v_raw = rc_battery_voltage();
+		rc_insert_new_stats_ringbuf_value(&statsB, v_raw);
+		v_pack = rc_march_filter(&filterB, v_raw);
 		v_jack = rc_march_filter(&filterJ, rc_dc_jack_voltage());
 
 		if(v_pack==-1 || v_jack==-1){
@@ -174,7 +184,7 @@ int main(int argc, char *argv[]){
 		
 		// find standard deviation of battery signal to determine
 		// if a 2S pack is connected or not
-		if(v_pack>(2*CELL_DIS)) stddev=rc_std_dev_ringbuf(filterB.in_buf);
+		if(v_pack>(2*CELL_DIS)) stddev=rc_stats_ringbuf_std_dev(&statsB);
 
 		// check if 2s pack if connected
 		if(v_pack>(2*CELL_DIS) && stddev<STD_DEV_TOLERANCE){
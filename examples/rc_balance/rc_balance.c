@@ -81,6 +81,9 @@ void on_pause_press();
 void on_mode_release();
 int blink_green();
 int blink_red();
+// D1 and D2 marched with their coefficients from balance_config.h compiled in
+RC_STATIC_FILTER(D1_march, D1_ORDER, D1_NUM, D1_DEN)
+RC_STATIC_FILTER(D2_march, D2_ORDER, D2_NUM, D2_DEN)
 
 /*******************************************************************************
 * Global Variables				
@@ -88,6 +91,9 @@ int blink_red();
 core_state_t cstate;
 setpoint_t setpoint;
 rc_filter_t D1, D2, D3;
+// D1 and D2 keep their coefficients and buffers here instead of on the heap
+float D1_storage[RC_FILTER_STORAGE_SIZE(D1_ORDER)];
+float D2_storage[RC_FILTER_STORAGE_SIZE(D2_ORDER)];
 rc_imu_data_t imu_data;
 
 /*******************************************************************************
@@ -124,7 +130,7 @@ int main(){
 	// set up D1 Theta controller
 	float D1_num[] = D1_NUM;
 	float D1_den[] = D1_DEN;
-	if(rc_alloc_filter_from_arrays(&D1,D1_ORDER, DT, D1_num, D1_den)){
+	if(rc_filter_from_storage(&D1, D1_ORDER, DT, D1_num, D1_den, D1_storage)){
 		fprintf(stderr,"ERROR in rc_balance, failed to make filter D1\n");
 		return -1;
 	}
@@ -135,7 +141,7 @@ int main(){
 	// set up D2 Phi controller
 	float D2_num[] = D2_NUM;
 	float D2_den[] = D2_DEN;
-	if(rc_alloc_filter_from_arrays(&D2, D2_ORDER, DT, D2_num, D2_den)){
+	if(rc_filter_from_storage(&D2, D2_ORDER, DT, D2_num, D2_den, D2_storage)){
 		fprintf(stderr,"ERROR in rc_balance, failed to make filter D2\n");
 		return -1;
 	}
@@ -353,7 +359,7 @@ void balance_controller(){
 	*************************************************************/
 	if(ENABLE_POSITION_HOLD){
 		if(setpoint.phi_dot != 0.0) setpoint.phi += setpoint.phi_dot*DT;
-		cstate.d2_u = rc_march_filter(&D2,setpoint.phi-cstate.phi);
+		cstate.d2_u = D2_march(&D2,setpoint.phi-cstate.phi);
 		setpoint.theta = cstate.d2_u;
 	}
 	else setpoint.theta = 0.0;
@@ -364,7 +370,7 @@ void balance_controller(){
 	* output u to compensate for changing battery voltage.
 	*************************************************************/
 	D1.gain = D1_GAIN * V_NOMINAL/cstate.vBatt;
-	cstate.d1_u = rc_march_filter(&D1,(setpoint.theta-cstate.theta));
+	cstate.d1_u = D1_march(&D1,(setpoint.theta-cstate.theta));
 	
 	/*************************************************************
 	* Check if the inner loop saturated. If it saturates for over
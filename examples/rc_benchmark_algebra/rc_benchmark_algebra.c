@@ -4,7 +4,17 @@
 * James Strawson 2016
 * This tests some of the more common functions in linear_algebra.c, it is not a
 * complete test of all available linear algebra functions but should get you
-* started.
+* started. With -m it instead sweeps a range of sizes multiplying matrices and
+* reports MFLOPS next to a naive triple loop for comparison. With -l it solves
+* one matrix against many right hand sides, refactoring every time with
+* rc_lin_system_solve and factoring once with rc_lu_factor/rc_lu_solve. With -e
+* it times the Jacobi eigensolver and SVD on the small sizes used on board.
+* With -p it times the float and double versions of the same operations side
+* by side and shows how much accuracy each keeps solving Hilbert systems. With
+* -b it compares a state update x=Ax+Bu and a rank-1 update P=P-kk' written
+* with the fused in-place kernels against the older calls and temporaries.
+* With -f it times the inline fixed-size vec3/mat3/mat4 operations against the
+* same operations on rc_vector_t and rc_matrix_t.
 *******************************************************************************/
 
 #include "../../libraries/rc_usefulincludes.h"
@@ -17,16 +27,580 @@
 #define TIMER rc_nanos_thread_time()
 #define TIMER_DELAY 2100 // ns consumed just by reading the thread time
 
+// matrix multiplication sweep, each size is repeated to take about this long
+#define SWEEP_NS	200000000
+#define SWEEP_SIZES	15
+const int sweep_size[SWEEP_SIZES] = {3,4,6,8,12,16,24,32,48,64,96,128,192,256,384};
+
+// repeated solve sweep, right hand sides solved against each matrix
+#define SOLVE_SIZES	10
+#define SOLVE_RHS	100
+const int solve_size[SOLVE_SIZES] = {3,4,6,9,12,16,24,32,64,128};
+
+// eigenvalue and SVD sweep
+#define EIG_SIZES	6
+#define EIG_REPS	2000
+const int eig_size[EIG_SIZES] = {3,4,6,8,10,12};
+
+// float vs double sweep, each operation is repeated to take about this long
+#define PREC_NS		50000000
+#define PREC_SIZES	7
+#define PREC_OPS	4
+const int prec_size[PREC_SIZES] = {3,4,6,8,16,32,64};
+const char* prec_op_name[PREC_OPS] = {"multiply","LU","Cholesky","QR"};
+#define HILBERT_MAX	12
+
+// fused kernel sweep, number of updates timed at each state size
+#define FUSED_SIZES	6
+#define FUSED_REPS	20000 // even so the fused loop ends back in x2
+const int fused_size[FUSED_SIZES] = {3,4,6,8,12,16};
+
+// fixed-size comparison, number of times each operation is repeated
+#define FIXED_REPS	1000000
+#define FIXED_OPS	5
+const char* fixed_op_name[FIXED_OPS] = {"rotate+cross","mat3 mul","mat4 mul",\
+										"mat3 inverse","mat4 inverse"};
+
 // printed if some invalid argument was given
 void print_usage(){
 	printf("\n");
 	printf("-d         use default matrix size (%dx%d)\n",DEFAULT_DIM,DEFAULT_DIM);
 	printf("-s {size}  use custom matrix size\n");
+	printf("-m         sweep sizes multiplying matrices, report MFLOPS\n");
+	printf("-l         sweep sizes solving %d right hand sides per matrix\n",SOLVE_RHS);
+	printf("-e         sweep small sizes finding eigenvalues and SVD\n");
+	printf("-p         compare float and double speed and accuracy\n");
+	printf("-b         compare fused in-place kernels to separate calls\n");
+	printf("-f         compare fixed-size vec3/mat3/mat4 to dynamic types\n");
 	printf("-h         print this help message\n");
 	printf("\n");
 }
 
 
+// textbook triple loop multiply used as the reference in the sweep
+void naive_multiply(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C){
+	int i,j,k;
+	float sum;
+	for(i=0;i<A.rows;i++){
+		for(j=0;j<B.cols;j++){
+			sum = 0.0f;
+			for(k=0;k<A.cols;k++) sum += A.d[i][k]*B.d[k][j];
+			C.d[i][j] = sum;
+		}
+	}
+	return;
+}
+
+// times repeated multiplication of random nxn matrices with rc_multiply_matrices
+// and the naive reference, prints MFLOPS for both and the largest difference
+int multiply_sweep(){
+	int i, j, s, n, reps;
+	uint64_t t1, t2, fast, naive;
+	float err, maxerr;
+	rc_matrix_t A = rc_empty_matrix();
+	rc_matrix_t B = rc_empty_matrix();
+	rc_matrix_t C = rc_empty_matrix();
+	rc_matrix_t D = rc_empty_matrix();
+	printf("\n  size   ns/multiply   MFLOPS   naive MFLOPS   max diff\n");
+	for(s=0;s<SWEEP_SIZES;s++){
+		n = sweep_size[s];
+		rc_random_matrix(&A,n,n);
+		rc_random_matrix(&B,n,n);
+		rc_alloc_matrix(&C,n,n);
+		rc_alloc_matrix(&D,n,n);
+		reps = SWEEP_NS/(2*n*n*n);
+		if(reps<1) reps=1;
+		t1 = TIMER;
+		for(i=0;i<reps;i++) rc_multiply_matrices(A,B,&C);
+		t2 = TIMER;
+		fast = t2-t1;
+		t1 = TIMER;
+		for(i=0;i<reps;i++) naive_multiply(A,B,D);
+		t2 = TIMER;
+		naive = t2-t1;
+		maxerr = 0.0f;
+		for(i=0;i<n;i++){
+			for(j=0;j<n;j++){
+				err = fabs(C.d[i][j]-D.d[i][j]);
+				if(err>maxerr) maxerr=err;
+			}
+		}
+		printf("%6d %13lld %8lld %14lld %10.2e\n", n, fast/reps, \
+				((uint64_t)2*n*n*n*reps*1000)/fast, \
+				((uint64_t)2*n*n*n*reps*1000)/naive, maxerr);
+	}
+	rc_free_matrix(&A);
+	rc_free_matrix(&B);
+	rc_free_matrix(&C);
+	rc_free_matrix(&D);
+	return 0;
+}
+
+// solves random nxn systems against SOLVE_RHS right hand sides, first calling
+// rc_lin_system_solve for each one and then factoring once and reusing it
+int solve_sweep(){
+	int i, j, s, n;
+	uint64_t t1, t2, fresh, factor, solve;
+	float err, maxerr;
+	rc_matrix_t A = rc_empty_matrix();
+	rc_matrix_t B = rc_empty_matrix();
+	rc_vector_t b = rc_empty_vector();
+	rc_vector_t x = rc_empty_vector();
+	rc_vector_t y = rc_empty_vector();
+	rc_lu_t lu = rc_empty_lu();
+	printf("\n  size   ns/solve refactor   factor ns   ns/solve reuse   speedup   max diff\n");
+	for(s=0;s<SOLVE_SIZES;s++){
+		n = solve_size[s];
+		rc_random_matrix(&A,n,n);
+		// keep the system well conditioned so the difference reflects rounding
+		for(i=0;i<n;i++) A.d[i][i] += n;
+		rc_random_matrix(&B,SOLVE_RHS,n);
+		rc_alloc_vector(&b,n);
+		rc_alloc_vector(&x,n);
+		rc_alloc_vector(&y,n);
+		// current path, everything is redone for every right hand side
+		t1 = TIMER;
+		for(i=0;i<SOLVE_RHS;i++){
+			memcpy(b.d,B.d[i],n*sizeof(float));
+			rc_lin_system_solve(A,b,&x);
+		}
+		t2 = TIMER;
+		fresh = t2-t1;
+		// factor once, then only substitute
+		t1 = TIMER;
+		rc_lu_factor(A,&lu);
+		t2 = TIMER;
+		factor = t2-t1;
+		t1 = TIMER;
+		for(i=0;i<SOLVE_RHS;i++){
+			memcpy(b.d,B.d[i],n*sizeof(float));
+			rc_lu_solve(lu,b,&y);
+		}
+		t2 = TIMER;
+		solve = t2-t1;
+		// x and y both hold the last solution
+		maxerr = 0.0f;
+		for(j=0;j<n;j++){
+			err = fabs(x.d[j]-y.d[j]);
+			if(err>maxerr) maxerr=err;
+		}
+		printf("%6d %17lld %11lld %16lld %8.1fx %10.2e\n", n, fresh/SOLVE_RHS, \
+				factor, solve/SOLVE_RHS, (double)fresh/(factor+solve), maxerr);
+	}
+	rc_free_matrix(&A);
+	rc_free_matrix(&B);
+	rc_free_vector(&b);
+	rc_free_vector(&x);
+	rc_free_vector(&y);
+	rc_free_lu(&lu);
+	return 0;
+}
+
+// times rc_eig_symmetric on random symmetric nxn matrices and rc_svd_decomp
+// on random nxn matrices, the workspace is allocated once outside the loop
+int eig_sweep(){
+	int i, j, s, n;
+	uint64_t t1, t2, eig, svd;
+	rc_matrix_t A = rc_empty_matrix();
+	rc_matrix_t S = rc_empty_matrix();
+	rc_eig_t e = rc_empty_eig();
+	rc_svd_t d = rc_empty_svd();
+	printf("\n  size   us/eig   sweeps   us/svd   sweeps\n");
+	for(s=0;s<EIG_SIZES;s++){
+		n = eig_size[s];
+		rc_random_matrix(&A,n,n);
+		rc_alloc_matrix(&S,n,n);
+		for(i=0;i<n;i++){
+			for(j=0;j<n;j++) S.d[i][j] = A.d[i][j]+A.d[j][i];
+		}
+		rc_alloc_eig(&e,n);
+		rc_alloc_svd(&d,n,n);
+		t1 = TIMER;
+		for(i=0;i<EIG_REPS;i++) rc_eig_symmetric(S,&e);
+		t2 = TIMER;
+		eig = t2-t1;
+		t1 = TIMER;
+		for(i=0;i<EIG_REPS;i++) rc_svd_decomp(A,&d);
+		t2 = TIMER;
+		svd = t2-t1;
+		printf("%6d %8.2f %8d %8.2f %8d\n", n, eig/(EIG_REPS*1000.0), \
+				e.sweeps, svd/(EIG_REPS*1000.0), d.sweeps);
+	}
+	rc_free_matrix(&A);
+	rc_free_matrix(&S);
+	rc_free_eig(&e);
+	rc_free_svd(&d);
+	return 0;
+}
+
+// runs operation op reps times on the float matrices A (random) and S (s.p.d.)
+// and returns the elapsed ns, Cholesky includes copying S since it's in place
+uint64_t time_float_op(int op, int reps, rc_matrix_t A, rc_matrix_t S){
+	int i;
+	uint64_t t1, t2;
+	rc_matrix_t C = rc_empty_matrix();
+	rc_lu_t lu = rc_empty_lu();
+	rc_qr_t qr = rc_empty_qr();
+	// allocate everything up front so only the arithmetic is timed
+	rc_alloc_matrix(&C,A.rows,A.cols);
+	rc_alloc_lu(&lu,A.rows);
+	rc_alloc_qr(&qr,A.rows,A.cols);
+	t1 = TIMER;
+	for(i=0;i<reps;i++){
+		switch(op){
+		case 0: rc_multiply_matrices(A,A,&C); break;
+		case 1: rc_lu_factor(A,&lu); break;
+		case 2: rc_duplicate_matrix(S,&C); rc_cholesky_decomp(&C); break;
+		case 3: rc_qr_factor(A,&qr); break;
+		}
+	}
+	t2 = TIMER;
+	rc_free_matrix(&C);
+	rc_free_lu(&lu);
+	rc_free_qr(&qr);
+	return t2-t1;
+}
+
+// double precision twin of time_float_op
+uint64_t time_double_op(int op, int reps, rc_matrix_d_t A, rc_matrix_d_t S){
+	int i;
+	uint64_t t1, t2;
+	rc_matrix_d_t C = rc_empty_matrix_d();
+	rc_lu_d_t lu = rc_empty_lu_d();
+	rc_qr_d_t qr = rc_empty_qr_d();
+	rc_alloc_matrix_d(&C,A.rows,A.cols);
+	rc_alloc_lu_d(&lu,A.rows);
+	rc_alloc_qr_d(&qr,A.rows,A.cols);
+	t1 = TIMER;
+	for(i=0;i<reps;i++){
+		switch(op){
+		case 0: rc_multiply_matrices_d(A,A,&C); break;
+		case 1: rc_lu_factor_d(A,&lu); break;
+		case 2: rc_duplicate_matrix_d(S,&C); rc_cholesky_decomp_d(&C); break;
+		case 3: rc_qr_factor_d(A,&qr); break;
+		}
+	}
+	t2 = TIMER;
+	rc_free_matrix_d(&C);
+	rc_free_lu_d(&lu);
+	rc_free_qr_d(&qr);
+	return t2-t1;
+}
+
+// times the float and double versions of each operation on the same random
+// matrices, then solves Hilbert systems whose exact solution is all ones to
+// show where float runs out of digits
+int precision_sweep(){
+	int i, j, k, s, n, op, reps;
+	uint64_t tf, td;
+	float errf;
+	double errd;
+	rc_matrix_t A = rc_empty_matrix();
+	rc_matrix_t S = rc_empty_matrix();
+	rc_matrix_d_t Ad = rc_empty_matrix_d();
+	rc_matrix_d_t Sd = rc_empty_matrix_d();
+	rc_vector_t b = rc_empty_vector();
+	rc_vector_t x = rc_empty_vector();
+	rc_vector_d_t bd = rc_empty_vector_d();
+	rc_vector_d_t xd = rc_empty_vector_d();
+	printf("\n  size  operation   ns float   ns double   double/float\n");
+	for(s=0;s<PREC_SIZES;s++){
+		n = prec_size[s];
+		rc_random_matrix(&A,n,n);
+		// s.p.d. S=AA'+nI for Cholesky
+		rc_alloc_matrix(&S,n,n);
+		for(i=0;i<n;i++){
+			for(j=0;j<n;j++){
+				S.d[i][j] = (i==j) ? n : 0.0f;
+				for(k=0;k<n;k++) S.d[i][j] += A.d[i][k]*A.d[j][k];
+			}
+		}
+		rc_matrix_float_to_double(A,&Ad);
+		rc_matrix_float_to_double(S,&Sd);
+		reps = PREC_NS/(2*n*n*n);
+		if(reps<1) reps=1;
+		for(op=0;op<PREC_OPS;op++){
+			tf = time_float_op(op,reps,A,S);
+			td = time_double_op(op,reps,Ad,Sd);
+			printf("%6d  %-9s %10lld %11lld %14.2f\n", n, prec_op_name[op], \
+					tf/reps, td/reps, (double)td/tf);
+		}
+	}
+	printf("\n  size   hilbert solve error float   double\n");
+	for(n=4;n<=HILBERT_MAX;n+=2){
+		rc_alloc_matrix_d(&Ad,n,n);
+		rc_alloc_vector_d(&bd,n);
+		for(i=0;i<n;i++){
+			bd.d[i] = 0.0;
+			for(j=0;j<n;j++){
+				Ad.d[i][j] = 1.0/(i+j+1);
+				bd.d[i] += Ad.d[i][j];
+			}
+		}
+		rc_matrix_double_to_float(Ad,&A);
+		rc_vector_double_to_float(bd,&b);
+		// float gives up with a singular pivot well before double does
+		errf = -1.0f;
+		if(rc_lin_system_solve(A,b,&x)==0){
+			errf = 0.0f;
+			for(i=0;i<n;i++) if(fabs(x.d[i]-1.0f)>errf) errf = fabs(x.d[i]-1.0f);
+		}
+		errd = -1.0;
+		if(rc_lin_system_solve_d(Ad,bd,&xd)==0){
+			errd = 0.0;
+			for(i=0;i<n;i++) if(fabs(xd.d[i]-1.0)>errd) errd = fabs(xd.d[i]-1.0);
+		}
+		printf("%6d %27.2e %8.2e\n", n, errf, errd);
+	}
+	printf("(-1 means the solve failed)\n");
+	rc_free_matrix(&A);
+	rc_free_matrix(&S);
+	rc_free_matrix_d(&Ad);
+	rc_free_matrix_d(&Sd);
+	rc_free_vector(&b);
+	rc_free_vector(&x);
+	rc_free_vector_d(&bd);
+	rc_free_vector_d(&xd);
+	return 0;
+}
+
+// times a state update x=Ax+Bu and a rank-1 downdate P=P-kk' with the older
+// allocating calls and temporaries, then with rc_gemv and rc_ger
+int fused_sweep(){
+	int i, s, n;
+	uint64_t t1, t2, old_x, new_x, old_p, new_p;
+	float err, maxerr;
+	rc_matrix_t A = rc_empty_matrix();
+	rc_matrix_t B = rc_empty_matrix();
+	rc_matrix_t P1 = rc_empty_matrix();
+	rc_matrix_t P2 = rc_empty_matrix();
+	rc_matrix_t K = rc_empty_matrix();
+	rc_vector_t u = rc_empty_vector();
+	rc_vector_t k = rc_empty_vector();
+	rc_vector_t x1 = rc_empty_vector();
+	rc_vector_t x2 = rc_empty_vector();
+	rc_vector_t ax = rc_empty_vector();
+	rc_vector_t bu = rc_empty_vector();
+	rc_vector_t tmp;
+	printf("\n  size   ns x=Ax+Bu old   fused   ns P-=kk' old   fused   max diff\n");
+	for(s=0;s<FUSED_SIZES;s++){
+		n = fused_size[s];
+		// keep A a contraction so repeated updates stay finite
+		rc_random_matrix(&A,n,n);
+		rc_matrix_times_scalar(&A,0.5f/n);
+		rc_random_matrix(&B,n,2);
+		rc_random_vector(&u,2);
+		rc_random_vector(&k,n);
+		rc_vector_times_scalar(&k,0.001f);
+		rc_vector_zeros(&x1,n);
+		rc_vector_zeros(&x2,n);
+		rc_identity_matrix(&P1,n);
+		rc_identity_matrix(&P2,n);
+		// old way, two products into temporaries then a sum
+		t1 = TIMER;
+		for(i=0;i<FUSED_REPS;i++){
+			rc_matrix_times_col_vec(A,x1,&ax);
+			rc_matrix_times_col_vec(B,u,&bu);
+			rc_vector_sum(ax,bu,&x1);
+		}
+		t2 = TIMER;
+		old_x = t2-t1;
+		// fused, Bu lands in the next state and Ax is accumulated on top, the
+		// two buffers swap roles each step since x can't be updated in place
+		rc_vector_zeros(&ax,n);
+		t1 = TIMER;
+		for(i=0;i<FUSED_REPS;i++){
+			rc_gemv(1.0f,B,u,0.0f,&ax);
+			rc_gemv(1.0f,A,x2,1.0f,&ax);
+			tmp = x2;
+			x2 = ax;
+			ax = tmp;
+		}
+		t2 = TIMER;
+		new_x = t2-t1;
+		t1 = TIMER;
+		for(i=0;i<FUSED_REPS;i++){
+			rc_vector_outer_product(k,k,&K);
+			rc_matrix_times_scalar(&K,-1.0f);
+			rc_add_matrices_inplace(&P1,K);
+		}
+		t2 = TIMER;
+		old_p = t2-t1;
+		t1 = TIMER;
+		for(i=0;i<FUSED_REPS;i++) rc_ger(-1.0f,k,k,&P2);
+		t2 = TIMER;
+		new_p = t2-t1;
+		maxerr = 0.0f;
+		for(i=0;i<n;i++){
+			err = fabs(x1.d[i]-x2.d[i]);
+			if(err>maxerr) maxerr=err;
+			err = fabs(P1.d[i][i]-P2.d[i][i]);
+			if(err>maxerr) maxerr=err;
+		}
+		printf("%6d %16lld %7lld %15lld %7lld %10.2e\n", n, old_x/FUSED_REPS, \
+				new_x/FUSED_REPS, old_p/FUSED_REPS, new_p/FUSED_REPS, maxerr);
+	}
+	rc_free_matrix(&A);
+	rc_free_matrix(&B);
+	rc_free_matrix(&P1);
+	rc_free_matrix(&P2);
+	rc_free_matrix(&K);
+	rc_free_vector(&u);
+	rc_free_vector(&k);
+	rc_free_vector(&x1);
+	rc_free_vector(&x2);
+	rc_free_vector(&ax);
+	rc_free_vector(&bu);
+	return 0;
+}
+
+// runs fixed-size operation op reps times on inputs built from A (4x4), q and
+// v, and returns the elapsed ns. Inputs and results go through memory on every
+// repetition so the compiler can't hoist or remove the work. Products are not
+// chained so nothing drifts towards denormals, inverses undo each other.
+uint64_t time_fixed_op(int op, int reps, rc_matrix_t A, rc_vector_t q, rc_vector_t v){
+	int i;
+	uint64_t t1, t2;
+	rc_vec3_t a3, b3, s3;
+	rc_vec4_t q4;
+	rc_mat3_t A3, B3, C3;
+	rc_mat4_t A4, B4, C4;
+	rc_matrix_t S = rc_empty_matrix();
+	rc_matrix_slice(A,0,0,3,3,&S);
+	rc_matrix_to_mat3(S,&A3);
+	rc_matrix_to_mat4(A,&A4);
+	rc_vector_to_vec4(q,&q4);
+	rc_vector_to_vec3(v,&a3);
+	b3 = rc_vec3(0.0f,0.0f,1.0f);
+	s3 = rc_vec3(0.0f,0.0f,0.0f);
+	B3 = A3;
+	B4 = A4;
+	t1 = TIMER;
+	switch(op){
+	case 0:
+		for(i=0;i<reps;i++){
+			__asm__ volatile("" : "+m"(q4), "+m"(a3));
+			s3 = rc_vec3_add(s3,rc_vec3_cross(rc_mat3_mul_vec(rc_mat3_from_quaternion(q4),a3),b3));
+		}
+		__asm__ volatile("" : "+m"(s3));
+		break;
+	case 1:
+		for(i=0;i<reps;i++){
+			__asm__ volatile("" : "+m"(A3), "+m"(B3));
+			C3 = rc_mat3_mul(A3,B3);
+			__asm__ volatile("" : "+m"(C3));
+		}
+		break;
+	case 2:
+		for(i=0;i<reps;i++){
+			__asm__ volatile("" : "+m"(A4), "+m"(B4));
+			C4 = rc_mat4_mul(A4,B4);
+			__asm__ volatile("" : "+m"(C4));
+		}
+		break;
+	case 3:
+		for(i=0;i<reps;i++){
+			rc_mat3_inverse(B3,&B3);
+			__asm__ volatile("" : "+m"(B3));
+		}
+		break;
+	case 4:
+		for(i=0;i<reps;i++){
+			rc_mat4_inverse(B4,&B4);
+			__asm__ volatile("" : "+m"(B4));
+		}
+		break;
+	}
+	t2 = TIMER;
+	return t2-t1;
+}
+
+// dynamic twin of time_fixed_op using the rc_vector_t and rc_matrix_t calls
+// a program would have made before the fixed-size types existed
+uint64_t time_dynamic_op(int op, int reps, rc_matrix_t A, rc_vector_t q, rc_vector_t v){
+	int i;
+	uint64_t t1, t2;
+	rc_matrix_t S = rc_empty_matrix();
+	rc_matrix_t A3 = rc_empty_matrix();
+	rc_matrix_t B = rc_empty_matrix();
+	rc_matrix_t C = rc_empty_matrix();
+	rc_matrix_t R = rc_empty_matrix();
+	rc_vector_t a = rc_empty_vector();
+	rc_vector_t b = rc_empty_vector();
+	rc_vector_t w = rc_empty_vector();
+	rc_vector_t c = rc_empty_vector();
+	rc_vector_t s = rc_empty_vector();
+	rc_matrix_slice(A,0,0,3,3,&S);
+	rc_duplicate_matrix(S,&A3);
+	rc_duplicate_vector(v,&a);
+	rc_vector_zeros(&b,3);
+	b.d[2] = 1.0f;
+	rc_alloc_vector(&w,3);
+	rc_alloc_vector(&c,3);
+	rc_vector_zeros(&s,3);
+	rc_quaternion_to_rotation_matrix(q,&R);
+	if(op==1 || op==3) rc_duplicate_matrix(A3,&B);
+	else rc_duplicate_matrix(A,&B);
+	rc_alloc_matrix(&C,B.rows,B.cols);
+	t1 = TIMER;
+	switch(op){
+	case 0:
+		for(i=0;i<reps;i++){
+			rc_quaternion_to_rotation_matrix(q,&R);
+			rc_matrix_times_col_vec(R,a,&w);
+			rc_vector_cross_product(w,b,&c);
+			rc_vector_sum_inplace(&s,c);
+		}
+		break;
+	case 1:
+	case 2:
+		for(i=0;i<reps;i++) rc_multiply_matrices(op==1 ? A3 : A,B,&C);
+		break;
+	case 3:
+	case 4:
+		for(i=0;i<reps;i++) rc_invert_matrix_inplace(&B);
+		break;
+	}
+	t2 = TIMER;
+	rc_free_matrix(&A3);
+	rc_free_matrix(&B);
+	rc_free_matrix(&C);
+	rc_free_matrix(&R);
+	rc_free_vector(&a);
+	rc_free_vector(&b);
+	rc_free_vector(&w);
+	rc_free_vector(&c);
+	rc_free_vector(&s);
+	return t2-t1;
+}
+
+// times each fixed-size operation against the dynamic calls it replaces
+int fixed_sweep(){
+	int i, op;
+	uint64_t tf, td;
+	rc_matrix_t A = rc_empty_matrix();
+	rc_vector_t q = rc_empty_vector();
+	rc_vector_t v = rc_empty_vector();
+	// scaled so repeated products stay finite and the inverses stay defined
+	rc_random_matrix(&A,4,4);
+	rc_matrix_times_scalar(&A,0.2f);
+	for(i=0;i<4;i++) A.d[i][i] += 1.0f;
+	rc_random_vector(&q,4);
+	rc_normalize_quaternion(&q);
+	rc_random_vector(&v,3);
+	printf("\n  operation      ns fixed   ns dynamic   speedup\n");
+	for(op=0;op<FIXED_OPS;op++){
+		tf = time_fixed_op(op,FIXED_REPS,A,q,v);
+		td = time_dynamic_op(op,FIXED_REPS,A,q,v);
+		printf("  %-12s %10.1f %12.1f %8.1fx\n", fixed_op_name[op], \
+				(double)tf/FIXED_REPS, (double)td/FIXED_REPS, (double)td/tf);
+	}
+	rc_free_matrix(&A);
+	rc_free_vector(&q);
+	rc_free_vector(&v);
+	return 0;
+}
+
 int main(int argc, char *argv[]){
 	int dim = 0;
 	int c;
@@ -54,7 +628,7 @@ int main(int argc, char *argv[]){
 	}
 	// parse arguments
 	opterr = 0;
-	while ((c = getopt(argc, argv, "ds:h")) != -1){
+	while ((c = getopt(argc, argv, "ds:mlpbfeh")) != -1){
 		switch (c){
 		case 'd': // default size option
 			if(dim!=0){
@@ -77,6 +651,54 @@ int main(int argc, char *argv[]){
 				return -1;
 			}
 			break;
+		case 'm': // multiplication sweep
+			if(dim!=0){
+				printf("invalid combination of arguments\n");
+				print_usage();
+				return -1;
+			}
+			dim = -1;
+			break;
+		case 'l': // repeated solve sweep
+			if(dim!=0){
+				printf("invalid combination of arguments\n");
+				print_usage();
+				return -1;
+			}
+			dim = -2;
+			break;
+		case 'e': // eigenvalue and SVD sweep
+			if(dim!=0){
+				printf("invalid combination of arguments\n");
+				print_usage();
+				return -1;
+			}
+			dim = -3;
+			break;
+		case 'p': // float vs double comparison
+			if(dim!=0){
+				printf("invalid combination of arguments\n");
+				print_usage();
+				return -1;
+			}
+			dim = -4;
+			break;
+		case 'b': // fused kernel comparison
+			if(dim!=0){
+				printf("invalid combination of arguments\n");
+				print_usage();
+				return -1;
+			}
+			dim = -5;
+			break;
+		case 'f': // fixed-size comparison
+			if(dim!=0){
+				printf("invalid combination of arguments\n");
+				print_usage();
+				return -1;
+			}
+			dim = -6;
+			break;
 		case 'h':
 			print_usage();
 			return 0;
@@ -89,6 +711,36 @@ int main(int argc, char *argv[]){
 
 	// set clock speed to 1000mhz to make sure scaling doesn't effect results
 	rc_set_cpu_freq(FREQ_1000MHZ);
+	if(dim==-1){
+		multiply_sweep();
+		rc_set_cpu_freq(FREQ_ONDEMAND);
+		return 0;
+	}
+	if(dim==-2){
+		solve_sweep();
+		rc_set_cpu_freq(FREQ_ONDEMAND);
+		return 0;
+	}
+	if(dim==-3){
+		eig_sweep();
+		rc_set_cpu_freq(FREQ_ONDEMAND);
+		return 0;
+	}
+	if(dim==-4){
+		precision_sweep();
+		rc_set_cpu_freq(FREQ_ONDEMAND);
+		return 0;
+	}
+	if(dim==-5){
+		fused_sweep();
+		rc_set_cpu_freq(FREQ_ONDEMAND);
+		return 0;
+	}
+	if(dim==-6){
+		fixed_sweep();
+		rc_set_cpu_freq(FREQ_ONDEMAND);
+		return 0;
+	}
 	printf("Starting\n");
 	
 	// create a random nxn matrix for later use
@@ -153,7 +805,17 @@ int main(int argc, char *argv[]){
 	diff = (t2-t1-TIMER_DELAY);
 	printf("%10lldus Time to do QR decomposition\n", diff/1000);
 
-	// do a QR decomposition on A
+	// Cholesky of the symmetric positive definite matrix AA'+nI
+	rc_matrix_transpose(A,&AA);
+	rc_multiply_matrices(A,AA,&B);
+	for(c=0;c<dim;c++) B.d[c][c] += dim;
+	t1 = TIMER;
+	rc_cholesky_decomp(&B);
+	t2 = TIMER;
+	diff = (t2-t1-TIMER_DELAY);
+	printf("%10lldus Time to do Cholesky decomposition\n", diff/1000);
+
+	// solve a linear system
 	rc_alloc_vector(&x,dim);
 	t1 = TIMER;
 	rc_lin_system_solve(A,b,&x);
@@ -0,0 +1,289 @@
+/*******************************************************************************
+* rc_benchmark_c2d.c
+*
+* Checks the matrix exponential and the exact discretization methods and times
+* re-discretizing a controller in place as if the loop rate had changed.
+*
+* rc_expm_ws and rc_expm_ws_d are compared against the closed form exponential
+* of a rotation, both for a small angle and for a large one which needs many
+* squarings, and of a non-normal Jordan block. A lightly damped resonance just
+* below the Nyquist frequency is then discretized with ZOH, FOH, matched
+* pole-zero and rc_c2d_tustin. The ZOH filter's step response should match
+* the continuous one exactly at every sample while Tustin's drifts in phase,
+* and every method should keep unity DC gain. FOH is also checked on a state
+* space integrator driven by a ramp, which it reproduces exactly.
+*
+* malloc and friends are wrapped as in rc_benchmark_kalman so any allocation
+* made while re-discretizing is counted. This needs glibc. No cape hardware is
+* used so this also runs on an ordinary Linux PC.
+*******************************************************************************/
+
+#include "../../libraries/rc_usefulincludes.h"
+#include "../../libraries/roboticscape.h"
+
+#define TIMER		rc_nanos_thread_time()
+#define DT			0.01f	// 100hz, so nyquist is 50hz
+#define DT_FAST		0.005f	// rate the loop switches to and from
+#define WN			(2.0*M_PI*40.0)	// resonance in rad/s
+#define ZETA		0.05	// damping ratio
+#define STEPS		200		// samples of step response to compare
+#define REPEATS		10000
+#define WS_BYTES	8192
+
+#define LEAN_MAX	0.3f
+
+// glibc's own allocator entry points, used by the wrappers below
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void  __libc_free(void* ptr);
+
+static int counting = 0;
+static long allocs = 0;
+
+/*******************************************************************************
+* allocator wrappers
+*
+* Definitions in the executable take precedence over libc for every shared
+* library it loads, including libroboticscape, so these see all of its calls.
+*******************************************************************************/
+void* malloc(size_t size){
+	if(counting) allocs++;
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size){
+	if(counting) allocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size){
+	if(counting) allocs++;
+	return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size){
+	if(counting) allocs++;
+	*ptr = __libc_memalign(alignment, size);
+	return (*ptr==NULL) ? ENOMEM : 0;
+}
+
+void free(void* ptr){
+	__libc_free(ptr);
+}
+/*******************************************************************************
+* double expm_err_d(rc_matrix_d_t A, rc_matrix_d_t X, rc_workspace_t* w)
+*
+* Largest difference between rc_expm_ws_d(A) and the known exponential X.
+*******************************************************************************/
+double expm_err_d(rc_matrix_d_t A, rc_matrix_d_t X, rc_workspace_t* w){
+	int i,j;
+	double err = 0.0;
+	rc_matrix_d_t E = rc_empty_matrix_d();
+	rc_expm_ws_d(A, &E, w);
+	for(i=0;i<A.rows;i++){
+		for(j=0;j<A.cols;j++) if(!(fabs(E.d[i][j]-X.d[i][j])<=err)) err = fabs(E.d[i][j]-X.d[i][j]);
+	}
+	rc_free_matrix_d(&E);
+	return err;
+}
+
+/*******************************************************************************
+* float expm_err(rc_matrix_d_t A, rc_matrix_d_t X, rc_workspace_t* w)
+*
+* Same as expm_err_d for the float rc_expm_ws.
+*******************************************************************************/
+float expm_err(rc_matrix_d_t A, rc_matrix_d_t X, rc_workspace_t* w){
+	int i,j;
+	float err = 0.0f;
+	rc_matrix_t Af = rc_empty_matrix();
+	rc_matrix_t E = rc_empty_matrix();
+	rc_matrix_double_to_float(A, &Af);
+	rc_expm_ws(Af, &E, w);
+	for(i=0;i<A.rows;i++){
+		for(j=0;j<A.cols;j++) if(!(fabs(E.d[i][j]-X.d[i][j])<=err)) err = fabs(E.d[i][j]-X.d[i][j]);
+	}
+	rc_free_matrix(&Af);
+	rc_free_matrix(&E);
+	return err;
+}
+
+/*******************************************************************************
+* void check_expm(const char* name, rc_matrix_d_t A, rc_matrix_d_t X, rc_workspace_t* w)
+*
+* Prints the float and double error of e^A against X.
+*******************************************************************************/
+void check_expm(const char* name, rc_matrix_d_t A, rc_matrix_d_t X, rc_workspace_t* w){
+	printf("%-24s %10.2e %10.2e\n", name, expm_err(A,X,w), expm_err_d(A,X,w));
+	return;
+}
+
+/*******************************************************************************
+* double step_response(double t)
+*
+* Continuous time unit step response of WN^2/(s^2+2*ZETA*WN*s+WN^2).
+*******************************************************************************/
+double step_response(double t){
+	double wd = WN*sqrt(1.0-ZETA*ZETA);
+	return 1.0 - exp(-ZETA*WN*t)*(cos(wd*t) + ZETA/sqrt(1.0-ZETA*ZETA)*sin(wd*t));
+}
+
+/*******************************************************************************
+* void check_filter(const char* name, rc_filter_t* f)
+*
+* Prints the DC gain of f and the largest error of its step response against
+* the continuous one at each sample.
+*******************************************************************************/
+void check_filter(const char* name, rc_filter_t* f){
+	int i;
+	float y, err = 0.0f, num = 0.0f, den = 0.0f;
+	for(i=0;i<=f->order;i++){
+		num += f->num.d[i];
+		den += f->den.d[i];
+	}
+	rc_reset_filter(f);
+	for(i=0;i<STEPS;i++){
+		// a step arriving at sample 0 is held from t=0, so sample i is t=i*dt
+		y = rc_march_filter(f, 1.0f);
+		if(fabs(y-step_response(i*f->dt))>err) err = fabs(y-step_response(i*f->dt));
+	}
+	printf("%-24s %10.6f %10.2e\n", name, num/den, err);
+	return;
+}
+
+int main(){
+	int i;
+	float u, y, err;
+	double c, s;
+	uint64_t t1, t2;
+	long ws_allocs, tustin_allocs;
+	float num_c[] = {(float)(WN*WN)};
+	float den_c[] = {1.0f, (float)(2.0*ZETA*WN), (float)(WN*WN)};
+	rc_vector_t num = rc_empty_vector();
+	rc_vector_t den = rc_empty_vector();
+	rc_matrix_d_t A = rc_empty_matrix_d();
+	rc_matrix_d_t X = rc_empty_matrix_d();
+	rc_matrix_t Ac = rc_empty_matrix();
+	rc_matrix_t Bc = rc_empty_matrix();
+	rc_matrix_t Cc = rc_empty_matrix();
+	rc_matrix_t Dc = rc_empty_matrix();
+	rc_filter_t f = rc_empty_filter();
+	rc_ss_t ss = rc_empty_ss();
+	rc_workspace_t w = rc_empty_workspace();
+
+	if(rc_alloc_workspace(&w, WS_BYTES)){
+		fprintf(stderr,"failed to allocate workspace\n");
+		return -1;
+	}
+	rc_vector_from_array(&num, num_c, 1);
+	rc_vector_from_array(&den, den_c, 3);
+
+	// rotation by angle t has exponential [cos t, sin t; -sin t, cos t]
+	printf("\nmatrix exponential         float     double max error\n");
+	rc_matrix_zeros_d(&A, 2, 2);
+	rc_matrix_zeros_d(&X, 2, 2);
+	c = 0.3;
+	A.d[0][1] = c;
+	A.d[1][0] = -c;
+	X.d[0][0] = X.d[1][1] = cos(c);
+	X.d[0][1] = sin(c);
+	X.d[1][0] = -sin(c);
+	check_expm("rotation by 0.3rad", A, X, &w);
+	c = 50.0;
+	A.d[0][1] = c;
+	A.d[1][0] = -c;
+	X.d[0][0] = X.d[1][1] = cos(c);
+	X.d[0][1] = sin(c);
+	X.d[1][0] = -sin(c);
+	check_expm("rotation by 50rad", A, X, &w);
+	// jordan block s*[-1 1; 0 -1] has exponential e^-s [1 s; 0 1]
+	s = 4.0;
+	A.d[0][0] = A.d[1][1] = -s;
+	A.d[0][1] = s;
+	A.d[1][0] = 0.0;
+	X.d[0][0] = X.d[1][1] = exp(-s);
+	X.d[0][1] = s*exp(-s);
+	X.d[1][0] = 0.0;
+	check_expm("jordan block, s=4", A, X, &w);
+
+	// resonance at 40hz sampled at 100hz
+	printf("\n%.0fhz resonance at %.0fhz     DC gain  max step response error\n", \
+						WN/(2.0*M_PI), 1.0f/DT);
+	rc_c2d_ws(&f, num, den, DT, RC_C2D_ZOH, &w);
+	check_filter("zero-order hold", &f);
+	rc_c2d_ws(&f, num, den, DT, RC_C2D_FOH, &w);
+	check_filter("first-order hold", &f);
+	rc_c2d_ws(&f, num, den, DT, RC_C2D_MATCHED, &w);
+	check_filter("matched pole-zero", &f);
+	rc_c2d_tustin(&f, num, den, DT, WN);
+	check_filter("tustin, prewarped at wn", &f);
+
+	// integrator driven by u=t, FOH should give exactly y=t^2/2
+	rc_matrix_zeros(&Ac, 1, 1);
+	rc_identity_matrix(&Bc, 1);
+	rc_identity_matrix(&Cc, 1);
+	rc_ss_c2d_ws(&ss, Ac, Bc, Cc, Dc, DT, RC_C2D_FOH, &w);
+	err = 0.0f;
+	for(i=0;i<STEPS;i++){
+		u = i*DT;
+		rc_march_ss(&ss, &u, &y);
+		if(fabsf(y-0.5f*u*u)>err) err = fabsf(y-0.5f*u*u);
+	}
+	printf("%-24s %10.2e max error integrating a ramp\n", "state-space FOH", err);
+
+	// switch the loop rate back and forth with everything already allocated
+	rc_c2d_ws(&f, num, den, DT, RC_C2D_ZOH, &w);
+	counting = 1;
+	allocs = 0;
+	t1 = TIMER;
+	for(i=0;i<REPEATS;i++){
+		rc_c2d_ws(&f, num, den, (i&1) ? DT : DT_FAST, RC_C2D_ZOH, &w);
+	}
+	t2 = TIMER;
+	counting = 0;
+	ws_allocs = allocs;
+	printf("\nre-discretizing between %.0fhz and %.0fhz\n", 1.0f/DT, 1.0f/DT_FAST);
+	printf("%10lldns per rc_c2d_ws ZOH, %ld allocations\n", (t2-t1)/REPEATS, ws_allocs);
+	counting = 1;
+	allocs = 0;
+	t1 = TIMER;
+	for(i=0;i<REPEATS;i++){
+		rc_c2d_ws(&f, num, den, (i&1) ? DT : DT_FAST, RC_C2D_MATCHED, &w);
+	}
+	t2 = TIMER;
+	counting = 0;
+	printf("%10lldns per rc_c2d_ws matched, %ld allocations\n", (t2-t1)/REPEATS, allocs);
+	counting = 1;
+	allocs = 0;
+	t1 = TIMER;
+	for(i=0;i<REPEATS;i++){
+		rc_c2d_tustin(&f, num, den, (i&1) ? DT : DT_FAST, WN);
+	}
+	t2 = TIMER;
+	counting = 0;
+	tustin_allocs = allocs;
+	printf("%10lldns per rc_c2d_tustin, %ld allocations\n", (t2-t1)/REPEATS, tustin_allocs);
+	counting = 1;
+	allocs = 0;
+	t1 = TIMER;
+	for(i=0;i<REPEATS;i++){
+		rc_ss_c2d_ws(&ss, Ac, Bc, Cc, Dc, (i&1) ? DT : DT_FAST, RC_C2D_FOH, &w);
+	}
+	t2 = TIMER;
+	counting = 0;
+	printf("%10lldns per rc_ss_c2d_ws FOH, %ld allocations\n", (t2-t1)/REPEATS, allocs);
+	printf("%10d bytes of workspace used at most\n", (int)w.peak);
+
+	rc_free_filter(&f);
+	rc_free_ss(&ss);
+	rc_free_workspace(&w);
+	rc_free_vector(&num);
+	rc_free_vector(&den);
+	rc_free_matrix_d(&A);
+	rc_free_matrix_d(&X);
+	rc_free_matrix(&Ac);
+	rc_free_matrix(&Bc);
+	rc_free_matrix(&Cc);
+	return 0;
+}
@@ -0,0 +1,206 @@
+/*******************************************************************************
+* rc_benchmark_fft.c
+*
+* Checks rc_fft_real against a direct double precision DFT, times it at a few
+* sizes, and then runs the streaming Welch estimator the way a robot would.
+* The main thread plays the control loop and pushes simulated 1khz gyro samples
+* with rc_psd_push while a background thread calls rc_psd_process. The x axis
+* carries a propeller vibration tone and its harmonic sits on the y axis, on
+* top of white noise on all three. The power found under each peak and the
+* noise floor are compared with what was put in. Last it frees estimators
+* that were never allocated, already freed, failed to allocate or are being
+* reallocated, and checks each one is left empty. No cape hardware is used so
+* this also runs on an ordinary Linux PC.
+*******************************************************************************/
+
+#include "../../libraries/rc_usefulincludes.h"
+#include "../../libraries/roboticscape.h"
+
+#define TIMER		rc_nanos_thread_time()
+#define REPEATS		10000
+#define FS			1000.0f	// gyro sample rate, hz
+#define N			1024	// samples per welch segment
+#define SECONDS		60		// of simulated flight
+#define BURST		50		// samples pushed between sleeps
+#define TONE_HZ		140.625	// lands exactly on bin 144
+#define TONE_AMP	0.2		// rad/s
+#define NOISE		0.01	// rad/s standard deviation
+#define PEAK_BINS	3		// bins either side of a peak to sum
+
+typedef struct shared_t{
+	rc_psd_t psd;
+	int running;		// cleared by the main thread when it's done pushing
+	uint64_t ns;		// consumer thread cpu time spent processing
+} shared_t;
+
+// gaussian noise from Box-Muller
+double randn(){
+	double u1 = (rand()+1.0)/(RAND_MAX+2.0);
+	double u2 = rand()/(RAND_MAX+1.0);
+	return sqrt(-2.0*log(u1))*cos(2.0*M_PI*u2);
+}
+
+// background thread, drains the ring buffer every few milliseconds
+void* consumer(void* ptr){
+	shared_t* s = (shared_t*)ptr;
+	uint64_t t1, ns = 0;
+	int last = 0;
+	while(!last){
+		last = !__atomic_load_n(&s->running, __ATOMIC_ACQUIRE);
+		t1 = TIMER;
+		rc_psd_process(&s->psd);
+		ns += TIMER-t1;
+		rc_usleep(5000);
+	}
+	s->ns = ns;
+	return NULL;
+}
+
+// sum of the density over bins around bin k times the bin width
+float peak_power(float* psd, int k){
+	int i;
+	float sum = 0.0f;
+	for(i=k-PEAK_BINS;i<=k+PEAK_BINS;i++) sum += psd[i];
+	return sum*FS/N;
+}
+
+// mean density between two bins, away from any peaks
+float floor_density(float* psd, int k1, int k2){
+	int i;
+	float sum = 0.0f;
+	for(i=k1;i<k2;i++) sum += psd[i];
+	return sum/(k2-k1);
+}
+
+// 1 if p is back to the state rc_empty_psd gives, 0 otherwise
+int psd_is_empty(rc_psd_t* p){
+	return !p->initialized && p->seg==NULL && p->window==NULL && \
+			p->hist==NULL && p->acc==NULL && !p->plan.initialized;
+}
+
+// frees estimators in every state they can be in, returns how many weren't
+// left empty or returned an error
+int psd_lifecycle(){
+	int fails = 0;
+	rc_psd_t p = rc_empty_psd();
+	// free before alloc
+	if(rc_free_psd(&p) || !psd_is_empty(&p)) fails++;
+	// alloc then double free
+	if(rc_alloc_psd(&p, 3, N, N/2, FS, 1024)) fails++;
+	if(rc_free_psd(&p) || !psd_is_empty(&p)) fails++;
+	if(rc_free_psd(&p) || !psd_is_empty(&p)) fails++;
+	// a failed alloc, n is not a power of two, then free
+	if(rc_alloc_psd(&p, 3, N+1, N/2, FS, 1024)==0) fails++;
+	if(rc_free_psd(&p) || !psd_is_empty(&p)) fails++;
+	// realloc over an existing estimator frees the old one first
+	if(rc_alloc_psd(&p, 3, N, N/2, FS, 1024)) fails++;
+	if(rc_alloc_psd(&p, 1, N/2, 0, FS, 256)) fails++;
+	if(p.n!=N/2 || p.channels!=1) fails++;
+	if(rc_free_psd(&p) || !psd_is_empty(&p)) fails++;
+	return fails;
+}
+
+int main(){
+	int i, j, k, n;
+	double re, im, err, mag;
+	float* x;
+	double* ref;
+	float sample[BURST][3];
+	float psd[3][N/2+1];
+	uint64_t t1, t2, push_ns = 0;
+	int bin = (int)(TONE_HZ*N/FS+0.5);
+	rc_fft_plan_t plan = rc_empty_fft_plan();
+	pthread_t thread;
+	shared_t s;
+
+	// accuracy against a direct DFT in double
+	x = (float*)malloc(4096*sizeof(float));
+	ref = (double*)malloc(4096*sizeof(double));
+	rc_alloc_fft_plan(&plan, N);
+	for(i=0;i<N;i++) x[i] = ref[i] = rc_get_random_float();
+	rc_fft_real(&plan, x);
+	err = mag = 0.0;
+	for(k=0;k<=N/2;k++){
+		re = im = 0.0;
+		for(j=0;j<N;j++){
+			re += ref[j]*cos(2.0*M_PI*j*k/N);
+			im -= ref[j]*sin(2.0*M_PI*j*k/N);
+		}
+		if(sqrt(re*re+im*im)>mag) mag = sqrt(re*re+im*im);
+		if(k==0) re -= x[0];
+		else if(k==N/2) re -= x[1];
+		else{
+			re -= x[2*k];
+			im -= x[2*k+1];
+		}
+		if(sqrt(re*re+im*im)>err) err = sqrt(re*re+im*im);
+	}
+	printf("\n%d point real FFT\n", N);
+	printf("%10.2e max error against a double precision DFT, relative to largest bin\n", err/mag);
+	rc_fft_real_inverse(&plan, x);
+	err = 0.0;
+	for(i=0;i<N;i++) if(fabs(x[i]-ref[i])>err) err = fabs(x[i]-ref[i]);
+	printf("%10.2e max error after the inverse\n", err);
+
+	// speed at a few sizes
+	printf("\n");
+	for(n=256;n<=4096;n*=4){
+		rc_alloc_fft_plan(&plan, n);
+		for(i=0;i<n;i++) x[i] = rc_get_random_float();
+		t1 = TIMER;
+		for(i=0;i<REPEATS;i++) rc_fft_real(&plan, x);
+		t2 = TIMER;
+		printf("%10lldns per %d point rc_fft_real\n", (t2-t1)/REPEATS, n);
+	}
+
+	// welch estimate of a simulated gyro with a background thread
+	s.psd = rc_empty_psd();
+	if(rc_alloc_psd(&s.psd, 3, N, N/2, FS, 1024)){
+		fprintf(stderr,"failed to allocate psd\n");
+		return -1;
+	}
+	s.running = 1;
+	s.ns = 0;
+	pthread_create(&thread, NULL, consumer, (void*)&s);
+	for(i=0;i<SECONDS*FS;i+=BURST){
+		for(j=0;j<BURST;j++){
+			double t = (i+j)/FS;
+			sample[j][0] = TONE_AMP*sin(2.0*M_PI*TONE_HZ*t) + NOISE*randn();
+			sample[j][1] = TONE_AMP*sin(4.0*M_PI*TONE_HZ*t) + NOISE*randn();
+			sample[j][2] = NOISE*randn();
+		}
+		t1 = TIMER;
+		for(j=0;j<BURST;j++) rc_psd_push(&s.psd, sample[j]);
+		t2 = TIMER;
+		push_ns += t2-t1;
+		rc_usleep(1000);
+	}
+	__atomic_store_n(&s.running, 0, __ATOMIC_RELEASE);
+	pthread_join(thread, NULL);
+	for(i=0;i<3;i++) rc_psd_get(&s.psd, i, psd[i]);
+	printf("\nwelch PSD, %d seconds of 3 axis gyro at %.0fhz, %d point segments\n", \
+						SECONDS, FS, N);
+	printf("%10lldns per rc_psd_push in the control loop\n", push_ns/(SECONDS*(int)FS));
+	printf("%10lldus per segment of all 3 axes in the background thread\n", \
+						s.ns/s.psd.segments/1000);
+	printf("%10d segments averaged, %u samples dropped\n", s.psd.segments, s.psd.dropped);
+	printf("\n                 expected   measured\n");
+	printf("x %6.1fhz power %10.4f %10.4f\n", bin*FS/N, \
+			0.5*TONE_AMP*TONE_AMP, peak_power(psd[0], bin));
+	printf("y %6.1fhz power %10.4f %10.4f\n", 2*bin*FS/N, \
+			0.5*TONE_AMP*TONE_AMP, peak_power(psd[1], 2*bin));
+	printf("z noise floor   %10.2e %10.2e\n", 2.0*NOISE*NOISE/FS, \
+			floor_density(psd[2], 10, N/2-10));
+
+	rc_free_psd(&s.psd);
+	rc_free_fft_plan(&plan);
+	free(x);
+	free(ref);
+
+	// freeing in every state, the expected errors from the failed alloc
+	// are printed to stderr
+	k = psd_lifecycle();
+	printf("\n%10d estimators not left empty by rc_free_psd\n", k);
+	if(k) return -1;
+	return 0;
+}
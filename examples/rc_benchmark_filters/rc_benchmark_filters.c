@@ -0,0 +1,425 @@
+/*******************************************************************************
+* rc_benchmark_filters.c
+*
+* Compares the time taken to filter a multi-channel signal, like the 9 axes of
+* the IMU, with one rc_filter_t per channel against a single rc_filter_bank_t
+* which marches all channels together with SIMD instructions. Both use the
+* same Butterworth low pass design and the largest difference between their
+* outputs is printed to show they agree.
+*
+* It then times the rc_balance inner loop controller D1 marched with
+* rc_march_filter against the same controller compiled in with
+* RC_STATIC_FILTER, as an rc_tdf2_filter_t and with rc_march_filter_block in
+* blocks of BLOCK_SIZE, and counts any steps where the static filter's output
+* differs.
+*
+* An 8th order Butterworth low pass is timed as one rc_filter_t polynomial and
+* as an rc_sos_filter_t cascade of second order sections.
+*
+* Finally it compares a long moving average made by rc_moving_average, which
+* keeps a running sum, against the same FIR filter built coefficient by
+* coefficient with rc_alloc_filter.
+*
+* Then a Butterworth low pass and a PID controller are converted to fixed
+* point and run on simulated raw 16-bit gyro counts, comparing speed and the
+* largest difference in counts from the floating point filters.
+*
+* Last, all three rc_balance controllers with their gains, saturation and soft
+* start are combined into one rc_ss_t with rc_ss_from_filters. Stepping that
+* once is timed against marching the three filters separately, along with the
+* largest difference in output and the steps where saturation differs.
+*******************************************************************************/
+
+#include "../../libraries/rc_usefulincludes.h"
+#include "../../libraries/roboticscape.h"
+
+#define DEFAULT_CHANNELS	9
+#define DEFAULT_ORDER		2
+#define MAX_CHANNELS		64
+#define MAX_ORDER			8
+#define SOS_ORDER			8
+#define STEPS				100000
+#define INPUT_ROWS			1000
+#define DT					0.01f
+#define WC					(2.0f*M_PI*5.0f)
+
+// inner loop controller from rc_balance's balance_config.h
+#define D1_ORDER			2
+#define D1_NUM				{-6.289, 11.910, -5.634 }
+#define D1_DEN				{ 1.000, -1.702,  0.702 }
+#define D1_GAIN				0.8f
+
+// outer loop and steering controllers from balance_config.h
+#define D2_ORDER			1
+#define D2_NUM				{ 0.3858, -0.3853 }
+#define D2_DEN				{ 1.0000, -0.9277 }
+#define D2_GAIN				0.7f
+#define THETA_REF_MAX		0.37f
+#define D3_KP				1.0f
+#define D3_KI				0.3f
+#define D3_KD				0.05f
+#define STEERING_INPUT_MAX	0.5f
+#define SOFT_START_SEC		0.7f
+
+// samples in the moving average test
+#define MA_SAMPLES			100
+
+// PID gains for the fixed point test, with raw counts in and out
+#define PID_KP				0.5f
+#define PID_KI				0.2f
+#define PID_KD				0.01f
+#define PID_LIMIT			20000.0f
+
+// samples per call to rc_march_filter_block, divides INPUT_ROWS and STEPS
+#define BLOCK_SIZE			10
+
+#define TIMER rc_nanos_thread_time()
+
+RC_STATIC_FILTER(D1_march, D1_ORDER, D1_NUM, D1_DEN)
+
+// printed if some invalid argument was given
+void print_usage(){
+	printf("\n");
+	printf("-c {channels}  number of channels, default %d\n", DEFAULT_CHANNELS);
+	printf("-o {order}     filter order, default %d\n", DEFAULT_ORDER);
+	printf("-h             print this help message\n");
+	printf("\n");
+}
+
+int main(int argc, char *argv[]){
+	int c, i, j;
+	int channels = DEFAULT_CHANNELS;
+	int order = DEFAULT_ORDER;
+	int mismatch = 0;
+	uint64_t t1, t2, t_single, t_bank, t_generic, t_static, t_tdf2, t_block;
+	static float block_in[INPUT_ROWS], block_out[INPUT_ROWS];
+	float D1_num[] = D1_NUM;
+	float D1_den[] = D1_DEN;
+	float u1, u2;
+	uint64_t t_fir, t_ma, t_poly, t_sos;
+	rc_filter_t poly = rc_empty_filter();
+	rc_sos_filter_t sos = rc_empty_sos_filter();
+	float max_ma_diff = 0.0f;
+	rc_vector_t ma_num = rc_empty_vector();
+	rc_vector_t ma_den = rc_empty_vector();
+	static int16_t raw[INPUT_ROWS];
+	int32_t q_out;
+	uint64_t t_float, t_fixed;
+	float max_q_diff;
+	float out[MAX_CHANNELS], single[MAX_CHANNELS];
+	static float input[INPUT_ROWS][MAX_CHANNELS];
+	float diff, max_diff = 0.0f;
+	rc_filter_t filters[MAX_CHANNELS];
+	rc_filter_bank_t bank = rc_empty_filter_bank();
+	rc_filter_t D1_generic = rc_empty_filter();
+	rc_filter_t D1_static = rc_empty_filter();
+	rc_tdf2_filter_t D1_tdf2 = rc_empty_tdf2_filter();
+	rc_filter_t fir = rc_empty_filter();
+	rc_filter_t ma = rc_empty_filter();
+	rc_filter_t lp = rc_empty_filter();
+	rc_filter_t pid = rc_empty_filter();
+	rc_fixed_filter_t lp_i16 = rc_empty_fixed_filter();
+	rc_fixed_filter_t pid_i32 = rc_empty_fixed_filter();
+	float D2_num[] = D2_NUM;
+	float D2_den[] = D2_DEN;
+	float bal_in[3], bal_out[3];
+	uint64_t t_filters, t_ss;
+	int sat_mismatch;
+	rc_filter_t bal[3];
+	rc_ss_t bal_ss = rc_empty_ss();
+
+	// parse arguments
+	opterr = 0;
+	while ((c = getopt(argc, argv, "c:o:h")) != -1){
+		switch (c){
+		case 'c':
+			channels = atoi(optarg);
+			if(channels<1 || channels>MAX_CHANNELS){
+				printf("channels must be between 1 and %d\n", MAX_CHANNELS);
+				return -1;
+			}
+			break;
+		case 'o':
+			order = atoi(optarg);
+			if(order<1 || order>MAX_ORDER){
+				printf("order must be between 1 and %d\n", MAX_ORDER);
+				return -1;
+			}
+			break;
+		case 'h':
+			print_usage();
+			return 0;
+		default:
+			printf("inavlid argument\n");
+			print_usage();
+			return -1;
+		}
+	}
+
+	// make one filter per channel and a bank with the same design
+	for(j=0;j<channels;j++){
+		filters[j] = rc_empty_filter();
+		if(rc_butterworth_lowpass(&filters[j], order, DT, WC)){
+			printf("failed to make filter\n");
+			return -1;
+		}
+	}
+	if(rc_filter_bank_from_filter(&bank, channels, filters[0])){
+		printf("failed to make filter bank\n");
+		return -1;
+	}
+
+	// set clock speed to 1000mhz to make sure scaling doesn't effect results
+	rc_set_cpu_freq(FREQ_1000MHZ);
+	printf("\n%d channels, order %d, %d steps\n\n", channels, order, STEPS);
+
+	// precompute a table of inputs so only the filters are timed
+	for(i=0;i<INPUT_ROWS;i++){
+		for(j=0;j<channels;j++) input[i][j] = sinf(0.01f*i*(j+1)) + 0.1f*j;
+	}
+
+	// one rc_filter_t per channel
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++){
+		for(j=0;j<channels;j++){
+			single[j] = rc_march_filter(&filters[j], input[i%INPUT_ROWS][j]);
+		}
+	}
+	t2 = TIMER;
+	t_single = t2-t1;
+
+	// all channels in the bank
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++) rc_march_filter_bank(&bank, input[i%INPUT_ROWS], out);
+	t2 = TIMER;
+	t_bank = t2-t1;
+
+	// check both give the same answer
+	for(j=0;j<channels;j++) rc_reset_filter(&filters[j]);
+	rc_reset_filter_bank(&bank);
+	for(i=0;i<INPUT_ROWS;i++){
+		for(j=0;j<channels;j++){
+			single[j] = rc_march_filter(&filters[j], input[i][j]);
+		}
+		rc_march_filter_bank(&bank, input[i], out);
+		for(j=0;j<channels;j++){
+			diff = fabsf(out[j]-single[j]);
+			if(diff>max_diff) max_diff = diff;
+		}
+	}
+
+	printf("%10lldns per step with %d rc_filter_t\n", t_single/STEPS, channels);
+	printf("%10lldns per step with one rc_filter_bank_t\n", t_bank/STEPS);
+	printf("%10.2fx speedup\n", (float)t_single/(float)t_bank);
+	printf("%10.2e max difference between outputs\n", max_diff);
+
+	// balance controller D1, saturated with soft start just like rc_balance
+	rc_alloc_filter_from_arrays(&D1_generic, D1_ORDER, DT, D1_num, D1_den);
+	rc_alloc_filter_from_arrays(&D1_static, D1_ORDER, DT, D1_num, D1_den);
+	rc_enable_saturation(&D1_generic, -1.0, 1.0);
+	rc_enable_saturation(&D1_static, -1.0, 1.0);
+	rc_enable_soft_start(&D1_generic, 0.7);
+	rc_enable_soft_start(&D1_static, 0.7);
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++) rc_march_filter(&D1_generic, input[i%INPUT_ROWS][0]);
+	t2 = TIMER;
+	t_generic = t2-t1;
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++) D1_march(&D1_static, input[i%INPUT_ROWS][0]);
+	t2 = TIMER;
+	t_static = t2-t1;
+	rc_reset_filter(&D1_generic);
+	rc_tdf2_filter_from_filter(&D1_tdf2, D1_generic);
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++) rc_march_tdf2_filter(&D1_tdf2, input[i%INPUT_ROWS][0]);
+	t2 = TIMER;
+	t_tdf2 = t2-t1;
+	for(i=0;i<INPUT_ROWS;i++) block_in[i] = input[i][0];
+	t1 = TIMER;
+	for(i=0;i<STEPS;i+=BLOCK_SIZE){
+		rc_march_filter_block(&D1_generic, block_in+i%INPUT_ROWS, \
+						block_out+i%INPUT_ROWS, BLOCK_SIZE);
+	}
+	t2 = TIMER;
+	t_block = t2-t1;
+	// same inputs again from reset, outputs should match exactly
+	rc_reset_filter(&D1_generic);
+	rc_reset_filter(&D1_static);
+	for(i=0;i<STEPS;i++){
+		u1 = rc_march_filter(&D1_generic, input[i%INPUT_ROWS][0]);
+		u2 = D1_march(&D1_static, input[i%INPUT_ROWS][0]);
+		if(u1!=u2) mismatch++;
+	}
+
+	printf("\nbalance controller D1\n");
+	printf("%10lldns per step with rc_march_filter\n", t_generic/STEPS);
+	printf("%10lldns per step with RC_STATIC_FILTER\n", t_static/STEPS);
+	printf("%10.2fx speedup\n", (float)t_generic/(float)t_static);
+	printf("%10d steps with different outputs\n", mismatch);
+	printf("%10lldns per step with rc_tdf2_filter_t\n", t_tdf2/STEPS);
+	printf("%10lldns per step with rc_march_filter_block, %d per block\n", \
+						t_block/STEPS, BLOCK_SIZE);
+
+	// high order low pass, the cutoff is high enough for the polynomial to be
+	// stable in float so both are doing real work
+	rc_butterworth_lowpass(&poly, SOS_ORDER, DT, WC);
+	rc_butterworth_lowpass_sos(&sos, SOS_ORDER, DT, WC);
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++) rc_march_filter(&poly, input[i%INPUT_ROWS][0]);
+	t2 = TIMER;
+	t_poly = t2-t1;
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++) rc_march_sos_filter(&sos, input[i%INPUT_ROWS][0]);
+	t2 = TIMER;
+	t_sos = t2-t1;
+	printf("\norder %d butterworth low pass\n", SOS_ORDER);
+	printf("%10lldns per step with rc_filter_t\n", t_poly/STEPS);
+	printf("%10lldns per step with rc_sos_filter_t\n", t_sos/STEPS);
+
+	// moving average with a running sum against the equivalent FIR filter
+	rc_vector_ones(&ma_num, MA_SAMPLES);
+	rc_vector_times_scalar(&ma_num, 1.0f/MA_SAMPLES);
+	rc_vector_zeros(&ma_den, MA_SAMPLES);
+	ma_den.d[0] = 1.0f;
+	rc_alloc_filter(&fir, ma_num, ma_den, 1);
+	rc_moving_average(&ma, MA_SAMPLES, 1);
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++) rc_march_filter(&fir, input[i%INPUT_ROWS][0]);
+	t2 = TIMER;
+	t_fir = t2-t1;
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++) rc_march_filter(&ma, input[i%INPUT_ROWS][0]);
+	t2 = TIMER;
+	t_ma = t2-t1;
+	for(i=0;i<STEPS;i++){
+		diff = fabsf(rc_march_filter(&fir, input[i%INPUT_ROWS][0]) - \
+					rc_march_filter(&ma, input[i%INPUT_ROWS][0]));
+		if(diff>max_ma_diff) max_ma_diff = diff;
+	}
+
+	printf("\n%d sample moving average\n", MA_SAMPLES);
+	printf("%10lldns per step as a FIR filter\n", t_fir/STEPS);
+	printf("%10lldns per step with rc_moving_average\n", t_ma/STEPS);
+	printf("%10.2fx speedup\n", (float)t_fir/(float)t_ma);
+	printf("%10.2e max difference between outputs\n", max_ma_diff);
+
+	// fixed point, raw gyro counts are a slow sine wave plus noise
+	for(i=0;i<INPUT_ROWS;i++){
+		raw[i] = 8000.0f*sinf(2.0f*M_PI*i/INPUT_ROWS) + 1000.0f*input[i][0];
+	}
+	rc_butterworth_lowpass(&lp, order, DT, WC);
+	rc_fixed_filter_from_filter(&lp_i16, lp, 15);
+	rc_pid_filter(&pid, PID_KP, PID_KI, PID_KD, 4*DT, DT);
+	rc_enable_saturation(&pid, -PID_LIMIT, PID_LIMIT);
+	rc_fixed_filter_from_filter(&pid_i32, pid, 31);
+	printf("\nfixed point, raw 16-bit counts\n");
+	// low pass
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++) rc_march_filter(&lp, raw[i%INPUT_ROWS]);
+	t2 = TIMER;
+	t_float = t2-t1;
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++) rc_march_fixed_filter(&lp_i16, raw[i%INPUT_ROWS]);
+	t2 = TIMER;
+	t_fixed = t2-t1;
+	rc_reset_filter(&lp);
+	rc_reset_fixed_filter(&lp_i16);
+	max_q_diff = 0.0f;
+	for(i=0;i<STEPS;i++){
+		q_out = rc_march_fixed_filter(&lp_i16, raw[i%INPUT_ROWS]);
+		diff = fabsf(rc_march_filter(&lp, raw[i%INPUT_ROWS])-q_out);
+		if(diff>max_q_diff) max_q_diff = diff;
+	}
+	printf("%10lldns per step order %d low pass float\n", t_float/STEPS, order);
+	printf("%10lldns per step order %d low pass int16\n", t_fixed/STEPS, order);
+	printf("%10.2f counts max difference\n", max_q_diff);
+	// pid
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++) rc_march_filter(&pid, raw[i%INPUT_ROWS]);
+	t2 = TIMER;
+	t_float = t2-t1;
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++) rc_march_fixed_filter(&pid_i32, raw[i%INPUT_ROWS]);
+	t2 = TIMER;
+	t_fixed = t2-t1;
+	rc_reset_filter(&pid);
+	rc_reset_fixed_filter(&pid_i32);
+	max_q_diff = 0.0f;
+	for(i=0;i<STEPS;i++){
+		q_out = rc_march_fixed_filter(&pid_i32, raw[i%INPUT_ROWS]);
+		diff = fabsf(rc_march_filter(&pid, raw[i%INPUT_ROWS])-q_out);
+		if(diff>max_q_diff) max_q_diff = diff;
+	}
+	printf("%10lldns per step PID float\n", t_float/STEPS);
+	printf("%10lldns per step PID int32\n", t_fixed/STEPS);
+	printf("%10.2f counts max difference\n", max_q_diff);
+
+	// rc_balance's D1, D2 and D3 set up the same way rc_balance does
+	for(j=0;j<3;j++) bal[j] = rc_empty_filter();
+	rc_alloc_filter_from_arrays(&bal[0], D1_ORDER, DT, D1_num, D1_den);
+	bal[0].gain = D1_GAIN;
+	rc_enable_saturation(&bal[0], -1.0, 1.0);
+	rc_enable_soft_start(&bal[0], SOFT_START_SEC);
+	rc_alloc_filter_from_arrays(&bal[1], D2_ORDER, DT, D2_num, D2_den);
+	bal[1].gain = D2_GAIN;
+	rc_enable_saturation(&bal[1], -THETA_REF_MAX, THETA_REF_MAX);
+	rc_enable_soft_start(&bal[1], SOFT_START_SEC);
+	rc_pid_filter(&bal[2], D3_KP, D3_KI, D3_KD, 4*DT, DT);
+	rc_enable_saturation(&bal[2], -STEERING_INPUT_MAX, STEERING_INPUT_MAX);
+	if(rc_ss_from_filters(&bal_ss, bal, 3)){
+		printf("failed to make state-space controller\n");
+		return -1;
+	}
+	// inputs are large enough to push every controller into saturation
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++){
+		for(j=0;j<3;j++) bal_out[j] = rc_march_filter(&bal[j], 3.0f*input[i%INPUT_ROWS][j]);
+	}
+	t2 = TIMER;
+	t_filters = t2-t1;
+	t1 = TIMER;
+	for(i=0;i<STEPS;i++){
+		for(j=0;j<3;j++) bal_in[j] = 3.0f*input[i%INPUT_ROWS][j];
+		rc_march_ss(&bal_ss, bal_in, bal_out);
+	}
+	t2 = TIMER;
+	t_ss = t2-t1;
+	for(j=0;j<3;j++) rc_reset_filter(&bal[j]);
+	rc_reset_ss(&bal_ss);
+	max_diff = 0.0f;
+	sat_mismatch = 0;
+	for(i=0;i<STEPS;i++){
+		for(j=0;j<3;j++) bal_in[j] = 3.0f*input[i%INPUT_ROWS][j];
+		rc_march_ss(&bal_ss, bal_in, bal_out);
+		for(j=0;j<3;j++){
+			diff = fabsf(rc_march_filter(&bal[j], bal_in[j])-bal_out[j]);
+			if(diff>max_diff) max_diff = diff;
+			if(bal[j].sat_flag!=bal_ss.sat_flag[j]) sat_mismatch++;
+		}
+	}
+	printf("\nbalance controllers D1, D2 and D3\n");
+	printf("%10lldns per step with 3 rc_filter_t\n", t_filters/STEPS);
+	printf("%10lldns per step with one rc_ss_t\n", t_ss/STEPS);
+	printf("%10.2e max difference between outputs\n", max_diff);
+	printf("%10d steps with different saturation\n", sat_mismatch);
+
+	for(j=0;j<3;j++) rc_free_filter(&bal[j]);
+	rc_free_ss(&bal_ss);
+	for(j=0;j<channels;j++) rc_free_filter(&filters[j]);
+	rc_free_filter(&lp);
+	rc_free_filter(&pid);
+	rc_free_fixed_filter(&lp_i16);
+	rc_free_fixed_filter(&pid_i32);
+	rc_free_filter(&poly);
+	rc_free_sos_filter(&sos);
+	rc_free_filter(&fir);
+	rc_free_filter(&ma);
+	rc_free_vector(&ma_num);
+	rc_free_vector(&ma_den);
+	rc_free_filter(&D1_generic);
+	rc_free_filter(&D1_static);
+	rc_free_tdf2_filter(&D1_tdf2);
+	rc_free_filter_bank(&bank);
+	rc_set_cpu_freq(FREQ_ONDEMAND);
+	return 0;
+}
@@ -0,0 +1,260 @@
+/*******************************************************************************
+* rc_benchmark_kalman.c
+*
+* Times rc_kalman_predict and rc_kalman_update for 6, 9 and 12 state filters,
+* the sizes that are useful on board, and checks that they fit in the 5ms
+* period of a 200hz IMU interrupt with lots of room to spare. The model is
+* three independent axes, each a chain of integrators driven by a commanded
+* acceleration with the first state of each axis measured, so 6 states is
+* position and velocity, 9 adds acceleration and 12 adds jerk.
+*
+* A simulated truth is run alongside with process and measurement noise so
+* the estimate error can be printed as a sanity check. The same model is also
+* run through the extended filter with callbacks that just evaluate it, which
+* must give the same estimate as the linear filter.
+*
+* malloc and friends are wrapped as in rc_test_workspace so any allocation
+* made while stepping the filters is counted. This needs glibc. No cape
+* hardware is used so this also runs on an ordinary Linux PC.
+*******************************************************************************/
+
+#include "../../libraries/rc_usefulincludes.h"
+#include "../../libraries/roboticscape.h"
+
+#define TIMER		rc_nanos_thread_time()
+#define STEPS		20000
+#define DT			0.005f	// 200hz
+#define AXES		3
+#define SIZES		3
+const int state_size[SIZES] = {6,9,12};
+#define Q_AMP		0.01f	// process noise is uniform in +-Q_AMP
+#define R_AMP		0.1f	// measurement noise is uniform in +-R_AMP
+// variance of uniform noise in +-a is a^2/3
+#define Q_VAR		(Q_AMP*Q_AMP/3.0f)
+#define R_VAR		(R_AMP*R_AMP/3.0f)
+
+// glibc's own allocator entry points, used by the wrappers below
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void  __libc_free(void* ptr);
+
+static int counting = 0;
+static long allocs = 0;
+
+/*******************************************************************************
+* allocator wrappers
+*
+* Definitions in the executable take precedence over libc for every shared
+* library it loads, including libroboticscape, so these see all of its calls.
+*******************************************************************************/
+void* malloc(size_t size){
+	if(counting) allocs++;
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size){
+	if(counting) allocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size){
+	if(counting) allocs++;
+	return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size){
+	if(counting) allocs++;
+	*ptr = __libc_memalign(alignment, size);
+	return (*ptr==NULL) ? ENOMEM : 0;
+}
+
+void free(void* ptr){
+	__libc_free(ptr);
+}
+
+// model shared with the EKF callbacks through ctx
+typedef struct model_t{
+	rc_matrix_t F;
+	rc_matrix_t G;
+	rc_matrix_t H;
+} model_t;
+
+// EKF model callback, x_next=Fx+Gu with the constant Jacobian F
+int model_f(rc_vector_t x, rc_vector_t u, rc_vector_t* x_next, rc_matrix_t* F, void* ctx){
+	model_t* m = (model_t*)ctx;
+	rc_gemv(1.0f,m->F,x,0.0f,x_next);
+	rc_gemv(1.0f,m->G,u,1.0f,x_next);
+	return rc_duplicate_matrix(m->F,F);
+}
+
+// EKF measurement callback, y=Hx with the constant Jacobian H
+int model_h(rc_vector_t x, rc_vector_t* y, rc_matrix_t* H, void* ctx){
+	model_t* m = (model_t*)ctx;
+	rc_gemv(1.0f,m->H,x,0.0f,y);
+	return rc_duplicate_matrix(m->H,H);
+}
+
+// fills in the integrator chain model with nx states split over AXES axes
+void build_model(model_t* m, int nx){
+	int a, i, k = nx/AXES;
+	rc_matrix_zeros(&m->F,nx,nx);
+	rc_matrix_zeros(&m->G,nx,AXES);
+	rc_matrix_zeros(&m->H,AXES,nx);
+	for(a=0;a<AXES;a++){
+		for(i=0;i<k;i++){
+			m->F.d[a*k+i][a*k+i] = 1.0f;
+			if(i<k-1) m->F.d[a*k+i][a*k+i+1] = DT;
+		}
+		// commanded acceleration drives the velocity state
+		m->G.d[a*k+1][a] = DT;
+		m->H.d[a][a*k] = 1.0f;
+	}
+	return;
+}
+
+int main(){
+	int s, i, j, nx, failures = 0;
+	uint64_t t1, t2, predict, total;
+	long step_allocs;
+	float err, rms, diff, asym;
+	model_t m;
+	rc_kalman_t kf = rc_empty_kalman();
+	rc_kalman_t ekf = rc_empty_kalman();
+	rc_matrix_t Q = rc_empty_matrix();
+	rc_matrix_t R = rc_empty_matrix();
+	rc_matrix_t Pi = rc_empty_matrix();
+	rc_matrix_t U = rc_empty_matrix();
+	rc_matrix_t Y = rc_empty_matrix();
+	rc_matrix_t pos = rc_empty_matrix();
+	rc_vector_t x = rc_empty_vector();
+	rc_vector_t xn = rc_empty_vector();
+	rc_vector_t us = rc_empty_vector();
+	rc_vector_t u = rc_empty_vector();
+	rc_vector_t y = rc_empty_vector();
+	m.F = rc_empty_matrix();
+	m.G = rc_empty_matrix();
+	m.H = rc_empty_matrix();
+
+	printf("%d steps at %.0fhz, %d measured axes\n\n", STEPS, 1.0f/DT, AXES);
+	printf("states  ns/predict  ns/update  %% of 5ms  allocs  rms pos err  ekf diff  P asym\n");
+	for(s=0;s<SIZES;s++){
+		nx = state_size[s];
+		build_model(&m,nx);
+		rc_identity_matrix(&Q,nx);
+		rc_matrix_times_scalar(&Q,Q_VAR);
+		rc_identity_matrix(&R,AXES);
+		rc_matrix_times_scalar(&R,R_VAR);
+		rc_identity_matrix(&Pi,nx);
+		if(rc_alloc_kalman_lin(&kf,m.F,m.G,m.H,Q,R,Pi) || \
+		   rc_alloc_kalman_ekf(&ekf,nx,AXES,AXES,model_f,model_h,&m,Q,R,Pi)){
+			fprintf(stderr,"failed to set up filters\n");
+			return -1;
+		}
+		// simulate the truth first so only the filter is inside the timer,
+		// process noise on every state, slowly varying commands
+		rc_alloc_matrix(&U,STEPS,AXES);
+		rc_alloc_matrix(&Y,STEPS,AXES);
+		rc_alloc_matrix(&pos,STEPS,AXES);
+		rc_vector_zeros(&x,nx);
+		rc_alloc_vector(&xn,nx);
+		for(i=0;i<STEPS;i++){
+			for(j=0;j<AXES;j++) U.d[i][j] = sin(0.001f*i*(j+1));
+			rc_vector_from_array(&us,U.d[i],AXES);
+			rc_gemv(1.0f,m.F,x,0.0f,&xn);
+			rc_gemv(1.0f,m.G,us,1.0f,&xn);
+			for(j=0;j<nx;j++) x.d[j] = xn.d[j] + Q_AMP*rc_get_random_float();
+			for(j=0;j<AXES;j++){
+				pos.d[i][j] = x.d[j*nx/AXES];
+				Y.d[i][j] = pos.d[i][j] + R_AMP*rc_get_random_float();
+			}
+		}
+		// u and y are views of one row at a time so nothing is copied
+		u.len = AXES;
+		u.initialized = 1;
+		y.len = AXES;
+		y.initialized = 1;
+		// predict alone, then predict and update together
+		counting = 1;
+		allocs = 0;
+		t1 = TIMER;
+		for(i=0;i<STEPS;i++){
+			u.d = U.d[i];
+			rc_kalman_predict(&kf,u);
+		}
+		t2 = TIMER;
+		predict = t2-t1;
+		rc_reset_kalman(&kf);
+		t1 = TIMER;
+		for(i=0;i<STEPS;i++){
+			u.d = U.d[i];
+			y.d = Y.d[i];
+			rc_kalman_predict(&kf,u);
+			rc_kalman_update(&kf,y);
+		}
+		t2 = TIMER;
+		total = t2-t1;
+		// extended filter run with the same data, then compare the estimates
+		// and the error against the truth, skipping the initial transient
+		rms = 0.0f;
+		for(i=0;i<STEPS;i++){
+			u.d = U.d[i];
+			y.d = Y.d[i];
+			rc_kalman_predict(&ekf,u);
+			rc_kalman_update(&ekf,y);
+		}
+		counting = 0;
+		step_allocs = allocs;
+		diff = 0.0f;
+		for(j=0;j<nx;j++){
+			err = fabs(kf.x_est.d[j]-ekf.x_est.d[j]);
+			if(err>diff) diff = err;
+		}
+		rc_reset_kalman(&kf);
+		for(i=0;i<STEPS;i++){
+			u.d = U.d[i];
+			y.d = Y.d[i];
+			rc_kalman_predict(&kf,u);
+			rc_kalman_update(&kf,y);
+			if(i<STEPS/10) continue;
+			for(j=0;j<AXES;j++){
+				err = kf.x_est.d[j*nx/AXES]-pos.d[i][j];
+				rms += err*err;
+			}
+		}
+		rms = sqrt(rms/((STEPS-STEPS/10)*AXES));
+		asym = 0.0f;
+		for(i=0;i<nx;i++){
+			for(j=0;j<nx;j++){
+				err = fabs(kf.P.d[i][j]-kf.P.d[j][i]);
+				if(err>asym) asym = err;
+			}
+		}
+		printf("%6d %11lld %10lld %9.3f %7ld %12.4f %9.2e %7.1e\n", nx, \
+				predict/STEPS, (total-predict)/STEPS, total/(STEPS*5000000.0)*100.0, \
+				step_allocs, rms, diff, asym);
+		if(step_allocs!=0 || diff>1e-4f || asym!=0.0f) failures++;
+		// the row views don't own memory, detach them before the next size
+		u = rc_empty_vector();
+		y = rc_empty_vector();
+	}
+	printf("\nmeasurement noise is up to +-%.2f, the position error should be well below that\n", R_AMP);
+	printf("%s\n", failures ? "FAILED" : "no allocations while stepping, kf and ekf agree");
+
+	rc_free_kalman(&kf);
+	rc_free_kalman(&ekf);
+	rc_free_matrix(&Q);
+	rc_free_matrix(&R);
+	rc_free_matrix(&Pi);
+	rc_free_matrix(&U);
+	rc_free_matrix(&Y);
+	rc_free_matrix(&pos);
+	rc_free_matrix(&m.F);
+	rc_free_matrix(&m.G);
+	rc_free_matrix(&m.H);
+	rc_free_vector(&x);
+	rc_free_vector(&xn);
+	rc_free_vector(&us);
+	return failures ? -1 : 0;
+}
@@ -0,0 +1,297 @@
+/*******************************************************************************
+* rc_benchmark_lqr.c
+*
+* Designs an LQR balance controller for a linearized model of the MiP with
+* rc_dlqr and rc_dlqr_d and times both. The double precision Riccati solution
+* is checked by plugging it back into the Riccati equation and against simply
+* iterating the Riccati recursion until it stops changing.
+*
+* The model depends on battery voltage, which scales the motor torque just as
+* rc_balance compensates D1's gain for, and on the lean angle it is linearized
+* about. A gain table over both is generated with rc_gain_table_from_lqr and
+* rc_gain_table_lookup is timed and compared against designing the gain from
+* scratch at random operating points between the grid points.
+*
+* malloc and friends are wrapped as in rc_benchmark_kalman so any allocation
+* made by the lookup is counted. This needs glibc. No cape hardware is used so
+* this also runs on an ordinary Linux PC.
+*******************************************************************************/
+
+#include "../../libraries/rc_usefulincludes.h"
+#include "../../libraries/roboticscape.h"
+
+#define TIMER		rc_nanos_thread_time()
+#define DT			0.01f	// 100hz like rc_balance
+#define NX			4		// body angle, its rate, wheel angle, its rate
+#define NU			1		// motor duty cycle
+#define SOLVES		200
+#define LOOKUPS		100000
+#define CHECKS		200
+#define RECURSIONS	5000
+#define V_NOMINAL	7.4f
+// gain table grid over battery voltage and lean angle
+#define V_POINTS	7
+#define V_MIN		6.0f
+#define V_MAX		8.4f
+#define LEAN_POINTS	4
+#define LEAN_MIN	0.0f
+#define LEAN_MAX	0.3f
+
+// glibc's own allocator entry points, used by the wrappers below
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void  __libc_free(void* ptr);
+
+static int counting = 0;
+static long allocs = 0;
+
+/*******************************************************************************
+* allocator wrappers
+*
+* Definitions in the executable take precedence over libc for every shared
+* library it loads, including libroboticscape, so these see all of its calls.
+*******************************************************************************/
+void* malloc(size_t size){
+	if(counting) allocs++;
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size){
+	if(counting) allocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size){
+	if(counting) allocs++;
+	return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size){
+	if(counting) allocs++;
+	*ptr = __libc_memalign(alignment, size);
+	return (*ptr==NULL) ? ENOMEM : 0;
+}
+
+void free(void* ptr){
+	__libc_free(ptr);
+}
+
+/*******************************************************************************
+* int mip_model(float* op, rc_matrix_t* A, rc_matrix_t* B, rc_matrix_t* Q, rc_matrix_t* R, void* ctx)
+*
+* Linearized MiP about lean angle op[1] with battery voltage op[0],
+* discretized with forward Euler. Gravity tips the body over in proportion to
+* the cosine of the lean angle and the motors push the body back and the wheels
+* forward in proportion to the battery voltage.
+*******************************************************************************/
+int mip_model(float* op, rc_matrix_t* A, rc_matrix_t* B, rc_matrix_t* Q, rc_matrix_t* R, \
+						__attribute__ ((unused)) void* ctx){
+	float v = op[0]/V_NOMINAL;
+	float c = cosf(op[1]);
+	rc_identity_matrix(A, NX);
+	A->d[0][1] = DT;
+	A->d[1][0] = DT*49.0f*c;
+	A->d[2][3] = DT;
+	A->d[3][0] = -DT*20.0f*c;
+	rc_matrix_zeros(B, NX, NU);
+	B->d[1][0] = -DT*30.0f*v;
+	B->d[3][0] = DT*120.0f*v;
+	rc_matrix_zeros(Q, NX, NX);
+	Q->d[0][0] = 10.0f;
+	Q->d[1][1] = 1.0f;
+	Q->d[2][2] = 1.0f;
+	Q->d[3][3] = 0.1f;
+	rc_identity_matrix(R, NU);
+	return 0;
+}
+
+// largest absolute entry of a double matrix
+double max_abs_d(rc_matrix_d_t A){
+	int i,j;
+	double m = 0.0;
+	for(i=0;i<A.rows;i++){
+		for(j=0;j<A.cols;j++) if(fabs(A.d[i][j])>m) m = fabs(A.d[i][j]);
+	}
+	return m;
+}
+
+int main(){
+	int i, j, k;
+	int points[2] = {V_POINTS, LEAN_POINTS};
+	float min[2] = {V_MIN, LEAN_MIN};
+	float max[2] = {V_MAX, LEAN_MAX};
+	float op[2] = {V_NOMINAL, 0.0f};
+	float err, max_err;
+	double res, rec_diff;
+	uint64_t t1, t2, t_float, t_double, t_table, t_lookup;
+	long lookup_allocs;
+	rc_matrix_t A = rc_empty_matrix();
+	rc_matrix_t B = rc_empty_matrix();
+	rc_matrix_t Q = rc_empty_matrix();
+	rc_matrix_t R = rc_empty_matrix();
+	rc_matrix_t K = rc_empty_matrix();
+	rc_matrix_t Kf = rc_empty_matrix();
+	rc_matrix_d_t Ad = rc_empty_matrix_d();
+	rc_matrix_d_t Bd = rc_empty_matrix_d();
+	rc_matrix_d_t Qd = rc_empty_matrix_d();
+	rc_matrix_d_t Rd = rc_empty_matrix_d();
+	rc_matrix_d_t Kd = rc_empty_matrix_d();
+	rc_matrix_d_t P = rc_empty_matrix_d();
+	rc_matrix_d_t Pr = rc_empty_matrix_d();
+	rc_matrix_d_t Kr = rc_empty_matrix_d();
+	rc_matrix_d_t Acl = rc_empty_matrix_d();
+	rc_matrix_d_t T = rc_empty_matrix_d();
+	rc_matrix_d_t T2 = rc_empty_matrix_d();
+	rc_matrix_d_t At = rc_empty_matrix_d();
+	rc_matrix_d_t Bt = rc_empty_matrix_d();
+	rc_matrix_d_t S = rc_empty_matrix_d();
+	rc_matrix_d_t N = rc_empty_matrix_d();
+	rc_gain_table_t table = rc_empty_gain_table();
+
+	// nominal design in both precisions
+	mip_model(op, &A, &B, &Q, &R, NULL);
+	rc_matrix_float_to_double(A, &Ad);
+	rc_matrix_float_to_double(B, &Bd);
+	rc_matrix_float_to_double(Q, &Qd);
+	rc_matrix_float_to_double(R, &Rd);
+	if(rc_dlqr(A, B, Q, R, &Kf, NULL) || rc_dlqr_d(Ad, Bd, Qd, Rd, &Kd, &P)){
+		fprintf(stderr,"LQR design failed\n");
+		return -1;
+	}
+	t1 = TIMER;
+	for(i=0;i<SOLVES;i++) rc_dlqr(A, B, Q, R, &Kf, NULL);
+	t2 = TIMER;
+	t_float = t2-t1;
+	t1 = TIMER;
+	for(i=0;i<SOLVES;i++) rc_dlqr_d(Ad, Bd, Qd, Rd, &Kd, NULL);
+	t2 = TIMER;
+	t_double = t2-t1;
+	printf("\nnominal LQR gain at %.1fV, u=-Kx\n", V_NOMINAL);
+	printf("float:  ");
+	for(j=0;j<NX;j++) printf("%10.4f ", Kf.d[0][j]);
+	printf("\ndouble: ");
+	for(j=0;j<NX;j++) printf("%10.4f ", Kd.d[0][j]);
+	printf("\n%10lldns per rc_dlqr\n", t_float/SOLVES);
+	printf("%10lldns per rc_dlqr_d\n", t_double/SOLVES);
+
+	// residual of A'PA - A'PB(R+B'PB)^-1 B'PA + Q - P with N = B'PA = SK
+	rc_matrix_transpose_d(Ad, &At);
+	rc_matrix_transpose_d(Bd, &Bt);
+	rc_multiply_matrices_d(P, Ad, &T);
+	rc_multiply_matrices_d(At, T, &T2);		// A'PA
+	rc_multiply_matrices_d(Bt, T, &N);		// B'PA
+	rc_matrix_transpose_d(N, &S);
+	rc_multiply_matrices_d(S, Kd, &T);		// A'PB K
+	for(i=0;i<NX;i++){
+		for(j=0;j<NX;j++) T2.d[i][j] += -T.d[i][j] + Qd.d[i][j] - P.d[i][j];
+	}
+	res = max_abs_d(T2)/max_abs_d(P);
+
+	// iterate the Riccati recursion from P=Q as an independent check, in the
+	// form P=(A-BK)'P(A-BK)+K'RK+Q which doesn't drift apart numerically
+	rc_duplicate_matrix_d(Qd, &Pr);
+	for(k=0;k<RECURSIONS;k++){
+		rc_multiply_matrices_d(Pr, Bd, &T);
+		rc_multiply_matrices_d(Bt, T, &S);
+		rc_add_matrices_inplace_d(&S, Rd);
+		rc_invert_matrix_inplace_d(&S);					// (R+B'PB)^-1
+		rc_multiply_matrices_d(Pr, Ad, &T);
+		rc_multiply_matrices_d(Bt, T, &N);
+		rc_multiply_matrices_d(S, N, &Kr);				// K
+		rc_multiply_matrices_d(Bd, Kr, &Acl);
+		for(i=0;i<NX;i++){
+			for(j=0;j<NX;j++) Acl.d[i][j] = Ad.d[i][j] - Acl.d[i][j];
+		}
+		rc_multiply_matrices_d(Pr, Acl, &T);
+		rc_matrix_transpose_d(Acl, &S);
+		rc_multiply_matrices_d(S, T, &T2);				// (A-BK)'P(A-BK)
+		rc_multiply_matrices_d(Rd, Kr, &N);
+		rc_matrix_transpose_d(Kr, &S);
+		rc_multiply_matrices_d(S, N, &T);				// K'RK
+		for(i=0;i<NX;i++){
+			for(j=0;j<NX;j++) Pr.d[i][j] = T2.d[i][j] + T.d[i][j] + Qd.d[i][j];
+		}
+		for(i=0;i<NX;i++){
+			for(j=0;j<i;j++) Pr.d[i][j] = Pr.d[j][i] = 0.5*(Pr.d[i][j]+Pr.d[j][i]);
+		}
+	}
+	// written so a NaN anywhere makes the difference NaN rather than 0
+	rec_diff = 0.0;
+	for(i=0;i<NX;i++){
+		for(j=0;j<NX;j++){
+			if(!(fabs(Pr.d[i][j]-P.d[i][j])<=rec_diff)) rec_diff = fabs(Pr.d[i][j]-P.d[i][j]);
+		}
+	}
+	rec_diff /= max_abs_d(P);
+	printf("%10.2e relative Riccati equation residual\n", res);
+	printf("%10.2e relative difference from %d Riccati recursions\n", rec_diff, RECURSIONS);
+
+	// gain table over battery voltage and lean angle
+	t1 = TIMER;
+	if(rc_gain_table_from_lqr(&table, 2, points, min, max, NX, NU, mip_model, NULL)){
+		fprintf(stderr,"failed to make gain table\n");
+		return -1;
+	}
+	t2 = TIMER;
+	t_table = t2-t1;
+	rc_gain_table_lookup(&table, op, &K);
+	counting = 1;
+	allocs = 0;
+	t1 = TIMER;
+	for(i=0;i<LOOKUPS;i++){
+		op[0] = V_MIN + (V_MAX-V_MIN)*(i%97)/96.0f;
+		op[1] = LEAN_MAX*(i%89)/88.0f;
+		rc_gain_table_lookup(&table, op, &K);
+	}
+	t2 = TIMER;
+	counting = 0;
+	lookup_allocs = allocs;
+	t_lookup = t2-t1;
+
+	// interpolation error at random points against a fresh design
+	max_err = 0.0f;
+	for(i=0;i<CHECKS;i++){
+		op[0] = 0.5f*(V_MIN+V_MAX) + 0.5f*(V_MAX-V_MIN)*rc_get_random_float();
+		op[1] = 0.5f*(LEAN_MIN+LEAN_MAX) + 0.5f*(LEAN_MAX-LEAN_MIN)*rc_get_random_float();
+		rc_gain_table_lookup(&table, op, &K);
+		mip_model(op, &A, &B, &Q, &R, NULL);
+		rc_dlqr(A, B, Q, R, &Kf, NULL);
+		for(j=0;j<NX;j++){
+			err = fabsf(K.d[0][j]-Kf.d[0][j])/fabsf(Kf.d[0][j]);
+			if(err>max_err) max_err = err;
+		}
+	}
+	printf("\n%dx%d gain table, %.1f-%.1fV and %.2f-%.2frad lean, %d bytes\n", \
+			V_POINTS, LEAN_POINTS, V_MIN, V_MAX, LEAN_MIN, LEAN_MAX, \
+			(int)(table.entries*table.rows*table.cols*sizeof(float)));
+	printf("%10lldus to generate\n", t_table/1000);
+	printf("%10lldns per rc_gain_table_lookup\n", t_lookup/LOOKUPS);
+	printf("%10ld allocations during lookups\n", lookup_allocs);
+	printf("%10.2f%% max interpolation error between grid points\n", 100.0f*max_err);
+
+	rc_free_gain_table(&table);
+	rc_free_matrix(&A);
+	rc_free_matrix(&B);
+	rc_free_matrix(&Q);
+	rc_free_matrix(&R);
+	rc_free_matrix(&K);
+	rc_free_matrix(&Kf);
+	rc_free_matrix_d(&Ad);
+	rc_free_matrix_d(&Bd);
+	rc_free_matrix_d(&Qd);
+	rc_free_matrix_d(&Rd);
+	rc_free_matrix_d(&Kd);
+	rc_free_matrix_d(&P);
+	rc_free_matrix_d(&Pr);
+	rc_free_matrix_d(&Kr);
+	rc_free_matrix_d(&Acl);
+	rc_free_matrix_d(&T);
+	rc_free_matrix_d(&T2);
+	rc_free_matrix_d(&At);
+	rc_free_matrix_d(&Bt);
+	rc_free_matrix_d(&S);
+	rc_free_matrix_d(&N);
+	return 0;
+}
@@ -0,0 +1,197 @@
+/*******************************************************************************
+* rc_benchmark_spsc.c
+*
+* Measures the throughput and latency of the lock-free single-producer
+* single-consumer ring buffer rc_spsc_ringbuf_t by passing small timestamped
+* packets from a producer thread to a consumer thread. The consumer checks
+* every packet arrives exactly once and in order. No cape hardware is used so
+* this also runs on an ordinary Linux PC.
+*
+* The throughput test pushes as fast as possible, optionally in batches. The
+* latency test sends one packet at a time at a fixed interval and measures how
+* long it takes to show up on the other side.
+*******************************************************************************/
+
+#include "../../libraries/rc_usefulincludes.h"
+#include "../../libraries/roboticscape.h"
+#include <sched.h> // for sched_yield
+
+#define DEFAULT_CAPACITY	1024
+#define DEFAULT_BATCH		1
+#define MAX_BATCH			256
+#define THROUGHPUT_PACKETS	10000000
+#define LATENCY_PACKETS		100000
+#define LATENCY_INTERVAL_NS	10000
+
+typedef struct packet_t{
+	uint64_t seq;		// sequence number, counts up from 0
+	uint64_t time_ns;	// time the producer pushed it
+} packet_t;
+
+typedef struct test_t{
+	rc_spsc_ringbuf_t r;
+	int batch;			// packets pushed or popped at once
+	int packets;		// total packets to send
+	int interval_ns;	// 0 to push as fast as possible
+	// filled in by the consumer
+	int errors;
+	uint64_t lat_sum;
+	uint64_t lat_max;
+} test_t;
+
+// printed if some invalid argument was given
+void print_usage(){
+	printf("\n");
+	printf("-c {capacity}  ring buffer capacity, default %d\n", DEFAULT_CAPACITY);
+	printf("-b {batch}     packets per push/pop in the throughput test, default %d\n", DEFAULT_BATCH);
+	printf("-h             print this help message\n");
+	printf("\n");
+}
+
+void* producer(void* ptr){
+	test_t* t = (test_t*)ptr;
+	packet_t p[MAX_BATCH];
+	uint64_t seq = 0;
+	uint64_t next = rc_nanos_since_boot();
+	int i, n, sent;
+	while(seq<(uint64_t)t->packets){
+		// in the latency test wait until it's time for the next packet
+		if(t->interval_ns){
+			while(rc_nanos_since_boot()<next) sched_yield();
+			next += t->interval_ns;
+		}
+		n = t->batch;
+		if(seq+n>(uint64_t)t->packets) n = t->packets-seq;
+		for(i=0;i<n;i++){
+			p[i].seq = seq+i;
+			p[i].time_ns = rc_nanos_since_boot();
+		}
+		// retry until everything is in, yielding in case the consumer is
+		// waiting for the same cpu core
+		if(n==1) while(rc_spsc_ringbuf_push(&t->r, &p[0])) sched_yield();
+		else{
+			sent = 0;
+			while(1){
+				sent += rc_spsc_ringbuf_push_batch(&t->r, p+sent, n-sent);
+				if(sent==n) break;
+				sched_yield();
+			}
+		}
+		seq += n;
+	}
+	return NULL;
+}
+
+void* consumer(void* ptr){
+	test_t* t = (test_t*)ptr;
+	packet_t p[MAX_BATCH];
+	uint64_t expected = 0;
+	uint64_t now, lat;
+	uint64_t lat_sum = 0;
+	uint64_t lat_max = 0;
+	int errors = 0;
+	int i, n;
+	// results are kept local until the end so the consumer doesn't write to
+	// the cache line holding the producer's settings
+	while(expected<(uint64_t)t->packets){
+		if(t->batch==1) n = rc_spsc_ringbuf_pop(&t->r, &p[0])==0;
+		else n = rc_spsc_ringbuf_pop_batch(&t->r, p, t->batch);
+		if(n<=0){
+			sched_yield();
+			continue;
+		}
+		now = rc_nanos_since_boot();
+		for(i=0;i<n;i++){
+			if(p[i].seq!=expected) errors++;
+			expected = p[i].seq+1;
+			lat = now-p[i].time_ns;
+			lat_sum += lat;
+			if(lat>lat_max) lat_max = lat;
+		}
+	}
+	t->errors = errors;
+	t->lat_sum = lat_sum;
+	t->lat_max = lat_max;
+	return NULL;
+}
+
+// runs one producer and one consumer thread and returns the elapsed time in ns
+uint64_t run_test(test_t* t){
+	pthread_t prod_thread, cons_thread;
+	uint64_t t1, t2;
+	t->errors = 0;
+	t->lat_sum = 0;
+	t->lat_max = 0;
+	t1 = rc_nanos_since_boot();
+	pthread_create(&cons_thread, NULL, consumer, (void*)t);
+	pthread_create(&prod_thread, NULL, producer, (void*)t);
+	pthread_join(prod_thread, NULL);
+	pthread_join(cons_thread, NULL);
+	t2 = rc_nanos_since_boot();
+	return t2-t1;
+}
+
+int main(int argc, char *argv[]){
+	int c;
+	int capacity = DEFAULT_CAPACITY;
+	int batch = DEFAULT_BATCH;
+	uint64_t ns;
+	test_t t;
+
+	// parse arguments
+	opterr = 0;
+	while ((c = getopt(argc, argv, "c:b:h")) != -1){
+		switch (c){
+		case 'c':
+			capacity = atoi(optarg);
+			if(capacity<2){
+				printf("capacity must be at least 2\n");
+				return -1;
+			}
+			break;
+		case 'b':
+			batch = atoi(optarg);
+			if(batch<1 || batch>MAX_BATCH){
+				printf("batch must be between 1 and %d\n", MAX_BATCH);
+				return -1;
+			}
+			break;
+		case 'h':
+			print_usage();
+			return 0;
+		default:
+			printf("inavlid argument\n");
+			print_usage();
+			return -1;
+		}
+	}
+
+	t.r = rc_empty_spsc_ringbuf();
+	if(rc_alloc_spsc_ringbuf(&t.r, capacity, sizeof(packet_t))){
+		printf("failed to allocate ring buffer\n");
+		return -1;
+	}
+	printf("\ncapacity %d, %d byte packets\n", t.r.capacity, (int)sizeof(packet_t));
+
+	// throughput
+	t.batch = batch;
+	t.packets = THROUGHPUT_PACKETS;
+	t.interval_ns = 0;
+	ns = run_test(&t);
+	printf("\nthroughput, batches of %d\n", batch);
+	printf("%10.2f million packets per second\n", t.packets*1000.0/ns);
+	printf("%10d sequence errors\n", t.errors);
+
+	// latency, one packet at a time
+	t.batch = 1;
+	t.packets = LATENCY_PACKETS;
+	t.interval_ns = LATENCY_INTERVAL_NS;
+	run_test(&t);
+	printf("\nlatency, one packet every %dus\n", LATENCY_INTERVAL_NS/1000);
+	printf("%10lldns mean\n", t.lat_sum/t.packets);
+	printf("%10lldns max\n", t.lat_max);
+	printf("%10d sequence errors\n", t.errors);
+
+	rc_free_spsc_ringbuf(&t.r);
+	return 0;
+}
@@ -3,13 +3,216 @@
 *
 * This tests some of the more common functions in rc_linear_algebra.c
 * it is not a complete test of all available linear algebra functions but
-* should get you started as an example.
+* should get you started as an example. At the end every inline fixed-size
+* vec3/vec4/mat3/mat4 operation is checked against the rc_vector_t and
+* rc_matrix_t function doing the same thing.
 *******************************************************************************/
 
 #include "../../libraries/rc_usefulincludes.h"
 #include "../../libraries/roboticscape.h"
 
 #define DIM 3
+#define FIXED_TOL	1e-5f	// largest difference allowed from the dynamic result
+#define FIXED_REPS	100		// random inputs tried for each fixed-size check
+
+// largest difference between n floats and the dynamic vector v
+float vec_diff(const float* a, rc_vector_t v, int n){
+	int i;
+	float err = 0.0f;
+	if(v.len!=n) return INFINITY;
+	for(i=0;i<n;i++) if(fabsf(a[i]-v.d[i])>err) err = fabsf(a[i]-v.d[i]);
+	return err;
+}
+
+// largest difference between n*n row-major floats and the dynamic matrix m
+float mat_diff(const float* a, rc_matrix_t m, int n){
+	int i, j;
+	float err = 0.0f;
+	if(m.rows!=n || m.cols!=n) return INFINITY;
+	for(i=0;i<n;i++){
+		for(j=0;j<n;j++){
+			if(fabsf(a[i*n+j]-m.d[i][j])>err) err = fabsf(a[i*n+j]-m.d[i][j]);
+		}
+	}
+	return err;
+}
+
+// prints the worst difference seen for one operation, returns 1 if it failed
+int report(const char* name, float err){
+	printf("%-22s %10.2e  %s\n", name, err, err<=FIXED_TOL ? "pass" : "FAIL");
+	return err>FIXED_TOL;
+}
+
+// runs every fixed-size operation on random inputs next to its dynamic
+// equivalent and returns the number of operations which disagreed
+int test_fixed_size(){
+	int i, j, r, fails = 0;
+	float e[16] = {0};
+	rc_vec3_t a3, b3, v3;
+	rc_vec4_t a4, b4, v4;
+	rc_mat3_t A3, B3, M3;
+	rc_mat4_t A4, B4, M4;
+	rc_vector_t a = rc_empty_vector();
+	rc_vector_t b = rc_empty_vector();
+	rc_vector_t v = rc_empty_vector();
+	rc_matrix_t A = rc_empty_matrix();
+	rc_matrix_t B = rc_empty_matrix();
+	rc_matrix_t M = rc_empty_matrix();
+
+	printf("\nFixed-size types against dynamic functions, max difference:\n");
+	for(r=0;r<FIXED_REPS;r++){
+		// vec3 and vec4
+		rc_random_vector(&a,3);
+		rc_random_vector(&b,3);
+		rc_vector_to_vec3(a,&a3);
+		rc_vector_to_vec3(b,&b3);
+		v3 = rc_vec3_add(a3,b3);
+		rc_vector_sum(a,b,&v);
+		e[0] = fmaxf(e[0], vec_diff(v3.d,v,3));
+		v3 = rc_vec3_scale(a3,-2.5f);
+		rc_duplicate_vector(a,&v);
+		rc_vector_times_scalar(&v,-2.5f);
+		e[0] = fmaxf(e[0], vec_diff(v3.d,v,3));
+		v3 = rc_vec3_sub(rc_vec3_add(a3,b3),b3);
+		e[0] = fmaxf(e[0], vec_diff(v3.d,a,3));
+		e[1] = fmaxf(e[1], fabsf(rc_vec3_dot(a3,b3)-rc_vector_dot_product(a,b)));
+		e[1] = fmaxf(e[1], fabsf(rc_vec3_norm(a3)-rc_vector_norm(a,2.0f)));
+		v3 = rc_vec3_cross(a3,b3);
+		rc_vector_cross_product(a,b,&v);
+		e[2] = fmaxf(e[2], vec_diff(v3.d,v,3));
+		rc_random_vector(&a,4);
+		rc_random_vector(&b,4);
+		rc_vector_to_vec4(a,&a4);
+		rc_vector_to_vec4(b,&b4);
+		v4 = rc_vec4_add(a4,b4);
+		rc_vector_sum(a,b,&v);
+		e[3] = fmaxf(e[3], vec_diff(v4.d,v,4));
+		v4 = rc_vec4_scale(a4,-2.5f);
+		rc_duplicate_vector(a,&v);
+		rc_vector_times_scalar(&v,-2.5f);
+		e[3] = fmaxf(e[3], vec_diff(v4.d,v,4));
+		v4 = rc_vec4_sub(rc_vec4_add(a4,b4),b4);
+		e[3] = fmaxf(e[3], vec_diff(v4.d,a,4));
+		e[4] = fmaxf(e[4], fabsf(rc_vec4_dot(a4,b4)-rc_vector_dot_product(a,b)));
+		e[4] = fmaxf(e[4], fabsf(rc_vec4_norm(a4)-rc_vector_norm(a,2.0f)));
+
+		// mat3, kept well conditioned so the inverse is meaningful in float
+		rc_random_matrix(&A,3,3);
+		rc_random_matrix(&B,3,3);
+		for(i=0;i<3;i++) A.d[i][i] += 3.0f;
+		rc_matrix_to_mat3(A,&A3);
+		rc_matrix_to_mat3(B,&B3);
+		M3 = rc_mat3_add(A3,B3);
+		rc_add_matrices(A,B,&M);
+		e[5] = fmaxf(e[5], mat_diff(&M3.d[0][0],M,3));
+		M3 = rc_mat3_scale(A3,-2.5f);
+		rc_duplicate_matrix(A,&M);
+		rc_matrix_times_scalar(&M,-2.5f);
+		e[5] = fmaxf(e[5], mat_diff(&M3.d[0][0],M,3));
+		M3 = rc_mat3_transpose(A3);
+		rc_matrix_transpose(A,&M);
+		e[5] = fmaxf(e[5], mat_diff(&M3.d[0][0],M,3));
+		M3 = rc_mat3_identity();
+		rc_identity_matrix(&M,3);
+		e[5] = fmaxf(e[5], mat_diff(&M3.d[0][0],M,3));
+		M3 = rc_mat3_mul(A3,B3);
+		rc_multiply_matrices(A,B,&M);
+		e[6] = fmaxf(e[6], mat_diff(&M3.d[0][0],M,3));
+		rc_random_vector(&a,3);
+		rc_vector_to_vec3(a,&a3);
+		v3 = rc_mat3_mul_vec(A3,a3);
+		rc_matrix_times_col_vec(A,a,&v);
+		e[6] = fmaxf(e[6], vec_diff(v3.d,v,3));
+		// determinants are in the tens here, compare relative to the value
+		e[7] = fmaxf(e[7], fabsf(rc_mat3_det(A3)/rc_matrix_determinant(A)-1.0f));
+		rc_mat3_inverse(A3,&M3);
+		rc_invert_matrix(A,&M);
+		e[8] = fmaxf(e[8], mat_diff(&M3.d[0][0],M,3));
+		M3 = rc_mat3_mul(M3,A3);
+		rc_identity_matrix(&M,3);
+		e[8] = fmaxf(e[8], mat_diff(&M3.d[0][0],M,3));
+
+		// mat4
+		rc_random_matrix(&A,4,4);
+		rc_random_matrix(&B,4,4);
+		for(i=0;i<4;i++) A.d[i][i] += 4.0f;
+		rc_matrix_to_mat4(A,&A4);
+		rc_matrix_to_mat4(B,&B4);
+		M4 = rc_mat4_add(A4,B4);
+		rc_add_matrices(A,B,&M);
+		e[9] = fmaxf(e[9], mat_diff(&M4.d[0][0],M,4));
+		M4 = rc_mat4_scale(A4,-2.5f);
+		rc_duplicate_matrix(A,&M);
+		rc_matrix_times_scalar(&M,-2.5f);
+		e[9] = fmaxf(e[9], mat_diff(&M4.d[0][0],M,4));
+		M4 = rc_mat4_transpose(A4);
+		rc_matrix_transpose(A,&M);
+		e[9] = fmaxf(e[9], mat_diff(&M4.d[0][0],M,4));
+		M4 = rc_mat4_identity();
+		rc_identity_matrix(&M,4);
+		e[9] = fmaxf(e[9], mat_diff(&M4.d[0][0],M,4));
+		M4 = rc_mat4_mul(A4,B4);
+		rc_multiply_matrices(A,B,&M);
+		e[10] = fmaxf(e[10], mat_diff(&M4.d[0][0],M,4));
+		rc_random_vector(&a,4);
+		rc_vector_to_vec4(a,&a4);
+		v4 = rc_mat4_mul_vec(A4,a4);
+		rc_matrix_times_col_vec(A,a,&v);
+		e[10] = fmaxf(e[10], vec_diff(v4.d,v,4));
+		e[11] = fmaxf(e[11], fabsf(rc_mat4_det(A4)/rc_matrix_determinant(A)-1.0f));
+		rc_mat4_inverse(A4,&M4);
+		rc_invert_matrix(A,&M);
+		e[12] = fmaxf(e[12], mat_diff(&M4.d[0][0],M,4));
+		M4 = rc_mat4_mul(M4,A4);
+		rc_identity_matrix(&M,4);
+		e[12] = fmaxf(e[12], mat_diff(&M4.d[0][0],M,4));
+
+		// random unit quaternion, its matrix against the dynamic one and
+		// both against rotating a vector by qpq*
+		rc_random_vector(&b,4);
+		rc_normalize_quaternion(&b);
+		rc_vector_to_vec4(b,&b4);
+		M3 = rc_mat3_from_quaternion(b4);
+		rc_quaternion_to_rotation_matrix(b,&M);
+		e[13] = fmaxf(e[13], mat_diff(&M3.d[0][0],M,3));
+		rc_random_vector(&a,3);
+		rc_vector_to_vec3(a,&a3);
+		rc_matrix_times_col_vec(M,a,&v);
+		rc_quaternion_rotate_vector(&a,b);
+		e[14] = fmaxf(e[14], vec_diff(v.d,a,3));
+		v3 = rc_mat3_mul_vec(M3,a3);
+		e[14] = fmaxf(e[14], vec_diff(v3.d,a,3));
+		// a rotation matrix is orthonormal, R'R=I
+		M3 = rc_mat3_mul(rc_mat3_transpose(M3),M3);
+		rc_identity_matrix(&M,3);
+		for(i=0;i<3;i++){
+			for(j=0;j<3;j++) e[15] = fmaxf(e[15], fabsf(M3.d[i][j]-M.d[i][j]));
+		}
+	}
+	fails += report("vec3 add/sub/scale", e[0]);
+	fails += report("vec3 dot/norm", e[1]);
+	fails += report("vec3 cross", e[2]);
+	fails += report("vec4 add/sub/scale", e[3]);
+	fails += report("vec4 dot/norm", e[4]);
+	fails += report("mat3 add/scale/transp", e[5]);
+	fails += report("mat3 mul/mul_vec", e[6]);
+	fails += report("mat3 det (relative)", e[7]);
+	fails += report("mat3 inverse, inv*A=I", e[8]);
+	fails += report("mat4 add/scale/transp", e[9]);
+	fails += report("mat4 mul/mul_vec", e[10]);
+	fails += report("mat4 det (relative)", e[11]);
+	fails += report("mat4 inverse, inv*A=I", e[12]);
+	fails += report("quaternion to matrix", e[13]);
+	fails += report("matrix vs qpq*", e[14]);
+	fails += report("rotation R'R=I", e[15]);
+	rc_free_vector(&a);
+	rc_free_vector(&b);
+	rc_free_vector(&v);
+	rc_free_matrix(&A);
+	rc_free_matrix(&B);
+	rc_free_matrix(&M);
+	return fails;
+}
 
 int main(){
 	float det;
@@ -21,6 +224,7 @@ int main(){
 	rc_matrix_t P = rc_empty_matrix();
 	rc_matrix_t Q = rc_empty_matrix();
 	rc_matrix_t R = rc_empty_matrix();
+	rc_matrix_t S = rc_empty_matrix();
 	rc_vector_t b = rc_empty_vector();
 	rc_vector_t x = rc_empty_vector();
 	rc_vector_t y = rc_empty_vector();
@@ -117,6 +321,31 @@ int main(){
 	rc_lin_system_solve_qr(A,b,&y);
 	rc_print_vector(y);
 
+	// make a symmetric positive definite matrix S=AA'+I
+	printf("\nSymmetric positive definite S=AA'+I:\n");
+	rc_matrix_transpose(A,&AA);
+	rc_multiply_matrices(A,AA,&S);
+	rc_identity_matrix(&AA,DIM);
+	rc_add_matrices_inplace(&S,AA);
+	rc_print_matrix(S);
+
+	// Cholesky decomposition of S, done in place on a copy
+	printf("\nCholesky decomposition L of S, S=LL'\n");
+	rc_duplicate_matrix(S,&L);
+	rc_cholesky_decomp(&L);
+	rc_print_matrix(L);
+
+	// solve using Cholesky factor
+	printf("\nCholesky solution x to the equation Sx=b:\n");
+	rc_cholesky_solve(L,b,&x);
+	rc_print_vector(x);
+	printf("log of determinant of S: %8.4f\n", rc_cholesky_log_det(L));
+
+	// fixed-size types
+	if(test_fixed_size()){
+		printf("\nfixed-size types FAILED\n");
+		return -1;
+	}
 
 	printf("\nDONE\n");
 	return 0;
@@ -6,6 +6,10 @@
 * It varies a common input u from 0 to 1 through time and show the output of 
 * each filter. It also displays the sum of the complementary high and low pass
 * filters to demonstrate how they sum to 1
+*
+* Before that it checks the alternate filter types against rc_march_filter on
+* the same designs and prints the largest difference found. The program
+* returns -1 if any check fails. Pass -c to only run the checks and exit.
 *******************************************************************************/
 
 #include "../../libraries/rc_usefulincludes.h"
@@ -13,8 +17,197 @@
 
 #define SAMPLE_RATE		50
 #define TIME_CONSTANT	2.0
+#define CHECK_STEPS		5000
+#define CHECK_TOL		1e-4f
+
+/*******************************************************************************
+* float check_input(int i)
+*
+* Input used by all checks, a sine wave with steps large enough to push the
+* saturated filters into their limits every so often.
+*******************************************************************************/
+float check_input(int i){
+	return 2.0f*sinf(0.03f*i) + (((i/400)%2) ? 1.5f : -0.5f);
+}
+
+/*******************************************************************************
+* int report(const char* name, float err, int mismatch)
+*
+* Prints one line of results and returns 1 if the check failed, 0 otherwise.
+* err is scaled by the largest output so it is relative.
+*******************************************************************************/
+int report(const char* name, float err, int mismatch){
+	int fail = !(err<=CHECK_TOL) || mismatch;
+	printf("%-36s %9.2e %6d   %s\n", name, err, mismatch, fail?"FAIL":"ok");
+	return fail;
+}
 
-int main(){
+/*******************************************************************************
+* int check_tdf2()
+*
+* Runs each filter through rc_march_filter and the rc_tdf2_filter_t made from
+* it by rc_tdf2_filter_from_filter. Mismatches count steps where the saturation
+* flag differs plus any difference in the final step counter.
+*******************************************************************************/
+int check_tdf2(){
+	int i, j, mismatch, fails = 0;
+	float y, yt, err, peak;
+	const float dt = 1.0/SAMPLE_RATE;
+	float D1_num[] = {-6.289, 11.910, -5.634};
+	float D1_den[] = { 1.000, -1.702,  0.702};
+	const char* name[4] = {"tdf2, butterworth order 2", "tdf2, butterworth order 4",
+				"tdf2, saturated soft start", "tdf2, saturated PID"};
+	rc_filter_t f[4];
+	rc_tdf2_filter_t t = rc_empty_tdf2_filter();
+
+	for(j=0;j<4;j++) f[j] = rc_empty_filter();
+	rc_butterworth_lowpass(&f[0], 2, dt, 2.0*M_PI/TIME_CONSTANT);
+	// higher cutoff, at 1/TIME_CONSTANT hz a 4th order polynomial is too poorly
+	// conditioned in float for either form to match a double reference
+	rc_butterworth_lowpass(&f[1], 4, dt, 2.0*M_PI*5.0);
+	rc_alloc_filter_from_arrays(&f[2], 2, dt, D1_num, D1_den);
+	f[2].gain = 0.8f;
+	rc_enable_saturation(&f[2], -1.0, 1.0);
+	rc_enable_soft_start(&f[2], 0.7);
+	rc_pid_filter(&f[3], 1.0, 0.3, 0.05, 4*dt, dt);
+	rc_enable_saturation(&f[3], -0.5, 0.5);
+
+	for(j=0;j<4;j++){
+		if(rc_tdf2_filter_from_filter(&t, f[j])){
+			printf("failed to make tdf2 filter\n");
+			return 1;
+		}
+		err = 0.0f;
+		peak = 1.0f;
+		mismatch = 0;
+		for(i=0;i<CHECK_STEPS;i++){
+			y = rc_march_filter(&f[j], check_input(i));
+			yt = rc_march_tdf2_filter(&t, check_input(i));
+			if(fabsf(y)>peak) peak = fabsf(y);
+			if(!(fabsf(y-yt)<=err)) err = fabsf(y-yt);
+			if(f[j].sat_flag!=t.sat_flag) mismatch++;
+		}
+		if(f[j].step!=t.step) mismatch++;
+		fails += report(name[j], err/peak, mismatch);
+		rc_free_filter(&f[j]);
+	}
+	rc_free_tdf2_filter(&t);
+	return fails;
+}
+
+// printed if some invalid argument was given
+void print_usage(){
+	printf("\n");
+	printf("-c             only run the checks then exit\n");
+	printf("-h             print this help message\n");
+	printf("\n");
+}
+
+/*******************************************************************************
+* int check_sos()
+*
+* An order 2 Butterworth low pass as second order sections should match
+* rc_butterworth_lowpass. At order 8 with a 2hz cutoff at 100hz the polynomial
+* form is unstable in float and is only printed for comparison while the
+* sections must settle to 1 after a unit step. Mismatches count steps where the
+* sections' output is not finite or goes past 1.17, just over the 16.4%
+* overshoot of an ideal 8th order Butterworth step response.
+*******************************************************************************/
+int check_sos(){
+	int i, mismatch = 0, fails = 0;
+	float y, ys, err = 0.0f, peak = 1.0f;
+	const float dt = 1.0/SAMPLE_RATE;
+	rc_filter_t f = rc_empty_filter();
+	rc_sos_filter_t sos = rc_empty_sos_filter();
+
+	rc_butterworth_lowpass(&f, 2, dt, 2.0*M_PI/TIME_CONSTANT);
+	rc_butterworth_lowpass_sos(&sos, 2, dt, 2.0*M_PI/TIME_CONSTANT);
+	for(i=0;i<CHECK_STEPS;i++){
+		y = rc_march_filter(&f, check_input(i));
+		ys = rc_march_sos_filter(&sos, check_input(i));
+		if(fabsf(y)>peak) peak = fabsf(y);
+		if(!(fabsf(y-ys)<=err)) err = fabsf(y-ys);
+	}
+	if(f.step!=sos.step) mismatch++;
+	fails += report("sos, butterworth order 2", err/peak, mismatch);
+
+	// unit step into both forms of the order 8 design, 20 seconds at 100hz
+	rc_butterworth_lowpass(&f, 8, 0.01, 2.0*M_PI*2.0);
+	rc_butterworth_lowpass_sos(&sos, 8, 0.01, 2.0*M_PI*2.0);
+	mismatch = 0;
+	for(i=0;i<2000;i++){
+		y = rc_march_filter(&f, 1.0f);
+		ys = rc_march_sos_filter(&sos, 1.0f);
+		if(!(fabsf(ys)<=1.17f)) mismatch++;
+	}
+	fails += report("sos, butterworth order 8 step", fabsf(ys-1.0f), mismatch);
+	printf("%-36s %9.2e   polynomial form, not checked\n", "", fabsf(y-1.0f));
+
+	rc_free_filter(&f);
+	rc_free_sos_filter(&sos);
+	return fails;
+}
+
+/*******************************************************************************
+* int check_block()
+*
+* Marches two copies of each filter over the same input, one sample at a time
+* with rc_march_filter and in blocks of 1 to 37 samples with
+* rc_march_filter_block, every other block in place. Results must be bit for
+* bit identical so mismatches count every output that differs at all, plus
+* any block after which the saturation flag or step counter differ.
+*******************************************************************************/
+int check_block(){
+	int i, j, k, n, mismatch, fails = 0;
+	float err, in[37], out[37], ref[37];
+	const float dt = 1.0/SAMPLE_RATE;
+	float D1_num[] = {-6.289, 11.910, -5.634};
+	float D1_den[] = { 1.000, -1.702,  0.702};
+	const char* name[2] = {"block, saturated soft start", "block, moving average"};
+	rc_filter_t a[2], b[2];
+
+	for(j=0;j<2;j++){
+		a[j] = rc_empty_filter();
+		b[j] = rc_empty_filter();
+	}
+	rc_alloc_filter_from_arrays(&a[0], 2, dt, D1_num, D1_den);
+	rc_alloc_filter_from_arrays(&b[0], 2, dt, D1_num, D1_den);
+	a[0].gain = b[0].gain = 0.8f;
+	rc_enable_saturation(&a[0], -1.0, 1.0);
+	rc_enable_saturation(&b[0], -1.0, 1.0);
+	rc_enable_soft_start(&a[0], 0.7);
+	rc_enable_soft_start(&b[0], 0.7);
+	rc_moving_average(&a[1], 20, 1);
+	rc_moving_average(&b[1], 20, 1);
+
+	for(j=0;j<2;j++){
+		err = 0.0f;
+		mismatch = 0;
+		for(i=0,n=1;i<CHECK_STEPS;i+=n,n=n%37+1){
+			if(i+n>CHECK_STEPS) n = CHECK_STEPS-i;
+			for(k=0;k<n;k++){
+				in[k] = check_input(i+k);
+				ref[k] = rc_march_filter(&a[j], in[k]);
+			}
+			if(n%2){
+				rc_march_filter_block(&b[j], in, in, n);
+				for(k=0;k<n;k++) out[k] = in[k];
+			}
+			else rc_march_filter_block(&b[j], in, out, n);
+			for(k=0;k<n;k++){
+				if(out[k]!=ref[k]) mismatch++;
+				if(!(fabsf(out[k]-ref[k])<=err)) err = fabsf(out[k]-ref[k]);
+			}
+			if(a[j].sat_flag!=b[j].sat_flag || a[j].step!=b[j].step) mismatch++;
+		}
+		fails += report(name[j], err, mismatch);
+		rc_free_filter(&a[j]);
+		rc_free_filter(&b[j]);
+	}
+	return fails;
+}
+
+int main(int argc, char *argv[]){
 	rc_filter_t low_pass = rc_empty_filter();
 	rc_filter_t high_pass = rc_empty_filter();
 	rc_filter_t integrator = rc_empty_filter();
@@ -24,6 +217,36 @@ int main(){
 	const float dt = 1.0/SAMPLE_RATE;
 	float lp,hp,i,u,lpb,hpb;
 	int counter = 0;
+	int fails = 0;
+	int c, only_check = 0;
+
+	// parse arguments
+	opterr = 0;
+	while ((c = getopt(argc, argv, "ch")) != -1){
+		switch (c){
+		case 'c':
+			only_check = 1;
+			break;
+		case 'h':
+			print_usage();
+			return 0;
+		default:
+			printf("inavlid argument\n");
+			print_usage();
+			return -1;
+		}
+	}
+
+	// check the other filter types against rc_march_filter
+	printf("\n%-36s %9s %6s\n", "check", "max diff", "mism.");
+	fails += check_tdf2();
+	fails += check_sos();
+	fails += check_block();
+	if(fails){
+		printf("%d checks failed\n", fails);
+		return -1;
+	}
+	if(only_check) return 0;
 
 	printf("\nSample Rate: %dhz\n", SAMPLE_RATE);
 	printf("Time Constant: %5.2f\n", TIME_CONSTANT);
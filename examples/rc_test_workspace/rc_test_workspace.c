@@ -0,0 +1,254 @@
+/*******************************************************************************
+* rc_test_workspace.c
+*
+* Checks that the _ws variants of the linear algebra functions don't touch the
+* heap once their outputs are allocated. malloc, calloc, realloc, free and
+* posix_memalign are wrapped in this program so every call made from inside
+* libroboticscape is counted. Each function is called once to size its outputs
+* and then many more times while counting, first the normal version and then
+* the _ws version with a shared rc_workspace_t. The results of the two versions
+* are also compared. No cape hardware is used so this also runs on an ordinary
+* Linux PC. Returns 0 if every _ws function made zero allocations.
+*
+* The wrappers use glibc's __libc_malloc family so this only builds with glibc,
+* which is what the BeagleBone images ship with.
+*******************************************************************************/
+
+#include "../../libraries/rc_usefulincludes.h"
+#include "../../libraries/roboticscape.h"
+
+#define CALLS			1000
+#define WORKSPACE_BYTES	(64*1024)
+#define INV_DIM			6
+#define MULT_DIM		24
+#define QR_ROWS			12
+#define QR_COLS			6
+#define ELLIPSOID_PTS	100
+
+// glibc's own allocator entry points, used by the wrappers below
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void  __libc_free(void* ptr);
+
+static int counting = 0;
+static long allocs = 0;
+
+/*******************************************************************************
+* allocator wrappers
+*
+* Definitions in the executable take precedence over libc for every shared
+* library it loads, including libroboticscape, so these see all of its calls.
+*******************************************************************************/
+void* malloc(size_t size){
+	if(counting) allocs++;
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size){
+	if(counting) allocs++;
+	return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void* ptr, size_t size){
+	if(counting) allocs++;
+	return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size){
+	if(counting) allocs++;
+	*ptr = __libc_memalign(alignment, size);
+	return (*ptr==NULL) ? ENOMEM : 0;
+}
+
+void free(void* ptr){
+	__libc_free(ptr);
+}
+
+/*******************************************************************************
+* float max_diff(rc_matrix_t A, rc_matrix_t B)
+*
+* Returns the largest absolute difference between entries of A and B.
+*******************************************************************************/
+float max_diff(rc_matrix_t A, rc_matrix_t B){
+	int i,j;
+	float d, max = 0.0f;
+	for(i=0;i<A.rows;i++){
+		for(j=0;j<A.cols;j++){
+			d = fabs(RC_MATRIX_ENTRY(A,i,j)-RC_MATRIX_ENTRY(B,i,j));
+			if(d>max) max = d;
+		}
+	}
+	return max;
+}
+
+/*******************************************************************************
+* void start_count() / long stop_count()
+*
+* Bracket a block of calls, stop_count returns the allocations made in it.
+*******************************************************************************/
+void start_count(){
+	allocs = 0;
+	counting = 1;
+}
+
+long stop_count(){
+	counting = 0;
+	return allocs;
+}
+
+/*******************************************************************************
+* int report(const char* name, long plain, long ws, float diff)
+*
+* Prints one line of the results table and returns 1 if the _ws version made
+* any allocations.
+*******************************************************************************/
+int report(const char* name, long plain, long ws, float diff){
+	printf("%-34s %8.2f %8.2f %10.2e %s\n", name, (double)plain/CALLS, \
+				(double)ws/CALLS, diff, ws==0 ? "PASS" : "FAIL");
+	return ws!=0;
+}
+
+int main(){
+	int i, failures = 0;
+	long plain, ws;
+	float diff;
+	rc_workspace_t w = rc_empty_workspace();
+	rc_matrix_t A = rc_empty_matrix();
+	rc_matrix_t B = rc_empty_matrix();
+	rc_matrix_t Bstart = rc_empty_matrix();
+	rc_matrix_t X1 = rc_empty_matrix();
+	rc_matrix_t X2 = rc_empty_matrix();
+	rc_matrix_t L1 = rc_empty_matrix();
+	rc_matrix_t U1 = rc_empty_matrix();
+	rc_matrix_t P1 = rc_empty_matrix();
+	rc_matrix_t L2 = rc_empty_matrix();
+	rc_matrix_t U2 = rc_empty_matrix();
+	rc_matrix_t P2 = rc_empty_matrix();
+	rc_matrix_t Q1 = rc_empty_matrix();
+	rc_matrix_t R1 = rc_empty_matrix();
+	rc_matrix_t Q2 = rc_empty_matrix();
+	rc_matrix_t R2 = rc_empty_matrix();
+	rc_matrix_t pts = rc_empty_matrix();
+	rc_vector_t ctr1 = rc_empty_vector();
+	rc_vector_t lens1 = rc_empty_vector();
+	rc_vector_t ctr2 = rc_empty_vector();
+	rc_vector_t lens2 = rc_empty_vector();
+
+	if(rc_alloc_workspace(&w, WORKSPACE_BYTES)){
+		fprintf(stderr,"failed to allocate workspace\n");
+		return -1;
+	}
+	printf("allocations per call over %d calls after the first\n\n", CALLS);
+	printf("%-34s %8s %8s %10s\n", "function", "plain", "_ws", "max diff");
+
+	// LUP decomposition, well conditioned by adding to the diagonal
+	rc_random_matrix(&A, INV_DIM, INV_DIM);
+	for(i=0;i<INV_DIM;i++) RC_MATRIX_ENTRY(A,i,i) += INV_DIM;
+	rc_lup_decomp(A,&L1,&U1,&P1);
+	rc_lup_decomp_ws(A,&L2,&U2,&P2,&w);
+	start_count();
+	for(i=0;i<CALLS;i++) rc_lup_decomp(A,&L1,&U1,&P1);
+	plain = stop_count();
+	start_count();
+	for(i=0;i<CALLS;i++) rc_lup_decomp_ws(A,&L2,&U2,&P2,&w);
+	ws = stop_count();
+	diff = max_diff(L1,L2);
+	if(max_diff(U1,U2)>diff) diff = max_diff(U1,U2);
+	failures += report("rc_lup_decomp", plain, ws, diff);
+
+	// inverse
+	rc_invert_matrix(A,&X1);
+	rc_invert_matrix_ws(A,&X2,&w);
+	start_count();
+	for(i=0;i<CALLS;i++) rc_invert_matrix(A,&X1);
+	plain = stop_count();
+	start_count();
+	for(i=0;i<CALLS;i++) rc_invert_matrix_ws(A,&X2,&w);
+	ws = stop_count();
+	failures += report("rc_invert_matrix", plain, ws, max_diff(X1,X2));
+
+	// in place multiply big enough to go through rc_gemm, B is scaled down
+	// each time so repeated products stay finite
+	rc_random_matrix(&A, MULT_DIM, MULT_DIM);
+	rc_matrix_times_scalar(&A, 1.0f/MULT_DIM);
+	rc_random_matrix(&Bstart, MULT_DIM, MULT_DIM);
+	rc_duplicate_matrix(Bstart,&X1);
+	rc_duplicate_matrix(Bstart,&X2);
+	start_count();
+	for(i=0;i<CALLS;i++) rc_left_multiply_matrix_inplace(A,&X1);
+	plain = stop_count();
+	start_count();
+	for(i=0;i<CALLS;i++) rc_left_multiply_matrix_inplace_ws(A,&X2,&w);
+	ws = stop_count();
+	rc_duplicate_matrix(Bstart,&X1);
+	rc_duplicate_matrix(Bstart,&X2);
+	rc_left_multiply_matrix_inplace(A,&X1);
+	rc_left_multiply_matrix_inplace_ws(A,&X2,&w);
+	failures += report("rc_left_multiply_matrix_inplace", plain, ws, max_diff(X1,X2));
+
+	// QR decomposition of a tall matrix
+	rc_random_matrix(&B, QR_ROWS, QR_COLS);
+	rc_qr_decomp(B,&Q1,&R1);
+	rc_qr_decomp_ws(B,&Q2,&R2,&w);
+	start_count();
+	for(i=0;i<CALLS;i++) rc_qr_decomp(B,&Q1,&R1);
+	plain = stop_count();
+	start_count();
+	for(i=0;i<CALLS;i++) rc_qr_decomp_ws(B,&Q2,&R2,&w);
+	ws = stop_count();
+	diff = max_diff(Q1,Q2);
+	if(max_diff(R1,R2)>diff) diff = max_diff(R1,R2);
+	failures += report("rc_qr_decomp", plain, ws, diff);
+
+	// ellipsoid fit to noisy points around a known ellipsoid
+	rc_alloc_matrix(&pts, ELLIPSOID_PTS, 3);
+	for(i=0;i<ELLIPSOID_PTS;i++){
+		float az = 2.0f*M_PI*i/ELLIPSOID_PTS;
+		float el = M_PI*(rc_get_random_float()*0.5f);
+		RC_MATRIX_ENTRY(pts,i,0) = 0.3f + 1.0f*cos(el)*cos(az) + 0.001f*rc_get_random_float();
+		RC_MATRIX_ENTRY(pts,i,1) = -0.2f + 2.0f*cos(el)*sin(az) + 0.001f*rc_get_random_float();
+		RC_MATRIX_ENTRY(pts,i,2) = 0.1f + 1.5f*sin(el) + 0.001f*rc_get_random_float();
+	}
+	rc_fit_ellipsoid(pts,&ctr1,&lens1);
+	rc_fit_ellipsoid_ws(pts,&ctr2,&lens2,&w);
+	start_count();
+	for(i=0;i<CALLS;i++) rc_fit_ellipsoid(pts,&ctr1,&lens1);
+	plain = stop_count();
+	start_count();
+	for(i=0;i<CALLS;i++) rc_fit_ellipsoid_ws(pts,&ctr2,&lens2,&w);
+	ws = stop_count();
+	diff = 0.0f;
+	for(i=0;i<3;i++){
+		if(fabs(ctr1.d[i]-ctr2.d[i])>diff) diff = fabs(ctr1.d[i]-ctr2.d[i]);
+		if(fabs(lens1.d[i]-lens2.d[i])>diff) diff = fabs(lens1.d[i]-lens2.d[i]);
+	}
+	failures += report("rc_fit_ellipsoid", plain, ws, diff);
+
+	printf("\nworkspace peak use: %zu of %zu bytes\n", w.peak, w.size);
+	printf("%s\n", failures ? "FAILED" : "all _ws functions made zero allocations");
+
+	rc_free_workspace(&w);
+	rc_free_matrix(&A);
+	rc_free_matrix(&B);
+	rc_free_matrix(&Bstart);
+	rc_free_matrix(&X1);
+	rc_free_matrix(&X2);
+	rc_free_matrix(&L1);
+	rc_free_matrix(&U1);
+	rc_free_matrix(&P1);
+	rc_free_matrix(&L2);
+	rc_free_matrix(&U2);
+	rc_free_matrix(&P2);
+	rc_free_matrix(&Q1);
+	rc_free_matrix(&R1);
+	rc_free_matrix(&Q2);
+	rc_free_matrix(&R2);
+	rc_free_matrix(&pts);
+	rc_free_vector(&ctr1);
+	rc_free_vector(&lens1);
+	rc_free_vector(&ctr2);
+	rc_free_vector(&lens2);
+	return failures ? -1 : 0;
+}
@@ -2,6 +2,9 @@
 * rc_algebra_common.h
 *
 * all things shared between rc_vector.c, rc_matrix.c, and rc_linear_algebra.c
+* and the other linear algebra sources. Everything after rc_real.h is declared
+* with real_t and the float names so it follows the precision of the file
+* including it.
 *******************************************************************************/
 
 #include "../roboticscape.h"
@@ -14,6 +17,40 @@
 
 #define ZERO_TOLERANCE 1e-6 // consider v to be zero if fabs(v)<ZERO_TOLERANCE
 
+#include "rc_real.h"
+
+// shorthand for indexing matrices which may be views, works as an lvalue
+#define AT(A,row,col) RC_MATRIX_ENTRY(A,row,col)
+
+/*******************************************************************************
+* int is_dense(rc_matrix_t A)
+*
+* Returns 1 if all of A's entries sit back to back in row-major order, as they
+* do for every matrix made by rc_alloc_matrix, so loops over the whole matrix
+* can treat A.data as one flat array.
+*******************************************************************************/
+static inline int is_dense(rc_matrix_t A){
+	return A.col_stride==1 && A.row_stride==A.cols;
+}
+
+/*******************************************************************************
+* int ws_lu(rc_workspace_t* w, rc_lu_t* f, int n)
+*
+* Sets up f to factor an n-by-n matrix with all of its memory taken from
+* workspace w. Since f is already marked as initialized with the right size,
+* rc_lu_factor uses it as is and never allocates. f must not be passed to
+* rc_free_lu.
+*******************************************************************************/
+static inline int ws_lu(rc_workspace_t* w, rc_lu_t* f, int n){
+	*f = rc_empty_lu();
+	if(unlikely(rc_workspace_matrix(w,&f->LU,n,n))) return -1;
+	f->piv = (int*)rc_workspace_push(w,n*sizeof(int));
+	if(unlikely(f->piv==NULL)) return -1;
+	f->n = n;
+	f->initialized = 1;
+	return 0;
+}
+
 /*******************************************************************************
 * float rc_mult_accumulate(float * __restrict__ a, float * __restrict__ b, int n)
 * 
@@ -23,5 +60,41 @@
 * the C compiler that the pointers are not aliased which helps the vectorization
 * process for optimization with the NEON FPU.
 *******************************************************************************/
-float rc_mult_accumulate(float * __restrict__ a, float * __restrict__ b, int n);
+real_t rc_mult_accumulate(real_t * __restrict__ a, real_t * __restrict__ b, int n);
 
+/*******************************************************************************
+* float rc_mult_accumulate_strided(float* a, int a_stride, float* b, int b_stride, int n)
+*
+* Same as rc_mult_accumulate but steps through a and b with the given strides
+* so columns and transposed views can be used without copying them first.
+*******************************************************************************/
+real_t rc_mult_accumulate_strided(real_t * __restrict__ a, int a_stride, \
+				real_t * __restrict__ b, int b_stride, int n);
+
+/*******************************************************************************
+* float rc_sum_squares_strided(float* a, int stride, int n)
+*
+* Sum of squares of n values of a read with the given stride, for when
+* rc_mult_accumulate_strided would be passed the same pointer twice.
+*******************************************************************************/
+real_t rc_sum_squares_strided(real_t* a, int stride, int n);
+
+/*******************************************************************************
+* void rc_scale_accumulate(float a, float * __restrict__ x, float * __restrict__ y, int n)
+*
+* y+=a*x over n values, the vectorized counterpart of rc_mult_accumulate for
+* loops that update a row instead of summing one. x and y must not overlap.
+*******************************************************************************/
+void rc_scale_accumulate(real_t a, real_t * __restrict__ x, real_t * __restrict__ y, int n);
+
+/*******************************************************************************
+* int rc_gemm(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, float* work)
+*
+* Cache-blocked matrix multiply C=A*B from rc_gemm.c. C must already be
+* allocated with the right dimensions and must not share memory with A or B.
+* work is a packing buffer of rc_gemm_work_size(A.rows,B.cols,A.cols) values,
+* or NULL to have rc_gemm allocate its own. Returns 0 on success or -1 on
+* failure.
+*******************************************************************************/
+int rc_gemm_work_size(int m, int n, int k);
+int rc_gemm(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, real_t* work);
@@ -0,0 +1,224 @@
+/*******************************************************************************
+* rc_blas.c
+*
+* In-place level-2 kernels in the style of BLAS: matrix-vector products with
+* accumulate, axpy, rank-1 and symmetric rank-k updates. Unlike the rest of the
+* linear algebra functions these never allocate, the output must already exist
+* with the right dimensions and is updated where it sits, so a state-space or
+* filter update can be written as a chain of these calls with no temporaries.
+* Scaling a vector or matrix in place is already rc_vector_times_scalar and
+* rc_matrix_times_scalar. Inner loops run through rc_mult_accumulate and
+* rc_scale_accumulate on contiguous rows so they are vectorized for NEON, views
+* with other strides fall back to plain loops.
+*
+* Following BLAS, when beta is 0 the old contents of the output are never read
+* so it doesn't need to be initialized to anything in particular.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+/*******************************************************************************
+* void scale_output(real_t beta, real_t* y, int stride, int n)
+*
+* only for use in this file. Multiplies n values of y spaced stride apart by
+* beta, writing zeros without reading y when beta is 0.
+*******************************************************************************/
+static void scale_output(real_t beta, real_t* y, int stride, int n){
+	int i;
+	if(beta==1.0f) return;
+	if(beta==0.0f){
+		for(i=0;i<n;i++) y[i*stride] = 0.0f;
+		return;
+	}
+	for(i=0;i<n;i++) y[i*stride] *= beta;
+	return;
+}
+
+/*******************************************************************************
+* int rc_gemv(float alpha, rc_matrix_t A, rc_vector_t x, float beta, rc_vector_t* y)
+*
+* Computes y=alpha*A*x+beta*y. y must already be allocated with A.rows entries
+* and must not share memory with x. A may be any view, dense rows are summed
+* with rc_mult_accumulate and transposed views are swept a column at a time so
+* memory is always read in order. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_gemv(real_t alpha, rc_matrix_t A, rc_vector_t x, real_t beta, rc_vector_t* y){
+	int i,j;
+	real_t sum;
+	if(unlikely(y==NULL)){
+		fprintf(stderr,"ERROR in rc_gemv, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized || !x.initialized || !y->initialized)){
+		fprintf(stderr,"ERROR in rc_gemv, matrix or vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(A.cols!=x.len || A.rows!=y->len)){
+		fprintf(stderr,"ERROR in rc_gemv, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(x.d==y->d)){
+		fprintf(stderr,"ERROR in rc_gemv, x and y must not share memory\n");
+		return -1;
+	}
+	// rows contiguous, one dot product per entry of y
+	if(A.col_stride==1){
+		for(i=0;i<A.rows;i++){
+			sum = alpha*rc_mult_accumulate(&AT(A,i,0),x.d,A.cols);
+			y->d[i] = (beta==0.0f) ? sum : sum+beta*y->d[i];
+		}
+		return 0;
+	}
+	// columns contiguous, as for a transposed view, add up scaled columns
+	scale_output(beta,y->d,1,y->len);
+	if(A.row_stride==1){
+		for(j=0;j<A.cols;j++){
+			rc_scale_accumulate(alpha*x.d[j],&AT(A,0,j),y->d,A.rows);
+		}
+		return 0;
+	}
+	for(i=0;i<A.rows;i++){
+		y->d[i] += alpha*rc_mult_accumulate_strided(&AT(A,i,0),A.col_stride,x.d,1,A.cols);
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_gemv_transpose(float alpha, rc_matrix_t A, rc_vector_t x, float beta, rc_vector_t* y)
+*
+* Computes y=alpha*A'*x+beta*y without forming A'. y must already be allocated
+* with A.cols entries and must not share memory with x.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_gemv_transpose(real_t alpha, rc_matrix_t A, rc_vector_t x, real_t beta, rc_vector_t* y){
+	rc_matrix_t T = rc_empty_matrix();
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_gemv_transpose, matrix uninitialized\n");
+		return -1;
+	}
+	// swapping the strides is free and rc_gemv handles either layout
+	rc_matrix_transpose_view(A,&T);
+	return rc_gemv(alpha,T,x,beta,y);
+}
+
+/*******************************************************************************
+* int rc_axpy(float alpha, rc_vector_t x, rc_vector_t* y)
+*
+* Computes y=alpha*x+y in place. x and y must be the same length and must not
+* share memory. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_axpy(real_t alpha, rc_vector_t x, rc_vector_t* y){
+	if(unlikely(y==NULL)){
+		fprintf(stderr,"ERROR in rc_axpy, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!x.initialized || !y->initialized)){
+		fprintf(stderr,"ERROR in rc_axpy, vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(x.len!=y->len)){
+		fprintf(stderr,"ERROR in rc_axpy, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(x.d==y->d)){
+		fprintf(stderr,"ERROR in rc_axpy, x and y must not share memory\n");
+		return -1;
+	}
+	rc_scale_accumulate(alpha,x.d,y->d,x.len);
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_ger(float alpha, rc_vector_t x, rc_vector_t y, rc_matrix_t* A)
+*
+* Rank-1 update A=A+alpha*x*y' in place. A must already be x.len by y.len and
+* may be a view, but must not share memory with x or y.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_ger(real_t alpha, rc_vector_t x, rc_vector_t y, rc_matrix_t* A){
+	int i,j;
+	if(unlikely(A==NULL)){
+		fprintf(stderr,"ERROR in rc_ger, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A->initialized || !x.initialized || !y.initialized)){
+		fprintf(stderr,"ERROR in rc_ger, matrix or vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(A->rows!=x.len || A->cols!=y.len)){
+		fprintf(stderr,"ERROR in rc_ger, dimension mismatch\n");
+		return -1;
+	}
+	if(A->col_stride==1){
+		for(i=0;i<A->rows;i++) rc_scale_accumulate(alpha*x.d[i],y.d,&AT(*A,i,0),A->cols);
+	}
+	else if(A->row_stride==1){
+		for(j=0;j<A->cols;j++) rc_scale_accumulate(alpha*y.d[j],x.d,&AT(*A,0,j),A->rows);
+	}
+	else{
+		for(i=0;i<A->rows;i++){
+			for(j=0;j<A->cols;j++) AT(*A,i,j) += alpha*x.d[i]*y.d[j];
+		}
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_syrk(float alpha, rc_matrix_t A, float beta, rc_matrix_t* C)
+*
+* Symmetric rank-k update C=alpha*A*A'+beta*C. C must already be square with
+* A.rows rows and must not share memory with A. Only the lower triangle of C is
+* read, the result is written to both triangles so C stays exactly symmetric,
+* which is the point of using this over two multiplies for covariance updates.
+* For A'*A pass a transposed view of A, that layout is handled as a sum of
+* rank-1 updates so it still reads A in order.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_syrk(real_t alpha, rc_matrix_t A, real_t beta, rc_matrix_t* C){
+	int i,j,k;
+	real_t sum, aki;
+	const int n = A.rows;
+	if(unlikely(C==NULL)){
+		fprintf(stderr,"ERROR in rc_syrk, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized || !C->initialized)){
+		fprintf(stderr,"ERROR in rc_syrk, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(C->rows!=n || C->cols!=n)){
+		fprintf(stderr,"ERROR in rc_syrk, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(A.data==C->data)){
+		fprintf(stderr,"ERROR in rc_syrk, A and C must not share memory\n");
+		return -1;
+	}
+	// rows of A contiguous, each entry is a dot product of two rows
+	if(A.col_stride==1 || A.row_stride!=1){
+		for(i=0;i<n;i++){
+			for(j=0;j<=i;j++){
+				if(A.col_stride==1) sum = rc_mult_accumulate(&AT(A,i,0),&AT(A,j,0),A.cols);
+				else sum = rc_mult_accumulate_strided(&AT(A,i,0),A.col_stride,&AT(A,j,0),A.col_stride,A.cols);
+				sum *= alpha;
+				AT(*C,i,j) = (beta==0.0f) ? sum : sum+beta*AT(*C,i,j);
+			}
+		}
+	}
+	// columns of A contiguous, add up alpha*a*a' for each column a
+	else{
+		for(i=0;i<n;i++) scale_output(beta,&AT(*C,i,0),C->col_stride,i+1);
+		for(k=0;k<A.cols;k++){
+			for(i=0;i<n;i++){
+				aki = alpha*AT(A,i,k);
+				if(C->col_stride==1) rc_scale_accumulate(aki,&AT(A,0,k),&AT(*C,i,0),i+1);
+				else for(j=0;j<=i;j++) AT(*C,i,j) += aki*AT(A,j,k);
+			}
+		}
+	}
+	// mirror the lower triangle
+	for(i=0;i<n;i++){
+		for(j=0;j<i;j++) AT(*C,j,i) = AT(*C,i,j);
+	}
+	return 0;
+}
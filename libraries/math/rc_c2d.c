@@ -0,0 +1,326 @@
+/*******************************************************************************
+* rc_c2d.c
+*
+* Continuous to discrete conversion of SISO transfer functions into
+* rc_filter_t with zero-order hold, first-order hold or matched pole-zero.
+* Hold equivalents go through a state-space model and rc_c2d_ss_ws_d, and the
+* discrete transfer function is read back from characteristic polynomials.
+* Matched pole-zero maps every pole and zero through z=e^(s*dt). All the
+* arithmetic is done in double on workspace memory, and a filter that already
+* has the right order has its coefficients replaced in place so a controller
+* can be re-discretized at runtime without allocating or losing its state.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+#include <complex.h>
+
+// Durand-Kerner root finder limits
+#define ROOT_MAX_ITER	500
+#define ROOT_TOL		1e-14
+
+/*******************************************************************************
+* int charpoly(rc_matrix_d_t A, double* c, rc_workspace_t* w)
+*
+* only for use in this file. Writes the n+1 coefficients of det(zI-A), highest
+* power first, to c using the Faddeev-LeVerrier recursion M1=I, then
+* c_k=-trace(A*M_k)/k and M_k+1=A*M_k+c_k*I. Fine for the low orders used in
+* filters and controllers.
+*******************************************************************************/
+static int charpoly(rc_matrix_d_t A, double* c, rc_workspace_t* w){
+	int i, j, k, n = A.rows, ret = -1;
+	size_t mark = w->used;
+	double tr;
+	rc_matrix_d_t M = rc_empty_matrix_d();
+	rc_matrix_d_t AM = rc_empty_matrix_d();
+	if(unlikely(rc_workspace_matrix_d(w,&M,n,n) || rc_workspace_matrix_d(w,&AM,n,n))){
+		goto end;
+	}
+	for(i=0;i<n;i++){
+		for(j=0;j<n;j++) AT(M,i,j) = (i==j) ? 1.0 : 0.0;
+	}
+	c[0] = 1.0;
+	for(k=1;k<=n;k++){
+		if(unlikely(rc_multiply_matrices_ws_d(A,M,&AM,w))) goto end;
+		tr = 0.0;
+		for(i=0;i<n;i++) tr += AT(AM,i,i);
+		c[k] = -tr/k;
+		for(i=0;i<n;i++){
+			for(j=0;j<n;j++) AT(M,i,j) = AT(AM,i,j);
+			AT(M,i,i) += c[k];
+		}
+	}
+	ret = 0;
+end:
+	rc_workspace_rewind(w,mark);
+	return ret;
+}
+
+/*******************************************************************************
+* int poly_roots(double* p, int deg, double complex* r)
+*
+* only for use in this file. Finds all deg roots of the polynomial p, highest
+* power first with p[0] nonzero, by Durand-Kerner iteration. Repeated roots
+* only converge to around the square root of machine precision.
+* Returns 0 on success or -1 if it failed to converge.
+*******************************************************************************/
+static int poly_roots(double* p, int deg, double complex* r){
+	int i, j, k, it;
+	double bound, change;
+	double complex num, den, delta;
+	if(deg<1) return 0;
+	// start on a circle enclosing every root, at angles that aren't symmetric
+	bound = 0.0;
+	for(i=1;i<=deg;i++) if(fabs(p[i]/p[0])>bound) bound = fabs(p[i]/p[0]);
+	bound += 1.0;
+	for(i=0;i<deg;i++) r[i] = bound*cpow(0.4+0.9*I,i);
+	for(it=0;it<ROOT_MAX_ITER;it++){
+		change = 0.0;
+		for(i=0;i<deg;i++){
+			num = 1.0;
+			for(k=1;k<=deg;k++) num = num*r[i] + p[k]/p[0];
+			den = 1.0;
+			for(j=0;j<deg;j++) if(j!=i) den *= r[i]-r[j];
+			delta = num/den;
+			r[i] -= delta;
+			if(cabs(delta)>change) change = cabs(delta);
+		}
+		if(change<=ROOT_TOL*bound) return 0;
+	}
+	return -1;
+}
+
+/*******************************************************************************
+* void poly_from_roots(double complex* r, int n, int ones, int minus_ones, double complex* tmp, double* c)
+*
+* only for use in this file. Writes the coefficients of the monic polynomial
+* with the n roots in r plus 'ones' roots at z=1 and 'minus_ones' roots at
+* z=-1 to c, highest power first. tmp needs room for one more coefficient
+* than the result. Conjugate pairs make the imaginary parts cancel so only
+* the real parts are kept.
+*******************************************************************************/
+static void poly_from_roots(double complex* r, int n, int ones, int minus_ones, double complex* tmp, double* c){
+	int i, k, deg = 0;
+	double complex root;
+	tmp[0] = 1.0;
+	for(i=0;i<n+ones+minus_ones;i++){
+		if(i<n) root = r[i];
+		else if(i<n+ones) root = 1.0;
+		else root = -1.0;
+		// multiply by (z-root)
+		tmp[deg+1] = 0.0;
+		for(k=deg+1;k>0;k--) tmp[k] -= root*tmp[k-1];
+		deg++;
+	}
+	for(k=0;k<=deg;k++) c[k] = creal(tmp[k]);
+	return;
+}
+
+/*******************************************************************************
+* int hold_equivalent(double* num, double* den, int n, double dt, rc_c2d_method_t method, double* numz, double* denz, rc_workspace_t* w)
+*
+* only for use in this file. ZOH or FOH equivalent of num/den, where den has
+* order n and has been normalized so den[0]=1 and num has been padded to n+1
+* coefficients. The transfer function is put in controllable canonical form,
+* discretized with rc_c2d_ss_ws_d, and converted back with
+* den(z)=det(zI-Ad) and num(z)=det(zI-Ad+Bd*Cd)+(Dd-1)den(z).
+*******************************************************************************/
+static int hold_equivalent(double* num, double* den, int n, double dt, rc_c2d_method_t method, \
+				double* numz, double* denz, rc_workspace_t* w){
+	int i, ret = -1;
+	size_t mark = w->used;
+	rc_matrix_d_t A, B, C, D, Ad, Bd, Cd, Dd;
+	double* cp;
+	A = B = C = D = Ad = Bd = Cd = Dd = rc_empty_matrix_d();
+	if(unlikely(rc_workspace_matrix_d(w,&A,n,n)		|| \
+				rc_workspace_matrix_d(w,&B,n,1)		|| \
+				rc_workspace_matrix_d(w,&C,1,n)		|| \
+				rc_workspace_matrix_d(w,&D,1,1)		|| \
+				rc_workspace_matrix_d(w,&Ad,n,n)	|| \
+				rc_workspace_matrix_d(w,&Bd,n,1)	|| \
+				rc_workspace_matrix_d(w,&Cd,1,n)	|| \
+				rc_workspace_matrix_d(w,&Dd,1,1))){
+		fprintf(stderr,"ERROR in rc_c2d_ws, failed to get workspace\n");
+		goto end;
+	}
+	cp = (double*)rc_workspace_push(w,(n+1)*sizeof(double));
+	if(unlikely(cp==NULL)){
+		fprintf(stderr,"ERROR in rc_c2d_ws, failed to get workspace\n");
+		goto end;
+	}
+	// controllable canonical form
+	rc_matrix_zeros_d(&A,n,n);
+	rc_matrix_zeros_d(&B,n,1);
+	for(i=0;i<n;i++){
+		AT(A,0,i) = -den[i+1];
+		if(i>0) AT(A,i,i-1) = 1.0;
+		AT(C,0,i) = num[i+1]-num[0]*den[i+1];
+	}
+	AT(B,0,0) = 1.0;
+	AT(D,0,0) = num[0];
+	if(unlikely(rc_c2d_ss_ws_d(A,B,C,D,dt,method,&Ad,&Bd,&Cd,&Dd,w))) goto end;
+	if(unlikely(charpoly(Ad,denz,w))) goto end;
+	// Ad-Bd*Cd in place of A, which isn't needed any more
+	for(i=0;i<n*n;i++) A.data[i] = Ad.data[i] - Bd.data[i/n]*Cd.data[i%n];
+	if(unlikely(charpoly(A,cp,w))) goto end;
+	for(i=0;i<=n;i++) numz[i] = cp[i] + (AT(Dd,0,0)-1.0)*denz[i];
+	ret = 0;
+end:
+	rc_workspace_rewind(w,mark);
+	return ret;
+}
+
+/*******************************************************************************
+* int matched(double* num, int m, double* den, int n, double dt, double* numz, double* denz, rc_workspace_t* w)
+*
+* only for use in this file. Matched pole-zero equivalent of num/den with num
+* of order m<=n with a nonzero leading coefficient and den of order n. Roots
+* at s=0 are taken from trailing zero coefficients so integrators map exactly
+* to z=1. Zeros at infinity are placed at z=-1. The gain is matched at low
+* frequency, ignoring the s^k and ((z-1)/dt)^k factors the two have in common.
+*******************************************************************************/
+static int matched(double* num, int m, double* den, int n, double dt, \
+				double* numz, double* denz, rc_workspace_t* w){
+	int i, kn, kd, ret = -1;
+	size_t mark = w->used;
+	double complex gz, gp;
+	double complex *rz, *rp, *tmp;
+	rz = (double complex*)rc_workspace_push(w,(n+1)*sizeof(double complex));
+	rp = (double complex*)rc_workspace_push(w,(n+1)*sizeof(double complex));
+	tmp = (double complex*)rc_workspace_push(w,(n+2)*sizeof(double complex));
+	if(unlikely(rz==NULL || rp==NULL || tmp==NULL)){
+		fprintf(stderr,"ERROR in rc_c2d_ws, failed to get workspace\n");
+		goto end;
+	}
+	// exact roots at the origin
+	for(kn=0;kn<m && num[m-kn]==0.0;kn++);
+	for(kd=0;kd<n && den[n-kd]==0.0;kd++);
+	if(unlikely(poly_roots(num,m-kn,rz) || poly_roots(den,n-kd,rp))){
+		fprintf(stderr,"ERROR in rc_c2d_ws, failed to find poles and zeros\n");
+		goto end;
+	}
+	// map through z=e^(s*dt) and find the gain at z=1 without the z=1 roots
+	gz = 1.0;
+	gp = 1.0;
+	for(i=0;i<m-kn;i++){
+		rz[i] = cexp(rz[i]*dt);
+		gz *= 1.0-rz[i];
+	}
+	for(i=0;i<n-kd;i++){
+		rp[i] = cexp(rp[i]*dt);
+		gp *= 1.0-rp[i];
+	}
+	for(i=0;i<n-m;i++) gz *= 2.0;
+	poly_from_roots(rz,m-kn,kn,n-m,tmp,numz);
+	poly_from_roots(rp,n-kd,kd,0,tmp,denz);
+	// near s=0, z-1 is about s*dt
+	gz = (num[m-kn]/den[n-kd]) * gp / (gz*pow(dt,kn-kd));
+	for(i=0;i<=n;i++) numz[i] *= creal(gz);
+	ret = 0;
+end:
+	rc_workspace_rewind(w,mark);
+	return ret;
+}
+
+/*******************************************************************************
+* int rc_c2d_ws(rc_filter_t* f, rc_vector_t num, rc_vector_t den, float dt, rc_c2d_method_t method, rc_workspace_t* w)
+*
+* Creates a discrete time filter from the continuous time transfer function
+* num/den, coefficients highest power first, with timestep dt using
+* RC_C2D_ZOH, RC_C2D_FOH or RC_C2D_MATCHED. The transfer function must be
+* proper. If f is already a filter of the same order its coefficients and dt
+* are replaced in place, keeping its inputs, outputs, gain and saturation and
+* rescaling soft start to the new dt, so no memory is allocated. Otherwise any
+* memory owned by f is freed and a new filter is allocated. All temporaries
+* are taken from w. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_c2d_ws(rc_filter_t* f, rc_vector_t num, rc_vector_t den, float dt, \
+				rc_c2d_method_t method, rc_workspace_t* w){
+	int i, n, m, lead, ret = -1;
+	size_t mark;
+	double *nd, *dd, *numz, *denz;
+	rc_vector_t numf = rc_empty_vector();
+	rc_vector_t denf = rc_empty_vector();
+	if(unlikely(f==NULL || w==NULL)){
+		fprintf(stderr,"ERROR in rc_c2d_ws, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!num.initialized || !den.initialized)){
+		fprintf(stderr,"ERROR in rc_c2d_ws, vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(dt<=0.0f)){
+		fprintf(stderr,"ERROR in rc_c2d_ws, dt must be positive\n");
+		return -1;
+	}
+	if(unlikely(den.d[0]==0.0f)){
+		fprintf(stderr,"ERROR in rc_c2d_ws, leading denominator coefficient must be nonzero\n");
+		return -1;
+	}
+	if(unlikely(method!=RC_C2D_ZOH && method!=RC_C2D_FOH && method!=RC_C2D_MATCHED)){
+		fprintf(stderr,"ERROR in rc_c2d_ws, invalid method\n");
+		return -1;
+	}
+	// leading zeros in num don't change its order
+	for(lead=0;lead<num.len && num.d[lead]==0.0f;lead++);
+	if(unlikely(lead==num.len)){
+		fprintf(stderr,"ERROR in rc_c2d_ws, numerator is zero\n");
+		return -1;
+	}
+	n = den.len-1;
+	m = num.len-1-lead;
+	if(unlikely(m>n)){
+		fprintf(stderr,"ERROR in rc_c2d_ws, improper transfer function\n");
+		return -1;
+	}
+	mark = w->used;
+	nd = (double*)rc_workspace_push(w,(n+1)*sizeof(double));
+	dd = (double*)rc_workspace_push(w,(n+1)*sizeof(double));
+	numz = (double*)rc_workspace_push(w,(n+1)*sizeof(double));
+	denz = (double*)rc_workspace_push(w,(n+1)*sizeof(double));
+	if(unlikely(nd==NULL || dd==NULL || numz==NULL || denz==NULL)){
+		fprintf(stderr,"ERROR in rc_c2d_ws, failed to get workspace\n");
+		goto end;
+	}
+	// normalize so den is monic and pad num out to n+1 coefficients
+	for(i=0;i<=n;i++){
+		dd[i] = (double)den.d[i]/den.d[0];
+		nd[i] = (i<n-m) ? 0.0 : (double)num.d[lead+i-(n-m)]/den.d[0];
+	}
+	if(n==0){
+		numz[0] = nd[0];
+		denz[0] = 1.0;
+	}
+	else if(method==RC_C2D_MATCHED){
+		if(unlikely(matched(nd+n-m,m,dd,n,dt,numz,denz,w))) goto end;
+	}
+	else if(unlikely(hold_equivalent(nd,dd,n,dt,method,numz,denz,w))) goto end;
+	// replace the coefficients in place if the filter already fits
+	if(f->initialized && !f->ma_en && f->order==n && f->num.len==n+1){
+		for(i=0;i<=n;i++){
+			f->num.d[i] = numz[i];
+			f->den.d[i] = denz[i];
+		}
+		if(f->ss_en) f->ss_steps *= f->dt/dt;
+		f->dt = dt;
+		ret = 0;
+		goto end;
+	}
+	if(unlikely(rc_alloc_vector(&numf,n+1) || rc_alloc_vector(&denf,n+1))){
+		fprintf(stderr,"ERROR in rc_c2d_ws, failed to allocate memory\n");
+		goto end;
+	}
+	for(i=0;i<=n;i++){
+		numf.d[i] = numz[i];
+		denf.d[i] = denz[i];
+	}
+	if(unlikely(rc_alloc_filter(f,numf,denf,dt))){
+		fprintf(stderr,"ERROR in rc_c2d_ws, failed to alloc filter\n");
+		goto end;
+	}
+	ret = 0;
+end:
+	rc_free_vector(&numf);
+	rc_free_vector(&denf);
+	rc_workspace_rewind(w,mark);
+	return ret;
+}
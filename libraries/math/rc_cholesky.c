@@ -0,0 +1,472 @@
+/*******************************************************************************
+* rc_cholesky.c
+*
+* Cholesky (A=LL') and LDL' (A=LDL') factorizations for symmetric matrices
+* such as covariances and the normal equations of least-squares problems.
+* Both work in place on an rc_matrix_t which may be a view. Only the lower
+* triangle of A is read, and after factoring it holds L with the strictly upper
+* triangle zeroed so the matrix can be used directly as L. For LDL' the unit
+* diagonal of L is implied and the diagonal holds D instead. Factoring takes
+* half the work of LUP since symmetry lets every inner product be shared, and
+* no pivoting is needed for positive definite matrices.
+*
+* The rank-1 update and downdate functions modify an existing factor in O(n^2)
+* instead of refactoring the modified matrix in O(n^3).
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+/*******************************************************************************
+* int check_square(rc_matrix_t A, const char* fn)
+*
+* only for use in this file. Prints an error and returns -1 if A isn't an
+* initialized square matrix.
+*******************************************************************************/
+static int check_square(rc_matrix_t A, const char* fn){
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in %s, matrix uninitialized\n", fn);
+		return -1;
+	}
+	if(unlikely(A.rows!=A.cols)){
+		fprintf(stderr,"ERROR in %s, matrix is not square\n", fn);
+		return -1;
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* void zero_upper(rc_matrix_t A)
+*
+* only for use in this file. Zeros the strictly upper triangle of square A.
+*******************************************************************************/
+static void zero_upper(rc_matrix_t A){
+	int i,j;
+	for(i=0;i<A.rows;i++){
+		for(j=i+1;j<A.cols;j++) AT(A,i,j) = 0.0f;
+	}
+	return;
+}
+
+/*******************************************************************************
+* int rc_cholesky_decomp(rc_matrix_t* A)
+*
+* Factors symmetric positive definite matrix A into LL' in place. Only the
+* lower triangle of A is read. On success A holds lower triangular L with the
+* upper triangle zeroed. Returns 0 on success or -1 on failure. If A is not
+* positive definite -1 is returned and A is left partially factored.
+*******************************************************************************/
+int rc_cholesky_decomp(rc_matrix_t* A){
+	int i,j,n,cs;
+	real_t s;
+	if(unlikely(check_square(*A,"rc_cholesky_decomp"))) return -1;
+	n = A->rows;
+	cs = A->col_stride;
+	// row by row, each entry is one dot product of two rows already factored
+	for(i=0;i<n;i++){
+		for(j=0;j<i;j++){
+			s = rc_mult_accumulate_strided(&AT(*A,i,0),cs,&AT(*A,j,0),cs,j);
+			AT(*A,i,j) = (AT(*A,i,j)-s)/AT(*A,j,j);
+		}
+		s = AT(*A,i,i)-rc_sum_squares_strided(&AT(*A,i,0),cs,i);
+		if(unlikely(s<=0.0f)){
+			fprintf(stderr,"ERROR in rc_cholesky_decomp, matrix not positive definite\n");
+			return -1;
+		}
+		AT(*A,i,i) = sqrt(s);
+	}
+	zero_upper(*A);
+	return 0;
+}
+
+/*******************************************************************************
+* void chol_substitute(rc_matrix_t L, float* x, int stride)
+*
+* only for use in this file. Solves LL'x=b in place where x holds b on entry
+* and is read with the given stride.
+*******************************************************************************/
+static inline void chol_substitute(rc_matrix_t L, real_t* x, const int stride){
+	int i;
+	const int n = L.rows;
+	// forward substitution with L reads rows of L
+	for(i=0;i<n;i++){
+		x[i*stride] = (x[i*stride]-rc_mult_accumulate_strided(&AT(L,i,0), \
+				L.col_stride,x,stride,i))/AT(L,i,i);
+	}
+	// back substitution with L' reads columns of L
+	for(i=n-1;i>=0;i--){
+		x[i*stride] = (x[i*stride]-rc_mult_accumulate_strided(&AT(L,i+1,i), \
+				L.row_stride,&x[(i+1)*stride],stride,n-i-1))/AT(L,i,i);
+	}
+	return;
+}
+
+/*******************************************************************************
+* int rc_cholesky_solve(rc_matrix_t L, rc_vector_t b, rc_vector_t* x)
+*
+* Solves Ax=b where L is the Cholesky factor of A from rc_cholesky_decomp.
+* x is only allocated if it is not already the right length and may be the
+* same vector as b. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_cholesky_solve(rc_matrix_t L, rc_vector_t b, rc_vector_t* x){
+	if(unlikely(check_square(L,"rc_cholesky_solve"))) return -1;
+	if(unlikely(!b.initialized)){
+		fprintf(stderr,"ERROR in rc_cholesky_solve, vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(b.len!=L.rows)){
+		fprintf(stderr,"ERROR in rc_cholesky_solve, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_vector(x,b.len))){
+		fprintf(stderr,"ERROR in rc_cholesky_solve, failed to allocate x\n");
+		return -1;
+	}
+	if(x->d!=b.d) memcpy(x->d,b.d,b.len*sizeof(real_t));
+	chol_substitute(L,x->d,1);
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_cholesky_solve_matrix(rc_matrix_t L, rc_matrix_t B, rc_matrix_t* X)
+*
+* Solves AX=B for every column of B where L is the Cholesky factor of A.
+* X is only allocated if it is not already the right size. Either may be a view
+* and X may be the same matrix as B. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_cholesky_solve_matrix(rc_matrix_t L, rc_matrix_t B, rc_matrix_t* X){
+	int j;
+	if(unlikely(check_square(L,"rc_cholesky_solve_matrix"))) return -1;
+	if(unlikely(!B.initialized)){
+		fprintf(stderr,"ERROR in rc_cholesky_solve_matrix, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(B.rows!=L.rows)){
+		fprintf(stderr,"ERROR in rc_cholesky_solve_matrix, dimension mismatch\n");
+		return -1;
+	}
+	if(X->data!=B.data || X->row_stride!=B.row_stride || X->col_stride!=B.col_stride){
+		if(unlikely(rc_duplicate_matrix(B,X))){
+			fprintf(stderr,"ERROR in rc_cholesky_solve_matrix, failed to copy B\n");
+			return -1;
+		}
+	}
+	for(j=0;j<X->cols;j++) chol_substitute(L,&AT(*X,0,j),X->row_stride);
+	return 0;
+}
+
+/*******************************************************************************
+* int chol_rank1(rc_matrix_t* L, rc_vector_t v, float sign, const char* fn)
+*
+* only for use in this file. Turns L into the Cholesky factor of LL'+sign*vv'
+* with one sweep of plane rotations, hyperbolic ones when sign is negative.
+* For downdates the result is checked first so L is untouched if it would no
+* longer be positive definite.
+*******************************************************************************/
+static int chol_rank1(rc_matrix_t* L, rc_vector_t v, real_t sign, const char* fn){
+	int i,k,n;
+	real_t r,c,s,sum;
+	real_t* x;
+	if(unlikely(check_square(*L,fn))) return -1;
+	if(unlikely(!v.initialized)){
+		fprintf(stderr,"ERROR in %s, vector uninitialized\n", fn);
+		return -1;
+	}
+	if(unlikely(v.len!=L->rows)){
+		fprintf(stderr,"ERROR in %s, dimension mismatch\n", fn);
+		return -1;
+	}
+	n = v.len;
+	// v is rotated into L so work on a copy from the stack
+	x = alloca(n*sizeof(real_t));
+	if(unlikely(x==NULL)){
+		fprintf(stderr,"ERROR in %s, alloca failed, stack overflow\n", fn);
+		return -1;
+	}
+	memcpy(x,v.d,n*sizeof(real_t));
+	// LL'-vv' stays positive definite only if p=inv(L)v has |p|<1
+	if(sign<0.0f){
+		sum = 0.0f;
+		for(i=0;i<n;i++){
+			x[i] = (x[i]-rc_mult_accumulate_strided(&AT(*L,i,0), \
+					L->col_stride,x,1,i))/AT(*L,i,i);
+			sum += x[i]*x[i];
+		}
+		if(unlikely(sum>=1.0f)){
+			fprintf(stderr,"ERROR in %s, result not positive definite\n", fn);
+			return -1;
+		}
+		memcpy(x,v.d,n*sizeof(real_t));
+	}
+	for(k=0;k<n;k++){
+		r = AT(*L,k,k)*AT(*L,k,k) + sign*x[k]*x[k];
+		if(unlikely(r<=0.0f)){
+			fprintf(stderr,"ERROR in %s, result not positive definite\n", fn);
+			return -1;
+		}
+		r = sqrt(r);
+		c = r/AT(*L,k,k);
+		s = x[k]/AT(*L,k,k);
+		AT(*L,k,k) = r;
+		for(i=k+1;i<n;i++){
+			AT(*L,i,k) = (AT(*L,i,k) + sign*s*x[i])/c;
+			x[i] = c*x[i] - s*AT(*L,i,k);
+		}
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_cholesky_update(rc_matrix_t* L, rc_vector_t v)
+*
+* Modifies Cholesky factor L of A in place so it becomes the factor of A+vv'.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_cholesky_update(rc_matrix_t* L, rc_vector_t v){
+	return chol_rank1(L,v,1.0f,"rc_cholesky_update");
+}
+
+/*******************************************************************************
+* int rc_cholesky_downdate(rc_matrix_t* L, rc_vector_t v)
+*
+* Modifies Cholesky factor L of A in place so it becomes the factor of A-vv'.
+* Returns 0 on success or -1 on failure. If A-vv' would not be positive
+* definite -1 is returned and L is left untouched.
+*******************************************************************************/
+int rc_cholesky_downdate(rc_matrix_t* L, rc_vector_t v){
+	return chol_rank1(L,v,-1.0f,"rc_cholesky_downdate");
+}
+
+/*******************************************************************************
+* float rc_cholesky_log_det(rc_matrix_t L)
+*
+* Returns the natural log of the determinant of A=LL', twice the sum of the
+* logs of the diagonal of L. This stays finite for large and badly scaled
+* covariances where the determinant itself would overflow or underflow.
+* Returns -1.0f on failure.
+*******************************************************************************/
+real_t rc_cholesky_log_det(rc_matrix_t L){
+	int i;
+	real_t sum = 0.0f;
+	if(unlikely(check_square(L,"rc_cholesky_log_det"))) return -1.0f;
+	for(i=0;i<L.rows;i++) sum += log(AT(L,i,i));
+	return 2.0f*sum;
+}
+
+/*******************************************************************************
+* int rc_ldl_decomp(rc_matrix_t* A)
+*
+* Factors symmetric matrix A into LDL' in place where L is unit lower
+* triangular and D is diagonal. Only the lower triangle of A is read. On success
+* the strictly lower triangle of A holds L, the diagonal holds D, and the upper
+* triangle is zeroed. Unlike Cholesky no square roots are taken and D may have
+* negative entries, but there is no pivoting so every leading submatrix of A
+* must be nonsingular as is the case for positive definite matrices.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_ldl_decomp(rc_matrix_t* A){
+	int i,j,n,cs;
+	real_t s;
+	real_t* w;
+	if(unlikely(check_square(*A,"rc_ldl_decomp"))) return -1;
+	n = A->rows;
+	cs = A->col_stride;
+	// w holds L(i,k)*D(k) for the current row so each entry is one dot product
+	w = alloca(n*sizeof(real_t));
+	if(unlikely(w==NULL)){
+		fprintf(stderr,"ERROR in rc_ldl_decomp, alloca failed, stack overflow\n");
+		return -1;
+	}
+	for(i=0;i<n;i++){
+		for(j=0;j<i;j++){
+			w[j] = AT(*A,i,j)-rc_mult_accumulate_strided(w,1,&AT(*A,j,0),cs,j);
+			AT(*A,i,j) = w[j]/AT(*A,j,j);
+		}
+		s = AT(*A,i,i)-rc_mult_accumulate_strided(w,1,&AT(*A,i,0),cs,i);
+		if(unlikely(s==0.0f)){
+			fprintf(stderr,"ERROR in rc_ldl_decomp, zero pivot, matrix singular\n");
+			return -1;
+		}
+		AT(*A,i,i) = s;
+	}
+	zero_upper(*A);
+	return 0;
+}
+
+/*******************************************************************************
+* void ldl_substitute(rc_matrix_t LD, float* x, int stride)
+*
+* only for use in this file. Solves LDL'x=b in place where x holds b on entry
+* and is read with the given stride.
+*******************************************************************************/
+static inline void ldl_substitute(rc_matrix_t LD, real_t* x, const int stride){
+	int i;
+	const int n = LD.rows;
+	for(i=1;i<n;i++){
+		x[i*stride] -= rc_mult_accumulate_strided(&AT(LD,i,0),LD.col_stride,x,stride,i);
+	}
+	for(i=0;i<n;i++) x[i*stride] /= AT(LD,i,i);
+	for(i=n-2;i>=0;i--){
+		x[i*stride] -= rc_mult_accumulate_strided(&AT(LD,i+1,i),LD.row_stride, \
+				&x[(i+1)*stride],stride,n-i-1);
+	}
+	return;
+}
+
+/*******************************************************************************
+* int rc_ldl_solve(rc_matrix_t LD, rc_vector_t b, rc_vector_t* x)
+*
+* Solves Ax=b where LD holds the LDL' factorization of A from rc_ldl_decomp.
+* x is only allocated if it is not already the right length and may be the
+* same vector as b. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_ldl_solve(rc_matrix_t LD, rc_vector_t b, rc_vector_t* x){
+	if(unlikely(check_square(LD,"rc_ldl_solve"))) return -1;
+	if(unlikely(!b.initialized)){
+		fprintf(stderr,"ERROR in rc_ldl_solve, vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(b.len!=LD.rows)){
+		fprintf(stderr,"ERROR in rc_ldl_solve, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_vector(x,b.len))){
+		fprintf(stderr,"ERROR in rc_ldl_solve, failed to allocate x\n");
+		return -1;
+	}
+	if(x->d!=b.d) memcpy(x->d,b.d,b.len*sizeof(real_t));
+	ldl_substitute(LD,x->d,1);
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_ldl_solve_matrix(rc_matrix_t LD, rc_matrix_t B, rc_matrix_t* X)
+*
+* Solves AX=B for every column of B where LD holds the LDL' factorization of A.
+* X is only allocated if it is not already the right size. Either may be a view
+* and X may be the same matrix as B. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_ldl_solve_matrix(rc_matrix_t LD, rc_matrix_t B, rc_matrix_t* X){
+	int j;
+	if(unlikely(check_square(LD,"rc_ldl_solve_matrix"))) return -1;
+	if(unlikely(!B.initialized)){
+		fprintf(stderr,"ERROR in rc_ldl_solve_matrix, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(B.rows!=LD.rows)){
+		fprintf(stderr,"ERROR in rc_ldl_solve_matrix, dimension mismatch\n");
+		return -1;
+	}
+	if(X->data!=B.data || X->row_stride!=B.row_stride || X->col_stride!=B.col_stride){
+		if(unlikely(rc_duplicate_matrix(B,X))){
+			fprintf(stderr,"ERROR in rc_ldl_solve_matrix, failed to copy B\n");
+			return -1;
+		}
+	}
+	for(j=0;j<X->cols;j++) ldl_substitute(LD,&AT(*X,0,j),X->row_stride);
+	return 0;
+}
+
+/*******************************************************************************
+* int ldl_rank1(rc_matrix_t* LD, rc_vector_t v, float alpha, const char* fn)
+*
+* only for use in this file. Turns LD into the LDL' factorization of
+* LDL'+alpha*vv' using method C1 of Gill, Golub, Murray and Saunders. For
+* downdates of a positive definite matrix the result is checked first so LD is
+* untouched if it would no longer be positive definite.
+*******************************************************************************/
+static int ldl_rank1(rc_matrix_t* LD, rc_vector_t v, real_t alpha, const char* fn){
+	int i,j,n;
+	real_t p,d,beta,sum;
+	real_t* w;
+	if(unlikely(check_square(*LD,fn))) return -1;
+	if(unlikely(!v.initialized)){
+		fprintf(stderr,"ERROR in %s, vector uninitialized\n", fn);
+		return -1;
+	}
+	if(unlikely(v.len!=LD->rows)){
+		fprintf(stderr,"ERROR in %s, dimension mismatch\n", fn);
+		return -1;
+	}
+	n = v.len;
+	w = alloca(n*sizeof(real_t));
+	if(unlikely(w==NULL)){
+		fprintf(stderr,"ERROR in %s, alloca failed, stack overflow\n", fn);
+		return -1;
+	}
+	memcpy(w,v.d,n*sizeof(real_t));
+	// LDL'-vv' stays positive definite only if p=inv(L)v has p'inv(D)p<1
+	if(alpha<0.0f){
+		sum = 0.0f;
+		for(i=0;i<n;i++){
+			if(unlikely(AT(*LD,i,i)<=0.0f)){
+				fprintf(stderr,"ERROR in %s, matrix not positive definite\n", fn);
+				return -1;
+			}
+			w[i] -= rc_mult_accumulate_strided(&AT(*LD,i,0),LD->col_stride,w,1,i);
+			sum += w[i]*w[i]/AT(*LD,i,i);
+		}
+		if(unlikely(sum>=1.0f)){
+			fprintf(stderr,"ERROR in %s, result not positive definite\n", fn);
+			return -1;
+		}
+		memcpy(w,v.d,n*sizeof(real_t));
+	}
+	for(j=0;j<n;j++){
+		p = w[j];
+		d = AT(*LD,j,j) + alpha*p*p;
+		if(unlikely(d==0.0f)){
+			fprintf(stderr,"ERROR in %s, zero pivot, result singular\n", fn);
+			return -1;
+		}
+		beta = p*alpha/d;
+		alpha = AT(*LD,j,j)*alpha/d;
+		AT(*LD,j,j) = d;
+		for(i=j+1;i<n;i++){
+			w[i] -= p*AT(*LD,i,j);
+			AT(*LD,i,j) += beta*w[i];
+		}
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_ldl_update(rc_matrix_t* LD, rc_vector_t v)
+*
+* Modifies LDL' factorization LD of A in place so it becomes the factorization
+* of A+vv'. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_ldl_update(rc_matrix_t* LD, rc_vector_t v){
+	return ldl_rank1(LD,v,1.0f,"rc_ldl_update");
+}
+
+/*******************************************************************************
+* int rc_ldl_downdate(rc_matrix_t* LD, rc_vector_t v)
+*
+* Modifies LDL' factorization LD of positive definite A in place so it becomes
+* the factorization of A-vv'. Returns 0 on success or -1 on failure. If A-vv'
+* would not be positive definite -1 is returned and LD is left untouched.
+*******************************************************************************/
+int rc_ldl_downdate(rc_matrix_t* LD, rc_vector_t v){
+	return ldl_rank1(LD,v,-1.0f,"rc_ldl_downdate");
+}
+
+/*******************************************************************************
+* float rc_ldl_log_det(rc_matrix_t LD)
+*
+* Returns the natural log of the determinant of A=LDL', the sum of the logs of
+* the diagonal of D. A must be positive definite so every entry of D is
+* positive. Returns -1.0f on failure.
+*******************************************************************************/
+real_t rc_ldl_log_det(rc_matrix_t LD){
+	int i;
+	real_t sum = 0.0f;
+	if(unlikely(check_square(LD,"rc_ldl_log_det"))) return -1.0f;
+	for(i=0;i<LD.rows;i++){
+		if(unlikely(AT(LD,i,i)<=0.0f)){
+			fprintf(stderr,"ERROR in rc_ldl_log_det, matrix not positive definite\n");
+			return -1.0f;
+		}
+		sum += log(AT(LD,i,i));
+	}
+	return sum;
+}
@@ -0,0 +1,228 @@
+/*******************************************************************************
+* rc_expm.c
+*
+* Matrix exponential and exact discretization of continuous-time state-space
+* models. The exponential uses a diagonal Pade approximant with scaling and
+* squaring. Discretization builds one block matrix and exponentiates it, which
+* gives the zero-order or first-order hold model without any series or
+* integrals to truncate. Everything temporary comes from an rc_workspace_t so
+* a model can be re-discretized at runtime, for example when the loop rate
+* changes, without touching the heap. Written with real_t so it is built in
+* both float and double, see rc_real.h.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+// degree of the Pade approximant and the norm it's accurate to. With q=6 and
+// ||A||<=0.5 the truncation error is below double rounding, the same choice
+// as the classic Moler and Van Loan algorithm
+#define PADE_Q		6
+#define PADE_NORM	0.5f
+
+/*******************************************************************************
+* real_t norm_1(rc_matrix_t A)
+*
+* only for use in this file. Returns the 1-norm of A, its largest absolute
+* column sum.
+*******************************************************************************/
+static real_t norm_1(rc_matrix_t A){
+	int i,j;
+	real_t sum, max = 0.0f;
+	for(j=0;j<A.cols;j++){
+		sum = 0.0f;
+		for(i=0;i<A.rows;i++) sum += fabs(AT(A,i,j));
+		if(sum>max) max = sum;
+	}
+	return max;
+}
+
+/*******************************************************************************
+* int rc_expm_ws(rc_matrix_t A, rc_matrix_t* E, rc_workspace_t* w)
+*
+* Computes the matrix exponential E=e^A. A is first scaled by 2^-s so its
+* 1-norm is at most PADE_NORM, then e^(A/2^s) is approximated by the (6,6)
+* Pade approximant D^-1 N, found with an LU solve, and finally squared s times.
+* All temporaries are taken from w. E is only allocated if it is not already
+* the right size, may be a view, and must not share memory with A.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_expm_ws(rc_matrix_t A, rc_matrix_t* E, rc_workspace_t* w){
+	int i, j, k, n, s, ret = -1;
+	size_t mark;
+	real_t norm, c, scale;
+	rc_matrix_t X, Xk, T, N, D;
+	rc_lu_t f;
+	if(unlikely(E==NULL || w==NULL)){
+		fprintf(stderr,"ERROR in rc_expm_ws, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_expm_ws, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(A.rows!=A.cols)){
+		fprintf(stderr,"ERROR in rc_expm_ws, nonsquare matrix\n");
+		return -1;
+	}
+	n = A.rows;
+	mark = w->used;
+	X = Xk = T = N = D = rc_empty_matrix();
+	if(unlikely(rc_workspace_matrix(w,&X,n,n)	|| \
+				rc_workspace_matrix(w,&Xk,n,n)	|| \
+				rc_workspace_matrix(w,&T,n,n)	|| \
+				rc_workspace_matrix(w,&N,n,n)	|| \
+				rc_workspace_matrix(w,&D,n,n)	|| \
+				ws_lu(w,&f,n))){
+		fprintf(stderr,"ERROR in rc_expm_ws, failed to get workspace\n");
+		goto end;
+	}
+	// choose s so the scaled matrix is small enough for the approximant
+	norm = norm_1(A);
+	s = 0;
+	if(norm>PADE_NORM){
+		frexp(norm/PADE_NORM,&s);
+		if(s<0) s = 0;
+	}
+	scale = ldexp(1.0,-s);
+	for(i=0;i<n;i++){
+		for(j=0;j<n;j++) AT(X,i,j) = scale*AT(A,i,j);
+	}
+	// N = sum c_k X^k and D = sum (-1)^k c_k X^k
+	c = 0.5f;
+	for(i=0;i<n;i++){
+		for(j=0;j<n;j++){
+			AT(Xk,i,j) = AT(X,i,j);
+			AT(N,i,j) = c*AT(X,i,j);
+			AT(D,i,j) = -c*AT(X,i,j);
+		}
+		AT(N,i,i) += 1.0f;
+		AT(D,i,i) += 1.0f;
+	}
+	for(k=2;k<=PADE_Q;k++){
+		c = c*(PADE_Q-k+1)/(k*(2*PADE_Q-k+1));
+		if(unlikely(rc_multiply_matrices_ws(X,Xk,&T,w))) goto end;
+		rc_duplicate_matrix(T,&Xk);
+		for(i=0;i<n;i++){
+			for(j=0;j<n;j++){
+				AT(N,i,j) += c*AT(Xk,i,j);
+				AT(D,i,j) += ((k&1) ? -c : c)*AT(Xk,i,j);
+			}
+		}
+	}
+	if(unlikely(rc_lu_factor(D,&f))){
+		fprintf(stderr,"ERROR in rc_expm_ws, Pade denominator is singular\n");
+		goto end;
+	}
+	if(unlikely(rc_lu_solve_matrix(f,N,E))){
+		fprintf(stderr,"ERROR in rc_expm_ws, failed to solve for Pade approximant\n");
+		goto end;
+	}
+	// undo the scaling, e^A = (e^(A/2^s))^(2^s)
+	for(k=0;k<s;k++){
+		if(unlikely(rc_multiply_matrices_ws(*E,*E,&T,w))) goto end;
+		rc_duplicate_matrix(T,E);
+	}
+	ret = 0;
+
+end:
+	rc_workspace_rewind(w,mark);
+	return ret;
+}
+
+/*******************************************************************************
+* int rc_c2d_ss_ws(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, rc_matrix_t D, real_t dt, rc_c2d_method_t method, rc_matrix_t* Ad, rc_matrix_t* Bd, rc_matrix_t* Cd, rc_matrix_t* Dd, rc_workspace_t* w)
+*
+* Discretizes the continuous-time model x'=Ax+Bu, y=Cx+Du with timestep dt.
+* With RC_C2D_ZOH the input is held constant over each step and
+*
+* exp([A B; 0 0]dt) = [Ad Bd; 0 I]
+*
+* With RC_C2D_FOH the input is a straight line between samples and the same
+* exponential of [A B 0; 0 0 I/dt; 0 0 0]dt gives Ad, G1 and G2. Moving the
+* state by G2*u to keep the model causal gives Bd=G1+(Ad-I)G2 and Dd=D+C*G2.
+* D may be an empty matrix for no feedthrough. Outputs are only allocated if
+* they are not already the right size, may be views, and must not share
+* memory with the inputs. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_c2d_ss_ws(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, rc_matrix_t D, real_t dt, \
+			rc_c2d_method_t method, rc_matrix_t* Ad, rc_matrix_t* Bd, rc_matrix_t* Cd, \
+			rc_matrix_t* Dd, rc_workspace_t* w){
+	int i, j, n, m, p, dim, ret = -1;
+	size_t mark;
+	rc_matrix_t M, E, G1, G2, T;
+	if(unlikely(Ad==NULL || Bd==NULL || Cd==NULL || Dd==NULL || w==NULL)){
+		fprintf(stderr,"ERROR in rc_c2d_ss_ws, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized || !B.initialized || !C.initialized)){
+		fprintf(stderr,"ERROR in rc_c2d_ss_ws, A, B or C uninitialized\n");
+		return -1;
+	}
+	n = A.rows;
+	m = B.cols;
+	p = C.rows;
+	if(unlikely(A.cols!=n || B.rows!=n || C.cols!=n || \
+			(D.initialized && (D.rows!=p || D.cols!=m)))){
+		fprintf(stderr,"ERROR in rc_c2d_ss_ws, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(dt<=0.0f)){
+		fprintf(stderr,"ERROR in rc_c2d_ss_ws, dt must be positive\n");
+		return -1;
+	}
+	if(method==RC_C2D_ZOH) dim = n+m;
+	else if(method==RC_C2D_FOH) dim = n+2*m;
+	else{
+		fprintf(stderr,"ERROR in rc_c2d_ss_ws, state-space models support ZOH and FOH only\n");
+		return -1;
+	}
+	mark = w->used;
+	M = E = G1 = G2 = T = rc_empty_matrix();
+	if(unlikely(rc_workspace_matrix(w,&M,dim,dim) || rc_workspace_matrix(w,&E,dim,dim))){
+		fprintf(stderr,"ERROR in rc_c2d_ss_ws, failed to get workspace\n");
+		goto end;
+	}
+	// block matrix [A B 0; 0 0 I; 0 0 0] already multiplied by dt
+	for(i=0;i<dim;i++){
+		for(j=0;j<dim;j++) AT(M,i,j) = 0.0f;
+	}
+	for(i=0;i<n;i++){
+		for(j=0;j<n;j++) AT(M,i,j) = dt*AT(A,i,j);
+		for(j=0;j<m;j++) AT(M,i,n+j) = dt*AT(B,i,j);
+	}
+	if(method==RC_C2D_FOH){
+		for(j=0;j<m;j++) AT(M,n+j,n+m+j) = 1.0f;
+	}
+	if(unlikely(rc_expm_ws(M,&E,w))){
+		fprintf(stderr,"ERROR in rc_c2d_ss_ws, failed to find matrix exponential\n");
+		goto end;
+	}
+	rc_matrix_slice(E,0,0,n,n,&T);
+	rc_matrix_slice(E,0,n,n,m,&G1);
+	if(unlikely(rc_duplicate_matrix(T,Ad) || rc_duplicate_matrix(G1,Bd) || \
+				rc_duplicate_matrix(C,Cd))){
+		fprintf(stderr,"ERROR in rc_c2d_ss_ws, failed to write output\n");
+		goto end;
+	}
+	if(D.initialized) rc_duplicate_matrix(D,Dd);
+	else rc_matrix_zeros(Dd,p,m);
+	if(method==RC_C2D_FOH){
+		// Bd = G1 + Ad*G2 - G2 and Dd = D + C*G2
+		rc_matrix_slice(E,0,n+m,n,m,&G2);
+		T = rc_empty_matrix();
+		if(unlikely(rc_workspace_matrix(w,&T,n,m) || \
+					rc_multiply_matrices_ws(*Ad,G2,&T,w))) goto end;
+		for(i=0;i<n;i++){
+			for(j=0;j<m;j++) AT(*Bd,i,j) += AT(T,i,j)-AT(G2,i,j);
+		}
+		T = rc_empty_matrix();
+		if(unlikely(rc_workspace_matrix(w,&T,p,m) || \
+					rc_multiply_matrices_ws(C,G2,&T,w))) goto end;
+		rc_add_matrices_inplace(Dd,T);
+	}
+	ret = 0;
+
+end:
+	rc_workspace_rewind(w,mark);
+	return ret;
+}
@@ -0,0 +1,345 @@
+/*******************************************************************************
+* rc_fft.c
+*
+* In-place FFT of real signals. n real samples are treated as n/2 complex
+* samples, transformed with an iterative decimation-in-time complex FFT, and
+* then split into the spectrum of the real signal in one extra O(n) pass. The
+* first two stages of the complex FFT are done together as one radix-4 pass
+* since their twiddle factors are just 1 and -i, and the remaining radix-2
+* passes each handle 4 butterflies per SIMD register with NEON or SSE.
+*
+* Everything that depends only on the size, the twiddle factors and the
+* bit-reversal permutation, is computed once in double precision by
+* rc_alloc_fft_plan so the transforms themselves never call sin, cos or
+* malloc and are safe to run from a background thread while the control loop
+* runs on another.
+*******************************************************************************/
+
+#include "../roboticscape.h"
+#include "../preprocessor_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+	#include <arm_neon.h>
+#elif defined(__SSE__)
+	#include <xmmintrin.h>
+#endif
+
+// twiddle tables are aligned to one SIMD register
+#define FFT_ALIGN		16
+// largest transform allowed, far more than a vibration spectrum needs
+#define FFT_MAX_LOG2	20
+
+/*******************************************************************************
+* rc_fft_plan_t rc_empty_fft_plan()
+*
+* Returns an rc_fft_plan_t with no allocated memory and the initialized flag
+* set to 0. Use this to initialize plans before calling rc_alloc_fft_plan.
+*******************************************************************************/
+rc_fft_plan_t rc_empty_fft_plan(){
+	rc_fft_plan_t out;
+	// zero-out piecemeal instead of with memset to avoid issues with padding
+	out.n			= 0;
+	out.tw			= NULL;
+	out.rtw			= NULL;
+	out.swap		= NULL;
+	out.swaps		= 0;
+	out.initialized	= 0;
+	return out;
+}
+
+/*******************************************************************************
+* int rc_alloc_fft_plan(rc_fft_plan_t* p, int n)
+*
+* Precomputes everything needed to transform n real samples. n must be a
+* power of two and at least 4. Any existing memory allocated for p is freed
+* first. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_fft_plan(rc_fft_plan_t* p, int n){
+	int i, j, k, m, bits, half;
+	size_t floats;
+	float* mem;
+	float* tw;
+	if(unlikely(p==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_fft_plan, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(n<4 || n>(1<<FFT_MAX_LOG2) || (n&(n-1)))){
+		fprintf(stderr,"ERROR in rc_alloc_fft_plan, n must be a power of two between 4 and 2^%d\n", FFT_MAX_LOG2);
+		return -1;
+	}
+	rc_free_fft_plan(p);
+	half = n/2;
+	for(bits=0;(1<<bits)<half;bits++);
+	// one block holds the butterfly twiddles, at most 2*half floats, then the
+	// real split twiddles for k=0..half/2, then the bit-reversal pairs
+	floats = 2*half + 2*(half/2+1);
+	if(unlikely(posix_memalign((void**)&mem, FFT_ALIGN, \
+				floats*sizeof(float) + half*sizeof(int)))){
+		fprintf(stderr,"ERROR in rc_alloc_fft_plan, failed to allocate memory\n");
+		return -1;
+	}
+	p->tw = mem;
+	p->rtw = mem+2*half;
+	p->swap = (int*)(mem+floats);
+	// each radix-2 pass after the first radix-4 one combines blocks of size m
+	// and stores cos then -sin of pi*j/m for j=0..m-1
+	tw = p->tw;
+	for(m=4;m<half;m*=2){
+		for(j=0;j<m;j++){
+			tw[j]	= cos(M_PI*j/m);
+			tw[m+j]	= -sin(M_PI*j/m);
+		}
+		tw += 2*m;
+	}
+	// cos and sin of 2*pi*k/n for splitting the real spectrum
+	for(k=0;k<=half/2;k++){
+		p->rtw[2*k]		= cos(2.0*M_PI*k/n);
+		p->rtw[2*k+1]	= sin(2.0*M_PI*k/n);
+	}
+	// pairs of complex samples swapped to put the input in bit-reversed order
+	p->swaps = 0;
+	for(i=0;i<half;i++){
+		k = 0;
+		for(j=0;j<bits;j++) if(i&(1<<j)) k |= 1<<(bits-1-j);
+		if(i<k){
+			p->swap[2*p->swaps]		= i;
+			p->swap[2*p->swaps+1]	= k;
+			p->swaps++;
+		}
+	}
+	p->n = n;
+	p->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_fft_plan(rc_fft_plan_t* p)
+*
+* Frees the memory allocated for a plan and sets its initialized flag to 0.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_fft_plan(rc_fft_plan_t* p){
+	if(unlikely(p==NULL)){
+		fprintf(stderr,"ERROR in rc_free_fft_plan, received NULL pointer\n");
+		return -1;
+	}
+	if(p->initialized) free(p->tw);
+	*p = rc_empty_fft_plan();
+	return 0;
+}
+
+/*******************************************************************************
+* void radix2_pass(float* x, int half, int m, const float* tw)
+*
+* only for use in this file. One decimation-in-time pass over half complex
+* samples interleaved in x, combining every pair of neighbouring blocks of m
+* samples with the twiddles cos tw[j] and -sin tw[m+j]. m is always a multiple
+* of 4 so the SIMD paths need no remainder loop.
+*******************************************************************************/
+static void radix2_pass(float* __restrict__ x, int half, int m, const float* __restrict__ tw){
+	int b, j;
+	const float* wr = tw;
+	const float* wi = tw+m;
+	for(b=0;b<half;b+=2*m){
+		float* u = x+2*b;
+		float* v = x+2*(b+m);
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+		for(j=0;j<m;j+=4){
+			// vld2 splits interleaved complex values into re and im registers
+			float32x4x2_t uv = vld2q_f32(u+2*j);
+			float32x4x2_t vv = vld2q_f32(v+2*j);
+			float32x4_t cr = vld1q_f32(wr+j);
+			float32x4_t ci = vld1q_f32(wi+j);
+			float32x4_t tr = vmlsq_f32(vmulq_f32(vv.val[0],cr), vv.val[1], ci);
+			float32x4_t ti = vmlaq_f32(vmulq_f32(vv.val[0],ci), vv.val[1], cr);
+			float32x4x2_t out;
+			out.val[0] = vsubq_f32(uv.val[0], tr);
+			out.val[1] = vsubq_f32(uv.val[1], ti);
+			vst2q_f32(v+2*j, out);
+			out.val[0] = vaddq_f32(uv.val[0], tr);
+			out.val[1] = vaddq_f32(uv.val[1], ti);
+			vst2q_f32(u+2*j, out);
+		}
+#elif defined(__SSE__)
+		for(j=0;j<m;j+=4){
+			// deinterleave two registers of re,im pairs with shuffles
+			__m128 a0 = _mm_loadu_ps(u+2*j);
+			__m128 a1 = _mm_loadu_ps(u+2*j+4);
+			__m128 b0 = _mm_loadu_ps(v+2*j);
+			__m128 b1 = _mm_loadu_ps(v+2*j+4);
+			__m128 ur = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2,0,2,0));
+			__m128 ui = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3,1,3,1));
+			__m128 vr = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2,0,2,0));
+			__m128 vi = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3,1,3,1));
+			__m128 cr = _mm_load_ps(wr+j);
+			__m128 ci = _mm_load_ps(wi+j);
+			__m128 tr = _mm_sub_ps(_mm_mul_ps(vr,cr), _mm_mul_ps(vi,ci));
+			__m128 ti = _mm_add_ps(_mm_mul_ps(vr,ci), _mm_mul_ps(vi,cr));
+			__m128 sr = _mm_add_ps(ur, tr);
+			__m128 si = _mm_add_ps(ui, ti);
+			__m128 dr = _mm_sub_ps(ur, tr);
+			__m128 di = _mm_sub_ps(ui, ti);
+			_mm_storeu_ps(u+2*j,	_mm_unpacklo_ps(sr, si));
+			_mm_storeu_ps(u+2*j+4,	_mm_unpackhi_ps(sr, si));
+			_mm_storeu_ps(v+2*j,	_mm_unpacklo_ps(dr, di));
+			_mm_storeu_ps(v+2*j+4,	_mm_unpackhi_ps(dr, di));
+		}
+#else
+		for(j=0;j<m;j++){
+			float tr = v[2*j]*wr[j] - v[2*j+1]*wi[j];
+			float ti = v[2*j]*wi[j] + v[2*j+1]*wr[j];
+			v[2*j]		= u[2*j] - tr;
+			v[2*j+1]	= u[2*j+1] - ti;
+			u[2*j]		+= tr;
+			u[2*j+1]	+= ti;
+		}
+#endif
+	}
+	return;
+}
+
+/*******************************************************************************
+* void fft_complex(const rc_fft_plan_t* p, float* x)
+*
+* only for use in this file. Forward complex FFT of the n/2 interleaved
+* complex samples in x, in place and unnormalized.
+*******************************************************************************/
+static void fft_complex(const rc_fft_plan_t* p, float* x){
+	int i, a, b, m;
+	const int half = p->n/2;
+	const float* tw = p->tw;
+	float t;
+	// bit-reversed order
+	for(i=0;i<p->swaps;i++){
+		a = 2*p->swap[2*i];
+		b = 2*p->swap[2*i+1];
+		t = x[a];	x[a] = x[b];	x[b] = t;
+		t = x[a+1];	x[a+1] = x[b+1];	x[b+1] = t;
+	}
+	if(half==2){
+		float r0 = x[0], i0 = x[1];
+		x[0] = r0+x[2];		x[1] = i0+x[3];
+		x[2] = r0-x[2];		x[3] = i0-x[3];
+		return;
+	}
+	// first two stages as one radix-4 pass, twiddles 1 and -i
+	for(i=0;i<2*half;i+=8){
+		float* y = x+i;
+		float t0r = y[0]+y[2], t0i = y[1]+y[3];
+		float t1r = y[0]-y[2], t1i = y[1]-y[3];
+		float t2r = y[4]+y[6], t2i = y[5]+y[7];
+		float t3r = y[4]-y[6], t3i = y[5]-y[7];
+		y[0] = t0r+t2r;		y[1] = t0i+t2i;
+		y[4] = t0r-t2r;		y[5] = t0i-t2i;
+		// -i*t3 = (t3i, -t3r)
+		y[2] = t1r+t3i;		y[3] = t1i-t3r;
+		y[6] = t1r-t3i;		y[7] = t1i+t3r;
+	}
+	for(m=4;m<half;m*=2){
+		radix2_pass(x, half, m, tw);
+		tw += 2*m;
+	}
+	return;
+}
+
+/*******************************************************************************
+* int rc_fft_real(const rc_fft_plan_t* p, float* x)
+*
+* Replaces the n real samples in x with their unnormalized discrete Fourier
+* transform X[k] = sum x[j]e^(-2*pi*i*j*k/n) for k=0..n/2 in packed format:
+* x[0] holds X[0], x[1] holds the also purely real X[n/2], and x[2k] and
+* x[2k+1] hold the real and imaginary parts of X[k] for 0<k<n/2. Returns 0 on
+* success or -1 on failure.
+*******************************************************************************/
+int rc_fft_real(const rc_fft_plan_t* p, float* x){
+	int k, j, half;
+	float ar, ai, br, bi, er, ei, odr, odi, pr, pi, c, s;
+	if(unlikely(p==NULL || x==NULL)){
+		fprintf(stderr,"ERROR in rc_fft_real, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!p->initialized)){
+		fprintf(stderr,"ERROR in rc_fft_real, plan not initialized\n");
+		return -1;
+	}
+	half = p->n/2;
+	fft_complex(p, x);
+	// Z[k] = E[k] + iO[k] where E and O are the spectra of the even and odd
+	// samples, and X[k] = E[k] + e^(-2*pi*i*k/n)O[k]. Bins k and half-k are
+	// worked out together since each needs Z at both.
+	ar = x[0];
+	x[0] = ar+x[1];
+	x[1] = ar-x[1];
+	for(k=1;k<=half/2;k++){
+		j = half-k;
+		ar = x[2*k];	ai = x[2*k+1];
+		br = x[2*j];	bi = x[2*j+1];
+		c = p->rtw[2*k];
+		s = p->rtw[2*k+1];
+		// E = (Z[k]+conj(Z[j]))/2 and iO = (Z[k]-conj(Z[j]))/2
+		er = 0.5f*(ar+br);	ei = 0.5f*(ai-bi);
+		odr = 0.5f*(ar-br);	odi = 0.5f*(ai+bi);
+		// P = e^(-2*pi*i*k/n) iO so X[k] = E-iP and X[j] = conj(E)-i*conj(P)
+		pr = c*odr + s*odi;
+		pi = c*odi - s*odr;
+		x[2*k]		= er + pi;
+		x[2*k+1]	= ei - pr;
+		x[2*j]		= er - pi;
+		x[2*j+1]	= -ei - pr;
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_fft_real_inverse(const rc_fft_plan_t* p, float* x)
+*
+* Undoes rc_fft_real, replacing a spectrum in the same packed format with the
+* n real samples it came from, including the 1/n scaling.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_fft_real_inverse(const rc_fft_plan_t* p, float* x){
+	int k, j, half;
+	float ar, ai, br, bi, er, ei, dr, di, pr, pi, odr, odi, c, s, scale;
+	if(unlikely(p==NULL || x==NULL)){
+		fprintf(stderr,"ERROR in rc_fft_real_inverse, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!p->initialized)){
+		fprintf(stderr,"ERROR in rc_fft_real_inverse, plan not initialized\n");
+		return -1;
+	}
+	half = p->n/2;
+	// rebuild Z from X by running the split backwards. The inverse complex
+	// FFT is done as conj(FFT(conj(Z))) so conj(Z) is what gets stored.
+	ar = x[0];
+	x[0] = 0.5f*(ar+x[1]);
+	x[1] = -0.5f*(ar-x[1]);
+	for(k=1;k<=half/2;k++){
+		j = half-k;
+		ar = x[2*k];	ai = x[2*k+1];
+		br = x[2*j];	bi = x[2*j+1];
+		c = p->rtw[2*k];
+		s = p->rtw[2*k+1];
+		// E = (X[k]+conj(X[j]))/2 and P = i(X[k]-conj(X[j]))/2
+		er = 0.5f*(ar+br);	ei = 0.5f*(ai-bi);
+		dr = 0.5f*(ar-br);	di = 0.5f*(ai+bi);
+		pr = -di;			pi = dr;
+		// iO = e^(2*pi*i*k/n) P, then Z[k] = E+iO and Z[j] = conj(E-iO)
+		odr = c*pr - s*pi;
+		odi = c*pi + s*pr;
+		x[2*k]		= er + odr;
+		x[2*k+1]	= -(ei + odi);
+		x[2*j]		= er - odr;
+		x[2*j+1]	= ei - odi;
+	}
+	fft_complex(p, x);
+	scale = 1.0f/half;
+	for(k=0;k<half;k++){
+		x[2*k]		*= scale;
+		x[2*k+1]	*= -scale;
+	}
+	return 0;
+}
@@ -13,6 +13,59 @@
 #include <string.h> // for memset
 #include <stdlib.h>
 
+// coefficients and ring buffers share one block aligned to a cache line
+#define FILTER_ALIGN 64
+
+/*******************************************************************************
+* void layout_filter(rc_filter_t* f, float* mem, float* num, int num_len, float* den, int den_len)
+*
+* only for use in this file. Points the input and output ring buffers and the
+* numerator and denominator vectors into the single block of memory 'mem',
+* which must hold 2*den_len+num_len+den_len floats, and copies the
+* coefficients in. The ring buffers come first and are zero'd. Everything the
+* filter touches when marching then sits next to each other in memory.
+*******************************************************************************/
+static void layout_filter(rc_filter_t* f, float* mem, float* num, int num_len, float* den, int den_len){
+	memset(mem,0,2*den_len*sizeof(float));
+	f->in_buf.d			= mem;
+	f->in_buf.size		= den_len;
+	f->in_buf.index		= 0;
+	f->in_buf.initialized = 1;
+	f->out_buf.d		= mem+den_len;
+	f->out_buf.size		= den_len;
+	f->out_buf.index	= 0;
+	f->out_buf.initialized = 1;
+	f->num.d			= mem+2*den_len;
+	f->num.len			= num_len;
+	f->num.initialized	= 1;
+	f->den.d			= mem+2*den_len+num_len;
+	f->den.len			= den_len;
+	f->den.initialized	= 1;
+	memcpy(f->num.d,num,num_len*sizeof(float));
+	memcpy(f->den.d,den,den_len*sizeof(float));
+	return;
+}
+
+/*******************************************************************************
+* int alloc_filter_block(rc_filter_t* f, float* num, int num_len, float* den, int den_len)
+*
+* only for use in this file. Frees any existing memory in f and then allocates
+* a single cache-aligned block for its coefficients and ring buffers.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+static int alloc_filter_block(rc_filter_t* f, float* num, int num_len, float* den, int den_len){
+	float* mem;
+	// free existing memory, this also zeros out all fields
+	rc_free_filter(f);
+	if(unlikely(posix_memalign((void**)&mem, FILTER_ALIGN, \
+					(3*den_len+num_len)*sizeof(float)))){
+		return -1;
+	}
+	layout_filter(f, mem, num, num_len, den, den_len);
+	f->mem = mem;
+	return 0;
+}
+
 /*******************************************************************************
 * int rc_alloc_filter(rc_filter_t* f, rc_vector_t num, rc_vector_t den, float dt)
 *
@@ -48,30 +101,9 @@ int rc_alloc_filter(rc_filter_t* f, rc_vector_t num, rc_vector_t den, float dt){
 		fprintf(stderr,"ERROR in rc_alloc_filter, first coefficient in denominator is 0\n");
 		return -1;
 	}
-	// free existing memory, this also zeros out all fields
-	rc_free_filter(f);
-	// move in vectors
-	if(unlikely(rc_duplicate_vector(num,&f->num))){
-		fprintf(stderr,"ERROR in rc_alloc_filter, failed to duplicate numerator\n");
-		return -1;
-	}
-	if(unlikely(rc_duplicate_vector(den,&f->den))){
-		fprintf(stderr,"ERROR in rc_alloc_filter, failed to duplicate denominator\n");
-		rc_free_vector(&f->num);
-		return -1;
-	}
-	// allocate buffers
-	if(unlikely(rc_alloc_ringbuf(&f->in_buf,den.len))){
-		fprintf(stderr,"ERROR in rc_alloc_filter, failed to allocate ring buffer\n");
-		rc_free_vector(&f->num);
-		rc_free_vector(&f->den);
-		return -1;
-	}
-	if(unlikely(rc_alloc_ringbuf(&f->out_buf,den.len))){
-		fprintf(stderr,"ERROR in rc_alloc_filter, failed to allocate ring buffer\n");
-		rc_free_vector(&f->num);
-		rc_free_vector(&f->den);
-		rc_free_ringbuf(&f->in_buf);
+	// coefficients and buffers all go in one block
+	if(unlikely(alloc_filter_block(f,num.d,num.len,den.d,den.len))){
+		fprintf(stderr,"ERROR in rc_alloc_filter, failed to allocate memory\n");
 		return -1;
 	}
 	// populate remaining values, everything else zero'd by rc_free_filter
@@ -102,33 +134,52 @@ int rc_alloc_filter_from_arrays(rc_filter_t* f,int order,float dt,float* num,flo
 		fprintf(stderr,"ERROR in rc_alloc_filter_from_arrays, dt must be >0\n");
 		return -1;
 	}
-	// free existing memory, this also zeros out all fields
-	rc_free_filter(f);
-	// copy numerator and denominators over
-	if(unlikely(rc_vector_from_array(&f->num,num,order+1))){
-		fprintf(stderr,"ERROR in rc_alloc_filter_from_arrays, failed to alloc vector\n");
+	// coefficients and buffers all go in one block
+	if(unlikely(alloc_filter_block(f,num,order+1,den,order+1))){
+		fprintf(stderr,"ERROR in rc_alloc_filter_from_arrays, failed to allocate memory\n");
 		return -1;
 	}
-	if(unlikely(rc_vector_from_array(&f->den,den,order+1))){
-		fprintf(stderr,"ERROR in rc_alloc_filter_from_arrays, failed to alloc vector\n");
-		rc_free_vector(&f->num);
+	// populate remaining values, everything else zero'd by rc_free_filter
+	f->dt=dt;
+	f->order=order;
+	f->initialized=1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_filter_from_storage(rc_filter_t* f, int order, float dt, float* num, float* den, float* storage)
+*
+* Like rc_alloc_filter_from_arrays() but no memory is allocated. Instead the
+* coefficients and ring buffers are placed in the caller-supplied array
+* 'storage' which must hold at least RC_FILTER_STORAGE_SIZE(order) floats and
+* must stay valid for as long as the filter is used. Typically this is a
+* static or global array declared next to the filter so real-time code can set
+* up its controllers without ever calling malloc. rc_free_filter can still be
+* called on the filter, it just zeros out the struct and leaves the storage
+* alone. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_filter_from_storage(rc_filter_t* f, int order, float dt, float* num, float* den, float* storage){
+	// sanity checks
+	if(unlikely(f==NULL || num==NULL || den==NULL || storage==NULL)){
+		fprintf(stderr,"ERROR in rc_filter_from_storage, received NULL pointer\n");
 		return -1;
 	}
-	// allocate buffers
-	if(unlikely(rc_alloc_ringbuf(&f->in_buf,order+1))){
-		fprintf(stderr,"ERROR in rc_alloc_filter, failed to allocate ring buffer\n");
-		rc_free_vector(&f->num);
-		rc_free_vector(&f->den);
+	if(unlikely(order<1)){
+		fprintf(stderr,"ERROR in rc_filter_from_storage, order must be >=1\n");
 		return -1;
 	}
-	if(unlikely(rc_alloc_ringbuf(&f->out_buf,order+1))){
-		fprintf(stderr,"ERROR in rc_alloc_filter, failed to duplicate denominator\n");
-		rc_free_vector(&f->num);
-		rc_free_vector(&f->den);
-		rc_free_ringbuf(&f->in_buf);
+	if(unlikely(dt<=0.0f)){
+		fprintf(stderr,"ERROR in rc_filter_from_storage, dt must be >0\n");
 		return -1;
 	}
-	// populate remaining values, everything else zero'd by rc_free_filter
+	if(unlikely(den[0]==0.0f)){
+		fprintf(stderr,"ERROR in rc_filter_from_storage, first coefficient in denominator is 0\n");
+		return -1;
+	}
+	// free existing memory, this also zeros out all fields. f->mem stays NULL
+	// so rc_free_filter never tries to free the caller's storage
+	rc_free_filter(f);
+	layout_filter(f, storage, num, order+1, den, order+1);
 	f->dt=dt;
 	f->order=order;
 	f->initialized=1;
@@ -139,17 +190,17 @@ int rc_alloc_filter_from_arrays(rc_filter_t* f,int order,float dt,float* num,flo
 * int rc_free_filter(rc_filter_t* f)
 *
 * Frees the memory allocated by a filter's buffers and coefficient vectors. Also
-* resets all filter properties back to 0. Returns 0 on success or -1 on failure.
+* resets all filter properties back to 0. The buffers and vectors all live in
+* the single block f->mem so they must not be freed individually. Filters made
+* with rc_filter_from_storage have no block to free and are just zero'd out.
+* Returns 0 on success or -1 on failure.
 *******************************************************************************/
 int rc_free_filter(rc_filter_t* f){
 	if(unlikely(f==NULL)){
 		fprintf(stderr, "ERROR in rc_free_filter, received NULL pointer\n");
 		return -1;
 	}
-	rc_free_ringbuf(&f->in_buf);
-	rc_free_ringbuf(&f->out_buf);
-	rc_free_vector(&f->num);
-	rc_free_vector(&f->den);
+	free(f->mem);
 	*f = rc_empty_filter();
 	return 0;
 }
@@ -183,10 +234,80 @@ rc_filter_t rc_empty_filter(){
 	f.newest_input	= 0.0f;
 	f.newest_output = 0.0f;
 	f.step			= 0;
+	f.ma_en			= 0;
+	f.ma_sum		= 0.0;
+	f.ma_resum		= 0;
+	f.mem			= NULL;
 	f.initialized	= 0;
 	return f;
 }
 
+/*******************************************************************************
+* void resum_moving_average(rc_filter_t* f)
+*
+* only for use in this file. Recomputes the running sum of a moving average
+* filter exactly from the input ring buffer so rounding error from adding and
+* subtracting values every step can't accumulate.
+*******************************************************************************/
+static void resum_moving_average(rc_filter_t* f){
+	int i;
+	double sum = 0.0;
+	for(i=0;i<f->in_buf.size;i++) sum += f->in_buf.d[i];
+	f->ma_sum = sum;
+	f->ma_resum = f->in_buf.size;
+	return;
+}
+
+/*******************************************************************************
+* float march_filter_unchecked(rc_filter_t* f, float new_input)
+*
+* only for use in this file. Does all the work of rc_march_filter without the
+* sanity checks so rc_march_filter and rc_march_filter_block share exactly the
+* same arithmetic. The ring buffers are indexed directly here instead of going
+* through rc_get_ringbuf_value to avoid a function call and bounds check for
+* every coefficient. Moving average filters skip the difference equation and
+* just update their running sum.
+*******************************************************************************/
+static inline float march_filter_unchecked(rc_filter_t* f, float new_input){
+	int i, rel_deg, idx;
+	float new_out = 0.0f;
+	float oldest;
+	const int size = f->in_buf.size;
+	const float* in = f->in_buf.d;
+	const float* out = f->out_buf.d;
+	// log new input, remembering the value about to drop out of the buffer
+	oldest = rc_filter_log_input(f, new_input, size);
+	if(f->ma_en){
+		// all numerator coefficients are equal so the output is just the
+		// running sum of the buffer scaled by one of them
+		f->ma_sum += (double)new_input - oldest;
+		f->ma_resum--;
+		if(f->ma_resum<=0) resum_moving_average(f);
+		new_out = f->gain*f->num.d[0]*f->ma_sum;
+		return rc_filter_log_output(f, new_out, f->out_buf.size);
+	}
+	else{
+		// relative degree should never be negative as rc_alloc_filter checks
+		// for improper transfer functions
+		rel_deg = f->den.len - f->num.len;
+		// evaluate the difference equation
+		for(i=0; i<(f->num.len); i++){
+			idx = f->in_buf.index-(i+rel_deg);
+			if(idx<0) idx+=size;
+			new_out+=f->gain*f->num.d[i]*in[idx];
+		}
+		for(i=0; i<(f->order); i++){
+			idx = f->out_buf.index-i;
+			if(idx<0) idx+=size;
+			new_out-=f->den.d[i+1]*out[idx];
+		}
+		// scale in case denominator doesn't have a leading 1
+		new_out /= f->den.d[0];
+	}
+	// soft start, saturation, output ring buffer and step counter
+	return rc_filter_log_output(f, new_out, size);
+}
+
 /*******************************************************************************
 * float rc_march_filter(rc_filter_t* f, float new_input)
 *
@@ -198,53 +319,89 @@ rc_filter_t rc_empty_filter(){
 * typically the only function required afterwards.
 *******************************************************************************/
 float rc_march_filter(rc_filter_t* f, float new_input){
-	int i, rel_deg;
-	float new_out = 0.0f;
 	// sanity checks
 	if(unlikely(!f->initialized)){
 		printf("ERROR in rc_march_filter, filter uninitialized\n");
 		return -1.0f;
 	}
-	// log new input
-	rc_insert_new_ringbuf_value(&f->in_buf, new_input);
-	f->newest_input = new_input;
-	// relative degree should never be negative as rc_alloc_filter checks
-	// for improper transfer functions
-	rel_deg = f->den.len - f->num.len;
-	// evaluate the difference equation
-	for(i=0; i<(f->num.len); i++){
-		new_out+=f->gain*f->num.d[i]*rc_get_ringbuf_value(&f->in_buf, i+rel_deg);
-	}
-	for(i=0; i<(f->order); i++){
-		new_out-=f->den.d[i+1]*rc_get_ringbuf_value(&f->out_buf, i);
-	}
-	// scale in case denominator doesn't have a leading 1
-	new_out /= f->den.d[0];
-	// soft start limits
-	if(f->ss_en && f->step<f->ss_steps){
-		float a=f->sat_max*(f->step/f->ss_steps);
-		float b=f->sat_min*(f->step/f->ss_steps);
-		if(new_out>a) new_out=a;
-		if(new_out<b) new_out=b;
-	}
-	// saturate and set flag
-	if(f->sat_en){
-		if(new_out>f->sat_max){
-			new_out=f->sat_max;
-			f->sat_flag=1;
+	return march_filter_unchecked(f, new_input);
+}
+
+/*******************************************************************************
+* float rc_static_filter_error(rc_filter_t* f, int order, const char* name)
+*
+* Called by the functions RC_STATIC_FILTER generates when they are given a
+* filter they can't march, kept here so the inline code doesn't need stdio.
+* Prints the reason and returns -1.
+*******************************************************************************/
+float rc_static_filter_error(rc_filter_t* f, int order, const char* name){
+	if(!f->initialized){
+		fprintf(stderr,"ERROR in %s, filter uninitialized\n", name);
+	}
+	else if(f->ma_en){
+		fprintf(stderr,"ERROR in %s, moving average filters are not supported\n", name);
+	}
+	else{
+		fprintf(stderr,"ERROR in %s, filter must have order %d\n", name, order);
+	}
+	return -1.0f;
+}
+
+/*******************************************************************************
+* int rc_static_filter_check(rc_filter_t* f, int order, const float* num, const float* den, const char* name)
+*
+* Called every step by the functions RC_STATIC_FILTER generates when they are
+* compiled with DEBUG defined. The compiled in coefficients num and den must be
+* exactly the ones in the filter, otherwise it was made with a different design
+* or re-discretized since and the static march would silently ignore that.
+* Returns -1 and prints the first coefficient that differs, 0 if all match.
+*******************************************************************************/
+int rc_static_filter_check(rc_filter_t* f, int order, const float* num, \
+				const float* den, const char* name){
+	int i;
+	for(i=0;i<=order;i++){
+		if(unlikely(f->num.d[i]!=num[i])){
+			fprintf(stderr,"ERROR in %s, num[%d] is %g but %g was compiled in\n", \
+						name, i, f->num.d[i], num[i]);
+			return -1;
 		}
-		else if(new_out<f->sat_min){
-			new_out=f->sat_min;
-			f->sat_flag=1;
+		if(unlikely(f->den.d[i]!=den[i])){
+			fprintf(stderr,"ERROR in %s, den[%d] is %g but %g was compiled in\n", \
+						name, i, f->den.d[i], den[i]);
+			return -1;
 		}
-		else f->sat_flag=0;
 	}
-	// record the output to filter struct and ring buffer
-	f->newest_output = new_out;
-	rc_insert_new_ringbuf_value(&f->out_buf, new_out);
-	// increment steps
-	f->step++;
-	return new_out;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_march_filter_block(rc_filter_t* f, float* in, float* out, int n)
+*
+* Marches a filter forward n steps, one for each entry in array 'in', and
+* places the n outputs in array 'out'. The results, saturation flag, soft start
+* behavior and step counter are exactly the same as calling rc_march_filter n
+* times in a loop, but the sanity checks are only done once for the whole
+* block. Useful for draining several samples from a FIFO at once or for post
+* processing logged data. 'in' and 'out' may point to the same array to filter
+* in place. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_march_filter_block(rc_filter_t* f, float* in, float* out, int n){
+	int i;
+	// sanity checks
+	if(unlikely(f==NULL || in==NULL || out==NULL)){
+		fprintf(stderr,"ERROR in rc_march_filter_block, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_march_filter_block, filter uninitialized\n");
+		return -1;
+	}
+	if(unlikely(n<0)){
+		fprintf(stderr,"ERROR in rc_march_filter_block, n must be >=0\n");
+		return -1;
+	}
+	for(i=0;i<n;i++) out[i] = march_filter_unchecked(f, in[i]);
+	return 0;
 }
 
 /*******************************************************************************
@@ -261,6 +418,7 @@ int rc_reset_filter(rc_filter_t* f){
 	}
 	rc_reset_ringbuf(&f->in_buf);
 	rc_reset_ringbuf(&f->out_buf);
+	if(f->ma_en) resum_moving_average(f);
 	f->newest_input	= 0.0f;
 	f->newest_output = 0.0f;
 	f->sat_flag = 0;
@@ -300,6 +458,11 @@ int rc_print_filter(rc_filter_t f){
 		fprintf(stderr,"ERROR in rc_print_filter, filter not initialized yet\n");
 		return -1;
 	}
+	if(f.ma_en){
+		printf("moving average of %d samples\n", f.in_buf.size);
+		printf("timestep dt: %0.4f\n", f.dt);
+		return 0;
+	}
 	if(unlikely(f.order>9)){
 		fprintf(stderr,"ERROR in rc_print_filter, filter order must be <=10\n");
 		return -1;
@@ -468,6 +631,7 @@ int rc_prefill_filter_inputs(rc_filter_t* f, float in){
 		return -1;
 	}
 	for(i=0;i<f->order;i++) rc_insert_new_ringbuf_value(&f->in_buf, in);
+	if(f->ma_en) resum_moving_average(f);
 	f->newest_input = in;
 	return 0;
 }
@@ -509,6 +673,10 @@ int rc_multiply_filters(rc_filter_t f1, rc_filter_t f2, rc_filter_t* f3){
 		fprintf(stderr,"ERROR in rc_multiply_filters, timestep dt must match\n");
 		return -1;
 	}
+	if(unlikely(f1.ma_en || f2.ma_en)){
+		fprintf(stderr,"ERROR in rc_multiply_filters, moving averages are not supported\n");
+		return -1;
+	}
 	// multiply out the transfer function coefficients
 	if(unlikely(rc_poly_conv(f1.num,f2.num,&newnum))){
 		fprintf(stderr,"ERROR in rc_multiply_filters, failed to polyconv\n");
@@ -754,34 +922,55 @@ int rc_butterworth_highpass(rc_filter_t* f, int order, float dt, float wc){
 * Makes a FIR moving average filter that averages over 'samples' which must be
 * greater than or equal to 2 otherwise no averaging would be performed. Any
 * existing memory allocated for f is freed safely to avoid memory leaks and new
-* memory is allocated for the new filter. Returns 0 on success or -1 on failure.
+* memory is allocated for the new filter. The filter is flagged so
+* rc_march_filter keeps a running sum of the input buffer instead of
+* multiplying out every coefficient, making each step O(1) regardless of the
+* number of samples. The running sum is recomputed exactly once every 'samples'
+* steps to cancel floating point drift. Since the coefficients are all the same
+* only the input history is allocated: num and den hold a single coefficient
+* each and the output buffer only the newest output.
+* Returns 0 on success or -1 on failure.
 *******************************************************************************/
 int rc_moving_average(rc_filter_t* f, int samples, int dt){
-	int i;
-	rc_vector_t num = rc_empty_vector();
-	rc_vector_t den = rc_empty_vector();
+	float* mem;
 	// sanity checks
 	if(unlikely(samples<2)){
 		fprintf(stderr,"ERROR in rc_moving_average, samples must be >=2\n");
 		return -1;
 	}
-	rc_alloc_vector(&num,samples);
-	rc_alloc_vector(&den,samples);
-	// fill in coefficients
-	for(i=0;i<samples;i++){
-		num.d[i] = 1.0f/samples;
-		den.d[i] = 0.0;
+	if(unlikely(dt<=0)){
+		fprintf(stderr,"ERROR in rc_moving_average, dt must be >0\n");
+		return -1;
 	}
-	den.d[0] = 1.0;
-	// make the filter
-	if(unlikely(rc_alloc_filter(f,num,den,dt))){
-		fprintf(stderr, "ERROR in rc_moving_average, failed to alloc filter\n");
-		rc_free_vector(&num);
-		rc_free_vector(&den);
+	// only the input history is needed, the output buffer keeps just the
+	// newest output and num and den the one distinct coefficient of each
+	rc_free_filter(f);
+	if(unlikely(posix_memalign((void**)&mem, FILTER_ALIGN, (samples+3)*sizeof(float)))){
+		fprintf(stderr, "ERROR in rc_moving_average, failed to allocate memory\n");
 		return -1;
 	}
-	rc_free_vector(&num);
-	rc_free_vector(&den);
+	memset(mem,0,(samples+1)*sizeof(float));
+	f->in_buf.d			= mem;
+	f->in_buf.size		= samples;
+	f->in_buf.initialized = 1;
+	f->out_buf.d		= mem+samples;
+	f->out_buf.size		= 1;
+	f->out_buf.initialized = 1;
+	f->num.d			= mem+samples+1;
+	f->num.len			= 1;
+	f->num.initialized	= 1;
+	f->num.d[0]			= 1.0f/samples;
+	f->den.d			= mem+samples+2;
+	f->den.len			= 1;
+	f->den.initialized	= 1;
+	f->den.d[0]			= 1.0f;
+	f->mem = mem;
+	f->dt = dt;
+	f->order = samples-1;
+	f->initialized = 1;
+	// march with a running sum instead of the difference equation
+	f->ma_en = 1;
+	resum_moving_average(f);
 	return 0;
 }
 
@@ -0,0 +1,309 @@
+/*******************************************************************************
+* rc_filter_bank.c
+*
+* A bank of identical discrete SISO filters, one per channel, for filtering
+* vector signals like 3-axis accelerometer, gyro and magnetometer readings.
+* All channels share one transfer function and their Transposed Direct Form II
+* state is stored in structure-of-arrays layout, s[i*stride+channel], so one
+* SIMD register holds the same state element for 4 (NEON, SSE) or 8 (AVX)
+* channels at once. Marching the bank is then a handful of vector multiply
+* accumulates per state element no matter how many channels there are.
+*******************************************************************************/
+
+#include "../roboticscape.h"
+#include "../preprocessor_macros.h"
+#include <stdio.h>
+#include <string.h> // for memset
+#include <stdlib.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+	#include <arm_neon.h>
+	#define BANK_WIDTH 4
+#elif defined(__AVX__)
+	#include <immintrin.h>
+	#define BANK_WIDTH 8
+#elif defined(__SSE__)
+	#include <xmmintrin.h>
+	#define BANK_WIDTH 4
+#else
+	#define BANK_WIDTH 1
+#endif
+
+// state and scratch arrays are aligned to one full SIMD register
+#define BANK_ALIGN (BANK_WIDTH*sizeof(float) < sizeof(void*) ? sizeof(void*) : BANK_WIDTH*sizeof(float))
+
+/*******************************************************************************
+* int rc_alloc_filter_bank(rc_filter_bank_t* f, int channels, rc_vector_t num, rc_vector_t den, float dt)
+*
+* Allocates memory for a bank of 'channels' filters which all share the
+* transfer function given by num and den. Coefficients are normalized by the
+* leading denominator coefficient and the numerator is right justified just
+* like rc_alloc_tdf2_filter. The number of channels is rounded up internally to
+* a multiple of the SIMD width, the extra channels are simply never read.
+* Any existing memory allocated for f is freed first.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_filter_bank(rc_filter_bank_t* f, int channels, rc_vector_t num, rc_vector_t den, float dt){
+	int i, n, stride, rel_deg;
+	float* mem;
+	// sanity checks
+	if(unlikely(f==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_filter_bank, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(channels<1)){
+		fprintf(stderr,"ERROR in rc_alloc_filter_bank, channels must be >=1\n");
+		return -1;
+	}
+	if(unlikely(dt<=0.0f)){
+		fprintf(stderr,"ERROR in rc_alloc_filter_bank, dt must be >0\n");
+		return -1;
+	}
+	if(unlikely(!num.initialized||!den.initialized)){
+		fprintf(stderr,"ERROR in rc_alloc_filter_bank, vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(num.len>den.len)){
+		fprintf(stderr,"ERROR in rc_alloc_filter_bank, improper transfer function\n");
+		return -1;
+	}
+	if(unlikely(den.d[0]==0.0f)){
+		fprintf(stderr,"ERROR in rc_alloc_filter_bank, first coefficient in denominator is 0\n");
+		return -1;
+	}
+	// free existing memory, this also zeros out all fields
+	rc_free_filter_bank(f);
+	n = den.len-1;
+	stride = ((channels+BANK_WIDTH-1)/BANK_WIDTH)*BANK_WIDTH;
+	// one aligned block holds the state s[(n+1)*stride], the scratch input and
+	// output vectors x[stride] and y[stride], then coefficients b[n+1] and
+	// a[n+1]. The vectors come first so they all start on a SIMD boundary. The
+	// last row of state is always zero so the march loop needs no special case.
+	if(unlikely(posix_memalign((void**)&mem, BANK_ALIGN, \
+			((n+3)*stride + 2*(n+1))*sizeof(float)))){
+		fprintf(stderr,"ERROR in rc_alloc_filter_bank, failed to allocate memory\n");
+		return -1;
+	}
+	memset(mem,0,((n+3)*stride + 2*(n+1))*sizeof(float));
+	f->s = mem;
+	f->x = mem+(n+1)*stride;
+	f->y = mem+(n+2)*stride;
+	f->b = mem+(n+3)*stride;
+	f->a = f->b+(n+1);
+	// normalize and right-justify the numerator
+	rel_deg = den.len-num.len;
+	for(i=0;i<num.len;i++) f->b[i+rel_deg] = num.d[i]/den.d[0];
+	for(i=0;i<=n;i++) f->a[i] = den.d[i]/den.d[0];
+	// populate remaining values, everything else zero'd by rc_free_filter_bank
+	f->order = n;
+	f->channels = channels;
+	f->stride = stride;
+	f->dt = dt;
+	f->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_filter_bank_from_filter(rc_filter_bank_t* bank, int channels, rc_filter_t f)
+*
+* Builds a filter bank with 'channels' copies of the transfer function and gain
+* of an existing rc_filter_t. This lets any of the filter design functions such
+* as rc_butterworth_lowpass be used to create a bank. The state of f is not
+* copied, the bank starts out reset. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_filter_bank_from_filter(rc_filter_bank_t* bank, int channels, rc_filter_t f){
+	if(unlikely(!f.initialized)){
+		fprintf(stderr,"ERROR in rc_filter_bank_from_filter, filter uninitialized\n");
+		return -1;
+	}
+	if(unlikely(f.ma_en)){
+		fprintf(stderr,"ERROR in rc_filter_bank_from_filter, moving averages are not supported\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_filter_bank(bank,channels,f.num,f.den,f.dt))){
+		fprintf(stderr,"ERROR in rc_filter_bank_from_filter, failed to alloc filter bank\n");
+		return -1;
+	}
+	bank->gain = f.gain;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_filter_bank(rc_filter_bank_t* f)
+*
+* Frees the memory allocated for the bank's coefficients and state. Also
+* resets all properties back to 0. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_filter_bank(rc_filter_bank_t* f){
+	if(unlikely(f==NULL)){
+		fprintf(stderr,"ERROR in rc_free_filter_bank, received NULL pointer\n");
+		return -1;
+	}
+	// s is the start of the single block holding everything
+	if(f->initialized) free(f->s);
+	*f = rc_empty_filter_bank();
+	return 0;
+}
+
+/*******************************************************************************
+* rc_filter_bank_t rc_empty_filter_bank()
+*
+* Returns an rc_filter_bank_t with no allocated memory and the initialized flag
+* set to 0. Use this to initialize local rc_filter_bank_t structs before any
+* other function, just like rc_empty_filter.
+*******************************************************************************/
+rc_filter_bank_t rc_empty_filter_bank(){
+	rc_filter_bank_t f;
+	f.order			= 0;
+	f.channels		= 0;
+	f.stride		= 0;
+	f.dt			= 0.0f;
+	f.gain			= 1.0f;
+	f.b				= NULL;
+	f.a				= NULL;
+	f.s				= NULL;
+	f.x				= NULL;
+	f.y				= NULL;
+	f.step			= 0;
+	f.initialized	= 0;
+	return f;
+}
+
+/*******************************************************************************
+* void march_bank_kernel(rc_filter_bank_t* f)
+*
+* only for use in this file. Marches every channel one step with the gain
+* scaled inputs already in f->x, leaving the outputs in f->y. Each group of
+* channels that fits in one SIMD register is run through the whole state
+* update before moving onto the next group so x and y stay in registers.
+*******************************************************************************/
+static void march_bank_kernel(rc_filter_bank_t* f){
+	int i, c;
+	const int n = f->order;
+	const int stride = f->stride;
+	float* __restrict__ s = f->s;
+	const float* __restrict__ x = f->x;
+	float* __restrict__ y = f->y;
+	const float* b = f->b;
+	const float* a = f->a;
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+	for(c=0;c<stride;c+=4){
+		float32x4_t xv = vld1q_f32(x+c);
+		float32x4_t yv = vmlaq_n_f32(vld1q_f32(s+c), xv, b[0]);
+		for(i=0;i<n;i++){
+			float32x4_t sv = vld1q_f32(s+(i+1)*stride+c);
+			sv = vmlaq_n_f32(sv, xv, b[i+1]);
+			sv = vmlsq_n_f32(sv, yv, a[i+1]);
+			vst1q_f32(s+i*stride+c, sv);
+		}
+		vst1q_f32(y+c, yv);
+	}
+#elif defined(__AVX__)
+	for(c=0;c<stride;c+=8){
+		__m256 xv = _mm256_load_ps(x+c);
+		__m256 yv = _mm256_add_ps(_mm256_load_ps(s+c), \
+					_mm256_mul_ps(xv, _mm256_set1_ps(b[0])));
+		for(i=0;i<n;i++){
+			__m256 sv = _mm256_load_ps(s+(i+1)*stride+c);
+			sv = _mm256_add_ps(sv, _mm256_mul_ps(xv, _mm256_set1_ps(b[i+1])));
+			sv = _mm256_sub_ps(sv, _mm256_mul_ps(yv, _mm256_set1_ps(a[i+1])));
+			_mm256_store_ps(s+i*stride+c, sv);
+		}
+		_mm256_store_ps(y+c, yv);
+	}
+#elif defined(__SSE__)
+	for(c=0;c<stride;c+=4){
+		__m128 xv = _mm_load_ps(x+c);
+		__m128 yv = _mm_add_ps(_mm_load_ps(s+c), _mm_mul_ps(xv, _mm_set1_ps(b[0])));
+		for(i=0;i<n;i++){
+			__m128 sv = _mm_load_ps(s+(i+1)*stride+c);
+			sv = _mm_add_ps(sv, _mm_mul_ps(xv, _mm_set1_ps(b[i+1])));
+			sv = _mm_sub_ps(sv, _mm_mul_ps(yv, _mm_set1_ps(a[i+1])));
+			_mm_store_ps(s+i*stride+c, sv);
+		}
+		_mm_store_ps(y+c, yv);
+	}
+#else
+	for(c=0;c<stride;c++) y[c] = b[0]*x[c] + s[c];
+	for(i=0;i<n;i++){
+		for(c=0;c<stride;c++){
+			s[i*stride+c] = s[(i+1)*stride+c] + b[i+1]*x[c] - a[i+1]*y[c];
+		}
+	}
+#endif
+	return;
+}
+
+/*******************************************************************************
+* int rc_march_filter_bank(rc_filter_bank_t* f, float* in, float* out)
+*
+* Marches every channel of the bank forward one step. 'in' must hold one new
+* input per channel and the new outputs are written to 'out', which must also
+* have room for one value per channel. 'in' and 'out' may be the same array.
+* The step counter is incremented by one. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_march_filter_bank(rc_filter_bank_t* f, float* in, float* out){
+	int c;
+	// sanity checks
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_march_filter_bank, filter bank uninitialized\n");
+		return -1;
+	}
+	if(unlikely(in==NULL || out==NULL)){
+		fprintf(stderr,"ERROR in rc_march_filter_bank, received NULL pointer\n");
+		return -1;
+	}
+	// the caller's arrays need not be aligned or padded so copy through the
+	// internal scratch vectors, applying the gain on the way in
+	for(c=0;c<f->channels;c++) f->x[c] = f->gain*in[c];
+	march_bank_kernel(f);
+	for(c=0;c<f->channels;c++) out[c] = f->y[c];
+	f->step++;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_reset_filter_bank(rc_filter_bank_t* f)
+*
+* Zeros the state of every channel and resets the step counter.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_reset_filter_bank(rc_filter_bank_t* f){
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_reset_filter_bank, filter bank uninitialized\n");
+		return -1;
+	}
+	memset(f->s,0,(f->order+3)*f->stride*sizeof(float));
+	f->step = 0;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_prefill_filter_bank(rc_filter_bank_t* f, float* in, float* out)
+*
+* Sets the state of each channel as if all of its previous inputs had been
+* in[channel] and all previous outputs had been out[channel]. Same as
+* rc_prefill_tdf2_filter but for every channel of the bank at once.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_prefill_filter_bank(rc_filter_bank_t* f, float* in, float* out){
+	int i, c;
+	float x;
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_prefill_filter_bank, filter bank uninitialized\n");
+		return -1;
+	}
+	if(unlikely(in==NULL || out==NULL)){
+		fprintf(stderr,"ERROR in rc_prefill_filter_bank, received NULL pointer\n");
+		return -1;
+	}
+	for(c=0;c<f->channels;c++){
+		x = f->gain*in[c];
+		// work backwards from the always-zero last row
+		for(i=f->order-1;i>=0;i--){
+			f->s[i*f->stride+c] = f->s[(i+1)*f->stride+c] + f->b[i+1]*x \
+													- f->a[i+1]*out[c];
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,315 @@
+/*******************************************************************************
+* rc_fixed_filter.c
+*
+* Fixed-point versions of the discrete SISO filters in rc_filter.c for running
+* raw integer sensor data such as gyro, accelerometer and ADC counts through a
+* filter without touching the FPU. Filters are designed as normal rc_filter_t
+* floats and converted here. Coefficients become 32-bit integers with as many
+* fractional bits as their largest magnitude allows, products are summed in a
+* 64-bit accumulator in Direct Form I, and every addition and the final output
+* saturate instead of wrapping around. Signals are integers in the sensor's own
+* units, not Q1.15 or Q1.31 fractions, the 15 and 31 bit formats only set the
+* output range.
+*******************************************************************************/
+
+#include "../roboticscape.h"
+#include "../preprocessor_macros.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h> // for memset
+#include <stdlib.h>
+
+/*******************************************************************************
+* int64_t sat_add64(int64_t a, int64_t b)
+*
+* only for use in this file. Adds two 64-bit integers, saturating at the ends
+* of the int64_t range instead of overflowing.
+*******************************************************************************/
+static inline int64_t sat_add64(int64_t a, int64_t b){
+	if(unlikely(b>0 && a>INT64_MAX-b)) return INT64_MAX;
+	if(unlikely(b<0 && a<INT64_MIN-b)) return INT64_MIN;
+	return a+b;
+}
+
+/*******************************************************************************
+* rc_fixed_filter_t rc_empty_fixed_filter()
+*
+* Returns an rc_fixed_filter_t with no allocated memory and the initialized flag
+* set to 0. Use this to initialize local filters before any other function,
+* just like rc_empty_filter.
+*******************************************************************************/
+rc_fixed_filter_t rc_empty_fixed_filter(){
+	rc_fixed_filter_t f;
+	f.order			= 0;
+	f.dt			= 0.0f;
+	f.bits			= 0;
+	f.frac_bits		= 0;
+	f.num			= NULL;
+	f.den			= NULL;
+	f.in			= NULL;
+	f.out			= NULL;
+	f.index			= 0;
+	f.residue		= 0;
+	f.sat_min		= 0;
+	f.sat_max		= 0;
+	f.sat_flag		= 0;
+	f.newest_input	= 0;
+	f.newest_output	= 0;
+	f.step			= 0;
+	f.initialized	= 0;
+	return f;
+}
+
+/*******************************************************************************
+* int rc_fixed_filter_from_filter(rc_fixed_filter_t* q, rc_filter_t f, int bits)
+*
+* Converts a floating point filter made with any of the rc_filter_t design
+* functions, such as rc_butterworth_lowpass or rc_pid_filter, into a fixed
+* point filter. The filter gain is folded into the numerator and the
+* coefficients are normalized by the leading denominator coefficient. 'bits'
+* must be 15 or 31 and selects the output range: 15 saturates the output to
+* the int16_t range and 31 to the int32_t range. If
+* saturation is enabled on f its limits are carried over, rounded to integers
+* and clipped to that range. Soft start is not supported. Any existing memory
+* allocated for q is freed first. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_fixed_filter_from_filter(rc_fixed_filter_t* q, rc_filter_t f, int bits){
+	int i, n, rel_deg, frac_bits;
+	double maxabs, c, scale;
+	double num[f.order+1], den[f.order+1];
+	int32_t* mem;
+	// sanity checks
+	if(unlikely(q==NULL)){
+		fprintf(stderr,"ERROR in rc_fixed_filter_from_filter, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!f.initialized)){
+		fprintf(stderr,"ERROR in rc_fixed_filter_from_filter, filter uninitialized\n");
+		return -1;
+	}
+	if(unlikely(f.ma_en)){
+		fprintf(stderr,"ERROR in rc_fixed_filter_from_filter, moving averages are not supported\n");
+		return -1;
+	}
+	if(unlikely(bits!=15 && bits!=31)){
+		fprintf(stderr,"ERROR in rc_fixed_filter_from_filter, bits must be 15 or 31\n");
+		return -1;
+	}
+	n = f.order;
+	// normalized coefficients with the gain folded in, numerator right justified
+	rel_deg = f.den.len-f.num.len;
+	for(i=0;i<=n;i++){
+		num[i] = 0.0;
+		den[i] = (double)f.den.d[i]/f.den.d[0];
+	}
+	for(i=0;i<f.num.len;i++){
+		num[i+rel_deg] = (double)f.gain*f.num.d[i]/f.den.d[0];
+	}
+	// pick the most fractional bits that still fit the largest coefficient
+	maxabs = 0.0;
+	for(i=0;i<=n;i++){
+		if(fabs(num[i])>maxabs) maxabs=fabs(num[i]);
+		if(fabs(den[i])>maxabs) maxabs=fabs(den[i]);
+	}
+	frac_bits = 30;
+	while(frac_bits>0 && maxabs*ldexp(1.0,frac_bits)>=2147483647.0) frac_bits--;
+	if(unlikely(maxabs*ldexp(1.0,frac_bits)>=2147483647.0)){
+		fprintf(stderr,"ERROR in rc_fixed_filter_from_filter, coefficients too large\n");
+		return -1;
+	}
+	// one block holds num, den, and the input and output histories
+	rc_free_fixed_filter(q);
+	mem = (int32_t*)calloc(4*(n+1),sizeof(int32_t));
+	if(unlikely(mem==NULL)){
+		fprintf(stderr,"ERROR in rc_fixed_filter_from_filter, failed to allocate memory\n");
+		return -1;
+	}
+	q->num = mem;
+	q->den = mem+(n+1);
+	q->in  = mem+2*(n+1);
+	q->out = mem+3*(n+1);
+	scale = ldexp(1.0,frac_bits);
+	for(i=0;i<=n;i++){
+		q->num[i] = (int32_t)lround(num[i]*scale);
+		q->den[i] = (int32_t)lround(den[i]*scale);
+	}
+	// output range
+	if(bits==15){
+		q->sat_min = INT16_MIN;
+		q->sat_max = INT16_MAX;
+	}
+	else{
+		q->sat_min = INT32_MIN;
+		q->sat_max = INT32_MAX;
+	}
+	if(f.sat_en){
+		c = round(f.sat_min);
+		if(c>q->sat_min) q->sat_min = (c<q->sat_max) ? (int32_t)c : q->sat_max;
+		c = round(f.sat_max);
+		if(c<q->sat_max) q->sat_max = (c>q->sat_min) ? (int32_t)c : q->sat_min;
+	}
+	q->order = n;
+	q->dt = f.dt;
+	q->bits = bits;
+	q->frac_bits = frac_bits;
+	q->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_fixed_filter(rc_fixed_filter_t* f)
+*
+* Frees the memory allocated by the filter and resets all properties back to 0.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_fixed_filter(rc_fixed_filter_t* f){
+	if(unlikely(f==NULL)){
+		fprintf(stderr,"ERROR in rc_free_fixed_filter, received NULL pointer\n");
+		return -1;
+	}
+	// num is the start of the single block holding everything
+	if(f->initialized) free(f->num);
+	*f = rc_empty_fixed_filter();
+	return 0;
+}
+
+/*******************************************************************************
+* int32_t rc_march_fixed_filter(rc_fixed_filter_t* f, int32_t new_input)
+*
+* March the filter forward one step and return the new integer output,
+* saturated to the filter's output range. The saturated output is what gets fed
+* back so integrators can't wind up past the limits.
+* 15 bit filters expect inputs in the int16_t range. Returns 0 and prints an
+* error if the filter is uninitialized.
+*******************************************************************************/
+int32_t rc_march_fixed_filter(rc_fixed_filter_t* f, int32_t new_input){
+	int i, idx;
+	int64_t acc;
+	int32_t y;
+	const int size = f->order+1;
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_march_fixed_filter, filter uninitialized\n");
+		return 0;
+	}
+	// log new input in the circular history
+	idx = f->index+1;
+	if(idx>=size) idx=0;
+	f->in[idx] = new_input;
+	f->index = idx;
+	f->newest_input = new_input;
+	// evaluate the difference equation with a 64-bit accumulator. It starts
+	// with the fractional part dropped from last step's output so the rounding
+	// error is fed back instead of being amplified by poles near 1
+	acc = f->residue;
+	for(i=0;i<=f->order;i++){
+		idx = f->index-i;
+		if(idx<0) idx+=size;
+		acc = sat_add64(acc, (int64_t)f->num[i]*f->in[idx]);
+	}
+	// outputs share the input index, so the previous outputs sit behind it
+	for(i=1;i<=f->order;i++){
+		idx = f->index-i;
+		if(idx<0) idx+=size;
+		acc = sat_add64(acc, -(int64_t)f->den[i]*f->out[idx]);
+	}
+	// saturate and set flag
+	if((acc>>f->frac_bits)>f->sat_max){
+		y = f->sat_max;
+		f->residue = 0;
+		f->sat_flag = 1;
+	}
+	else if((acc>>f->frac_bits)<f->sat_min){
+		y = f->sat_min;
+		f->residue = 0;
+		f->sat_flag = 1;
+	}
+	else{
+		y = (int32_t)(acc>>f->frac_bits);
+		f->residue = acc-((int64_t)y<<f->frac_bits);
+		f->sat_flag = 0;
+	}
+	f->out[f->index] = y;
+	f->newest_output = y;
+	f->step++;
+	return y;
+}
+
+/*******************************************************************************
+* int rc_reset_fixed_filter(rc_fixed_filter_t* f)
+*
+* Resets all previous inputs and outputs to 0 and resets the step counter and
+* saturation flag. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_reset_fixed_filter(rc_fixed_filter_t* f){
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_reset_fixed_filter, filter uninitialized\n");
+		return -1;
+	}
+	memset(f->in,0,2*(f->order+1)*sizeof(int32_t));
+	f->index = 0;
+	f->residue = 0;
+	f->newest_input = 0;
+	f->newest_output = 0;
+	f->sat_flag = 0;
+	f->step = 0;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_enable_fixed_saturation(rc_fixed_filter_t* f, int32_t min, int32_t max)
+*
+* Bounds the filter output between min and max. The limits are clipped to the
+* int16_t or int32_t range the filter was created with.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_enable_fixed_saturation(rc_fixed_filter_t* f, int32_t min, int32_t max){
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_enable_fixed_saturation, filter uninitialized\n");
+		return -1;
+	}
+	if(unlikely(min>=max)){
+		fprintf(stderr,"ERROR in rc_enable_fixed_saturation, max must be > min\n");
+		return -1;
+	}
+	if(f->bits==15){
+		if(min<INT16_MIN) min=INT16_MIN;
+		if(max>INT16_MAX) max=INT16_MAX;
+	}
+	f->sat_min = min;
+	f->sat_max = max;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_prefill_fixed_filter_inputs(rc_fixed_filter_t* f, int32_t in)
+*
+* Fills all previous inputs to the filter as if they had been equal to 'in'.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_prefill_fixed_filter_inputs(rc_fixed_filter_t* f, int32_t in){
+	int i;
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_prefill_fixed_filter_inputs, filter uninitialized\n");
+		return -1;
+	}
+	for(i=0;i<=f->order;i++) f->in[i] = in;
+	f->newest_input = in;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_prefill_fixed_filter_outputs(rc_fixed_filter_t* f, int32_t out)
+*
+* Fills all previous outputs of the filter as if they had been equal to 'out'.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_prefill_fixed_filter_outputs(rc_fixed_filter_t* f, int32_t out){
+	int i;
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_prefill_fixed_filter_outputs, filter uninitialized\n");
+		return -1;
+	}
+	for(i=0;i<=f->order;i++) f->out[i] = out;
+	f->newest_output = out;
+	return 0;
+}
@@ -0,0 +1,142 @@
+/*******************************************************************************
+* rc_fixed_size.c
+*
+* Conversions between the fixed-size rc_vec3_t, rc_vec4_t, rc_mat3_t and
+* rc_mat4_t types and the dynamic rc_vector_t and rc_matrix_t. Everything else
+* for the fixed-size types is inlined from roboticscape.h.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+/*******************************************************************************
+* int vec_to_vector(const float* a, int n, rc_vector_t* v, const char* fn)
+*
+* only for use in this file. Copies n floats into v, allocating it if needed.
+*******************************************************************************/
+static int vec_to_vector(const float* a, int n, rc_vector_t* v, const char* fn){
+	if(unlikely(rc_alloc_vector(v,n))){
+		fprintf(stderr,"ERROR in %s, failed to allocate vector\n", fn);
+		return -1;
+	}
+	memcpy(v->d,a,n*sizeof(float));
+	return 0;
+}
+
+/*******************************************************************************
+* int vector_to_vec(rc_vector_t v, float* a, int n, const char* fn)
+*
+* only for use in this file. Copies v into n floats if it has length n.
+*******************************************************************************/
+static int vector_to_vec(rc_vector_t v, float* a, int n, const char* fn){
+	if(unlikely(!v.initialized)){
+		fprintf(stderr,"ERROR in %s, vector uninitialized\n", fn);
+		return -1;
+	}
+	if(unlikely(v.len!=n)){
+		fprintf(stderr,"ERROR in %s, expected vector of length %d\n", fn, n);
+		return -1;
+	}
+	memcpy(a,v.d,n*sizeof(float));
+	return 0;
+}
+
+/*******************************************************************************
+* int mat_to_matrix(const float* a, int n, rc_matrix_t* m, const char* fn)
+*
+* only for use in this file. Copies row-major nxn array a into m, allocating it
+* if needed. m may be a view.
+*******************************************************************************/
+static int mat_to_matrix(const float* a, int n, rc_matrix_t* m, const char* fn){
+	int i,j;
+	if(unlikely(rc_alloc_matrix(m,n,n))){
+		fprintf(stderr,"ERROR in %s, failed to allocate matrix\n", fn);
+		return -1;
+	}
+	for(i=0;i<n;i++){
+		for(j=0;j<n;j++) AT(*m,i,j) = a[i*n+j];
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int matrix_to_mat(rc_matrix_t m, float* a, int n, const char* fn)
+*
+* only for use in this file. Copies nxn matrix m, which may be a view, into
+* row-major array a.
+*******************************************************************************/
+static int matrix_to_mat(rc_matrix_t m, float* a, int n, const char* fn){
+	int i,j;
+	if(unlikely(!m.initialized)){
+		fprintf(stderr,"ERROR in %s, matrix uninitialized\n", fn);
+		return -1;
+	}
+	if(unlikely(m.rows!=n || m.cols!=n)){
+		fprintf(stderr,"ERROR in %s, expected %dx%d matrix\n", fn, n, n);
+		return -1;
+	}
+	for(i=0;i<n;i++){
+		for(j=0;j<n;j++) a[i*n+j] = AT(m,i,j);
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_vec3_to_vector(rc_vec3_t a, rc_vector_t* v)
+* int rc_vec4_to_vector(rc_vec4_t a, rc_vector_t* v)
+*
+* Copy a fixed-size vector into v, which is only allocated if it is not
+* already the right length. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_vec3_to_vector(rc_vec3_t a, rc_vector_t* v){
+	return vec_to_vector(a.d,3,v,"rc_vec3_to_vector");
+}
+
+int rc_vec4_to_vector(rc_vec4_t a, rc_vector_t* v){
+	return vec_to_vector(a.d,4,v,"rc_vec4_to_vector");
+}
+
+/*******************************************************************************
+* int rc_mat3_to_matrix(rc_mat3_t a, rc_matrix_t* m)
+* int rc_mat4_to_matrix(rc_mat4_t a, rc_matrix_t* m)
+*
+* Copy a fixed-size matrix into m, which is only allocated if it is not
+* already the right size and may be a view. Returns 0 on success or -1 on
+* failure.
+*******************************************************************************/
+int rc_mat3_to_matrix(rc_mat3_t a, rc_matrix_t* m){
+	return mat_to_matrix(&a.d[0][0],3,m,"rc_mat3_to_matrix");
+}
+
+int rc_mat4_to_matrix(rc_mat4_t a, rc_matrix_t* m){
+	return mat_to_matrix(&a.d[0][0],4,m,"rc_mat4_to_matrix");
+}
+
+/*******************************************************************************
+* int rc_vector_to_vec3(rc_vector_t v, rc_vec3_t* a)
+* int rc_vector_to_vec4(rc_vector_t v, rc_vec4_t* a)
+*
+* Copy a dynamic vector of length 3 or 4 into a fixed-size vector.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_vector_to_vec3(rc_vector_t v, rc_vec3_t* a){
+	return vector_to_vec(v,a->d,3,"rc_vector_to_vec3");
+}
+
+int rc_vector_to_vec4(rc_vector_t v, rc_vec4_t* a){
+	return vector_to_vec(v,a->d,4,"rc_vector_to_vec4");
+}
+
+/*******************************************************************************
+* int rc_matrix_to_mat3(rc_matrix_t m, rc_mat3_t* a)
+* int rc_matrix_to_mat4(rc_matrix_t m, rc_mat4_t* a)
+*
+* Copy a dynamic 3x3 or 4x4 matrix, which may be a view, into a fixed-size
+* matrix. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_matrix_to_mat3(rc_matrix_t m, rc_mat3_t* a){
+	return matrix_to_mat(m,&a->d[0][0],3,"rc_matrix_to_mat3");
+}
+
+int rc_matrix_to_mat4(rc_matrix_t m, rc_mat4_t* a){
+	return matrix_to_mat(m,&a->d[0][0],4,"rc_matrix_to_mat4");
+}
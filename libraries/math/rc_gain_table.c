@@ -0,0 +1,298 @@
+/*******************************************************************************
+* rc_gain_table.c
+*
+* Gain scheduling tables. A gain matrix is stored for every point of a uniform
+* grid over one to RC_GAIN_TABLE_MAX_DIMS operating point variables, such as
+* battery voltage or forward speed. The gains are normally designed offline or
+* at startup with rc_gain_table_from_lqr so that the control loop only has to
+* call rc_gain_table_lookup, which interpolates between the surrounding grid
+* points without searching or allocating anything.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+/*******************************************************************************
+* rc_gain_table_t rc_empty_gain_table()
+*
+* Returns an rc_gain_table_t with no allocated memory and the initialized flag
+* set to 0. Use this to initialize local tables before any other function.
+*******************************************************************************/
+rc_gain_table_t rc_empty_gain_table(){
+	int i;
+	rc_gain_table_t t;
+	// zero-out piecemeal instead of with memset to avoid issues with padding
+	t.dims = 0;
+	for(i=0;i<RC_GAIN_TABLE_MAX_DIMS;i++){
+		t.points[i]		= 0;
+		t.stride[i]		= 0;
+		t.min[i]		= 0.0f;
+		t.max[i]		= 0.0f;
+		t.scale[i]		= 0.0f;
+	}
+	t.rows			= 0;
+	t.cols			= 0;
+	t.entries		= 0;
+	t.gains			= NULL;
+	t.initialized	= 0;
+	return t;
+}
+
+/*******************************************************************************
+* int rc_alloc_gain_table(rc_gain_table_t* t, int dims, int* points, float* min, float* max, int rows, int cols)
+*
+* Allocates a table of rows by cols gains on a grid with dims dimensions.
+* Dimension i has points[i] evenly spaced grid points from min[i] to max[i].
+* All gains start at zero. Any memory already owned by t is freed first.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_gain_table(rc_gain_table_t* t, int dims, int* points, float* min, float* max, int rows, int cols){
+	int i, entries;
+	if(unlikely(t==NULL || points==NULL || min==NULL || max==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_gain_table, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(dims<1 || dims>RC_GAIN_TABLE_MAX_DIMS)){
+		fprintf(stderr,"ERROR in rc_alloc_gain_table, dims must be between 1 and %d\n", RC_GAIN_TABLE_MAX_DIMS);
+		return -1;
+	}
+	if(unlikely(rows<1 || cols<1)){
+		fprintf(stderr,"ERROR in rc_alloc_gain_table, rows and cols must be >=1\n");
+		return -1;
+	}
+	entries = 1;
+	for(i=0;i<dims;i++){
+		if(unlikely(points[i]<2)){
+			fprintf(stderr,"ERROR in rc_alloc_gain_table, need at least 2 points per dimension\n");
+			return -1;
+		}
+		if(unlikely(min[i]>=max[i])){
+			fprintf(stderr,"ERROR in rc_alloc_gain_table, max must be > min\n");
+			return -1;
+		}
+		entries *= points[i];
+	}
+	rc_free_gain_table(t);
+	t->gains = (float*)calloc(entries*rows*cols,sizeof(float));
+	if(unlikely(t->gains==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_gain_table, failed to allocate memory\n");
+		return -1;
+	}
+	// the first dimension varies fastest through the table
+	for(i=0;i<dims;i++){
+		t->points[i] = points[i];
+		t->min[i] = min[i];
+		t->max[i] = max[i];
+		t->scale[i] = (points[i]-1)/(max[i]-min[i]);
+		t->stride[i] = (i==0) ? rows*cols : t->stride[i-1]*points[i-1];
+	}
+	t->dims = dims;
+	t->rows = rows;
+	t->cols = cols;
+	t->entries = entries;
+	t->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_gain_table(rc_gain_table_t* t)
+*
+* Frees the memory owned by t and resets it to an empty table.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_gain_table(rc_gain_table_t* t){
+	if(unlikely(t==NULL)){
+		fprintf(stderr,"ERROR in rc_free_gain_table, received NULL pointer\n");
+		return -1;
+	}
+	free(t->gains);
+	*t = rc_empty_gain_table();
+	return 0;
+}
+
+/*******************************************************************************
+* void grid_point(rc_gain_table_t* t, int* idx, float* op)
+*
+* only for use in this file. Fills op with the operating point at grid index
+* idx.
+*******************************************************************************/
+static void grid_point(rc_gain_table_t* t, int* idx, float* op){
+	int i;
+	for(i=0;i<t->dims;i++) op[i] = t->min[i] + idx[i]/t->scale[i];
+	return;
+}
+
+/*******************************************************************************
+* int rc_set_gain_table_entry(rc_gain_table_t* t, int* idx, rc_matrix_t K)
+*
+* Copies K into the table at the grid point with index idx[i] along each
+* dimension i. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_set_gain_table_entry(rc_gain_table_t* t, int* idx, rc_matrix_t K){
+	int i, j, off;
+	if(unlikely(t==NULL || idx==NULL)){
+		fprintf(stderr,"ERROR in rc_set_gain_table_entry, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!t->initialized || !K.initialized)){
+		fprintf(stderr,"ERROR in rc_set_gain_table_entry, table or matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(K.rows!=t->rows || K.cols!=t->cols)){
+		fprintf(stderr,"ERROR in rc_set_gain_table_entry, K must be %dx%d\n", t->rows, t->cols);
+		return -1;
+	}
+	off = 0;
+	for(i=0;i<t->dims;i++){
+		if(unlikely(idx[i]<0 || idx[i]>=t->points[i])){
+			fprintf(stderr,"ERROR in rc_set_gain_table_entry, index out of range\n");
+			return -1;
+		}
+		off += idx[i]*t->stride[i];
+	}
+	for(i=0;i<K.rows;i++){
+		for(j=0;j<K.cols;j++) t->gains[off+i*K.cols+j] = AT(K,i,j);
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_gain_table_from_lqr(rc_gain_table_t* t, int dims, int* points, float* min, float* max, int nx, int nu, rc_gain_table_model_t model, void* ctx)
+*
+* Allocates a table as with rc_alloc_gain_table and fills it with LQR gains.
+* At every grid point the model callback is given the operating point and
+* fills in the linearized A, B, Q and R, which are then converted to double
+* and passed to rc_dlqr_d so the Riccati solution isn't limited by float
+* rounding. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_gain_table_from_lqr(rc_gain_table_t* t, int dims, int* points, float* min, float* max, \
+			int nx, int nu, rc_gain_table_model_t model, void* ctx){
+	int i, e, rem, ret = -1;
+	int idx[RC_GAIN_TABLE_MAX_DIMS];
+	float op[RC_GAIN_TABLE_MAX_DIMS];
+	rc_matrix_t A = rc_empty_matrix();
+	rc_matrix_t B = rc_empty_matrix();
+	rc_matrix_t Q = rc_empty_matrix();
+	rc_matrix_t R = rc_empty_matrix();
+	rc_matrix_t K = rc_empty_matrix();
+	rc_matrix_d_t Ad = rc_empty_matrix_d();
+	rc_matrix_d_t Bd = rc_empty_matrix_d();
+	rc_matrix_d_t Qd = rc_empty_matrix_d();
+	rc_matrix_d_t Rd = rc_empty_matrix_d();
+	rc_matrix_d_t Kd = rc_empty_matrix_d();
+	if(unlikely(model==NULL)){
+		fprintf(stderr,"ERROR in rc_gain_table_from_lqr, received NULL model\n");
+		return -1;
+	}
+	if(unlikely(nx<1 || nu<1)){
+		fprintf(stderr,"ERROR in rc_gain_table_from_lqr, nx and nu must be >=1\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_gain_table(t,dims,points,min,max,nu,nx))) return -1;
+	if(unlikely(rc_matrix_zeros(&A,nx,nx) || rc_matrix_zeros(&B,nx,nu) || \
+				rc_matrix_zeros(&Q,nx,nx) || rc_matrix_zeros(&R,nu,nu))){
+		fprintf(stderr,"ERROR in rc_gain_table_from_lqr, failed to allocate memory\n");
+		goto end;
+	}
+	for(e=0;e<t->entries;e++){
+		// split the entry number back into a grid index
+		rem = e;
+		for(i=0;i<dims;i++){
+			idx[i] = rem%points[i];
+			rem /= points[i];
+		}
+		grid_point(t,idx,op);
+		if(unlikely(model(op,&A,&B,&Q,&R,ctx))){
+			fprintf(stderr,"ERROR in rc_gain_table_from_lqr, model failed at entry %d\n", e);
+			goto end;
+		}
+		if(unlikely(A.rows!=nx || A.cols!=nx || B.rows!=nx || B.cols!=nu || \
+				Q.rows!=nx || Q.cols!=nx || R.rows!=nu || R.cols!=nu)){
+			fprintf(stderr,"ERROR in rc_gain_table_from_lqr, model changed matrix sizes\n");
+			goto end;
+		}
+		rc_matrix_float_to_double(A,&Ad);
+		rc_matrix_float_to_double(B,&Bd);
+		rc_matrix_float_to_double(Q,&Qd);
+		rc_matrix_float_to_double(R,&Rd);
+		if(unlikely(rc_dlqr_d(Ad,Bd,Qd,Rd,&Kd,NULL))){
+			fprintf(stderr,"ERROR in rc_gain_table_from_lqr, LQR design failed at entry %d\n", e);
+			goto end;
+		}
+		rc_matrix_double_to_float(Kd,&K);
+		rc_set_gain_table_entry(t,idx,K);
+	}
+	ret = 0;
+
+end:
+	if(ret) rc_free_gain_table(t);
+	rc_free_matrix(&A);
+	rc_free_matrix(&B);
+	rc_free_matrix(&Q);
+	rc_free_matrix(&R);
+	rc_free_matrix(&K);
+	rc_free_matrix_d(&Ad);
+	rc_free_matrix_d(&Bd);
+	rc_free_matrix_d(&Qd);
+	rc_free_matrix_d(&Rd);
+	rc_free_matrix_d(&Kd);
+	return ret;
+}
+
+/*******************************************************************************
+* int rc_gain_table_lookup(rc_gain_table_t* t, float* op, rc_matrix_t* K)
+*
+* Writes the gain at operating point op into K by multilinear interpolation
+* between the 2^dims surrounding grid points. Operating points outside the
+* grid are clamped to its edge. K is only allocated if it is not already the
+* right size so after the first call this makes no allocations and takes the
+* same time every step. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_gain_table_lookup(rc_gain_table_t* t, float* op, rc_matrix_t* K){
+	int i, c, n, base, off, i0;
+	float s, w;
+	float frac[RC_GAIN_TABLE_MAX_DIMS];
+	if(unlikely(t==NULL || op==NULL || K==NULL)){
+		fprintf(stderr,"ERROR in rc_gain_table_lookup, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!t->initialized)){
+		fprintf(stderr,"ERROR in rc_gain_table_lookup, table uninitialized\n");
+		return -1;
+	}
+	if(unlikely(rc_matrix_zeros(K,t->rows,t->cols))){
+		fprintf(stderr,"ERROR in rc_gain_table_lookup, failed to allocate K\n");
+		return -1;
+	}
+	if(unlikely(!is_dense(*K))){
+		fprintf(stderr,"ERROR in rc_gain_table_lookup, K must be a dense matrix\n");
+		return -1;
+	}
+	// find the cell containing op, the spacing is even so there's no search
+	base = 0;
+	for(i=0;i<t->dims;i++){
+		s = (op[i]-t->min[i])*t->scale[i];
+		if(s<0.0f) s = 0.0f;
+		i0 = (int)s;
+		if(i0>t->points[i]-2) i0 = t->points[i]-2;
+		frac[i] = s-i0;
+		if(frac[i]>1.0f) frac[i] = 1.0f;
+		base += i0*t->stride[i];
+	}
+	// weighted sum of the cell's corners, bit i of c picks the upper
+	// neighbour along dimension i
+	n = t->rows*t->cols;
+	for(c=0;c<(1<<t->dims);c++){
+		w = 1.0f;
+		off = base;
+		for(i=0;i<t->dims;i++){
+			if(c&(1<<i)){
+				w *= frac[i];
+				off += t->stride[i];
+			}
+			else w *= 1.0f-frac[i];
+		}
+		if(w==0.0f) continue;
+		rc_scale_accumulate(w,t->gains+off,K->data,n);
+	}
+	return 0;
+}
@@ -0,0 +1,252 @@
+/*******************************************************************************
+* rc_gemm.c
+*
+* Cache-blocked general matrix multiplication used by rc_multiply_matrices for
+* anything bigger than a handful of rows. The product is split into blocks of
+* B that fit in L2 cache and blocks of A that fit in L1, each packed into
+* contiguous panels in the exact order the micro-kernel reads them. The
+* micro-kernel keeps an MR x NR tile of C in SIMD registers for the whole inner
+* dimension of the block so every value loaded is used MR or NR times. Packing
+* also makes strided views and transposed views just as fast as dense matrices
+* since the kernel only ever sees the packed copies.
+*
+* The micro-kernel is picked at build time: AVX or SSE on x86 hosts, plain C
+* elsewhere and for the double precision build from rc_gemm_double.c. There is
+* no hand written NEON kernel, on the BeagleBone the plain C kernel is left to
+* gcc's vectorizer.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+#if defined(RC_DOUBLE)
+	// the SIMD kernels below are all single precision so double always gets
+	// the C kernel
+	#define MR 4
+	#define NR 4
+#elif defined(__AVX__)
+	#include <immintrin.h>
+	#define GEMM_AVX
+	#define MR 6
+	#define NR 16
+#elif defined(__SSE__)
+	#include <xmmintrin.h>
+	#define GEMM_SSE
+	#define MR 4
+	#define NR 8
+#else
+	#define MR 4
+	#define NR 4
+#endif
+
+// block sizes, KC*NR floats of B stay in L1 while a panel of A streams past,
+// MC*KC floats of A stay in L2 (Cortex-A8 has 32k L1 and 256k L2)
+#define KC 128
+#define MC (MR*16)
+#define NC 512
+
+#define GEMM_ALIGN 64
+
+/*******************************************************************************
+* void pack_a(rc_matrix_t A, int i0, int p0, int mc, int kc, float* Ap)
+*
+* only for use in this file. Copies the mc x kc block of A at (i0,p0) into
+* panels of MR rows. Within a panel the MR entries of each column are
+* consecutive. Rows past the end of the last panel are zero filled.
+*******************************************************************************/
+static void pack_a(rc_matrix_t A, int i0, int p0, int mc, int kc, real_t* Ap){
+	int i, p, r, mr;
+	for(i=0;i<mc;i+=MR){
+		mr = mc-i<MR ? mc-i : MR;
+		for(p=0;p<kc;p++){
+			for(r=0;r<mr;r++) Ap[r] = AT(A,i0+i+r,p0+p);
+			for(;r<MR;r++) Ap[r] = 0.0f;
+			Ap += MR;
+		}
+	}
+	return;
+}
+
+/*******************************************************************************
+* void pack_b(rc_matrix_t B, int p0, int j0, int kc, int nc, float* Bp)
+*
+* only for use in this file. Copies the kc x nc block of B at (p0,j0) into
+* panels of NR columns. Within a panel the NR entries of each row are
+* consecutive. Columns past the end of the last panel are zero filled.
+*******************************************************************************/
+static void pack_b(rc_matrix_t B, int p0, int j0, int kc, int nc, real_t* Bp){
+	int j, p, c, nr;
+	for(j=0;j<nc;j+=NR){
+		nr = nc-j<NR ? nc-j : NR;
+		for(p=0;p<kc;p++){
+			if(B.col_stride==1){
+				memcpy(Bp, &AT(B,p0+p,j0+j), nr*sizeof(real_t));
+				c = nr;
+			}
+			else{
+				for(c=0;c<nr;c++) Bp[c] = AT(B,p0+p,j0+j+c);
+			}
+			for(;c<NR;c++) Bp[c] = 0.0f;
+			Bp += NR;
+		}
+	}
+	return;
+}
+
+/*******************************************************************************
+* void micro_kernel(int kc, const float* a, const float* b, float* t)
+*
+* only for use in this file. Multiplies one packed MR x kc panel of A by one
+* packed kc x NR panel of B and writes the MR x NR result to t, row-major.
+*******************************************************************************/
+static void micro_kernel(int kc, const real_t* __restrict__ a, \
+					const real_t* __restrict__ b, real_t* __restrict__ t){
+	int p;
+#if defined(GEMM_AVX)
+	int r;
+	__m256 c[MR][2];
+	for(r=0;r<MR;r++){
+		c[r][0] = _mm256_setzero_ps();
+		c[r][1] = _mm256_setzero_ps();
+	}
+	for(p=0;p<kc;p++){
+		__m256 b0 = _mm256_loadu_ps(b);
+		__m256 b1 = _mm256_loadu_ps(b+8);
+		// fully unrolled by the compiler so c stays in registers
+		for(r=0;r<MR;r++){
+			__m256 ar = _mm256_broadcast_ss(a+r);
+		#ifdef __FMA__
+			c[r][0] = _mm256_fmadd_ps(ar, b0, c[r][0]);
+			c[r][1] = _mm256_fmadd_ps(ar, b1, c[r][1]);
+		#else
+			c[r][0] = _mm256_add_ps(c[r][0], _mm256_mul_ps(ar, b0));
+			c[r][1] = _mm256_add_ps(c[r][1], _mm256_mul_ps(ar, b1));
+		#endif
+		}
+		a += MR;
+		b += NR;
+	}
+	for(r=0;r<MR;r++){
+		_mm256_storeu_ps(t+r*NR,   c[r][0]);
+		_mm256_storeu_ps(t+r*NR+8, c[r][1]);
+	}
+#elif defined(GEMM_SSE)
+	__m128 c00 = _mm_setzero_ps(), c01 = _mm_setzero_ps();
+	__m128 c10 = _mm_setzero_ps(), c11 = _mm_setzero_ps();
+	__m128 c20 = _mm_setzero_ps(), c21 = _mm_setzero_ps();
+	__m128 c30 = _mm_setzero_ps(), c31 = _mm_setzero_ps();
+	for(p=0;p<kc;p++){
+		__m128 b0 = _mm_loadu_ps(b);
+		__m128 b1 = _mm_loadu_ps(b+4);
+		__m128 ar;
+		ar = _mm_set1_ps(a[0]);
+		c00 = _mm_add_ps(c00, _mm_mul_ps(ar, b0));
+		c01 = _mm_add_ps(c01, _mm_mul_ps(ar, b1));
+		ar = _mm_set1_ps(a[1]);
+		c10 = _mm_add_ps(c10, _mm_mul_ps(ar, b0));
+		c11 = _mm_add_ps(c11, _mm_mul_ps(ar, b1));
+		ar = _mm_set1_ps(a[2]);
+		c20 = _mm_add_ps(c20, _mm_mul_ps(ar, b0));
+		c21 = _mm_add_ps(c21, _mm_mul_ps(ar, b1));
+		ar = _mm_set1_ps(a[3]);
+		c30 = _mm_add_ps(c30, _mm_mul_ps(ar, b0));
+		c31 = _mm_add_ps(c31, _mm_mul_ps(ar, b1));
+		a += MR;
+		b += NR;
+	}
+	_mm_storeu_ps(t,    c00); _mm_storeu_ps(t+4,  c01);
+	_mm_storeu_ps(t+8,  c10); _mm_storeu_ps(t+12, c11);
+	_mm_storeu_ps(t+16, c20); _mm_storeu_ps(t+20, c21);
+	_mm_storeu_ps(t+24, c30); _mm_storeu_ps(t+28, c31);
+#else
+	int r, c;
+	real_t acc[MR][NR];
+	for(r=0;r<MR;r++){
+		for(c=0;c<NR;c++) acc[r][c] = 0.0f;
+	}
+	for(p=0;p<kc;p++){
+		for(r=0;r<MR;r++){
+			for(c=0;c<NR;c++) acc[r][c] += a[r]*b[c];
+		}
+		a += MR;
+		b += NR;
+	}
+	for(r=0;r<MR;r++){
+		for(c=0;c<NR;c++) t[r*NR+c] = acc[r][c];
+	}
+#endif
+	return;
+}
+
+/*******************************************************************************
+* int rc_gemm_work_size(int m, int n, int k)
+*
+* Returns the number of floats of packing buffer rc_gemm needs to multiply an
+* m x k matrix by a k x n matrix. The buffer only has to be as big as the
+* largest block actually used so small products need much less than the full
+* MC*KC+NC*KC.
+*******************************************************************************/
+int rc_gemm_work_size(int m, int n, int k){
+	const int mc = m<MC ? ((m+MR-1)/MR)*MR : MC;
+	const int nc = n<NC ? ((n+NR-1)/NR)*NR : NC;
+	const int kc = k<KC ? k : KC;
+	return mc*kc+nc*kc;
+}
+
+/*******************************************************************************
+* int rc_gemm(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, float* work)
+*
+* Computes C=A*B where C has already been allocated with the right dimensions.
+* Any of the three may be views. C must not share memory with A or B. work is
+* the packing buffer, at least rc_gemm_work_size floats and ideally aligned to
+* a cache line. If work is NULL the buffer is allocated and freed here instead.
+* Returns 0 on success or -1 if the packing buffers couldn't be allocated.
+*******************************************************************************/
+int rc_gemm(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, real_t* work){
+	int ic, jc, pc, ir, jr, i, j, mc, nc, kc, mr, nr;
+	const int m = A.rows;
+	const int n = B.cols;
+	const int k = A.cols;
+	real_t* Ap;
+	real_t* Bp;
+	real_t t[MR*NR] __attribute__((aligned(GEMM_ALIGN)));
+	// packed B goes right after the largest block of A in the buffer
+	mc = m<MC ? ((m+MR-1)/MR)*MR : MC;
+	kc = k<KC ? k : KC;
+	if(work!=NULL) Ap = work;
+	else if(unlikely(posix_memalign((void**)&Ap, GEMM_ALIGN, rc_gemm_work_size(m,n,k)*sizeof(real_t)))){
+		fprintf(stderr,"ERROR in rc_gemm, failed to allocate memory\n");
+		return -1;
+	}
+	Bp = Ap+mc*kc;
+	for(jc=0;jc<n;jc+=NC){
+		nc = n-jc<NC ? n-jc : NC;
+		for(pc=0;pc<k;pc+=KC){
+			kc = k-pc<KC ? k-pc : KC;
+			pack_b(B, pc, jc, kc, nc, Bp);
+			for(ic=0;ic<m;ic+=MC){
+				mc = m-ic<MC ? m-ic : MC;
+				pack_a(A, ic, pc, mc, kc, Ap);
+				for(jr=0;jr<nc;jr+=NR){
+					nr = nc-jr<NR ? nc-jr : NR;
+					for(ir=0;ir<mc;ir+=MR){
+						mr = mc-ir<MR ? mc-ir : MR;
+						micro_kernel(kc, Ap+ir*kc, Bp+jr*kc, t);
+						// the first block along k sets C, the rest add to it
+						if(pc==0){
+							for(i=0;i<mr;i++){
+								for(j=0;j<nr;j++) AT(C,ic+ir+i,jc+jr+j) = t[i*NR+j];
+							}
+						}
+						else{
+							for(i=0;i<mr;i++){
+								for(j=0;j<nr;j++) AT(C,ic+ir+i,jc+jr+j) += t[i*NR+j];
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+	if(work==NULL) free(Ap);
+	return 0;
+}
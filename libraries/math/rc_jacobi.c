@@ -0,0 +1,418 @@
+/*******************************************************************************
+* rc_jacobi.c
+*
+* Jacobi methods for the symmetric eigenvalue problem and the singular value
+* decomposition. Both sweep through every pair of rows and columns applying
+* plane rotations until the off-diagonal part vanishes. They take more flops
+* than tridiagonal QR or Golub-Kahan for big matrices but the loops are short
+* and simple, converge in a handful of sweeps for the 3x3 to 12x12 problems
+* seen on the BeagleBone, and find small eigenvalues and singular values to
+* high relative accuracy.
+*
+* All working memory lives in the rc_eig_t and rc_svd_t structs and is only
+* allocated when a matrix of a new size is passed in, so repeated calls inside
+* a control loop don't touch the heap.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+// every pair is visited once per sweep, float precision is reached well before
+#define MAX_SWEEPS 30
+
+/*******************************************************************************
+* void rotate_cols(rc_matrix_t A, int p, int q, float c, float s)
+*
+* only for use in this file. Replaces columns p and q of A with c*p-s*q and
+* s*p+c*q, which is A times a plane rotation.
+*******************************************************************************/
+static inline void rotate_cols(rc_matrix_t A, int p, int q, real_t c, real_t s){
+	int i;
+	real_t ap, aq;
+	for(i=0;i<A.rows;i++){
+		ap = AT(A,i,p);
+		aq = AT(A,i,q);
+		AT(A,i,p) = c*ap - s*aq;
+		AT(A,i,q) = s*ap + c*aq;
+	}
+	return;
+}
+
+/*******************************************************************************
+* void swap_cols(rc_matrix_t A, int p, int q)
+*
+* only for use in this file. Swaps columns p and q of A.
+*******************************************************************************/
+static inline void swap_cols(rc_matrix_t A, int p, int q){
+	int i;
+	real_t tmp;
+	for(i=0;i<A.rows;i++){
+		tmp = AT(A,i,p);
+		AT(A,i,p) = AT(A,i,q);
+		AT(A,i,q) = tmp;
+	}
+	return;
+}
+
+/*******************************************************************************
+* void sort_descending(rc_vector_t v, rc_matrix_t A, rc_matrix_t B)
+*
+* only for use in this file. Sorts v into descending order, swapping columns
+* of A and B along with it. B is skipped if it's uninitialized.
+*******************************************************************************/
+static void sort_descending(rc_vector_t v, rc_matrix_t A, rc_matrix_t B){
+	int i,j,k;
+	real_t tmp;
+	for(i=0;i<v.len-1;i++){
+		k = i;
+		for(j=i+1;j<v.len;j++) if(v.d[j]>v.d[k]) k = j;
+		if(k==i) continue;
+		tmp = v.d[i];
+		v.d[i] = v.d[k];
+		v.d[k] = tmp;
+		swap_cols(A,i,k);
+		if(B.initialized) swap_cols(B,i,k);
+	}
+	return;
+}
+
+/*******************************************************************************
+* rc_eig_t rc_empty_eig()
+*
+* Returns an rc_eig_t with no allocated memory and the initialized flag set to
+* 0. Use this to initialize local rc_eig_t structs before any other function.
+*******************************************************************************/
+rc_eig_t rc_empty_eig(){
+	rc_eig_t out;
+	// zero-out piecemeal instead of with memset to avoid issues with padding
+	out.n			= 0;
+	out.values		= rc_empty_vector();
+	out.vectors		= rc_empty_matrix();
+	out.work		= rc_empty_matrix();
+	out.sweeps		= 0;
+	out.initialized	= 0;
+	return out;
+}
+
+/*******************************************************************************
+* int rc_alloc_eig(rc_eig_t* e, int n)
+*
+* Allocates memory for the eigen decomposition of an n-by-n matrix. If e is
+* already the right size nothing is done. This is called automatically by
+* rc_eig_symmetric, calling it first just moves the allocation out of the loop.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_eig(rc_eig_t* e, int n){
+	if(unlikely(e==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_eig, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(n<1)){
+		fprintf(stderr,"ERROR in rc_alloc_eig, n must be >=1\n");
+		return -1;
+	}
+	if(e->initialized && e->n==n) return 0;
+	rc_free_eig(e);
+	if(unlikely(rc_alloc_vector(&e->values,n) || \
+				rc_alloc_matrix(&e->vectors,n,n) || \
+				rc_alloc_matrix(&e->work,n,n))){
+		fprintf(stderr,"ERROR in rc_alloc_eig, failed to allocate memory\n");
+		rc_free_eig(e);
+		return -1;
+	}
+	e->n = n;
+	e->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_eig(rc_eig_t* e)
+*
+* Frees the memory allocated for the decomposition and resets e back to an
+* empty struct. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_eig(rc_eig_t* e){
+	if(unlikely(e==NULL)){
+		fprintf(stderr,"ERROR in rc_free_eig, received NULL pointer\n");
+		return -1;
+	}
+	rc_free_vector(&e->values);
+	rc_free_matrix(&e->vectors);
+	rc_free_matrix(&e->work);
+	*e = rc_empty_eig();
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_eig_symmetric(rc_matrix_t A, rc_eig_t* e)
+*
+* Finds the eigenvalues and eigenvectors of symmetric matrix A with the cyclic
+* Jacobi method. Only the lower triangle of A is read and A may be a view. The
+* eigenvalues are placed in e->values in descending order and the matching
+* unit eigenvectors in the columns of e->vectors so that A=V*diag(values)*V'.
+* e is allocated on the first call or if the size of A changes.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_eig_symmetric(rc_matrix_t A, rc_eig_t* e){
+	int i,j,p,q,n,sweep;
+	real_t off, norm, apq, theta, t, c, s, wp, wq;
+	rc_matrix_t W;
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_eig_symmetric, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(A.rows!=A.cols)){
+		fprintf(stderr,"ERROR in rc_eig_symmetric, matrix is not square\n");
+		return -1;
+	}
+	n = A.rows;
+	if(unlikely(rc_alloc_eig(e,n))){
+		fprintf(stderr,"ERROR in rc_eig_symmetric, failed to allocate memory\n");
+		return -1;
+	}
+	// work on a full symmetric copy built from the lower triangle, V starts
+	// as the identity and accumulates the rotations
+	W = e->work;
+	norm = 0.0f;
+	for(i=0;i<n;i++){
+		for(j=0;j<=i;j++){
+			W.d[i][j] = W.d[j][i] = AT(A,i,j);
+			norm += (i==j ? 1.0f : 2.0f)*W.d[i][j]*W.d[i][j];
+			e->vectors.d[i][j] = e->vectors.d[j][i] = (i==j) ? 1.0f : 0.0f;
+		}
+	}
+	for(sweep=0;sweep<MAX_SWEEPS;sweep++){
+		// done once the off-diagonal part is lost in rounding of the whole
+		off = 0.0f;
+		for(i=1;i<n;i++){
+			for(j=0;j<i;j++) off += 2.0f*W.d[i][j]*W.d[i][j];
+		}
+		if(off<=REAL_EPSILON*REAL_EPSILON*norm) break;
+		for(p=0;p<n-1;p++){
+			for(q=p+1;q<n;q++){
+				apq = W.d[p][q];
+				if(apq==0.0f) continue;
+				// rotation angle that zeros W(p,q), taking the smaller root
+				theta = (W.d[q][q]-W.d[p][p])/(2.0f*apq);
+				t = 1.0f/(fabs(theta)+sqrt(theta*theta+1.0f));
+				if(theta<0.0f) t = -t;
+				c = 1.0f/sqrt(t*t+1.0f);
+				s = t*c;
+				// W=J'WJ touches only rows and columns p and q
+				for(i=0;i<n;i++){
+					wp = W.d[i][p];
+					wq = W.d[i][q];
+					W.d[i][p] = c*wp - s*wq;
+					W.d[i][q] = s*wp + c*wq;
+				}
+				for(j=0;j<n;j++){
+					wp = W.d[p][j];
+					wq = W.d[q][j];
+					W.d[p][j] = c*wp - s*wq;
+					W.d[q][j] = s*wp + c*wq;
+				}
+				W.d[p][q] = W.d[q][p] = 0.0f;
+				rotate_cols(e->vectors,p,q,c,s);
+			}
+		}
+	}
+	e->sweeps = sweep;
+	if(unlikely(sweep==MAX_SWEEPS)){
+		fprintf(stderr,"ERROR in rc_eig_symmetric, failed to converge\n");
+		return -1;
+	}
+	for(i=0;i<n;i++) e->values.d[i] = W.d[i][i];
+	sort_descending(e->values,e->vectors,rc_empty_matrix());
+	return 0;
+}
+
+/*******************************************************************************
+* rc_svd_t rc_empty_svd()
+*
+* Returns an rc_svd_t with no allocated memory and the initialized flag set to
+* 0. Use this to initialize local rc_svd_t structs before any other function.
+*******************************************************************************/
+rc_svd_t rc_empty_svd(){
+	rc_svd_t out;
+	// zero-out piecemeal instead of with memset to avoid issues with padding
+	out.rows		= 0;
+	out.cols		= 0;
+	out.U			= rc_empty_matrix();
+	out.S			= rc_empty_vector();
+	out.V			= rc_empty_matrix();
+	out.sweeps		= 0;
+	out.initialized	= 0;
+	return out;
+}
+
+/*******************************************************************************
+* int rc_alloc_svd(rc_svd_t* d, int rows, int cols)
+*
+* Allocates memory for the singular value decomposition of a rows-by-cols
+* matrix. If d is already the right size nothing is done. This is called
+* automatically by rc_svd_decomp, calling it first just moves the allocation
+* out of the loop. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_svd(rc_svd_t* d, int rows, int cols){
+	int k;
+	if(unlikely(d==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_svd, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(rows<1 || cols<1)){
+		fprintf(stderr,"ERROR in rc_alloc_svd, rows and cols must be >=1\n");
+		return -1;
+	}
+	if(d->initialized && d->rows==rows && d->cols==cols) return 0;
+	rc_free_svd(d);
+	k = rows<cols ? rows : cols;
+	if(unlikely(rc_alloc_matrix(&d->U,rows,k) || \
+				rc_alloc_vector(&d->S,k) || \
+				rc_alloc_matrix(&d->V,cols,k))){
+		fprintf(stderr,"ERROR in rc_alloc_svd, failed to allocate memory\n");
+		rc_free_svd(d);
+		return -1;
+	}
+	d->rows = rows;
+	d->cols = cols;
+	d->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_svd(rc_svd_t* d)
+*
+* Frees the memory allocated for the decomposition and resets d back to an
+* empty struct. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_svd(rc_svd_t* d){
+	if(unlikely(d==NULL)){
+		fprintf(stderr,"ERROR in rc_free_svd, received NULL pointer\n");
+		return -1;
+	}
+	rc_free_matrix(&d->U);
+	rc_free_vector(&d->S);
+	rc_free_matrix(&d->V);
+	*d = rc_empty_svd();
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_svd_decomp(rc_matrix_t A, rc_svd_t* d)
+*
+* Finds the thin singular value decomposition A=U*diag(S)*V' of any m-by-n
+* matrix A with the one-sided Jacobi method. With k=min(m,n), U is m-by-k, S
+* holds the k singular values in descending order and V is n-by-k. A may be a
+* view. Columns of U for singular values that are exactly zero are left as
+* zeros. d is allocated on the first call or if the size of A changes.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_svd_decomp(rc_matrix_t A, rc_svd_t* d){
+	int i,j,p,q,k,sweep,rotated;
+	real_t alpha, beta, gamma, zeta, t, c, s;
+	rc_matrix_t W, X;
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_svd_decomp, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_svd(d,A.rows,A.cols))){
+		fprintf(stderr,"ERROR in rc_svd_decomp, failed to allocate memory\n");
+		return -1;
+	}
+	// Orthogonalize the columns of A, or of A' if A is wide, accumulating the
+	// rotations in X. The working copy lives in whichever of U or V has the
+	// right shape so no extra memory is needed.
+	if(A.rows>=A.cols){
+		W = d->U;
+		X = d->V;
+		k = A.cols;
+		for(i=0;i<A.rows;i++){
+			for(j=0;j<k;j++) W.d[i][j] = AT(A,i,j);
+		}
+	}
+	else{
+		W = d->V;
+		X = d->U;
+		k = A.rows;
+		for(i=0;i<A.cols;i++){
+			for(j=0;j<k;j++) W.d[i][j] = AT(A,j,i);
+		}
+	}
+	for(i=0;i<k;i++){
+		for(j=0;j<k;j++) X.d[i][j] = (i==j) ? 1.0f : 0.0f;
+	}
+	for(sweep=0;sweep<MAX_SWEEPS;sweep++){
+		rotated = 0;
+		for(p=0;p<k-1;p++){
+			for(q=p+1;q<k;q++){
+				alpha = beta = gamma = 0.0f;
+				for(i=0;i<W.rows;i++){
+					alpha += W.d[i][p]*W.d[i][p];
+					beta  += W.d[i][q]*W.d[i][q];
+					gamma += W.d[i][p]*W.d[i][q];
+				}
+				// skip pairs that are already orthogonal to working precision
+				if(fabs(gamma)<=REAL_EPSILON*sqrt(alpha*beta)) continue;
+				rotated = 1;
+				zeta = (beta-alpha)/(2.0f*gamma);
+				t = 1.0f/(fabs(zeta)+sqrt(zeta*zeta+1.0f));
+				if(zeta<0.0f) t = -t;
+				c = 1.0f/sqrt(t*t+1.0f);
+				s = t*c;
+				rotate_cols(W,p,q,c,s);
+				rotate_cols(X,p,q,c,s);
+			}
+		}
+		if(!rotated) break;
+	}
+	d->sweeps = sweep;
+	if(unlikely(sweep==MAX_SWEEPS)){
+		fprintf(stderr,"ERROR in rc_svd_decomp, failed to converge\n");
+		return -1;
+	}
+	// column norms are the singular values, normalizing leaves the vectors
+	for(j=0;j<k;j++){
+		s = 0.0f;
+		for(i=0;i<W.rows;i++) s += W.d[i][j]*W.d[i][j];
+		s = sqrt(s);
+		d->S.d[j] = s;
+		if(s>0.0f){
+			for(i=0;i<W.rows;i++) W.d[i][j] /= s;
+		}
+	}
+	sort_descending(d->S,d->U,d->V);
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_svd_pinv(rc_svd_t d, rc_matrix_t* Ainv)
+*
+* Forms the Moore-Penrose pseudo-inverse V*diag(1/S)*U' of the decomposed
+* matrix. Singular values below max(rows,cols)*S[0]*FLT_EPSILON are treated as
+* zero, the same default tolerance as MATLAB's pinv. Ainv is only allocated if
+* it is not already the right size and may be a view.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_svd_pinv(rc_svd_t d, rc_matrix_t* Ainv){
+	int i,j,l,k;
+	real_t tol, sum;
+	if(unlikely(!d.initialized)){
+		fprintf(stderr,"ERROR in rc_svd_pinv, decomposition uninitialized\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_matrix(Ainv,d.cols,d.rows))){
+		fprintf(stderr,"ERROR in rc_svd_pinv, failed to allocate Ainv\n");
+		return -1;
+	}
+	k = d.S.len;
+	tol = (d.rows>d.cols ? d.rows : d.cols)*d.S.d[0]*REAL_EPSILON;
+	// S is sorted so stop at the first one treated as zero
+	for(l=0;l<k && d.S.d[l]>tol;l++);
+	for(i=0;i<d.cols;i++){
+		for(j=0;j<d.rows;j++){
+			sum = 0.0f;
+			for(k=0;k<l;k++) sum += d.V.d[i][k]*d.U.d[j][k]/d.S.d[k];
+			AT(*Ainv,i,j) = sum;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,418 @@
+/*******************************************************************************
+* rc_kalman.c
+*
+* Discrete-time Kalman filter, linear and extended. Every matrix the filter
+* needs is allocated when it is set up, along with a workspace for the rc_gemm
+* packing buffer, so rc_kalman_predict and rc_kalman_update never touch the
+* heap and can run inside the IMU interrupt.
+*
+* The covariance is kept exactly symmetric. Only its lower triangle is computed
+* in each product that produces it, and the upper triangle is mirrored from it.
+* The innovation covariance S is factored with Cholesky instead of inverted,
+* and the covariance update uses the Joseph form
+* P=(I-KH)P(I-KH)'+KRK', which stays positive definite under float rounding
+* where the short form P=(I-KH)P slowly loses it.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+/*******************************************************************************
+* rc_kalman_t rc_empty_kalman()
+*
+* Returns an rc_kalman_t with no allocated memory and the initialized flag set
+* to 0. Use this to initialize local filters before any other function.
+*******************************************************************************/
+rc_kalman_t rc_empty_kalman(){
+	rc_kalman_t kf;
+	// zero-out piecemeal instead of with memset to avoid issues with padding
+	kf.nx			= 0;
+	kf.nu			= 0;
+	kf.ny			= 0;
+	kf.ekf			= 0;
+	kf.f			= NULL;
+	kf.h			= NULL;
+	kf.ctx			= NULL;
+	kf.F			= rc_empty_matrix();
+	kf.G			= rc_empty_matrix();
+	kf.H			= rc_empty_matrix();
+	kf.Q			= rc_empty_matrix();
+	kf.R			= rc_empty_matrix();
+	kf.P			= rc_empty_matrix();
+	kf.Pi			= rc_empty_matrix();
+	kf.x_est		= rc_empty_vector();
+	kf.x_pre		= rc_empty_vector();
+	kf.innov		= rc_empty_vector();
+	kf.S			= rc_empty_matrix();
+	kf.K			= rc_empty_matrix();
+	kf.Kt			= rc_empty_matrix();
+	kf.PHt			= rc_empty_matrix();
+	kf.KR			= rc_empty_matrix();
+	kf.M			= rc_empty_matrix();
+	kf.T			= rc_empty_matrix();
+	kf.ws			= rc_empty_workspace();
+	kf.step			= 0;
+	kf.initialized	= 0;
+	return kf;
+}
+
+/*******************************************************************************
+* int check_square_size(rc_matrix_t A, int n, const char* name, const char* fn)
+*
+* only for use in this file. Prints an error and returns -1 unless A is an
+* initialized n x n matrix.
+*******************************************************************************/
+static int check_square_size(rc_matrix_t A, int n, const char* name, const char* fn){
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in %s, %s uninitialized\n", fn, name);
+		return -1;
+	}
+	if(unlikely(A.rows!=n || A.cols!=n)){
+		fprintf(stderr,"ERROR in %s, %s must be %dx%d\n", fn, name, n, n);
+		return -1;
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int alloc_common(rc_kalman_t* kf, int nx, int nu, int ny, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t Pi, const char* fn)
+*
+* only for use in this file. Allocates everything both filter types share,
+* copies in the noise covariances and initial covariance, and resets the
+* filter. The workspace is sized for the largest product done per step.
+*******************************************************************************/
+static int alloc_common(rc_kalman_t* kf, int nx, int nu, int ny, rc_matrix_t Q, \
+				rc_matrix_t R, rc_matrix_t Pi, const char* fn){
+	size_t bytes, need;
+	if(unlikely(check_square_size(Q,nx,"Q",fn))) return -1;
+	if(unlikely(check_square_size(R,ny,"R",fn))) return -1;
+	if(unlikely(check_square_size(Pi,nx,"Pi",fn))) return -1;
+	kf->nx = nx;
+	kf->nu = nu;
+	kf->ny = ny;
+	if(unlikely(rc_duplicate_matrix(Q,&kf->Q)	|| \
+				rc_duplicate_matrix(R,&kf->R)	|| \
+				rc_duplicate_matrix(Pi,&kf->Pi)	|| \
+				rc_alloc_matrix(&kf->F,nx,nx)	|| \
+				rc_alloc_matrix(&kf->H,ny,nx)	|| \
+				rc_alloc_matrix(&kf->P,nx,nx)	|| \
+				rc_alloc_vector(&kf->x_est,nx)	|| \
+				rc_alloc_vector(&kf->x_pre,nx)	|| \
+				rc_alloc_vector(&kf->innov,ny)	|| \
+				rc_alloc_matrix(&kf->S,ny,ny)	|| \
+				rc_alloc_matrix(&kf->K,nx,ny)	|| \
+				rc_alloc_matrix(&kf->Kt,ny,nx)	|| \
+				rc_alloc_matrix(&kf->PHt,nx,ny)	|| \
+				rc_alloc_matrix(&kf->KR,nx,ny)	|| \
+				rc_alloc_matrix(&kf->M,nx,nx)	|| \
+				rc_alloc_matrix(&kf->T,nx,nx))){
+		fprintf(stderr,"ERROR in %s, failed to allocate memory\n", fn);
+		rc_free_kalman(kf);
+		return -1;
+	}
+	// every product goes through rc_multiply_matrices_ws one at a time, so
+	// the workspace only needs the biggest packing buffer plus alignment
+	bytes = rc_gemm_work_size(nx,nx,nx);
+	need = rc_gemm_work_size(nx,ny,nx);
+	if(need>bytes) bytes = need;
+	need = rc_gemm_work_size(ny,ny,nx);
+	if(need>bytes) bytes = need;
+	need = rc_gemm_work_size(nx,ny,ny);
+	if(need>bytes) bytes = need;
+	if(unlikely(rc_alloc_workspace(&kf->ws,bytes*sizeof(real_t)+64))){
+		fprintf(stderr,"ERROR in %s, failed to allocate workspace\n", fn);
+		rc_free_kalman(kf);
+		return -1;
+	}
+	kf->initialized = 1;
+	rc_reset_kalman(kf);
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_alloc_kalman_lin(rc_kalman_t* kf, rc_matrix_t F, rc_matrix_t G, rc_matrix_t H, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t Pi)
+*
+* Sets up kf as a linear Kalman filter for x[k+1]=Fx[k]+Gu[k]+w, y=Hx+v with
+* process noise covariance Q and measurement noise covariance R. Pi is the
+* covariance of the initial estimate, which starts at zero. Pass an empty
+* matrix for G if the model has no inputs. All of the matrices are copied so
+* the originals may be freed afterwards. Any memory already owned by kf is
+* freed first. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_kalman_lin(rc_kalman_t* kf, rc_matrix_t F, rc_matrix_t G, rc_matrix_t H, \
+				rc_matrix_t Q, rc_matrix_t R, rc_matrix_t Pi){
+	int nx,nu,ny;
+	if(unlikely(kf==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_kalman_lin, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!F.initialized || !H.initialized)){
+		fprintf(stderr,"ERROR in rc_alloc_kalman_lin, F or H uninitialized\n");
+		return -1;
+	}
+	nx = F.rows;
+	ny = H.rows;
+	nu = G.initialized ? G.cols : 0;
+	if(unlikely(F.cols!=nx || H.cols!=nx || (nu && G.rows!=nx))){
+		fprintf(stderr,"ERROR in rc_alloc_kalman_lin, dimension mismatch\n");
+		return -1;
+	}
+	rc_free_kalman(kf);
+	if(unlikely(alloc_common(kf,nx,nu,ny,Q,R,Pi,"rc_alloc_kalman_lin"))) return -1;
+	rc_duplicate_matrix(F,&kf->F);
+	rc_duplicate_matrix(H,&kf->H);
+	if(nu && unlikely(rc_duplicate_matrix(G,&kf->G))){
+		fprintf(stderr,"ERROR in rc_alloc_kalman_lin, failed to allocate memory\n");
+		rc_free_kalman(kf);
+		return -1;
+	}
+	kf->ekf = 0;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_alloc_kalman_ekf(rc_kalman_t* kf, int nx, int nu, int ny, rc_kalman_f_t f, rc_kalman_h_t h, void* ctx, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t Pi)
+*
+* Sets up kf as an extended Kalman filter with nx states, nu inputs and ny
+* measurements. f and h are called every predict and update with ctx to
+* evaluate the model and fill in its Jacobians, see rc_kalman_f_t and
+* rc_kalman_h_t. Q, R and Pi are as for rc_alloc_kalman_lin and are copied.
+* Any memory already owned by kf is freed first.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_kalman_ekf(rc_kalman_t* kf, int nx, int nu, int ny, rc_kalman_f_t f, \
+				rc_kalman_h_t h, void* ctx, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t Pi){
+	if(unlikely(kf==NULL || f==NULL || h==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_kalman_ekf, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(nx<1 || nu<0 || ny<1)){
+		fprintf(stderr,"ERROR in rc_alloc_kalman_ekf, nx and ny must be >=1 and nu >=0\n");
+		return -1;
+	}
+	rc_free_kalman(kf);
+	if(unlikely(alloc_common(kf,nx,nu,ny,Q,R,Pi,"rc_alloc_kalman_ekf"))) return -1;
+	rc_matrix_zeros(&kf->F,nx,nx);
+	rc_matrix_zeros(&kf->H,ny,nx);
+	kf->ekf = 1;
+	kf->f = f;
+	kf->h = h;
+	kf->ctx = ctx;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_kalman(rc_kalman_t* kf)
+*
+* Frees all memory owned by kf and resets it back to an empty struct.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_kalman(rc_kalman_t* kf){
+	if(unlikely(kf==NULL)){
+		fprintf(stderr,"ERROR in rc_free_kalman, received NULL pointer\n");
+		return -1;
+	}
+	rc_free_matrix(&kf->F);
+	rc_free_matrix(&kf->G);
+	rc_free_matrix(&kf->H);
+	rc_free_matrix(&kf->Q);
+	rc_free_matrix(&kf->R);
+	rc_free_matrix(&kf->P);
+	rc_free_matrix(&kf->Pi);
+	rc_free_vector(&kf->x_est);
+	rc_free_vector(&kf->x_pre);
+	rc_free_vector(&kf->innov);
+	rc_free_matrix(&kf->S);
+	rc_free_matrix(&kf->K);
+	rc_free_matrix(&kf->Kt);
+	rc_free_matrix(&kf->PHt);
+	rc_free_matrix(&kf->KR);
+	rc_free_matrix(&kf->M);
+	rc_free_matrix(&kf->T);
+	rc_free_workspace(&kf->ws);
+	*kf = rc_empty_kalman();
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_reset_kalman(rc_kalman_t* kf)
+*
+* Sets the estimate back to zero, the covariance back to Pi and the step
+* counter to 0. Write to kf->x_est afterwards to start from a different
+* estimate. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_reset_kalman(rc_kalman_t* kf){
+	if(unlikely(kf==NULL)){
+		fprintf(stderr,"ERROR in rc_reset_kalman, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!kf->initialized)){
+		fprintf(stderr,"ERROR in rc_reset_kalman, filter uninitialized\n");
+		return -1;
+	}
+	memset(kf->x_est.d,0,kf->nx*sizeof(real_t));
+	memcpy(kf->x_pre.d,kf->x_est.d,kf->nx*sizeof(real_t));
+	rc_duplicate_matrix(kf->Pi,&kf->P);
+	kf->step = 0;
+	return 0;
+}
+
+/*******************************************************************************
+* void sym_accumulate(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C)
+*
+* only for use in this file. Adds A*B' to the lower triangle of C, each entry
+* being a dot product of a row of A with a row of B. Used for products known
+* to be symmetric so the upper half is never computed. All three are dense
+* matrices owned by the filter.
+*******************************************************************************/
+static void sym_accumulate(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C){
+	int i,j;
+	for(i=0;i<C.rows;i++){
+		for(j=0;j<=i;j++){
+			AT(C,i,j) += rc_mult_accumulate(&AT(A,i,0),&AT(B,j,0),A.cols);
+		}
+	}
+	return;
+}
+
+/*******************************************************************************
+* void mirror_lower(rc_matrix_t C)
+*
+* only for use in this file. Copies the lower triangle of square C into its
+* upper triangle.
+*******************************************************************************/
+static void mirror_lower(rc_matrix_t C){
+	int i,j;
+	for(i=0;i<C.rows;i++){
+		for(j=0;j<i;j++) AT(C,j,i) = AT(C,i,j);
+	}
+	return;
+}
+
+/*******************************************************************************
+* int rc_kalman_predict(rc_kalman_t* kf, rc_vector_t u)
+*
+* Time update. Propagates the estimate through the model, x=Fx+Gu for a linear
+* filter or x=f(x,u) for an EKF, and the covariance as P=FPF'+Q with F being
+* the Jacobian from f for an EKF. u is ignored if the model has no inputs and
+* may be an empty vector. Makes no memory allocations.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_kalman_predict(rc_kalman_t* kf, rc_vector_t u){
+	int i;
+	if(unlikely(kf==NULL)){
+		fprintf(stderr,"ERROR in rc_kalman_predict, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!kf->initialized)){
+		fprintf(stderr,"ERROR in rc_kalman_predict, filter uninitialized\n");
+		return -1;
+	}
+	if(unlikely(kf->nu && (!u.initialized || u.len!=kf->nu))){
+		fprintf(stderr,"ERROR in rc_kalman_predict, u must have length %d\n", kf->nu);
+		return -1;
+	}
+	// state, x_pre is filled in then swapped into place
+	if(kf->ekf){
+		if(unlikely(kf->f(kf->x_est,u,&kf->x_pre,&kf->F,kf->ctx))){
+			fprintf(stderr,"ERROR in rc_kalman_predict, f callback failed\n");
+			return -1;
+		}
+	}
+	else{
+		rc_gemv(1.0f,kf->F,kf->x_est,0.0f,&kf->x_pre);
+		if(kf->nu) rc_gemv(1.0f,kf->G,u,1.0f,&kf->x_pre);
+	}
+	memcpy(kf->x_est.d,kf->x_pre.d,kf->nx*sizeof(real_t));
+	// covariance, T=FP then P=Q+TF' built from its lower triangle
+	if(unlikely(rc_multiply_matrices_ws(kf->F,kf->P,&kf->T,&kf->ws))){
+		fprintf(stderr,"ERROR in rc_kalman_predict, failed to multiply\n");
+		return -1;
+	}
+	for(i=0;i<kf->nx;i++) memcpy(&AT(kf->P,i,0),&AT(kf->Q,i,0),(i+1)*sizeof(real_t));
+	sym_accumulate(kf->T,kf->F,kf->P);
+	mirror_lower(kf->P);
+	kf->step++;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_kalman_update(rc_kalman_t* kf, rc_vector_t y)
+*
+* Measurement update with measurement y. The innovation y-Hx, or y-h(x) for an
+* EKF, is weighted by the gain K=PH'S^-1 where S=HPH'+R is solved with its
+* Cholesky factor, and P is updated in Joseph form. If S is not positive
+* definite the estimate and covariance are left untouched and -1 is returned.
+* Makes no memory allocations. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_kalman_update(rc_kalman_t* kf, rc_vector_t y){
+	int i,j,nx,ny;
+	rc_matrix_t KtT = rc_empty_matrix();
+	rc_matrix_t Ht = rc_empty_matrix();
+	if(unlikely(kf==NULL)){
+		fprintf(stderr,"ERROR in rc_kalman_update, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!kf->initialized)){
+		fprintf(stderr,"ERROR in rc_kalman_update, filter uninitialized\n");
+		return -1;
+	}
+	nx = kf->nx;
+	ny = kf->ny;
+	if(unlikely(!y.initialized || y.len!=ny)){
+		fprintf(stderr,"ERROR in rc_kalman_update, y must have length %d\n", ny);
+		return -1;
+	}
+	// innovation
+	if(kf->ekf){
+		if(unlikely(kf->h(kf->x_est,&kf->innov,&kf->H,kf->ctx))){
+			fprintf(stderr,"ERROR in rc_kalman_update, h callback failed\n");
+			return -1;
+		}
+		for(i=0;i<ny;i++) kf->innov.d[i] = y.d[i]-kf->innov.d[i];
+	}
+	else{
+		memcpy(kf->innov.d,y.d,ny*sizeof(real_t));
+		rc_gemv(-1.0f,kf->H,kf->x_est,1.0f,&kf->innov);
+	}
+	// PH' and S=HPH'+R, only the lower triangle of S is read by Cholesky
+	rc_matrix_transpose_view(kf->H,&Ht);
+	if(unlikely(rc_multiply_matrices_ws(kf->P,Ht,&kf->PHt,&kf->ws) || \
+				rc_multiply_matrices_ws(kf->H,kf->PHt,&kf->S,&kf->ws))){
+		fprintf(stderr,"ERROR in rc_kalman_update, failed to multiply\n");
+		return -1;
+	}
+	for(i=0;i<ny;i++){
+		for(j=0;j<=i;j++) AT(kf->S,i,j) += AT(kf->R,i,j);
+	}
+	if(unlikely(rc_cholesky_decomp(&kf->S))){
+		fprintf(stderr,"ERROR in rc_kalman_update, innovation covariance not positive definite\n");
+		return -1;
+	}
+	// K'=S^-1(PH')' so the solve runs down columns of a transposed view,
+	// then K is copied out dense for the row-wise products below
+	rc_matrix_transpose_view(kf->PHt,&KtT);
+	rc_cholesky_solve_matrix(kf->S,KtT,&kf->Kt);
+	for(i=0;i<nx;i++){
+		for(j=0;j<ny;j++) AT(kf->K,i,j) = AT(kf->Kt,j,i);
+	}
+	// state
+	rc_gemv(1.0f,kf->K,kf->innov,1.0f,&kf->x_est);
+	// Joseph form, M=I-KH, T=MP, P=TM'+(KR)K'
+	if(unlikely(rc_multiply_matrices_ws(kf->K,kf->H,&kf->M,&kf->ws) || \
+				rc_multiply_matrices_ws(kf->K,kf->R,&kf->KR,&kf->ws))){
+		fprintf(stderr,"ERROR in rc_kalman_update, failed to multiply\n");
+		return -1;
+	}
+	for(i=0;i<nx;i++){
+		for(j=0;j<nx;j++) AT(kf->M,i,j) = (i==j) - AT(kf->M,i,j);
+	}
+	if(unlikely(rc_multiply_matrices_ws(kf->M,kf->P,&kf->T,&kf->ws))){
+		fprintf(stderr,"ERROR in rc_kalman_update, failed to multiply\n");
+		return -1;
+	}
+	for(i=0;i<nx;i++) memset(&AT(kf->P,i,0),0,(i+1)*sizeof(real_t));
+	sym_accumulate(kf->T,kf->M,kf->P);
+	sym_accumulate(kf->KR,kf->K,kf->P);
+	mirror_lower(kf->P);
+	return 0;
+}
@@ -7,6 +7,39 @@
 
 #include "rc_algebra_common.h"
 
+/*******************************************************************************
+* int ws_vector(rc_workspace_t* w, rc_vector_t* v, int len)
+*
+* only for use in this file. Points v at len floats taken from workspace w.
+* rc_vector_t has no notion of a view so v must never be passed to
+* rc_free_vector or to anything that could resize it. It is released along
+* with everything else when w is rewound.
+*******************************************************************************/
+static int ws_vector(rc_workspace_t* w, rc_vector_t* v, int len){
+	v->d = (real_t*)rc_workspace_push(w,len*sizeof(real_t));
+	if(unlikely(v->d==NULL)) return -1;
+	v->len = len;
+	v->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int ws_qr(rc_workspace_t* w, rc_qr_t* f, int rows, int cols)
+*
+* only for use in this file. Same as ws_lu in rc_algebra_common.h but for a
+* rows-by-cols QR factorization. f must not be passed to rc_free_qr.
+*******************************************************************************/
+static int ws_qr(rc_workspace_t* w, rc_qr_t* f, int rows, int cols){
+	*f = rc_empty_qr();
+	if(unlikely(rc_workspace_matrix(w,&f->QR,rows,cols))) return -1;
+	f->tau = (real_t*)rc_workspace_push(w,(rows<cols ? rows : cols)*sizeof(real_t));
+	if(unlikely(f->tau==NULL)) return -1;
+	f->rows = rows;
+	f->cols = cols;
+	f->initialized = 1;
+	return 0;
+}
+
 /*******************************************************************************
 * int rc_matrix_times_col_vec(rc_matrix_t A, rc_vector_t v, rc_vector_t* c)
 *
@@ -31,8 +64,15 @@ int rc_matrix_times_col_vec(rc_matrix_t A, rc_vector_t v, rc_vector_t* c){
 		fprintf(stderr,"ERROR in rc_matrix_times_col_vec, failed to allocate c\n");
 		return -1;
 	}
-	// run the sum
-	for(i=0;i<A.rows;i++) c->d[i]=rc_mult_accumulate(A.d[i],v.d,v.len);
+	// run the sum, rows of A are contiguous unless it is a transposed view
+	if(A.col_stride==1){
+		for(i=0;i<A.rows;i++) c->d[i]=rc_mult_accumulate(&AT(A,i,0),v.d,v.len);
+	}
+	else{
+		for(i=0;i<A.rows;i++){
+			c->d[i]=rc_mult_accumulate_strided(&AT(A,i,0),A.col_stride,v.d,1,v.len);
+		}
+	}
 	return 0;
 }
 
@@ -47,7 +87,7 @@ int rc_matrix_times_col_vec(rc_matrix_t A, rc_vector_t v, rc_vector_t* c){
 *******************************************************************************/
 int rc_row_vec_times_matrix(rc_vector_t v, rc_matrix_t A, rc_vector_t* c){
 	int i,j;
-	float* tmp;
+	real_t* tmp;
 	// sanity checks
 	if(unlikely(!A.initialized || !v.initialized)){
 		fprintf(stderr,"ERROR in rc_row_vec_times_matrix, matrix or vector uninitialized\n");
@@ -60,7 +100,7 @@ int rc_row_vec_times_matrix(rc_vector_t v, rc_matrix_t A, rc_vector_t* c){
 	// allocate memory for a column of A from the stack, this is faster than 
 	// malloc and the memory is freed automatically when this function returns
 	// it is faster to put a column of A in contiguous memory then multiply
-	tmp = alloca(A.rows*sizeof(float));
+	tmp = alloca(A.rows*sizeof(real_t));
 	if(unlikely(tmp==NULL)){
 		fprintf(stderr,"ERROR in rc_row_vec_times_matrix, alloca failed, stack overflow\n");
 		return -1;
@@ -73,7 +113,7 @@ int rc_row_vec_times_matrix(rc_vector_t v, rc_matrix_t A, rc_vector_t* c){
 	// go through columns of A calculating c left to right
 	for(i=0;i<A.cols;i++){
 		// put column of A in sequential memory slot
-		for(j=0;j<A.rows;j++) tmp[j]=A.d[j][i];
+		for(j=0;j<A.rows;j++) tmp[j]=AT(A,j,i);
 		// calculate each entry in c
 		c->d[i]=rc_mult_accumulate(v.d,tmp,v.len);
 	}
@@ -85,9 +125,9 @@ int rc_row_vec_times_matrix(rc_vector_t v, rc_matrix_t A, rc_vector_t* c){
 *
 * Returns the determinant of square matrix A or -1.0f on failure.
 *******************************************************************************/
-float rc_matrix_determinant(rc_matrix_t A){
+real_t rc_matrix_determinant(rc_matrix_t A){
 	int i,j,k;
-	float ratio, det;
+	real_t ratio, det;
 	rc_matrix_t tmp = rc_empty_matrix();
 	// sanity checks
 	if(unlikely(!A.initialized)){
@@ -99,9 +139,9 @@ float rc_matrix_determinant(rc_matrix_t A){
 		return -1.0f;
 	}
 	// shortcut for 1x1 matrix
-	if(A.rows==1) return A.d[0][0];
+	if(A.rows==1) return AT(A,0,0);
 	// shortcut for 2x2 matrix
-	if(A.rows==2) return A.d[0][0]*A.d[1][1] - A.d[0][1]*A.d[1][0];
+	if(A.rows==2) return AT(A,0,0)*AT(A,1,1) - AT(A,0,1)*AT(A,1,0);
 	// allocate a duplicate to shuffle around
 	if(unlikely(rc_duplicate_matrix(A,&tmp))){
 		fprintf(stderr,"ERROR in rc_matrix_determinant, failed to allocate duplicate\n");
@@ -121,6 +161,56 @@ float rc_matrix_determinant(rc_matrix_t A){
 	return det;
 }
 
+/*******************************************************************************
+* void lup_reduce(rc_matrix_t A, rc_matrix_t L, rc_matrix_t U, rc_matrix_t P, int* ptmp)
+*
+* only for use in this file. The body of rc_lup_decomp once the outputs are
+* allocated: U holds a copy of A, L is the identity, P is zeros and ptmp has
+* room for A.rows ints.
+*******************************************************************************/
+static void lup_reduce(rc_matrix_t A, rc_matrix_t L, rc_matrix_t U, rc_matrix_t P, int* ptmp){
+	int i,j,k,index,tmpint;
+	real_t s, a, tmpf;
+	const int m = A.rows;
+	// make ptmp where each value contains the column position of the 1 in it's
+	// initial identity matrix form
+	for(i=0;i<m;i++) ptmp[i]=i;
+	// now do the pivoting
+	for(i=0;i<m-1;i++){
+		index = i;
+		for(j=i;j<m;j++){
+			if(fabs(AT(A,j,i))>=fabs(AT(A,index,i)))	index=j;
+		}
+		if(index!=i){
+			// swap rows in ptmp
+			tmpint = ptmp[index];
+			ptmp[index]=ptmp[i];
+			ptmp[i]=tmpint;
+			// swap rows of U
+			for(j=0;j<m;j++){
+				tmpf = AT(U,index,j);
+				AT(U,index,j) = AT(U,i,j);
+				AT(U,i,j) = tmpf;
+			}
+		}
+	}
+	// construct P from ptmp
+	for(i=0;i<m;i++) AT(P,i,ptmp[i])=1.0f;
+	// now do normal LU. Row i of U still holds the pivoted row of A when it is
+	// reached so each entry is read once then replaced by its entry of U or L
+	for(i=0;i<m;i++){
+		for(j=0;j<m;j++){
+			s = 0.0f;
+			for(k=0;k<i && k<j;k++) s += AT(U,k,j) * AT(L,i,k);
+			a = AT(U,i,j);
+			if(j>=i) AT(U,i,j) = a-s;
+			if(i>=j) AT(L,i,j) = (a-s)/AT(U,j,j);
+			if(j<i)  AT(U,i,j) = 0.0f;
+		}
+	}
+	return;
+}
+
 /*******************************************************************************
 * int rc_lup_decomp(rc_matrix_t A, rc_matrix_t* L, rc_matrix_t* U, rc_matrix_t* P)
 *
@@ -130,11 +220,8 @@ float rc_matrix_determinant(rc_matrix_t A){
 * Returns 0 on success or -1 on failure.
 *******************************************************************************/
 int rc_lup_decomp(rc_matrix_t A, rc_matrix_t* L, rc_matrix_t* U, rc_matrix_t* P){
-	int i,j,k,m,index,tmpint;
-	float s1, s2;
+	int m;
 	int* ptmp;
-	void* rowtmp;
-	rc_matrix_t Adup = rc_empty_matrix();
 	// sanity checks
 	if(unlikely(!A.initialized)){
 		fprintf(stderr,"ERROR in rc_lup_decomp, matrix not initialized yet\n");
@@ -144,291 +231,142 @@ int rc_lup_decomp(rc_matrix_t A, rc_matrix_t* L, rc_matrix_t* U, rc_matrix_t* P)
 		fprintf(stderr,"ERROR in rc_lup_decomp, matrix is not square\n");
 		return -1;
 	}
-	// allocate some memory!
+	// allocate some memory! U starts as a copy of A and is pivoted and reduced
+	// in place so no other duplicate of A is needed
 	m = A.cols;
-	if(unlikely(rc_duplicate_matrix(A, &Adup))){
+	if(unlikely(rc_duplicate_matrix(A, U))){
 		fprintf(stderr,"ERROR in rc_lup_decomp, failed to duplicate A\n");
 		return -1;
 	}
 	if(unlikely(rc_identity_matrix(L,m))){
 		fprintf(stderr,"ERROR in rc_lup_decomp, failed to allocate identity matrix\n");
-		rc_free_matrix(&Adup);
-		return -1;
-	}
-	if(unlikely(rc_alloc_matrix(U,m,m))){
-		fprintf(stderr,"ERROR in rc_lup_decomp, failed to allocate U\n");
-		rc_free_matrix(&Adup);
-		rc_free_matrix(L);
+		rc_free_matrix(U);
 		return -1;
 	}
 	if(unlikely(rc_matrix_zeros(P,m,m))){
 		fprintf(stderr,"ERROR in rc_lup_decomp, failed to allocate matrix of zeros\n");
-		rc_free_matrix(&Adup);
 		rc_free_matrix(L);
 		rc_free_matrix(U);
 		return -1;
 	}
 	// represent P as an array of positions 0 through (m-1) for fast pivoting
-	// also alloc memory for a row of A as tmp holder while pivoting
 	ptmp = alloca(m*sizeof(int));
-	rowtmp = alloca(m*sizeof(float));
-	if(unlikely(ptmp==NULL || rowtmp==NULL)){
+	if(unlikely(ptmp==NULL)){
 		fprintf(stderr,"ERROR in rc_lup_decomp, alloca failed, stack overflow\n");
-		rc_free_matrix(&Adup);
 		rc_free_matrix(L);
 		rc_free_matrix(U);
 		rc_free_matrix(P);
 		return -1;
 	}
-	// make ptmp where each value contains the column position of the 1 in it's
-	// initial identity matrix form
-	for(i=0;i<m;i++) ptmp[i]=i;
-	// now do the pivoting
-	for(i=0;i<m-1;i++){
-		index = i;
-		for(j=i;j<m;j++){
-			if(fabs(A.d[j][i])>=fabs(A.d[index][i]))	index=j;
-		}
-		if(index!=i){
-			// swap rows in ptmp
-			tmpint = ptmp[index];
-			ptmp[index]=ptmp[i];
-			ptmp[i]=tmpint;
-			// swap rows of A
-			memcpy(rowtmp,Adup.d[index],m*sizeof(float));
-			memcpy(Adup.d[index],Adup.d[i],m*sizeof(float));
-			memcpy(Adup.d[i],rowtmp,m*sizeof(float));
-		}
-	}
-	// construct P from ptmp
-	for(i=0;i<m;i++) P->d[i][ptmp[i]]=1.0f;
-	// now do normal LU
-	for(i=0;i<m;i++){
-		for(j=0;j<m;j++){
-			s1 = 0.0f;
-			s2 = 0.0f;
-			for(k=0;k<i;k++) s1 += U->d[k][j] * L->d[i][k];
-			for(k=0;k<j;k++) s2 += U->d[k][j] * L->d[i][k];
-			if(j>=i) U->d[i][j] = (Adup.d[i][j]-s1);
-			if(i>=j) L->d[i][j] = (Adup.d[i][j]-s2)/U->d[j][j];
-		}
-	}
-	rc_free_matrix(&Adup);
+	lup_reduce(A,*L,*U,*P,ptmp);
 	return 0;
 }
 
 /*******************************************************************************
-* int qr_multiply_q_right(rc_matrix_t* A, rc_matrix_t x)
+* int rc_lup_decomp_ws(rc_matrix_t A, rc_matrix_t* L, rc_matrix_t* U, rc_matrix_t* P, rc_workspace_t* w)
 *
-* performs a right matrix multiplication of x on the bottom right minor of A 
-* where x is smaller than or equal to the size of A. Only used here in the
-* backend, not for user access.
+* Same as rc_lup_decomp but the pivot array comes from workspace w instead of
+* the stack. L, U and P are only allocated if they are not already the right
+* size and may be views, so repeated calls with the same outputs never touch
+* the heap. Returns 0 on success or -1 on failure.
 *******************************************************************************/
-int qr_multiply_q_right(rc_matrix_t* A, rc_matrix_t x){
-	int i,j,k,q;
-	rc_matrix_t tmp = rc_empty_matrix();
-	float* col;
-	if(unlikely(!A->initialized || !x.initialized)){
-		fprintf(stderr,"ERROR in qr_multiply_q_right, uninitialized matrix\n");
+int rc_lup_decomp_ws(rc_matrix_t A, rc_matrix_t* L, rc_matrix_t* U, rc_matrix_t* P, rc_workspace_t* w){
+	int m;
+	size_t mark;
+	int* ptmp;
+	// sanity checks
+	if(unlikely(w==NULL)){
+		fprintf(stderr,"ERROR in rc_lup_decomp_ws, received NULL pointer\n");
 		return -1;
 	}
-	if(unlikely(A->cols<x.rows || A->rows<x.cols)){
-		fprintf(stderr,"ERROR in qr_multiply_q_right, dimension mismatch\n");
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_lup_decomp_ws, matrix not initialized yet\n");
 		return -1;
 	}
-	// q is the number of columns of A left untouched because x is smaller
-	q=A->cols-x.rows;
-	// duplicate the subset of A to be operated on
-	if(unlikely(rc_alloc_matrix(&tmp,A->rows, x.rows))){
-		fprintf(stderr,"ERROR in qr_multiply_q_right, failed to allocate tmp\n");
+	if(unlikely(A.cols!=A.rows)){
+		fprintf(stderr,"ERROR in rc_lup_decomp_ws, matrix is not square\n");
 		return -1;
 	}
-	for(i=0;i<A->rows;i++){
-		for(j=0;j<x.rows;j++){
-			tmp.d[i][j]=A->d[i][j+q];
-		}
-	}
-	// allocate memory for a column of tmp from the stack, this is faster than 
-	// malloc and the memory is freed automatically when this function returns
-	// it is faster to put a column in contiguous memory before multiplying
-	col = alloca(x.rows*sizeof(float));
-	if(unlikely(col==NULL)){
-		fprintf(stderr,"ERROR in qr_multiply_q_right, alloca failed, stack overflow\n");
-		rc_free_matrix(&tmp);
+	m = A.cols;
+	if(unlikely(rc_duplicate_matrix(A,U) || rc_identity_matrix(L,m) || rc_matrix_zeros(P,m,m))){
+		fprintf(stderr,"ERROR in rc_lup_decomp_ws, failed to allocate outputs\n");
 		return -1;
 	}
-	// do the multiplication, overwriting A left q columns of A remain untouched 
-	for(j=0;j<(A->cols-q);j++){
-		// put column of x in sequential memory slot
-		for(k=0;k<x.rows;k++) col[k]=x.d[k][j];
-		// now go down the i'th column of A
-		// x is hermetian so don't bother transposing its columns
-		for(i=0;i<A->rows;i++){
-			A->d[i][j+q]=rc_mult_accumulate(tmp.d[i],col,x.rows);
-		}
+	mark = w->used;
+	ptmp = (int*)rc_workspace_push(w,m*sizeof(int));
+	if(unlikely(ptmp==NULL)){
+		fprintf(stderr,"ERROR in rc_lup_decomp_ws, failed to get workspace\n");
+		return -1;
 	}
-	// free up tmp memory
-	rc_free_matrix(&tmp);
+	lup_reduce(A,*L,*U,*P,ptmp);
+	rc_workspace_rewind(w,mark);
 	return 0;
 }
 
 /*******************************************************************************
-* int qr_multiply_r_left(rc_matrix_t x, rc_matrix_t* Am, float norm)
+* int rc_qr_decomp(rc_matrix_t A, rc_matrix_t* Q, rc_matrix_t* R)
 *
-* performs a left matrix multiplication of x on the bottom right minor of A 
-* where x is smaller than or equal to the size of A. Only used here in the
-* backend, not for user access.
+* Uses householder reflection method to find the QR decomposition of A. The
+* compact factorization from rc_qr_factor is formed into full Q and R here,
+* use rc_qr_factor directly if Q isn't actually needed.
+* Returns 0 on success or -1 on failure.
 *******************************************************************************/
-int qr_multiply_r_left(rc_matrix_t H, rc_matrix_t* R, float norm){
-	int i,j,p;
-	rc_matrix_t tmp = rc_empty_matrix();
-	// sanity checks
-	if(unlikely(!R->initialized || !H.initialized)){
-		fprintf(stderr,"ERROR in qr_multiply_q_right, uninitialized matrix\n");
-		return -1;
-	}
-	if(R->rows<H.cols){
-		fprintf(stderr,"ERROR in  qr_multiply_r_left dimension mismatch\n");
+int rc_qr_decomp(rc_matrix_t A, rc_matrix_t* Q, rc_matrix_t* R){
+	int ret = 0;
+	rc_qr_t f = rc_empty_qr();
+	// Sanity Checks
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_qr_decomp, matrix not initialized yet\n");
 		return -1;
 	}
-	// p is the index of A defining the top left corner of the operation
-	// p=q=0 if x is same size as A', 
-	p=R->rows-H.rows; 
-	//q=R->cols-H.cols;
-	// alloc memory for a duplicate the subset of A to be operated on
-	if(unlikely(rc_alloc_matrix(&tmp, R->cols-p, R->rows-p))){
-		fprintf(stderr,"ERROR in qr_multiply_r_left, failed to allocate tmp\n");
+	if(unlikely(rc_qr_factor(A,&f))){
+		fprintf(stderr,"ERROR in rc_qr_decomp, failed to factor A\n");
 		return -1;
 	}
-	// Copy Section of R to be operated on
-	// store it in transpose form so memory access later is contiguous
-	for(i=0;i<R->rows-p;i++){
-		for(j=0;j<R->cols-p;j++){
-			tmp.d[j][i]=R->d[i+p][j+p];
-		}
-	}
-	// go through the rows of R starting from the first row that requires
-	// modifying. as H shrinks, only the lower rows need modifying
-	for(i=0;i<(R->rows-p);i++){
-		// we know first column of R will be mostly zeros, so fill in zeros
-		// or known norm where possible. we use p to 
-		if(i==0)	R->d[i+p][p]=norm;
-		else		R->d[i+p][p]=0.0f;
-		// do multiplication for the rest of the columns
-		// A has already been transposed so don't transpose each column
-		for(j=1;j<(R->cols-p);j++){
-			R->d[i+p][j+p]=rc_mult_accumulate(H.d[i],tmp.d[j],H.cols);
-		}
-	}
-	// free up tmp memory
-	rc_free_matrix(&tmp);
-	return 0;
-}
-
-/*******************************************************************************
-* rc_matrix_t qr_householder_matrix(rc_vector_t x, float* new_norm)
-*
-* returns the householder reflection matrix for a given vector
-* where u=x-ae1, v=u/norm(u), H=I-(2/norm(x))vv'
-* warning! modifies x!, only for use by qr decomposition below
-*******************************************************************************/
-rc_matrix_t qr_householder_matrix(rc_vector_t x, float* new_norm){
-	int i, j;
-	float norm, tau, taui, dot;
-	rc_matrix_t out = rc_empty_matrix();
-	rc_vector_t v = rc_empty_vector();
-
-	if(unlikely(!x.initialized)){
-		fprintf(stderr,"ERROR in qr_householder_matrix, vector uninitialized\n");
-		return rc_empty_matrix();
-	}
-	// allocate memory for output matrix
-	if(unlikely(rc_alloc_matrix(&out,x.len,x.len))){
-		fprintf(stderr,"ERROR in qr_householder_matrix, failed to alloc matrix\n");
-		return rc_empty_matrix();
-	}
-	// allocate memory for output matrix
-	if(unlikely(rc_alloc_vector(&v,x.len))){
-		fprintf(stderr,"ERROR in qr_householder_matrix, failed to alloc vector\n");
-		rc_free_matrix(&out);
-		return rc_empty_matrix();
-	}
-	// set sign of norm to opposite of the pivot to avoid loss of significance
-	norm = rc_vector_norm(x,2);
-	if(x.d[0]>=0.0){
-		x.d[0]=(x.d[0]+norm);
-		*new_norm = -norm;
-	}
-	else {
-		x.d[0]=(x.d[0]-norm);
-		*new_norm = norm;
-	}
-	// pre-calculate matrix multiplication coefficient
-	// doing this on one line causes a compiler optimization error :-/
-	dot = rc_vector_dot_product(x,x);
-	tau = -2.0/dot;
-	// fill in diagonal and upper triangle of H
-	for(i=0;i<v.len;i++){
-		taui = tau*x.d[i];
-		// H=I-(2/norm(x))vv' so add 1 on the diagonal
-		out.d[i][i] = 1.0 + taui*x.d[i];
-		for(j=i+1;j<v.len;j++){
-			out.d[i][j] = taui*x.d[j];
-		}
-	}
-	// copy to lower triangle
-	for(i=1;i<v.len;i++){
-		for(j=0;j<i;j++){
-			out.d[i][j] = out.d[j][i];
-		}
+	if(unlikely(rc_qr_get_q(f,Q) || rc_qr_get_r(f,R))){
+		fprintf(stderr,"ERROR in rc_qr_decomp, failed to form Q and R\n");
+		ret = -1;
 	}
-	rc_free_vector(&v);
-	return out;
+	rc_free_qr(&f);
+	return ret;
 }
 
 /*******************************************************************************
-* int rc_qr_decomp(rc_matrix_t A, rc_matrix_t* Q, rc_matrix_t* R)
+* int rc_qr_decomp_ws(rc_matrix_t A, rc_matrix_t* Q, rc_matrix_t* R, rc_workspace_t* w)
 *
-* Uses householder reflection method to find the QR decomposition of A.
+* Same as rc_qr_decomp but the compact factorization lives in workspace w.
+* Q and R are only allocated if they are not already the right size and may be
+* views, so repeated calls with the same outputs never touch the heap.
 * Returns 0 on success or -1 on failure.
 *******************************************************************************/
-int rc_qr_decomp(rc_matrix_t A, rc_matrix_t* Q, rc_matrix_t* R){
-	int i,j,steps;
-	float norm;
-	rc_vector_t x = rc_empty_vector();
-	rc_matrix_t H = rc_empty_matrix();
+int rc_qr_decomp_ws(rc_matrix_t A, rc_matrix_t* Q, rc_matrix_t* R, rc_workspace_t* w){
+	int ret = 0;
+	size_t mark;
+	rc_qr_t f;
 	// Sanity Checks
+	if(unlikely(w==NULL)){
+		fprintf(stderr,"ERROR in rc_qr_decomp_ws, received NULL pointer\n");
+		return -1;
+	}
 	if(unlikely(!A.initialized)){
-		fprintf(stderr,"ERROR in rc_qr_decomp, matrix not initialized yet\n");
+		fprintf(stderr,"ERROR in rc_qr_decomp_ws, matrix not initialized yet\n");
 		return -1;
 	}
-	// start R as A
-	if(unlikely(rc_duplicate_matrix(A,R))){
-		fprintf(stderr,"ERROR in rc_qr_decomp, failed to duplicate A\n");
-		return -1;
-	}
-	// start R as square identity
-	rc_identity_matrix(Q,A.rows);
-	// find out how many householder reflections are necessary
-	if(A.rows==A.cols) steps=A.cols-1;		// square
-	else if(A.rows>A.cols) steps=A.cols;	// tall
-	else steps=A.rows-1;					// wide
-	// iterate through columns of A doing householder reflection to zero
-	// the entries below the diagonal
-	for(i=0;i<steps;i++){
-		// take col of R from diag down
-		rc_alloc_vector(&x,A.rows-i);
-		for(j=i;j<A.rows;j++) x.d[j-i]=R->d[j][i];
-		// get the ever-shrinking householder reflection for that column
-		// qr_householder also fills in the norm of that column to 'norm'
-		H = qr_householder_matrix(x, &norm);
-		rc_free_vector(&x);
-		// left multiply R
-		qr_multiply_r_left(H,R,norm);
-		qr_multiply_q_right(Q,H);
-		rc_free_matrix(&H);
+	mark = w->used;
+	if(unlikely(ws_qr(w,&f,A.rows,A.cols))){
+		fprintf(stderr,"ERROR in rc_qr_decomp_ws, failed to get workspace\n");
+		ret = -1;
 	}
-	return 0;
+	else if(unlikely(rc_qr_factor(A,&f))){
+		fprintf(stderr,"ERROR in rc_qr_decomp_ws, failed to factor A\n");
+		ret = -1;
+	}
+	else if(unlikely(rc_qr_get_q(f,Q) || rc_qr_get_r(f,R))){
+		fprintf(stderr,"ERROR in rc_qr_decomp_ws, failed to form Q and R\n");
+		ret = -1;
+	}
+	rc_workspace_rewind(w,mark);
+	return ret;
 }
 
 /*******************************************************************************
@@ -509,18 +447,74 @@ int rc_invert_matrix(rc_matrix_t A, rc_matrix_t* Ainv){
 	return i;
 }
 
+/*******************************************************************************
+* int rc_invert_matrix_ws(rc_matrix_t A, rc_matrix_t* Ainv, rc_workspace_t* w)
+*
+* Same as rc_invert_matrix but the factorization of A is packed into workspace
+* w with rc_lu_factor and the inverse is solved straight into Ainv, which is
+* only allocated if it is not already the right size and may be a view.
+* Repeated calls with the same Ainv never touch the heap. Returns 0 on success
+* or -1 on failure such as if matrix A is not invertible.
+*******************************************************************************/
+int rc_invert_matrix_ws(rc_matrix_t A, rc_matrix_t* Ainv, rc_workspace_t* w){
+	int ret = 0;
+	size_t mark;
+	rc_lu_t f;
+	// sanity checks
+	if(unlikely(w==NULL)){
+		fprintf(stderr,"ERROR in rc_invert_matrix_ws, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_invert_matrix_ws, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(A.cols!=A.rows)){
+		fprintf(stderr,"ERROR in rc_invert_matrix_ws, nonsquare matrix\n");
+		return -1;
+	}
+	mark = w->used;
+	if(unlikely(ws_lu(w,&f,A.rows))){
+		fprintf(stderr,"ERROR in rc_invert_matrix_ws, failed to get workspace\n");
+		ret = -1;
+	}
+	else if(unlikely(rc_lu_factor(A,&f))){
+		fprintf(stderr,"ERROR in rc_invert_matrix_ws, failed to factor A\n");
+		ret = -1;
+	}
+	// same singularity threshold as rc_invert_matrix
+	else if(fabs(rc_lu_determinant(f)) < 0.0001f){
+		fprintf(stderr,"ERROR in rc_invert_matrix_ws, matrix is singular\n");
+		ret = -1;
+	}
+	else if(unlikely(rc_lu_invert(f,Ainv))){
+		fprintf(stderr,"ERROR in rc_invert_matrix_ws, failed to invert\n");
+		ret = -1;
+	}
+	rc_workspace_rewind(w,mark);
+	return ret;
+}
+
 /*******************************************************************************
 * int rc_invert_matrix_inplace(rc_matrix_t* A)
 *
-* Inverts Matrix A in place. The original contents of A are lost.
+* Inverts Matrix A in place. The original contents of A are lost. If A is a
+* view the inverse is written back through the view.
 * Returns 0 on success or -1 on failure such as if A is not invertible.
 *******************************************************************************/
 int rc_invert_matrix_inplace(rc_matrix_t* A){
+	int ret;
 	rc_matrix_t Atmp = rc_empty_matrix();
 	if(unlikely(rc_invert_matrix(*A,&Atmp))){
 		fprintf(stderr, "ERROR in rc_invert_matrix_inplace, failed to invert\n");
 		return -1;
 	}
+	// views can't take over new memory, copy the result into them instead
+	if(A->d==NULL){
+		ret = rc_duplicate_matrix(Atmp,A);
+		rc_free_matrix(&Atmp);
+		return ret;
+	}
 	// free original memory and copy new matrix into place
 	rc_free_matrix(A);
 	*A = Atmp;
@@ -537,7 +531,7 @@ int rc_invert_matrix_inplace(rc_matrix_t* A){
 * Returns 0 on success or -1 on failure.
 *******************************************************************************/
 int rc_lin_system_solve(rc_matrix_t A, rc_vector_t b, rc_vector_t* x){
-	float fMaxElem, fAcc;
+	real_t fMaxElem, fAcc;
 	int nDim,i,j,k,m;
 	rc_matrix_t Atemp = rc_empty_matrix();
 	rc_vector_t btemp = rc_empty_vector();
@@ -628,50 +622,69 @@ int rc_lin_system_solve(rc_matrix_t A, rc_vector_t b, rc_vector_t* x){
 * Returns 0 on success or -1 on failure.
 *******************************************************************************/
 int rc_lin_system_solve_qr(rc_matrix_t A, rc_vector_t b, rc_vector_t* x){
-	int i,k;
-	rc_vector_t temp = rc_empty_vector();
-	rc_matrix_t Q = rc_empty_matrix();
-	rc_matrix_t R = rc_empty_matrix();
+	int ret = 0;
+	rc_qr_t f = rc_empty_qr();
 	if(unlikely(!A.initialized || !b.initialized)){
 		fprintf(stderr,"ERROR in rc_lin_system_solve_qr, matrix or vector uninitialized\n");
 		return -1;
 	}
 	// do QR decomposition
-	if(unlikely(rc_qr_decomp(A,&Q,&R))){
+	if(unlikely(rc_qr_factor(A,&f))){
 		fprintf(stderr,"ERROR in rc_lin_system_solve_qr, failed to perform QR decomp\n");
 		return -1;
 	}
 	// Ax=b
 	// QRx=b
 	// Rx=Q'b		because Q'Q=I
-	// RX=(b'Q)'	to avoid transposing q
-	// multiply through right hand side. No difference between row and col
-	// vector so avoid transposing Q by left instead of right multiplying
-	if(unlikely(rc_row_vec_times_matrix(b,Q,&temp))){
-		fprintf(stderr,"ERROR in rc_lin_system_solve_qr, failed to multiply vec by matrix\n");
-		rc_free_matrix(&Q);
-		rc_free_matrix(&R);
-		return -1;
-	}
-	// allocate memory for the output x
-	if(unlikely(rc_alloc_vector(x,R.cols))){
-		fprintf(stderr,"ERROR in rc_lin_system_solve_qr, failed to alloc vector\n");
-		rc_free_matrix(&Q);
-		rc_free_matrix(&R);
-		rc_free_vector(&temp);
-		return -1;
-	}
-	// solve for x knowing R is upper triangular
-	for(k=R.cols-1;k>=0;k--){
-		x->d[k]=temp.d[k];
-		for(i=k+1;i<R.cols;i++)	x->d[k]-=R.d[k][i]*x->d[i];
-		x->d[k] = x->d[k]/R.d[k][k];
+	// Q'b comes from applying the reflections straight to b, Q is never formed
+	if(unlikely(rc_qr_solve(f,b,x))){
+		fprintf(stderr,"ERROR in rc_lin_system_solve_qr, failed to solve\n");
+		ret = -1;
 	}
-	// free memory and return
-	rc_free_matrix(&Q);
-	rc_free_matrix(&R);
-	rc_free_vector(&temp);
-	return 0;
+	rc_free_qr(&f);
+	return ret;
+}
+
+/*******************************************************************************
+* void ellipsoid_design_matrix(rc_matrix_t pts, rc_matrix_t M)
+*
+* only for use in this file. Fills in the p-by-6 matrix M for the least
+* squares fit of ellipsoid coefficients to the p points in the rows of pts.
+*******************************************************************************/
+static void ellipsoid_design_matrix(rc_matrix_t pts, rc_matrix_t M){
+	int i;
+	for(i=0;i<pts.rows;i++){
+		AT(M,i,0) = AT(pts,i,0) * AT(pts,i,0);
+		AT(M,i,1) = AT(pts,i,0);
+		AT(M,i,2) = AT(pts,i,1) * AT(pts,i,1);
+		AT(M,i,3) = AT(pts,i,1);
+		AT(M,i,4) = AT(pts,i,2) * AT(pts,i,2);
+		AT(M,i,5) = AT(pts,i,2);
+	}
+	return;
+}
+
+/*******************************************************************************
+* void ellipsoid_length_system(rc_vector_t f, rc_vector_t ctr, rc_matrix_t A, rc_vector_t b)
+*
+* only for use in this file. Fills in the 3x3 system Ax=b whose solution holds
+* the inverse squared lengths of the ellipsoid with coefficients f and center
+* ctr.
+*******************************************************************************/
+static void ellipsoid_length_system(rc_vector_t f, rc_vector_t ctr, rc_matrix_t A, rc_vector_t b){
+	AT(A,0,0) = (f.d[0] * ctr.d[0] * ctr.d[0]) + 1.0f;
+	AT(A,0,1) = (f.d[0] * ctr.d[1] * ctr.d[1]);
+	AT(A,0,2) = (f.d[0] * ctr.d[2] * ctr.d[2]);
+	AT(A,1,0) = (f.d[2] * ctr.d[0] * ctr.d[0]);
+	AT(A,1,1) = (f.d[2] * ctr.d[1] * ctr.d[1]) + 1.0f;
+	AT(A,1,2) = (f.d[2] * ctr.d[2] * ctr.d[2]);
+	AT(A,2,0) = (f.d[4] * ctr.d[0] * ctr.d[0]);
+	AT(A,2,1) = (f.d[4] * ctr.d[1] * ctr.d[1]);
+	AT(A,2,2) = (f.d[4] * ctr.d[2] * ctr.d[2]) + 1.0f;
+	b.d[0] = f.d[0];
+	b.d[1] = f.d[2];
+	b.d[2] = f.d[4];
+	return;
 }
 
 /*******************************************************************************
@@ -695,10 +708,11 @@ int rc_lin_system_solve_qr(rc_matrix_t A, rc_vector_t b, rc_vector_t* x){
 * Returns 0 on success or -1 on failure. 
 *******************************************************************************/
 int rc_fit_ellipsoid(rc_matrix_t pts, rc_vector_t* ctr, rc_vector_t* lens){
-	int i,p;
+	int p;
 	rc_matrix_t A = rc_empty_matrix();
 	rc_vector_t b = rc_empty_vector();
 	rc_vector_t f = rc_empty_vector();
+	rc_qr_t qr = rc_empty_qr();
 	// sanity checks
 	if(unlikely(!pts.initialized)){
 		fprintf(stderr,"ERROR in rc_fit_ellipsoid, matrix not initialized\n");
@@ -718,30 +732,24 @@ int rc_fit_ellipsoid(rc_matrix_t pts, rc_vector_t* ctr, rc_vector_t* lens){
 		fprintf(stderr,"ERROR in rc_fit_ellipsoid, failed to alloc vector\n");
 		return -1;
 	}
-	if(unlikely(rc_alloc_matrix(&A,p,6))){
-		fprintf(stderr,"ERROR in rc_fit_ellipsoid, failed to alloc matrix\n");
+	if(unlikely(rc_alloc_qr(&qr,p,6))){
+		fprintf(stderr,"ERROR in rc_fit_ellipsoid, failed to alloc QR\n");
 		rc_free_vector(&b);
 		return -1;
 	}
-	// fill in A for QR
-	for(i=0;i<p;i++){
-		A.d[i][0] = pts.d[i][0] * pts.d[i][0];
-		A.d[i][1] = pts.d[i][0];
-		A.d[i][2] = pts.d[i][1] * pts.d[i][1];
-		A.d[i][3] = pts.d[i][1];
-		A.d[i][4] = pts.d[i][2] * pts.d[i][2];
-		A.d[i][5] = pts.d[i][2];
-	}
+	// fill in A for QR directly in the factorization's memory so it can be
+	// factored in place without a copy
+	ellipsoid_design_matrix(pts,qr.QR);
 	// solve least squares fit for centroid
-	if(unlikely(rc_lin_system_solve_qr(A,b,&f))){
+	if(unlikely(rc_qr_factor(qr.QR,&qr) || rc_qr_solve(qr,b,&f))){
 		fprintf(stderr,"ERROR in rc_fit_ellipsoid, failed to solve QR\n");
-		rc_free_matrix(&A);
+		rc_free_qr(&qr);
 		rc_free_vector(&b);
 		rc_free_vector(&f);
 		return -1;
 	}
-	// done with A&b now
-	rc_free_matrix(&A);
+	// done with the QR and b now
+	rc_free_qr(&qr);
 	rc_free_vector(&b);
 	
 	// compute center 
@@ -764,20 +772,7 @@ int rc_fit_ellipsoid(rc_matrix_t pts, rc_vector_t* ctr, rc_vector_t* lens){
 		rc_free_vector(&b);
 		return -1;
 	}
-	// fill in A
-	A.d[0][0] = (f.d[0] * ctr->d[0] * ctr->d[0]) + 1.0f;
-	A.d[0][1] = (f.d[0] * ctr->d[1] * ctr->d[1]);
-	A.d[0][2] = (f.d[0] * ctr->d[2] * ctr->d[2]);
-	A.d[1][0] = (f.d[2] * ctr->d[0] * ctr->d[0]);
-	A.d[1][1] = (f.d[2] * ctr->d[1] * ctr->d[1]) + 1.0f;
-	A.d[1][2] = (f.d[2] * ctr->d[2] * ctr->d[2]);
-	A.d[2][0] = (f.d[4] * ctr->d[0] * ctr->d[0]);
-	A.d[2][1] = (f.d[4] * ctr->d[1] * ctr->d[1]);
-	A.d[2][2] = (f.d[4] * ctr->d[2] * ctr->d[2]) + 1.0f;
-	// fill in b
-	b.d[0] = f.d[0];
-	b.d[1] = f.d[2];
-	b.d[2] = f.d[4];
+	ellipsoid_length_system(f,*ctr,A,b);
 	// solve for lengths
 	if(unlikely(rc_lin_system_solve(A,b,lens))){
 		fprintf(stderr,"ERROR in rc_fit_ellipsoid, failed to solve linear system\n");
@@ -795,3 +790,75 @@ int rc_fit_ellipsoid(rc_matrix_t pts, rc_vector_t* ctr, rc_vector_t* lens){
 	rc_free_vector(&f);
 	return 0;
 }
+
+/*******************************************************************************
+* int rc_fit_ellipsoid_ws(rc_matrix_t pts, rc_vector_t* ctr, rc_vector_t* lens, rc_workspace_t* w)
+*
+* Same as rc_fit_ellipsoid but the least squares system, its QR factorization
+* and the 3x3 system for the lengths all live in workspace w. ctr and lens are
+* only allocated if they are not already 3 long, so repeated fits never touch
+* the heap. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_fit_ellipsoid_ws(rc_matrix_t pts, rc_vector_t* ctr, rc_vector_t* lens, rc_workspace_t* w){
+	int i,p;
+	size_t mark;
+	rc_matrix_t A = rc_empty_matrix();
+	rc_vector_t b, f;
+	rc_qr_t qr;
+	rc_lu_t lu;
+	// sanity checks
+	if(unlikely(w==NULL || ctr==NULL || lens==NULL)){
+		fprintf(stderr,"ERROR in rc_fit_ellipsoid_ws, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!pts.initialized)){
+		fprintf(stderr,"ERROR in rc_fit_ellipsoid_ws, matrix not initialized\n");
+		return -1;
+	}
+	if(unlikely(pts.cols!=3)){
+		fprintf(stderr,"ERROR in rc_fit_ellipsoid_ws, matrix pts must have 3 columns\n");
+		return -1;
+	}
+	p = pts.rows;
+	if(p<6){
+		fprintf(stderr,"ERROR in rc_fit_ellipsoid_ws, matrix pts must have at least 6 rows\n");
+		return -1;
+	}
+	mark = w->used;
+	if(unlikely(ws_qr(w,&qr,p,6) || ws_vector(w,&b,p) || ws_vector(w,&f,6) || \
+				rc_workspace_matrix(w,&A,3,3) || ws_lu(w,&lu,3))){
+		fprintf(stderr,"ERROR in rc_fit_ellipsoid_ws, failed to get workspace\n");
+		rc_workspace_rewind(w,mark);
+		return -1;
+	}
+	// solve least squares fit for centroid, factoring in place
+	for(i=0;i<p;i++) b.d[i] = 1.0f;
+	ellipsoid_design_matrix(pts,qr.QR);
+	if(unlikely(rc_qr_factor(qr.QR,&qr) || rc_qr_solve(qr,b,&f))){
+		fprintf(stderr,"ERROR in rc_fit_ellipsoid_ws, failed to solve QR\n");
+		rc_workspace_rewind(w,mark);
+		return -1;
+	}
+	// compute center
+	if(unlikely(rc_alloc_vector(ctr,3))){
+		fprintf(stderr,"ERROR in rc_fit_ellipsoid_ws, failed to allocate ctr\n");
+		rc_workspace_rewind(w,mark);
+		return -1;
+	}
+	ctr->d[0] = -f.d[1]/(2.0f*f.d[0]);
+	ctr->d[1] = -f.d[3]/(2.0f*f.d[2]);
+	ctr->d[2] = -f.d[5]/(2.0f*f.d[4]);
+	// solve for lengths using the front of b as the right hand side
+	b.len = 3;
+	ellipsoid_length_system(f,*ctr,A,b);
+	if(unlikely(rc_lu_factor(A,&lu) || rc_lu_solve(lu,b,lens))){
+		fprintf(stderr,"ERROR in rc_fit_ellipsoid_ws, failed to solve linear system\n");
+		rc_workspace_rewind(w,mark);
+		return -1;
+	}
+	lens->d[0] = 1.0f/sqrt(lens->d[0]);
+	lens->d[1] = 1.0f/sqrt(lens->d[1]);
+	lens->d[2] = 1.0f/sqrt(lens->d[2]);
+	rc_workspace_rewind(w,mark);
+	return 0;
+}
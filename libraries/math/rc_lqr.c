@@ -0,0 +1,224 @@
+/*******************************************************************************
+* rc_lqr.c
+*
+* Discrete algebraic Riccati equation solver and LQR gain design. The Riccati
+* equation is solved with the structure-preserving doubling algorithm which
+* needs only matrix products and one LU solve per iteration, converges
+* quadratically, and unlike a Schur method doesn't need a general eigenvalue
+* solver. Written with real_t so it is built in both float and double, see
+* rc_real.h. These allocate their temporaries and are meant for setup time or
+* a background thread, not the control loop itself.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+// doubling converges quadratically so this is only reached when the pair
+// (A,B) is not stabilizable or (A,Q) is not detectable
+#define DARE_MAX_ITER	64
+// stop once an iteration changes P by less than this relative amount
+#define DARE_TOL		(16*REAL_EPSILON)
+// P this much bigger than Q means it is growing without bound. Checked with a
+// finite limit since -ffast-math lets the compiler assume there are no inf/nan
+#define DARE_MAX_GROWTH	(1.0f/(REAL_EPSILON*REAL_EPSILON))
+
+/*******************************************************************************
+* void symmetrize(rc_matrix_t* A)
+*
+* only for use in this file. Replaces A with (A+A')/2 to stop rounding errors
+* from slowly making a symmetric iterate unsymmetric.
+*******************************************************************************/
+static void symmetrize(rc_matrix_t* A){
+	int i,j;
+	real_t avg;
+	for(i=0;i<A->rows;i++){
+		for(j=0;j<i;j++){
+			avg = 0.5f*(AT(*A,i,j)+AT(*A,j,i));
+			AT(*A,i,j) = avg;
+			AT(*A,j,i) = avg;
+		}
+	}
+	return;
+}
+
+/*******************************************************************************
+* real_t max_abs(rc_matrix_t A)
+*
+* only for use in this file. Returns the largest absolute entry of A.
+*******************************************************************************/
+static real_t max_abs(rc_matrix_t A){
+	int i,j;
+	real_t m = 0.0f;
+	for(i=0;i<A.rows;i++){
+		for(j=0;j<A.cols;j++){
+			if(fabs(AT(A,i,j))>m) m = fabs(AT(A,i,j));
+		}
+	}
+	return m;
+}
+
+/*******************************************************************************
+* int rc_dare(rc_matrix_t A, rc_matrix_t B, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t* P)
+*
+* Solves the discrete algebraic Riccati equation
+* P = A'PA - A'PB(R+B'PB)^-1 B'PA + Q
+* for the stabilizing solution P with the structure-preserving doubling
+* algorithm. Starting from A0=A, G0=BR^-1B' and H0=Q each iteration does
+*
+* W = I+GH
+* A = A W^-1 A
+* G = G + A W^-1 G A'
+* H = H + A' H W^-1 A
+*
+* and H converges to P. Q must be symmetric positive semidefinite and R
+* symmetric positive definite. P is only allocated if it is not already the
+* right size. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_dare(rc_matrix_t A, rc_matrix_t B, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t* P){
+	int i, it, n, m, ret = -1;
+	real_t change, limit;
+	rc_matrix_t Ak = rc_empty_matrix();
+	rc_matrix_t Gk = rc_empty_matrix();
+	rc_matrix_t Hk = rc_empty_matrix();
+	rc_matrix_t W  = rc_empty_matrix();
+	rc_matrix_t X1 = rc_empty_matrix();
+	rc_matrix_t X2 = rc_empty_matrix();
+	rc_matrix_t T1 = rc_empty_matrix();
+	rc_matrix_t T2 = rc_empty_matrix();
+	rc_matrix_t Rl = rc_empty_matrix();
+	rc_matrix_t Bt = rc_empty_matrix();
+	rc_matrix_t At = rc_empty_matrix();
+	rc_lu_t lu = rc_empty_lu();
+	if(unlikely(P==NULL)){
+		fprintf(stderr,"ERROR in rc_dare, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized || !B.initialized || !Q.initialized || !R.initialized)){
+		fprintf(stderr,"ERROR in rc_dare, matrix uninitialized\n");
+		return -1;
+	}
+	n = A.rows;
+	m = B.cols;
+	if(unlikely(A.cols!=n || B.rows!=n || Q.rows!=n || Q.cols!=n || \
+				R.rows!=m || R.cols!=m)){
+		fprintf(stderr,"ERROR in rc_dare, dimension mismatch\n");
+		return -1;
+	}
+	// G0 = B R^-1 B' through the Cholesky factor of R
+	rc_duplicate_matrix(R,&Rl);
+	if(unlikely(rc_cholesky_decomp(&Rl))){
+		fprintf(stderr,"ERROR in rc_dare, R must be positive definite\n");
+		goto end;
+	}
+	rc_matrix_transpose(B,&Bt);
+	if(unlikely(rc_cholesky_solve_matrix(Rl,Bt,&T1) || \
+				rc_multiply_matrices(B,T1,&Gk))){
+		fprintf(stderr,"ERROR in rc_dare, failed to form BR^-1B'\n");
+		goto end;
+	}
+	symmetrize(&Gk);
+	rc_duplicate_matrix(A,&Ak);
+	rc_duplicate_matrix(Q,&Hk);
+	symmetrize(&Hk);
+	limit = max_abs(Hk);
+	if(limit<1.0f) limit = 1.0f;
+	limit *= DARE_MAX_GROWTH;
+	for(it=0;it<DARE_MAX_ITER;it++){
+		// W = I+GH, then X1 = W^-1 A and X2 = W^-1 G
+		rc_multiply_matrices(Gk,Hk,&W);
+		for(i=0;i<n;i++) AT(W,i,i) += 1.0f;
+		if(unlikely(rc_lu_factor(W,&lu))){
+			fprintf(stderr,"ERROR in rc_dare, I+GH became singular\n");
+			goto end;
+		}
+		rc_lu_solve_matrix(lu,Ak,&X1);
+		rc_lu_solve_matrix(lu,Gk,&X2);
+		rc_matrix_transpose_view(Ak,&At);
+		// H = H + A'HX1
+		rc_multiply_matrices(Hk,X1,&T1);
+		rc_multiply_matrices(At,T1,&T2);
+		change = max_abs(T2);
+		rc_add_matrices_inplace(&Hk,T2);
+		symmetrize(&Hk);
+		// G = G + AX2A'
+		rc_multiply_matrices(Ak,X2,&T1);
+		rc_multiply_matrices(T1,At,&T2);
+		rc_add_matrices_inplace(&Gk,T2);
+		symmetrize(&Gk);
+		// A = AX1 last since At is a view of it
+		rc_multiply_matrices(Ak,X1,&T1);
+		rc_duplicate_matrix(T1,&Ak);
+		if(unlikely(max_abs(Hk)>limit)) break;
+		if(change<=DARE_TOL*max_abs(Hk)){
+			ret = 0;
+			break;
+		}
+	}
+	if(unlikely(ret)){
+		fprintf(stderr,"ERROR in rc_dare, failed to converge, check that (A,B) is stabilizable\n");
+		goto end;
+	}
+	rc_duplicate_matrix(Hk,P);
+
+end:
+	rc_free_matrix(&Ak);
+	rc_free_matrix(&Gk);
+	rc_free_matrix(&Hk);
+	rc_free_matrix(&W);
+	rc_free_matrix(&X1);
+	rc_free_matrix(&X2);
+	rc_free_matrix(&T1);
+	rc_free_matrix(&T2);
+	rc_free_matrix(&Rl);
+	rc_free_matrix(&Bt);
+	rc_free_lu(&lu);
+	return ret;
+}
+
+/*******************************************************************************
+* int rc_dlqr(rc_matrix_t A, rc_matrix_t B, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t* K, rc_matrix_t* P)
+*
+* Designs the discrete linear quadratic regulator u=-Kx for the system
+* x[k+1]=Ax+Bu minimizing the sum of x'Qx+u'Ru. Solves the Riccati equation
+* with rc_dare and then K = (R+B'PB)^-1 B'PA. P may be NULL if the Riccati
+* solution isn't wanted. K and P are only allocated if they are not already
+* the right size. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_dlqr(rc_matrix_t A, rc_matrix_t B, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t* K, rc_matrix_t* P){
+	int ret = -1;
+	rc_matrix_t Pl = rc_empty_matrix();
+	rc_matrix_t Bt = rc_empty_matrix();
+	rc_matrix_t BtP = rc_empty_matrix();
+	rc_matrix_t S = rc_empty_matrix();
+	rc_matrix_t N = rc_empty_matrix();
+	if(unlikely(K==NULL)){
+		fprintf(stderr,"ERROR in rc_dlqr, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(rc_dare(A,B,Q,R,&Pl))){
+		fprintf(stderr,"ERROR in rc_dlqr, failed to solve Riccati equation\n");
+		return -1;
+	}
+	// S = R+B'PB and N = B'PA then solve SK=N with S positive definite
+	rc_matrix_transpose_view(B,&Bt);
+	rc_multiply_matrices(Bt,Pl,&BtP);
+	rc_multiply_matrices(BtP,B,&S);
+	rc_add_matrices_inplace(&S,R);
+	rc_multiply_matrices(BtP,A,&N);
+	if(unlikely(rc_cholesky_decomp(&S))){
+		fprintf(stderr,"ERROR in rc_dlqr, R+B'PB not positive definite\n");
+		goto end;
+	}
+	if(unlikely(rc_cholesky_solve_matrix(S,N,K))){
+		fprintf(stderr,"ERROR in rc_dlqr, failed to solve for K\n");
+		goto end;
+	}
+	if(P!=NULL) rc_duplicate_matrix(Pl,P);
+	ret = 0;
+
+end:
+	rc_free_matrix(&Pl);
+	rc_free_matrix(&BtP);
+	rc_free_matrix(&S);
+	rc_free_matrix(&N);
+	return ret;
+}
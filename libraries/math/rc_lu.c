@@ -0,0 +1,295 @@
+/*******************************************************************************
+* rc_lu.c
+*
+* Packed LU factorization with partial pivoting that is factored once and then
+* reused. The unit lower triangular L is stored below the diagonal and U on and
+* above it in a single square matrix, and the row swaps are kept as an array
+* of indices in the order they were made, the same convention as LAPACK's
+* getrf. Memory is only allocated when a matrix of a new size is factored so
+* estimators solving against the same system matrix with many right hand sides
+* don't touch the heap after the first call.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+/*******************************************************************************
+* rc_lu_t rc_empty_lu()
+*
+* Returns an rc_lu_t with no allocated memory and the initialized flag set to
+* 0. Use this to initialize local rc_lu_t structs before any other function.
+*******************************************************************************/
+rc_lu_t rc_empty_lu(){
+	rc_lu_t out;
+	// zero-out piecemeal instead of with memset to avoid issues with padding
+	out.n			= 0;
+	out.LU			= rc_empty_matrix();
+	out.piv			= NULL;
+	out.factored	= 0;
+	out.initialized	= 0;
+	return out;
+}
+
+/*******************************************************************************
+* int rc_alloc_lu(rc_lu_t* f, int n)
+*
+* Allocates memory for the factorization of an n-by-n matrix. If f is already
+* the right size nothing is done. This is called automatically by
+* rc_lu_factor, calling it first just moves the allocation out of the loop.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_lu(rc_lu_t* f, int n){
+	if(unlikely(f==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_lu, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(n<1)){
+		fprintf(stderr,"ERROR in rc_alloc_lu, n must be >=1\n");
+		return -1;
+	}
+	if(f->initialized && f->n==n) return 0;
+	rc_free_lu(f);
+	if(unlikely(rc_alloc_matrix(&f->LU,n,n))){
+		fprintf(stderr,"ERROR in rc_alloc_lu, failed to allocate matrix\n");
+		return -1;
+	}
+	f->piv = (int*)malloc(n*sizeof(int));
+	if(unlikely(f->piv==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_lu, failed to allocate memory\n");
+		rc_free_matrix(&f->LU);
+		return -1;
+	}
+	f->n = n;
+	f->factored = 0;
+	f->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_lu(rc_lu_t* f)
+*
+* Frees the memory allocated for the factorization and resets f back to an
+* empty struct. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_lu(rc_lu_t* f){
+	if(unlikely(f==NULL)){
+		fprintf(stderr,"ERROR in rc_free_lu, received NULL pointer\n");
+		return -1;
+	}
+	rc_free_matrix(&f->LU);
+	free(f->piv);
+	*f = rc_empty_lu();
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_lu_factor(rc_matrix_t A, rc_lu_t* f)
+*
+* Factors square matrix A into PA=LU with partial pivoting and stores the
+* result in f. A is left untouched and may be a view. f is allocated on the
+* first call or if the size of A changes, otherwise no memory is allocated.
+* Returns 0 on success or -1 on failure, including when A is singular.
+*******************************************************************************/
+int rc_lu_factor(rc_matrix_t A, rc_lu_t* f){
+	int i,j,k,p,n;
+	real_t max, l;
+	real_t* tmp;
+	real_t* rk;
+	real_t* ri;
+	// sanity checks
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_lu_factor, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(A.rows!=A.cols)){
+		fprintf(stderr,"ERROR in rc_lu_factor, matrix is not square\n");
+		return -1;
+	}
+	n = A.rows;
+	if(unlikely(rc_alloc_lu(f,n))){
+		fprintf(stderr,"ERROR in rc_lu_factor, failed to allocate memory\n");
+		return -1;
+	}
+	f->factored = 0;
+	if(unlikely(rc_duplicate_matrix(A,&f->LU))){
+		fprintf(stderr,"ERROR in rc_lu_factor, failed to copy matrix\n");
+		return -1;
+	}
+	// LU always has unit column stride, even when it is a view of workspace
+	// memory, so a pointer to the start of each row can be indexed directly
+	for(k=0;k<n;k++){
+		// find the largest pivot in column k and swap its row up
+		p = k;
+		max = fabs(AT(f->LU,k,k));
+		for(i=k+1;i<n;i++){
+			if(fabs(AT(f->LU,i,k))>max){
+				max = fabs(AT(f->LU,i,k));
+				p = i;
+			}
+		}
+		f->piv[k] = p;
+		if(unlikely(max<ZERO_TOLERANCE)){
+			fprintf(stderr,"ERROR in rc_lu_factor, matrix is singular\n");
+			return -1;
+		}
+		if(p!=k){
+			tmp = &AT(f->LU,k,0);
+			for(j=0;j<n;j++){
+				l = tmp[j];
+				tmp[j] = AT(f->LU,p,j);
+				AT(f->LU,p,j) = l;
+			}
+		}
+		// eliminate below the pivot, each row update is a contiguous axpy
+		rk = &AT(f->LU,k,0);
+		for(i=k+1;i<n;i++){
+			ri = &AT(f->LU,i,0);
+			l = ri[k]/rk[k];
+			ri[k] = l;
+			for(j=k+1;j<n;j++) ri[j] -= l*rk[j];
+		}
+	}
+	f->factored = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* void lu_substitute(rc_lu_t f, float* x, int stride)
+*
+* only for use in this file. Solves LUx=Pb in place where x holds b on entry.
+* x is read with the given stride so columns of a matrix can be solved without
+* copying them out.
+*******************************************************************************/
+static inline void lu_substitute(rc_lu_t f, real_t* x, const int stride){
+	int i,j;
+	real_t s, tmp;
+	const real_t* ri;
+	const int n = f.n;
+	// apply the row swaps in the order they were made
+	for(i=0;i<n;i++){
+		if(f.piv[i]!=i){
+			tmp = x[i*stride];
+			x[i*stride] = x[f.piv[i]*stride];
+			x[f.piv[i]*stride] = tmp;
+		}
+	}
+	// forward substitution with unit diagonal L
+	for(i=1;i<n;i++){
+		ri = &AT(f.LU,i,0);
+		s = 0.0f;
+		for(j=0;j<i;j++) s += ri[j]*x[j*stride];
+		x[i*stride] -= s;
+	}
+	// back substitution with U
+	for(i=n-1;i>=0;i--){
+		ri = &AT(f.LU,i,0);
+		s = 0.0f;
+		for(j=i+1;j<n;j++) s += ri[j]*x[j*stride];
+		x[i*stride] = (x[i*stride]-s)/ri[i];
+	}
+	return;
+}
+
+/*******************************************************************************
+* int rc_lu_solve(rc_lu_t f, rc_vector_t b, rc_vector_t* x)
+*
+* Solves Ax=b using the factorization of A in f. x is only allocated if it is
+* not already the right length and may be the same vector as b.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_lu_solve(rc_lu_t f, rc_vector_t b, rc_vector_t* x){
+	if(unlikely(!f.factored)){
+		fprintf(stderr,"ERROR in rc_lu_solve, matrix not factored\n");
+		return -1;
+	}
+	if(unlikely(!b.initialized)){
+		fprintf(stderr,"ERROR in rc_lu_solve, vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(b.len!=f.n)){
+		fprintf(stderr,"ERROR in rc_lu_solve, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_vector(x,f.n))){
+		fprintf(stderr,"ERROR in rc_lu_solve, failed to allocate x\n");
+		return -1;
+	}
+	if(x->d!=b.d) memcpy(x->d,b.d,f.n*sizeof(real_t));
+	lu_substitute(f,x->d,1);
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_lu_solve_matrix(rc_lu_t f, rc_matrix_t B, rc_matrix_t* X)
+*
+* Solves AX=B for every column of B at once using the factorization of A in f.
+* X is only allocated if it is not already the right size. Either may be a view
+* and X may be the same matrix as B. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_lu_solve_matrix(rc_lu_t f, rc_matrix_t B, rc_matrix_t* X){
+	int j;
+	if(unlikely(!f.factored)){
+		fprintf(stderr,"ERROR in rc_lu_solve_matrix, matrix not factored\n");
+		return -1;
+	}
+	if(unlikely(!B.initialized)){
+		fprintf(stderr,"ERROR in rc_lu_solve_matrix, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(B.rows!=f.n)){
+		fprintf(stderr,"ERROR in rc_lu_solve_matrix, dimension mismatch\n");
+		return -1;
+	}
+	if(X->data!=B.data || X->row_stride!=B.row_stride || X->col_stride!=B.col_stride){
+		if(unlikely(rc_duplicate_matrix(B,X))){
+			fprintf(stderr,"ERROR in rc_lu_solve_matrix, failed to copy B\n");
+			return -1;
+		}
+	}
+	for(j=0;j<X->cols;j++) lu_substitute(f,&AT(*X,0,j),X->row_stride);
+	return 0;
+}
+
+/*******************************************************************************
+* float rc_lu_determinant(rc_lu_t f)
+*
+* Returns the determinant of the factored matrix, the product of the diagonal
+* of U with the sign flipped for every row swap, or -1.0f on failure.
+*******************************************************************************/
+real_t rc_lu_determinant(rc_lu_t f){
+	int i;
+	real_t det = 1.0f;
+	if(unlikely(!f.factored)){
+		fprintf(stderr,"ERROR in rc_lu_determinant, matrix not factored\n");
+		return -1.0f;
+	}
+	for(i=0;i<f.n;i++){
+		det *= AT(f.LU,i,i);
+		if(f.piv[i]!=i) det = -det;
+	}
+	return det;
+}
+
+/*******************************************************************************
+* int rc_lu_invert(rc_lu_t f, rc_matrix_t* Ainv)
+*
+* Computes the inverse of the factored matrix one column at a time and places
+* it in Ainv, which is only allocated if it is not already the right size and
+* may be a view. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_lu_invert(rc_lu_t f, rc_matrix_t* Ainv){
+	int i,j;
+	if(unlikely(!f.factored)){
+		fprintf(stderr,"ERROR in rc_lu_invert, matrix not factored\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_matrix(Ainv,f.n,f.n))){
+		fprintf(stderr,"ERROR in rc_lu_invert, failed to allocate Ainv\n");
+		return -1;
+	}
+	// solve against each column of the identity matrix
+	for(j=0;j<f.n;j++){
+		for(i=0;i<f.n;i++) AT(*Ainv,i,j) = (i==j) ? 1.0f : 0.0f;
+		lu_substitute(f,&AT(*Ainv,0,j),Ainv->row_stride);
+	}
+	return 0;
+}
@@ -6,6 +6,32 @@
 
 #include "rc_algebra_common.h"
 
+// products with fewer multiply-adds than this are done with simple dot products
+// since packing them for rc_gemm costs more than it saves
+#define GEMM_MIN_MACS (8*8*8)
+// and products up to this size skip the dot products too for a plain loop
+#define SMALL_MACS (4*4*4)
+
+/*******************************************************************************
+* int replace_matrix(rc_matrix_t* A, rc_matrix_t* tmp)
+*
+* only for use in this file. Puts the result of an out-of-place operation held
+* in tmp into A for the inplace functions. Normally A is freed and takes over
+* tmp's memory. If A is a view of the same size the data is copied back through
+* the view instead so the matrix it came from sees the result.
+*******************************************************************************/
+static int replace_matrix(rc_matrix_t* A, rc_matrix_t* tmp){
+	int ret = 0;
+	if(A->d==NULL && A->initialized && A->rows==tmp->rows && A->cols==tmp->cols){
+		ret = rc_duplicate_matrix(*tmp,A);
+		rc_free_matrix(tmp);
+		return ret;
+	}
+	rc_free_matrix(A);
+	*A=*tmp;
+	return 0;
+}
+
 /*******************************************************************************
 * int rc_alloc_matrix(rc_matrix_t* A, int rows, int cols)
 *
@@ -14,7 +40,8 @@
 * is preserved. If A is uninitialized or of the wrong size then any existing
 * memory is freed and new memory is allocated, helping to prevent accidental
 * memory leaks. The contents of the new matrix is not guaranteed to be anything
-* in particular.
+* in particular. A view of the right size is also left as it is, so functions
+* which allocate their output through here will write straight into a view.
 * Returns 0 on success, otherwise -1. Will only be unsuccessful if 
 * rows&cols are invalid or there is insufficient memory available.
 *******************************************************************************/
@@ -34,22 +61,25 @@ int rc_alloc_matrix(rc_matrix_t* A, int rows, int cols){
 	// free any old memory 
 	rc_free_matrix(A);
 	// allocate contiguous memory for the major(row) pointers
-	A->d = (float**)malloc(rows*sizeof(float*));
+	A->d = (real_t**)malloc(rows*sizeof(real_t*));
 	if(unlikely(A->d==NULL)){
 		fprintf(stderr,"ERROR in rc_alloc_matrix, not enough memory\n");
 		return -1;
 	}
 	// allocate contiguous memory for the actual data
-	void* ptr = malloc(rows*cols*sizeof(float));
+	void* ptr = malloc(rows*cols*sizeof(real_t));
 	if(unlikely(ptr==NULL)){
 		fprintf(stderr,"ERROR in rc_alloc_matrix, not enough memory\n");
 		free(A->d);
 		return -1;
 	}
 	// manually fill in the pointer to each row
-	for(i=0;i<rows;i++) A->d[i]=(float*)(ptr+i*cols*sizeof(float));
+	for(i=0;i<rows;i++) A->d[i]=(real_t*)(ptr+i*cols*sizeof(real_t));
+	A->data = (real_t*)ptr;
 	A->rows = rows;
 	A->cols = cols;
+	A->row_stride = cols;
+	A->col_stride = 1;
 	A->initialized = 1;
 	return 0;
 }
@@ -61,6 +91,8 @@ int rc_alloc_matrix(rc_matrix_t* A, int rows, int cols){
 * and initialized flag of the rc_matrix_t struct to 0 to indicate to other
 * functions that A no longer points to allocated memory and cannot be used until
 * more memory is allocated such as with rc_alloc_matrix or rc_matrix_zeros.
+* Views don't own their memory so freeing one just empties the struct and leaves
+* the matrix it was taken from untouched.
 * Returns 0 on success. Will only fail and return -1 if it is passed a NULL
 * pointer.
 *******************************************************************************/
@@ -69,8 +101,9 @@ int rc_free_matrix(rc_matrix_t* A){
 		fprintf(stderr,"ERROR in rc_free_matrix, received NULL pointer\n");
 		return -1;
 	}
-	// free memory allocated for the data then the major array
-	if(A->d!=NULL && A->initialized) free(A->d[0]);
+	// free memory allocated for the data then the major array, views have no
+	// row pointers and nothing to free
+	if(A->d!=NULL && A->initialized) free(A->data);
 	free(A->d);
 	// zero out the struct
 	*A = rc_empty_matrix();
@@ -93,8 +126,11 @@ rc_matrix_t rc_empty_matrix(){
 	// in case the struct changes in the future or if compiled with different
 	// padding on other architectures.
 	out.d = NULL;
+	out.data = NULL;
 	out.rows = 0;
 	out.cols = 0;
+	out.row_stride = 0;
+	out.col_stride = 0;
 	out.initialized = 0;
 	return out;
 }
@@ -104,11 +140,12 @@ rc_matrix_t rc_empty_matrix(){
 *
 * Resizes matrix A and allocates memory for a matrix with specified rows &
 * columns. The new memory is pre-filled with zeros. Any existing memory 
-* allocated for A is freed if necessary to avoid memory leaks.
+* allocated for A is freed if necessary to avoid memory leaks. If A is already
+* the right size, including a view, it is zeroed in place instead.
 * Returns 0 on success or -1 on error.
 *******************************************************************************/
 int rc_matrix_zeros(rc_matrix_t* A, int rows, int cols){
-	int i;
+	int i,j;
 	// sanity checks
 	if(unlikely(rows<1 || cols<1)){
 		fprintf(stderr,"ERROR in rc_create_matrix_zeros, rows and cols must be >=1\n");
@@ -118,25 +155,38 @@ int rc_matrix_zeros(rc_matrix_t* A, int rows, int cols){
 		fprintf(stderr,"ERROR in rc_create_matrix_zeros, received NULL pointer\n");
 		return -1;
 	}
+	// if A is already the right size just zero it
+	if(A->initialized && rows==A->rows && cols==A->cols){
+		if(is_dense(*A)) memset(A->data,0,rows*cols*sizeof(real_t));
+		else{
+			for(i=0;i<rows;i++){
+				for(j=0;j<cols;j++) AT(*A,i,j)=0.0f;
+			}
+		}
+		return 0;
+	}
 	// make sure A is freed before allocating new memory
 	rc_free_matrix(A);
 	// allocate contiguous memory for the major(row) pointers
-	A->d = (float**)malloc(rows*sizeof(float*));
+	A->d = (real_t**)malloc(rows*sizeof(real_t*));
 	if(unlikely(A->d==NULL)){
 		fprintf(stderr,"ERROR in rc_create_matrix_zeros, not enough memory\n");
 		return -1;
 	}
 	// allocate contiguous memory for the actual data
-	void* ptr = calloc(rows*cols,sizeof(float));
+	void* ptr = calloc(rows*cols,sizeof(real_t));
 	if(unlikely(ptr==NULL)){
 		fprintf(stderr,"ERROR in rc_create_matrix_zeros, not enough memory\n");
 		free(A->d);
 		return -1;
 	}
 	// manually fill in the pointer to each row
-	for(i=0;i<rows;i++) A->d[i]=(float*)(ptr+i*cols*sizeof(float));
+	for(i=0;i<rows;i++) A->d[i]=(real_t*)(ptr+i*cols*sizeof(real_t));
+	A->data = (real_t*)ptr;
 	A->rows = rows;
 	A->cols = cols;
+	A->row_stride = cols;
+	A->col_stride = 1;
 	A->initialized = 1;
 	return 0;
 }
@@ -155,7 +205,7 @@ int rc_identity_matrix(rc_matrix_t* A, int dim){
 		return -1;
 	}
 	// fill in diagonal of ones
-	for(i=0;i<dim;i++) A->d[i][i]=1.0f;
+	for(i=0;i<dim;i++) AT(*A,i,i)=1.0f;
 	return 0;
 }
 
@@ -168,12 +218,14 @@ int rc_identity_matrix(rc_matrix_t* A, int dim){
 * memory leaks. Returns 0 on success or -1 on failure.
 *******************************************************************************/
 int rc_random_matrix(rc_matrix_t* A, int rows, int cols){
-	int i;
+	int i,j;
 	if(unlikely(rc_alloc_matrix(A,rows,cols))){
 		fprintf(stderr,"ERROR in rc_random_matrix, failed to allocate matrix\n");
 		return -1;
 	}
-	for(i=0;i<(A->rows*A->cols);i++) A->d[0][i]=rc_get_random_float();
+	for(i=0;i<A->rows;i++){
+		for(j=0;j<A->cols;j++) AT(*A,i,j)=rc_get_random_float();
+	}
 	return 0;
 }
 
@@ -198,7 +250,7 @@ int rc_diag_matrix(rc_matrix_t* A, rc_vector_t v){
 		fprintf(stderr,"ERROR in rc_diag_matrix, failed to allocate matrix\n");
 		return -1;
 	}
-	for(i=0;i<v.len;i++) A->d[i][i]=v.d[i];
+	for(i=0;i<v.len;i++) AT(*A,i,i)=v.d[i];
 	return 0;
 }
 
@@ -208,10 +260,12 @@ int rc_diag_matrix(rc_matrix_t* A, rc_vector_t v){
 * Makes a duplicate of the data from matrix A and places into matrix B. If B is
 * already the right size then its contents are overwritten. If B is unallocated
 * or is of the wrong size then the memory is freed if necessary and new memory
-* is allocated to hold the duplicate of A.
+* is allocated to hold the duplicate of A. Either matrix may be a view, which
+* makes this the way to copy data into or out of part of another matrix.
 * Returns 0 on success or -1 on error.
 *******************************************************************************/
 int rc_duplicate_matrix(rc_matrix_t A, rc_matrix_t* B){
+	int i,j;
 	// sanity check
 	if(unlikely(!A.initialized)){
 		fprintf(stderr,"ERROR in rc_duplicate_matrix not initialized yet\n");
@@ -222,8 +276,20 @@ int rc_duplicate_matrix(rc_matrix_t A, rc_matrix_t* B){
 		fprintf(stderr,"ERROR in rc_duplicate_matrix, failed to allocate memory\n");
 		return -1;
 	}
-	// all matrix data is stored contiguously so one memcpy is sufficient
-	memcpy(B->d[0],A.d[0],A.rows*A.cols*sizeof(float));
+	// dense matrices are stored contiguously so one memcpy is sufficient
+	if(is_dense(A) && is_dense(*B)){
+		memcpy(B->data,A.data,A.rows*A.cols*sizeof(real_t));
+		return 0;
+	}
+	// otherwise copy row by row
+	for(i=0;i<A.rows;i++){
+		if(A.col_stride==1 && B->col_stride==1){
+			memcpy(&AT(*B,i,0),&AT(A,i,0),A.cols*sizeof(real_t));
+		}
+		else{
+			for(j=0;j<A.cols;j++) AT(*B,i,j)=AT(A,i,j);
+		}
+	}
 	return 0;
 }
 
@@ -236,6 +302,8 @@ int rc_duplicate_matrix(rc_matrix_t A, rc_matrix_t* B){
 *
 * A.d[row][col]=val;
 *
+* or RC_MATRIX_ENTRY(A,row,col)=val; if A may be a view.
+*
 * However, we provide this function for completeness. It is not strictly
 * necessary for A to be provided as a pointer since a copy of the struct A
 * would also contain the correct pointer to the original matrix's allocated 
@@ -244,7 +312,7 @@ int rc_duplicate_matrix(rc_matrix_t A, rc_matrix_t* B){
 * modified by the function, and as a normal argument when it is only to be read 
 * by the function. Returns 0 on success or -1 on error.
 *******************************************************************************/
-int rc_set_matrix_entry(rc_matrix_t* A, int row, int col, float val){
+int rc_set_matrix_entry(rc_matrix_t* A, int row, int col, real_t val){
 	if(unlikely(A==NULL)){
 		fprintf(stderr,"ERROR in rc_set_matrix_entry, received null pointer\n");
 		return -1;
@@ -261,7 +329,7 @@ int rc_set_matrix_entry(rc_matrix_t* A, int row, int col, float val){
 		fprintf(stderr,"ERROR in rc_set_matrix_entry, column out of bounds\n");
 		return -1;
 	}
-	A->d[row][col] = val;
+	AT(*A,row,col) = val;
 	return 0;
 }
 
@@ -275,10 +343,12 @@ int rc_set_matrix_entry(rc_matrix_t* A, int row, int col, float val){
 *
 * val = A.d[row][col];
 *
+* or val = RC_MATRIX_ENTRY(A,row,col); if A may be a view.
+*
 * However, we provide this function for completeness. It also provides sanity
 * checks to avoid possible segfaults.
 *******************************************************************************/
-float rc_get_matrix_entry(rc_matrix_t A, int row, int col){
+real_t rc_get_matrix_entry(rc_matrix_t A, int row, int col){
 	if(unlikely(!A.initialized)){
 		fprintf(stderr,"ERROR in rc_get_matrix_entry, ,matrix not initialized yet\n");
 		return -1.0f;
@@ -291,7 +361,7 @@ float rc_get_matrix_entry(rc_matrix_t A, int row, int col){
 		fprintf(stderr,"ERROR in rc_get_matrix_entry, column out of bounds\n");
 		return -1.0f;
 	}
-	return A.d[row][col];
+	return AT(A,row,col);
 }
 
 /*******************************************************************************
@@ -309,7 +379,7 @@ int rc_print_matrix(rc_matrix_t A){
 	}
 	for(i=0;i<A.rows;i++){
 		for(j=0;j<A.cols;j++){
-			printf("%7.4f  ",A.d[i][j]);
+			printf("%7.4f  ",AT(A,i,j));
 		}
 		printf("\n");
 	}
@@ -331,7 +401,7 @@ void rc_print_matrix_sci(rc_matrix_t A){
 	}
 	for(i=0;i<A.rows;i++){
 		for(j=0;j<A.cols;j++){
-			printf("%11.4e  ",A.d[i][j]);
+			printf("%11.4e  ",AT(A,i,j));
 		}	
 		printf("\n");
 	}
@@ -349,14 +419,79 @@ void rc_print_matrix_sci(rc_matrix_t A){
 * modified by the function, and as a normal argument when it is only to be read 
 * by the function. Returns 0 on success or -1 on failure.
 *******************************************************************************/
-int rc_matrix_times_scalar(rc_matrix_t* A, float s){
-	int i;
+int rc_matrix_times_scalar(rc_matrix_t* A, real_t s){
+	int i,j;
 	if(unlikely(!A->initialized)){
 		fprintf(stderr,"ERROR in rc_matrix_times_scalar. matrix uninitialized\n");
 		return -1;
 	}
-	// since A contains contiguous memory, gcc should vectorize this loop
-	for(i=0;i<(A->rows*A->cols);i++) A->d[0][i] *= s;
+	// if A contains contiguous memory, gcc should vectorize this loop
+	if(is_dense(*A)){
+		for(i=0;i<(A->rows*A->cols);i++) A->data[i] *= s;
+		return 0;
+	}
+	for(i=0;i<A->rows;i++){
+		for(j=0;j<A->cols;j++) AT(*A,i,j) *= s;
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int multiply_into(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, float* work)
+*
+* only for use in this file. Computes A*B into C which must already be the
+* right size and not share memory with A or B. work is passed on to rc_gemm for
+* products big enough to use it and may be NULL.
+*******************************************************************************/
+static int multiply_into(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, real_t* work){
+	int i,j,k;
+	real_t sum;
+	real_t* tmp;
+	// anything but small products goes to the cache-blocked kernel
+	if(A.rows*A.cols*B.cols >= GEMM_MIN_MACS){
+		if(unlikely(rc_gemm(A,B,C,work))){
+			fprintf(stderr,"ERROR in rc_multiply_matrices, rc_gemm failed\n");
+			return -1;
+		}
+		return 0;
+	}
+	// tiny products like 3x3 and 4x4 spend more time setting up the column
+	// copy and dot products below than multiplying, so use a plain loop
+	if(A.rows*A.cols*B.cols <= SMALL_MACS){
+		for(i=0;i<A.rows;i++){
+			for(j=0;j<B.cols;j++){
+				sum = 0.0f;
+				for(k=0;k<A.cols;k++) sum += AT(A,i,k)*AT(B,k,j);
+				AT(C,i,j) = sum;
+			}
+		}
+		return 0;
+	}
+	// allocate memory for a column of B from the stack, this is faster than 
+	// malloc and the memory is freed automatically when this function returns
+	// it is faster to put a column in contiguous memory before multiplying
+	tmp = alloca(B.rows*sizeof(real_t));
+	if(unlikely(tmp==NULL)){
+		fprintf(stderr,"ERROR in rc_multiply_matrices, alloca failed, stack overflow\n");
+		return -1;
+	}
+	// go through columns of B calculating columns of C left to right
+	for(i=0;i<(B.cols);i++){
+		// put column of B in sequential memory slot
+		for(j=0;j<B.rows;j++) tmp[j]=AT(B,j,i);
+		// calculate each row in column i, rows of A are contiguous unless it
+		// is a transposed view
+		if(A.col_stride==1){
+			for(j=0;j<(A.rows);j++){
+				AT(C,j,i)=rc_mult_accumulate(&AT(A,j,0),tmp,B.rows);
+			}
+		}
+		else{
+			for(j=0;j<(A.rows);j++){
+				AT(C,j,i)=rc_mult_accumulate_strided(&AT(A,j,0),A.col_stride,tmp,1,B.rows);
+			}
+		}
+	}
 	return 0;
 }
 
@@ -364,11 +499,11 @@ int rc_matrix_times_scalar(rc_matrix_t* A, float s){
 * int rc_multiply_matrices(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C)
 *
 * Multiplies A*B=C. C is resized and its original contents are freed if 
-* necessary to avoid memory leaks. Returns 0 on success or -1 on failure.
+* necessary to avoid memory leaks. Apart from very small products this uses the
+* cache-blocked kernel in rc_gemm.c, so C must not share memory with A or
+* B. Returns 0 on success or -1 on failure.
 *******************************************************************************/
 int rc_multiply_matrices(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C){
-	int i,j;
-	float* tmp;
 	if(unlikely(!A.initialized||!B.initialized)){
 		fprintf(stderr,"ERROR in rc_multiply_matrices, matrix not initialized\n");
 		return -1;
@@ -382,31 +517,15 @@ int rc_multiply_matrices(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C){
 		fprintf(stderr,"ERROR in rc_multiply_matrices, can't allocate memory for C\n");
 		return -1;
 	}
-	// allocate memory for a column of B from the stack, this is faster than 
-	// malloc and the memory is freed automatically when this function returns
-	// it is faster to put a column in contiguous memory before multiplying
-	tmp = alloca(B.rows*sizeof(float));
-	if(unlikely(tmp==NULL)){
-		fprintf(stderr,"ERROR in rc_multiply_matrices, alloca failed, stack overflow\n");
-		return -1;
-	}
-	// go through columns of B calculating columns of C left to right
-	for(i=0;i<(B.cols);i++){
-		// put column of B in sequential memory slot
-		for(j=0;j<B.rows;j++) tmp[j]=B.d[j][i];
-		// calculate each row in column i
-		for(j=0;j<(A.rows);j++){
-			C->d[j][i]=rc_mult_accumulate(A.d[j],tmp,B.rows);
-		}
-	}
-	return 0;
+	return multiply_into(A,B,*C,NULL);
 }
 
 /*******************************************************************************
 * int rc_left_multiply_matrix_inplace(rc_matrix_t A, rc_matrix_t* B)
 *
 * Multiplies A*B and puts the result back in the place of B. B is resized and
-* its original contents are freed if necessary to avoid memory leaks.
+* its original contents are freed if necessary to avoid memory leaks. If B is a
+* view and the result is the same size, it is written back through the view.
 * Returns 0 on success or -1 on failure.
 *******************************************************************************/
 int rc_left_multiply_matrix_inplace(rc_matrix_t A, rc_matrix_t* B){
@@ -417,16 +536,104 @@ int rc_left_multiply_matrix_inplace(rc_matrix_t A, rc_matrix_t* B){
 		rc_free_matrix(&tmp);
 		return -1;
 	}
-	rc_free_matrix(B);
-	*B=tmp;
-	return 0;
+	return replace_matrix(B,&tmp);
+}
+
+/*******************************************************************************
+* int rc_multiply_matrices_ws(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C, rc_workspace_t* w)
+*
+* Same as rc_multiply_matrices but the rc_gemm packing buffer is taken from
+* workspace w, so once C is the right size no heap memory is touched. C must
+* not share memory with A or B. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_multiply_matrices_ws(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C, rc_workspace_t* w){
+	int ret;
+	size_t mark;
+	real_t* work = NULL;
+	if(unlikely(w==NULL || C==NULL)){
+		fprintf(stderr,"ERROR in rc_multiply_matrices_ws, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized||!B.initialized)){
+		fprintf(stderr,"ERROR in rc_multiply_matrices_ws, matrix not initialized\n");
+		return -1;
+	}
+	if(unlikely(A.cols!=B.rows)){
+		fprintf(stderr,"ERROR in rc_multiply_matrices_ws, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_matrix(C,A.rows,B.cols))){
+		fprintf(stderr,"ERROR in rc_multiply_matrices_ws, can't allocate memory for C\n");
+		return -1;
+	}
+	mark = w->used;
+	if(A.rows*A.cols*B.cols >= GEMM_MIN_MACS){
+		work = rc_workspace_push(w, rc_gemm_work_size(A.rows,B.cols,A.cols)*sizeof(real_t));
+		if(unlikely(work==NULL)){
+			fprintf(stderr,"ERROR in rc_multiply_matrices_ws, failed to get workspace\n");
+			return -1;
+		}
+	}
+	ret = multiply_into(A,B,*C,work);
+	rc_workspace_rewind(w,mark);
+	return ret;
+}
+
+/*******************************************************************************
+* int rc_left_multiply_matrix_inplace_ws(rc_matrix_t A, rc_matrix_t* B, rc_workspace_t* w)
+*
+* Same as rc_left_multiply_matrix_inplace but the product and the rc_gemm
+* packing buffer are taken from workspace w and the result is copied back into
+* B. When A is square, B keeps its size and no heap memory is touched. B is
+* only reallocated when the product changes its size.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_left_multiply_matrix_inplace_ws(rc_matrix_t A, rc_matrix_t* B, rc_workspace_t* w){
+	int ret;
+	size_t mark;
+	real_t* work = NULL;
+	rc_matrix_t tmp = rc_empty_matrix();
+	if(unlikely(w==NULL || B==NULL)){
+		fprintf(stderr,"ERROR in rc_left_multiply_matrix_inplace_ws, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized||!B->initialized)){
+		fprintf(stderr,"ERROR in rc_left_multiply_matrix_inplace_ws, matrix not initialized\n");
+		return -1;
+	}
+	if(unlikely(A.cols!=B->rows)){
+		fprintf(stderr,"ERROR in rc_left_multiply_matrix_inplace_ws, dimension mismatch\n");
+		return -1;
+	}
+	mark = w->used;
+	if(unlikely(rc_workspace_matrix(w,&tmp,A.rows,B->cols))){
+		fprintf(stderr,"ERROR in rc_left_multiply_matrix_inplace_ws, failed to get workspace\n");
+		rc_workspace_rewind(w,mark);
+		return -1;
+	}
+	if(A.rows*A.cols*B->cols >= GEMM_MIN_MACS){
+		work = rc_workspace_push(w, rc_gemm_work_size(A.rows,B->cols,A.cols)*sizeof(real_t));
+		if(unlikely(work==NULL)){
+			fprintf(stderr,"ERROR in rc_left_multiply_matrix_inplace_ws, failed to get workspace\n");
+			rc_workspace_rewind(w,mark);
+			return -1;
+		}
+	}
+	ret = multiply_into(A,*B,tmp,work);
+	if(likely(ret==0)) ret = rc_duplicate_matrix(tmp,B);
+	if(unlikely(ret)){
+		fprintf(stderr,"ERROR in rc_left_multiply_matrix_inplace_ws, failed to multiply\n");
+	}
+	rc_workspace_rewind(w,mark);
+	return ret;
 }
 
 /*******************************************************************************
 * int rc_right_multiply_matrix_inplace(rc_matrix_t* A, rc_matrix_t B)
 *
 * Multiplies A*B and puts the result back in the place of A. A is resized and
-* its original contents are freed if necessary to avoid memory leaks.
+* its original contents are freed if necessary to avoid memory leaks. If A is a
+* view and the result is the same size, it is written back through the view.
 * Returns 0 on success or -1 on failure.
 *******************************************************************************/
 int rc_right_multiply_matrix_inplace(rc_matrix_t* A, rc_matrix_t B){
@@ -436,9 +643,7 @@ int rc_right_multiply_matrix_inplace(rc_matrix_t* A, rc_matrix_t B){
 		rc_free_matrix(&tmp);
 		return -1;
 	}
-	rc_free_matrix(A);
-	*A=tmp;
-	return 0;
+	return replace_matrix(A,&tmp);
 }
 
 /*******************************************************************************
@@ -449,7 +654,7 @@ int rc_right_multiply_matrix_inplace(rc_matrix_t* A, rc_matrix_t B){
 * Returns 0 on success or -1 on failure. 
 *******************************************************************************/
 int rc_add_matrices(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C){
-	int i;
+	int i,j;
 	if(unlikely(!A.initialized||!B.initialized)){
 		fprintf(stderr,"ERROR in rc_add_matrices, matrix not initialized\n");
 		return -1;
@@ -463,8 +668,14 @@ int rc_add_matrices(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C){
 		fprintf(stderr,"ERROR in rc_add_matrices, can't allocate memory for C\n");
 		return -1;
 	}
-	// since A contains contiguous memory, gcc should vectorize this loop
-	for(i=0;i<(A.rows*A.cols);i++) C->d[0][i]=A.d[0][i]+B.d[0][i];
+	// if all contain contiguous memory, gcc should vectorize this loop
+	if(is_dense(A) && is_dense(B) && is_dense(*C)){
+		for(i=0;i<(A.rows*A.cols);i++) C->data[i]=A.data[i]+B.data[i];
+		return 0;
+	}
+	for(i=0;i<A.rows;i++){
+		for(j=0;j<A.cols;j++) AT(*C,i,j)=AT(A,i,j)+AT(B,i,j);
+	}
 	return 0;
 }
 
@@ -476,7 +687,7 @@ int rc_add_matrices(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C){
 * A and B. Returns 0 on success or -1 on failure.
 *******************************************************************************/
 int rc_add_matrices_inplace(rc_matrix_t* A, rc_matrix_t B){
-	int i;
+	int i,j;
 	if(unlikely(!A->initialized||!B.initialized)){
 		fprintf(stderr,"ERROR in rc_add_matrices_inplace, matrix not initialized\n");
 		return -1;
@@ -485,8 +696,14 @@ int rc_add_matrices_inplace(rc_matrix_t* A, rc_matrix_t B){
 		fprintf(stderr,"ERROR in rc_add_matrices_inplace, dimension mismatch\n");
 		return -1;
 	}
-	// since A contains contiguous memory, gcc should vectorize this loop
-	for(i=0;i<(A->rows*A->cols);i++) A->d[0][i]+=B.d[0][i];
+	// if both contain contiguous memory, gcc should vectorize this loop
+	if(is_dense(*A) && is_dense(B)){
+		for(i=0;i<(A->rows*A->cols);i++) A->data[i]+=B.data[i];
+		return 0;
+	}
+	for(i=0;i<A->rows;i++){
+		for(j=0;j<A->cols;j++) AT(*A,i,j)+=AT(B,i,j);
+	}
 	return 0;
 }
 
@@ -503,14 +720,14 @@ int rc_matrix_transpose(rc_matrix_t A, rc_matrix_t* T){
 		return -1;
 	}
 	// make sure T is allocated
-	if(unlikely(rc_alloc_matrix(T,A.rows,A.cols))){
+	if(unlikely(rc_alloc_matrix(T,A.cols,A.rows))){
 		fprintf(stderr,"ERROR in rc_matrix_transpose, can't allocate memory for T\n");
 		return -1;
 	}
 	// fill in new memory
 	for(i=0;i<(A.rows);i++){
 		for(j=0;j<(A.cols);j++){
-			T->d[i][j] = A.d[j][i];
+			AT(*T,j,i) = AT(A,i,j);
 		}
 	}
 	return 0;
@@ -520,10 +737,14 @@ int rc_matrix_transpose(rc_matrix_t A, rc_matrix_t* T){
 * int rc_matrix_transpose_inplace(rc_matrix_t* A)
 *
 * Transposes matrix A in place. Use as an alternative to rc_matrix_transpose
-* if you no longer have need for the original contents of matrix A.
+* if you no longer have need for the original contents of matrix A. Square
+* matrices are transposed by swapping entries without allocating. Views must be
+* square since their shape is fixed by the matrix they were taken from.
 * Returns 0 on success or -1 on failure.
 *******************************************************************************/
 int rc_matrix_transpose_inplace(rc_matrix_t* A){
+	int i,j;
+	real_t tmpf;
 	if(unlikely(A==NULL)){
 		fprintf(stderr,"ERROR in rc_transpose_matrix_inplace, received NULL pointer\n");
 		return -1;
@@ -534,6 +755,21 @@ int rc_matrix_transpose_inplace(rc_matrix_t* A){
 	}
 	// shortcut for 1x1 matrix
 	if(A->rows==1 && A->cols==1) return 0;
+	// square matrices are done by swapping across the diagonal
+	if(A->rows==A->cols){
+		for(i=0;i<A->rows;i++){
+			for(j=i+1;j<A->cols;j++){
+				tmpf = AT(*A,i,j);
+				AT(*A,i,j) = AT(*A,j,i);
+				AT(*A,j,i) = tmpf;
+			}
+		}
+		return 0;
+	}
+	if(unlikely(A->d==NULL)){
+		fprintf(stderr,"ERROR in rc_transpose_matrix_inplace, can't resize a non-square view\n");
+		return -1;
+	}
 	// allocate memory for new A, easier than doing it in place since A will 
 	// change size if non-square
 	rc_matrix_t tmp = rc_empty_matrix();
@@ -547,3 +783,98 @@ int rc_matrix_transpose_inplace(rc_matrix_t* A){
 	*A=tmp;
 	return 0;
 }
+
+/*******************************************************************************
+* int rc_matrix_view(rc_matrix_t* V, float* data, int rows, int cols, int row_stride)
+*
+* Makes V a rows-by-cols matrix over memory the caller already has, such as a
+* static array, without allocating or copying anything. Entry (i,j) lives at
+* data[i*row_stride+j] so row_stride must be at least cols. Views have no row
+* pointers (V->d is NULL), use RC_MATRIX_ENTRY to index them. Any memory owned
+* by V is not freed, so only pass an empty matrix or another view.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_matrix_view(rc_matrix_t* V, real_t* data, int rows, int cols, int row_stride){
+	if(unlikely(V==NULL || data==NULL)){
+		fprintf(stderr,"ERROR in rc_matrix_view, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(rows<1 || cols<1)){
+		fprintf(stderr,"ERROR in rc_matrix_view, rows and cols must be >=1\n");
+		return -1;
+	}
+	if(unlikely(row_stride<cols)){
+		fprintf(stderr,"ERROR in rc_matrix_view, row_stride must be >=cols\n");
+		return -1;
+	}
+	V->d = NULL;
+	V->data = data;
+	V->rows = rows;
+	V->cols = cols;
+	V->row_stride = row_stride;
+	V->col_stride = 1;
+	V->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_matrix_slice(rc_matrix_t A, int row, int col, int rows, int cols, rc_matrix_t* S)
+*
+* Makes S a view of the rows-by-cols block of A whose top left entry is
+* A(row,col). S shares A's memory so writing to S writes to A, and S must not
+* be used after A is freed. A may itself be a view, including a transposed one.
+* Any memory owned by S is not freed, so only pass an empty matrix or another
+* view. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_matrix_slice(rc_matrix_t A, int row, int col, int rows, int cols, rc_matrix_t* S){
+	if(unlikely(S==NULL)){
+		fprintf(stderr,"ERROR in rc_matrix_slice, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_matrix_slice, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(rows<1 || cols<1 || row<0 || col<0 || \
+				row+rows>A.rows || col+cols>A.cols)){
+		fprintf(stderr,"ERROR in rc_matrix_slice, block out of bounds\n");
+		return -1;
+	}
+	S->d = NULL;
+	S->data = &AT(A,row,col);
+	S->rows = rows;
+	S->cols = cols;
+	S->row_stride = A.row_stride;
+	S->col_stride = A.col_stride;
+	S->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_matrix_transpose_view(rc_matrix_t A, rc_matrix_t* T)
+*
+* Makes T a view of the transpose of A by swapping the dimensions and strides,
+* no data is moved. Rows of a transposed view are not contiguous so it is best
+* used as the right hand argument of rc_multiply_matrices or copied with
+* rc_duplicate_matrix when it will be read many times. Any memory owned by T is
+* not freed, so only pass an empty matrix or another view.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_matrix_transpose_view(rc_matrix_t A, rc_matrix_t* T){
+	if(unlikely(T==NULL)){
+		fprintf(stderr,"ERROR in rc_matrix_transpose_view, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_matrix_transpose_view, matrix uninitialized\n");
+		return -1;
+	}
+	T->d = NULL;
+	T->data = A.data;
+	T->rows = A.cols;
+	T->cols = A.rows;
+	T->row_stride = A.col_stride;
+	T->col_stride = A.row_stride;
+	T->initialized = 1;
+	return 0;
+}
@@ -1,3 +1,5 @@
+#include "rc_algebra_common.h"
+
 
 /*******************************************************************************
 * float rc_mult_accumulate(float * __restrict__ a, float * __restrict__ b, int n)
@@ -8,11 +10,58 @@
 * the C compiler that the pointers are not aliased which helps the vectorization
 * process for optimization with the NEON FPU.
 *******************************************************************************/
-float rc_mult_accumulate(float * __restrict__ a, float * __restrict__ b, int n){
+real_t rc_mult_accumulate(real_t * __restrict__ a, real_t * __restrict__ b, int n){
 	int i;
-	float sum = 0.0f;
+	real_t sum = 0.0f;
 	for(i=0;i<n;i++){
 		sum+=a[i]*b[i];
 	}
 	return sum;
-}
\ No newline at end of file
+}
+
+/*******************************************************************************
+* float rc_mult_accumulate_strided(float* a, int a_stride, float* b, int b_stride, int n)
+*
+* Same as rc_mult_accumulate but steps through a and b with the given strides
+* so columns and transposed views can be used without copying them first.
+*******************************************************************************/
+real_t rc_mult_accumulate_strided(real_t * __restrict__ a, int a_stride, \
+				real_t * __restrict__ b, int b_stride, int n){
+	int i;
+	real_t sum = 0.0f;
+	for(i=0;i<n;i++){
+		sum+=a[i*a_stride]*b[i*b_stride];
+	}
+	return sum;
+}
+
+/*******************************************************************************
+* float rc_sum_squares_strided(float* a, int stride, int n)
+*
+* Sum of the squares of n values of a read with the given stride. This is
+* rc_mult_accumulate_strided of a with itself, which can't be written as that
+* call since the same pointer would be passed as both restrict arguments.
+*******************************************************************************/
+real_t rc_sum_squares_strided(real_t* a, int stride, int n){
+	int i;
+	real_t sum = 0.0f;
+	for(i=0;i<n;i++){
+		sum+=a[i*stride]*a[i*stride];
+	}
+	return sum;
+}
+
+/*******************************************************************************
+* void rc_scale_accumulate(float a, float * __restrict__ x, float * __restrict__ y, int n)
+*
+* Adds a times x to y over n values, the inner loop of axpy, gemv with a
+* transposed matrix and rank-1 updates. Same caveats as rc_mult_accumulate, x
+* and y must not overlap so the loop can be vectorized.
+*******************************************************************************/
+void rc_scale_accumulate(real_t a, real_t * __restrict__ x, real_t * __restrict__ y, int n){
+	int i;
+	for(i=0;i<n;i++){
+		y[i]+=a*x[i];
+	}
+	return;
+}
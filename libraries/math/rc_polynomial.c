@@ -334,7 +334,7 @@ int rc_poly_divide(rc_vector_t n, rc_vector_t d, rc_vector_t* div, rc_vector_t*
 * of order N and cutoff wc (rad/s) and places them in vector b.
 * Returns 0 on success or -1 on failure.
 *******************************************************************************/
-int rc_poly_butter(int N, float wc, rc_vector_t* b){
+int rc_poly_butter(int N, real_t wc, rc_vector_t* b){
 	int i;
 	int ret=0;
 	rc_vector_t P2	= rc_empty_vector();
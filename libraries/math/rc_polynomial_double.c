@@ -0,0 +1,9 @@
+/*******************************************************************************
+* rc_polynomial_double.c
+*
+* Double precision build of rc_polynomial.c. The source is compiled a second time
+* with real_t set to double and every name given the _d suffix, see rc_real.h.
+*******************************************************************************/
+
+#define RC_DOUBLE
+#include "rc_polynomial.c"
@@ -0,0 +1,94 @@
+/*******************************************************************************
+* rc_precision.c
+*
+* Conversions between the float and double vector and matrix types. These
+* can't live in the shared sources since they need both sets of names at once.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+/*******************************************************************************
+* int rc_vector_float_to_double(rc_vector_t v, rc_vector_d_t* out)
+*
+* Copies v into out converting each entry to double. out is only allocated if
+* it is not already the right length. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_vector_float_to_double(rc_vector_t v, rc_vector_d_t* out){
+	int i;
+	if(unlikely(!v.initialized)){
+		fprintf(stderr,"ERROR in rc_vector_float_to_double, vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_vector_d(out,v.len))){
+		fprintf(stderr,"ERROR in rc_vector_float_to_double, failed to allocate vector\n");
+		return -1;
+	}
+	for(i=0;i<v.len;i++) out->d[i] = v.d[i];
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_vector_double_to_float(rc_vector_d_t v, rc_vector_t* out)
+*
+* Copies v into out rounding each entry to float. out is only allocated if it
+* is not already the right length. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_vector_double_to_float(rc_vector_d_t v, rc_vector_t* out){
+	int i;
+	if(unlikely(!v.initialized)){
+		fprintf(stderr,"ERROR in rc_vector_double_to_float, vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_vector(out,v.len))){
+		fprintf(stderr,"ERROR in rc_vector_double_to_float, failed to allocate vector\n");
+		return -1;
+	}
+	for(i=0;i<v.len;i++) out->d[i] = v.d[i];
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_matrix_float_to_double(rc_matrix_t A, rc_matrix_d_t* out)
+*
+* Copies A into out converting each entry to double. A may be a view. out is
+* only allocated if it is not already the right size and may be a view.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_matrix_float_to_double(rc_matrix_t A, rc_matrix_d_t* out){
+	int i,j;
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_matrix_float_to_double, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_matrix_d(out,A.rows,A.cols))){
+		fprintf(stderr,"ERROR in rc_matrix_float_to_double, failed to allocate matrix\n");
+		return -1;
+	}
+	for(i=0;i<A.rows;i++){
+		for(j=0;j<A.cols;j++) AT(*out,i,j) = AT(A,i,j);
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_matrix_double_to_float(rc_matrix_d_t A, rc_matrix_t* out)
+*
+* Copies A into out rounding each entry to float. A may be a view. out is only
+* allocated if it is not already the right size and may be a view.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_matrix_double_to_float(rc_matrix_d_t A, rc_matrix_t* out){
+	int i,j;
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_matrix_double_to_float, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_matrix(out,A.rows,A.cols))){
+		fprintf(stderr,"ERROR in rc_matrix_double_to_float, failed to allocate matrix\n");
+		return -1;
+	}
+	for(i=0;i<A.rows;i++){
+		for(j=0;j<A.cols;j++) AT(*out,i,j) = AT(A,i,j);
+	}
+	return 0;
+}
@@ -0,0 +1,275 @@
+/*******************************************************************************
+* rc_psd.c
+*
+* Streaming power spectral density estimate by Welch's method for looking at
+* motor and propeller vibration on the IMU while the robot runs. The control
+* loop only copies each sample into a lock-free rc_spsc_ringbuf_t. A background
+* thread drains it into a history of the last n samples per channel and, every
+* hop samples, removes the mean of each channel's segment, applies a Hann
+* window, transforms it with rc_fft_real and adds the squared magnitudes to a
+* running sum. The result is the same one-sided density scipy.signal.welch
+* gives with its default window and detrending, so it can be compared directly
+* against data analysed elsewhere.
+*
+* Nothing is allocated after rc_alloc_psd. rc_psd_push is the only function for
+* the producer thread, everything else belongs to the consumer thread.
+*******************************************************************************/
+
+#include "../roboticscape.h"
+#include "../preprocessor_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // for memset and memmove
+#include <math.h>
+
+// segment, window and history arrays are aligned to one SIMD register
+#define PSD_ALIGN	16
+
+/*******************************************************************************
+* rc_psd_t rc_empty_psd()
+*
+* Returns an rc_psd_t with no allocated memory and the initialized flag set to
+* 0. Use this to initialize estimators before calling rc_alloc_psd.
+*******************************************************************************/
+rc_psd_t rc_empty_psd(){
+	rc_psd_t out;
+	// zero-out piecemeal instead of with memset to avoid issues with padding
+	out.plan		= rc_empty_fft_plan();
+	out.ring		= rc_empty_spsc_ringbuf();
+	out.n			= 0;
+	out.hop			= 0;
+	out.channels	= 0;
+	out.fs			= 0.0f;
+	out.scale		= 0.0f;
+	out.seg			= NULL;
+	out.window		= NULL;
+	out.hist		= NULL;
+	out.acc			= NULL;
+	out.fill		= 0;
+	out.segments	= 0;
+	out.dropped		= 0;
+	out.initialized	= 0;
+	return out;
+}
+
+/*******************************************************************************
+* int rc_alloc_psd(rc_psd_t* p, int channels, int n, int overlap, float fs, int capacity)
+*
+* Sets up an estimator for 'channels' signals sampled at fs hz, averaging
+* segments of n samples which overlap by 'overlap' samples. n must be a power
+* of two and 0<=overlap<n, n/2 being the usual choice. 'capacity' is how many
+* samples the ring buffer between the two threads holds, it only needs to
+* cover the longest time the background thread may go without calling
+* rc_psd_process. Any existing memory allocated for p is freed first. Must be
+* called before either thread starts using p.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_psd(rc_psd_t* p, int channels, int n, int overlap, float fs, int capacity){
+	int i, bins;
+	double sum;
+	if(unlikely(p==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_psd, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(channels<1 || channels>n)){
+		fprintf(stderr,"ERROR in rc_alloc_psd, channels must be between 1 and n\n");
+		return -1;
+	}
+	if(unlikely(overlap<0 || overlap>=n)){
+		fprintf(stderr,"ERROR in rc_alloc_psd, overlap must be >=0 and <n\n");
+		return -1;
+	}
+	if(unlikely(fs<=0.0f)){
+		fprintf(stderr,"ERROR in rc_alloc_psd, fs must be >0\n");
+		return -1;
+	}
+	rc_free_psd(p);
+	if(unlikely(rc_alloc_fft_plan(&p->plan, n))){
+		fprintf(stderr,"ERROR in rc_alloc_psd, failed to make fft plan\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_spsc_ringbuf(&p->ring, capacity, channels*sizeof(float)))){
+		fprintf(stderr,"ERROR in rc_alloc_psd, failed to allocate ring buffer\n");
+		rc_free_psd(p);
+		return -1;
+	}
+	// one block holds the segment, window and history of every channel, then
+	// the double precision sums which sit on an aligned boundary since n>=4
+	bins = n/2+1;
+	if(unlikely(posix_memalign((void**)&p->seg, PSD_ALIGN, \
+			(2+channels)*n*sizeof(float) + channels*bins*sizeof(double)))){
+		fprintf(stderr,"ERROR in rc_alloc_psd, failed to allocate memory\n");
+		p->seg = NULL;
+		rc_free_psd(p);
+		return -1;
+	}
+	p->window = p->seg+n;
+	p->hist = p->window+n;
+	p->acc = (double*)(p->hist+channels*n);
+	memset(p->acc, 0, channels*bins*sizeof(double));
+	// periodic hann window, and 1/(fs*sum(w^2)) to turn |X|^2 into a density
+	sum = 0.0;
+	for(i=0;i<n;i++){
+		p->window[i] = 0.5-0.5*cos(2.0*M_PI*i/n);
+		sum += p->window[i]*p->window[i];
+	}
+	p->scale = 1.0/(fs*sum);
+	p->n = n;
+	p->hop = n-overlap;
+	p->channels = channels;
+	p->fs = fs;
+	p->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_psd(rc_psd_t* p)
+*
+* Frees the memory allocated for an estimator and sets its initialized flag to
+* 0. Both threads must be finished with it first.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_psd(rc_psd_t* p){
+	if(unlikely(p==NULL)){
+		fprintf(stderr,"ERROR in rc_free_psd, received NULL pointer\n");
+		return -1;
+	}
+	rc_free_fft_plan(&p->plan);
+	rc_free_spsc_ringbuf(&p->ring);
+	free(p->seg);
+	*p = rc_empty_psd();
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_psd_push(rc_psd_t* p, const float* sample)
+*
+* Producer side. Copies one sample, holding one value per channel, into the
+* ring buffer. This is all the work done on the calling thread so it is cheap
+* enough for the control loop. If the ring buffer is full the sample is
+* dropped and counted in p->dropped rather than waiting. Nothing is printed in
+* that case. Returns 0 on success or -1 if the sample was dropped.
+*******************************************************************************/
+int rc_psd_push(rc_psd_t* p, const float* sample){
+	if(unlikely(rc_spsc_ringbuf_push(&p->ring, sample))){
+		__atomic_fetch_add(&p->dropped, 1, __ATOMIC_RELAXED);
+		return -1;
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* void add_segment(rc_psd_t* p, const float* x, double* acc)
+*
+* only for use in this file. Detrends, windows and transforms the n samples of
+* one channel in x and adds the squared magnitude of each bin to acc.
+*******************************************************************************/
+static void add_segment(rc_psd_t* p, const float* x, double* acc){
+	int i, k;
+	const int n = p->n;
+	float* __restrict__ s = p->seg;
+	const float* __restrict__ w = p->window;
+	float mean = 0.0f;
+	for(i=0;i<n;i++) mean += x[i];
+	mean /= n;
+	for(i=0;i<n;i++) s[i] = (x[i]-mean)*w[i];
+	rc_fft_real(&p->plan, s);
+	acc[0] += s[0]*s[0];
+	acc[n/2] += s[1]*s[1];
+	for(k=1;k<n/2;k++) acc[k] += s[2*k]*s[2*k] + s[2*k+1]*s[2*k+1];
+	return;
+}
+
+/*******************************************************************************
+* int rc_psd_process(rc_psd_t* p)
+*
+* Consumer side. Takes every sample waiting in the ring buffer and adds each
+* segment that completes to the average. Call this periodically from a
+* background thread. Returns the number of new segments averaged, which may
+* be 0, or -1 on failure.
+*******************************************************************************/
+int rc_psd_process(rc_psd_t* p){
+	int i, c, n, ch, got, want, added = 0;
+	if(unlikely(p==NULL || !p->initialized)){
+		fprintf(stderr,"ERROR in rc_psd_process, estimator not initialized\n");
+		return -1;
+	}
+	n = p->n;
+	ch = p->channels;
+	while(1){
+		// pop straight into the segment buffer which is free between
+		// transforms, then spread the samples out into each channel's history
+		want = n-p->fill;
+		if(want>n/ch) want = n/ch;
+		got = rc_spsc_ringbuf_pop_batch(&p->ring, p->seg, want);
+		if(got<=0) break;
+		for(i=0;i<got;i++){
+			for(c=0;c<ch;c++) p->hist[c*n+p->fill+i] = p->seg[i*ch+c];
+		}
+		p->fill += got;
+		if(p->fill<n) continue;
+		for(c=0;c<ch;c++){
+			add_segment(p, p->hist+c*n, p->acc+c*(n/2+1));
+			memmove(p->hist+c*n, p->hist+c*n+p->hop, (n-p->hop)*sizeof(float));
+		}
+		p->fill = n-p->hop;
+		p->segments++;
+		added++;
+	}
+	return added;
+}
+
+/*******************************************************************************
+* int rc_psd_get(rc_psd_t* p, int channel, float* out)
+*
+* Consumer side. Writes the averaged one-sided power spectral density of one
+* channel to out, which must have room for n/2+1 values. Bin k is at k*fs/n hz
+* and is in units of the input squared per hz. Returns the number of segments
+* averaged, 0 if none have completed yet in which case out is all zero, or -1
+* on failure.
+*******************************************************************************/
+int rc_psd_get(rc_psd_t* p, int channel, float* out){
+	int k, bins;
+	double s;
+	if(unlikely(p==NULL || out==NULL)){
+		fprintf(stderr,"ERROR in rc_psd_get, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!p->initialized)){
+		fprintf(stderr,"ERROR in rc_psd_get, estimator not initialized\n");
+		return -1;
+	}
+	if(unlikely(channel<0 || channel>=p->channels)){
+		fprintf(stderr,"ERROR in rc_psd_get, channel out of bounds\n");
+		return -1;
+	}
+	bins = p->n/2+1;
+	if(p->segments==0){
+		for(k=0;k<bins;k++) out[k] = 0.0f;
+		return 0;
+	}
+	// every bin but DC and nyquist also holds the power of its negative twin
+	s = p->scale/p->segments;
+	for(k=0;k<bins;k++){
+		out[k] = ((k==0 || k==bins-1) ? s : 2.0*s)*p->acc[channel*bins+k];
+	}
+	return p->segments;
+}
+
+/*******************************************************************************
+* int rc_psd_reset(rc_psd_t* p)
+*
+* Consumer side. Clears the average so a new one can be started, for example
+* after changing the motor speed. The sample history is kept so the next
+* segment still completes after hop samples.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_psd_reset(rc_psd_t* p){
+	if(unlikely(p==NULL || !p->initialized)){
+		fprintf(stderr,"ERROR in rc_psd_reset, estimator not initialized\n");
+		return -1;
+	}
+	memset(p->acc, 0, p->channels*(p->n/2+1)*sizeof(double));
+	p->segments = 0;
+	return 0;
+}
@@ -0,0 +1,292 @@
+/*******************************************************************************
+* rc_qr.c
+*
+* Compact Householder QR factorization. Each Householder reflection
+* H=I-tau*v*v' is kept as its vector v, stored below the diagonal in the
+* columns it zeroed, with the leading 1 of v implied and tau kept in a separate
+* array. R sits on and above the diagonal, the same layout as LAPACK's geqrf.
+* Reflections are applied to the rest of the matrix one rank-1 update at a time
+* instead of building and multiplying full Householder matrices, so factoring
+* an m x n matrix takes O(mn^2) work and no memory beyond the factorization
+* itself. Q is only formed when asked for. Least squares solves apply the
+* reflections straight to the right hand side.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+/*******************************************************************************
+* rc_qr_t rc_empty_qr()
+*
+* Returns an rc_qr_t with no allocated memory and the initialized flag set to
+* 0. Use this to initialize local rc_qr_t structs before any other function.
+*******************************************************************************/
+rc_qr_t rc_empty_qr(){
+	rc_qr_t out;
+	// zero-out piecemeal instead of with memset to avoid issues with padding
+	out.rows		= 0;
+	out.cols		= 0;
+	out.QR			= rc_empty_matrix();
+	out.tau			= NULL;
+	out.factored	= 0;
+	out.initialized	= 0;
+	return out;
+}
+
+/*******************************************************************************
+* int rc_alloc_qr(rc_qr_t* f, int rows, int cols)
+*
+* Allocates memory for the factorization of a rows-by-cols matrix. If f is
+* already the right size nothing is done. This is called automatically by
+* rc_qr_factor, calling it first just moves the allocation out of the loop.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_qr(rc_qr_t* f, int rows, int cols){
+	if(unlikely(f==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_qr, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(rows<1 || cols<1)){
+		fprintf(stderr,"ERROR in rc_alloc_qr, rows and cols must be >=1\n");
+		return -1;
+	}
+	if(f->initialized && f->rows==rows && f->cols==cols) return 0;
+	rc_free_qr(f);
+	if(unlikely(rc_alloc_matrix(&f->QR,rows,cols))){
+		fprintf(stderr,"ERROR in rc_alloc_qr, failed to allocate matrix\n");
+		return -1;
+	}
+	f->tau = (real_t*)malloc((rows<cols ? rows : cols)*sizeof(real_t));
+	if(unlikely(f->tau==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_qr, failed to allocate memory\n");
+		rc_free_matrix(&f->QR);
+		return -1;
+	}
+	f->rows = rows;
+	f->cols = cols;
+	f->factored = 0;
+	f->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_qr(rc_qr_t* f)
+*
+* Frees the memory allocated for the factorization and resets f back to an
+* empty struct. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_qr(rc_qr_t* f){
+	if(unlikely(f==NULL)){
+		fprintf(stderr,"ERROR in rc_free_qr, received NULL pointer\n");
+		return -1;
+	}
+	rc_free_matrix(&f->QR);
+	free(f->tau);
+	*f = rc_empty_qr();
+	return 0;
+}
+
+/*******************************************************************************
+* void reflect_rows(rc_matrix_t V, int k, float tau, rc_matrix_t X, int col0, float* w)
+*
+* only for use in this file. Applies reflection H=I-tau*v*v' to rows k and
+* below of X, only touching columns col0 and up. v is read from column k of V
+* below the diagonal with an implied 1 in row k. The rows of X are streamed
+* through twice: once to sum w=v'X and once to subtract tau*v*w, so every
+* access is along a row. w must have room for X.cols-col0 floats.
+*******************************************************************************/
+static void reflect_rows(rc_matrix_t V, int k, real_t tau, rc_matrix_t X, int col0, real_t* w){
+	int i,j;
+	real_t vi;
+	const int n = X.cols-col0;
+	if(tau==0.0f || n<=0) return;
+	for(j=0;j<n;j++) w[j] = AT(X,k,col0+j);
+	for(i=k+1;i<X.rows;i++){
+		vi = AT(V,i,k);
+		for(j=0;j<n;j++) w[j] += vi*AT(X,i,col0+j);
+	}
+	for(j=0;j<n;j++){
+		w[j] *= tau;
+		AT(X,k,col0+j) -= w[j];
+	}
+	for(i=k+1;i<X.rows;i++){
+		vi = AT(V,i,k);
+		for(j=0;j<n;j++) AT(X,i,col0+j) -= vi*w[j];
+	}
+	return;
+}
+
+/*******************************************************************************
+* int rc_qr_factor(rc_matrix_t A, rc_qr_t* f)
+*
+* Factors A into QR with Householder reflections and stores the compact result
+* in f. A may be any shape and may be a view, it is left untouched. f is
+* allocated on the first call or if the size of A changes, otherwise no memory
+* is allocated. To factor without copying, allocate f with rc_alloc_qr, fill
+* in f->QR and pass f->QR as A. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_qr_factor(rc_matrix_t A, rc_qr_t* f){
+	int i,k,m,n,steps;
+	real_t alpha, beta, xnorm, scale;
+	real_t* w;
+	if(unlikely(!A.initialized)){
+		fprintf(stderr,"ERROR in rc_qr_factor, matrix uninitialized\n");
+		return -1;
+	}
+	m = A.rows;
+	n = A.cols;
+	if(unlikely(rc_alloc_qr(f,m,n))){
+		fprintf(stderr,"ERROR in rc_qr_factor, failed to allocate memory\n");
+		return -1;
+	}
+	f->factored = 0;
+	// A may already be f->QR, filled in by the caller to avoid the copy
+	if(A.data!=f->QR.data && unlikely(rc_duplicate_matrix(A,&f->QR))){
+		fprintf(stderr,"ERROR in rc_qr_factor, failed to copy matrix\n");
+		return -1;
+	}
+	w = alloca(n*sizeof(real_t));
+	if(unlikely(w==NULL)){
+		fprintf(stderr,"ERROR in rc_qr_factor, alloca failed, stack overflow\n");
+		return -1;
+	}
+	steps = m<n ? m : n;
+	for(k=0;k<steps;k++){
+		// norm of the column below the diagonal
+		xnorm = 0.0f;
+		for(i=k+1;i<m;i++) xnorm += AT(f->QR,i,k)*AT(f->QR,i,k);
+		xnorm = sqrt(xnorm);
+		// nothing to zero, H is the identity
+		if(xnorm==0.0f){
+			f->tau[k] = 0.0f;
+			continue;
+		}
+		// reflect onto the opposite sign of the pivot to avoid cancellation
+		alpha = AT(f->QR,k,k);
+		beta = sqrt(alpha*alpha+xnorm*xnorm);
+		if(alpha>=0.0f) beta = -beta;
+		f->tau[k] = (beta-alpha)/beta;
+		scale = 1.0f/(alpha-beta);
+		for(i=k+1;i<m;i++) AT(f->QR,i,k) *= scale;
+		AT(f->QR,k,k) = beta;
+		// apply to the columns to the right
+		reflect_rows(f->QR,k,f->tau[k],f->QR,k+1,w);
+	}
+	f->factored = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_qr_get_q(rc_qr_t f, rc_matrix_t* Q)
+*
+* Forms the square orthogonal matrix Q from the factorization in f by applying
+* the reflections to the identity matrix, last to first. Q is only allocated
+* if it is not already the right size and may be a view.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_qr_get_q(rc_qr_t f, rc_matrix_t* Q){
+	int i,j,k,steps;
+	real_t* w;
+	if(unlikely(!f.factored)){
+		fprintf(stderr,"ERROR in rc_qr_get_q, matrix not factored\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_matrix(Q,f.rows,f.rows))){
+		fprintf(stderr,"ERROR in rc_qr_get_q, failed to allocate Q\n");
+		return -1;
+	}
+	w = alloca(f.rows*sizeof(real_t));
+	if(unlikely(w==NULL)){
+		fprintf(stderr,"ERROR in rc_qr_get_q, alloca failed, stack overflow\n");
+		return -1;
+	}
+	for(i=0;i<f.rows;i++){
+		for(j=0;j<f.rows;j++) AT(*Q,i,j) = (i==j) ? 1.0f : 0.0f;
+	}
+	// reflection k only mixes rows and columns k and up of what's built so far
+	steps = f.rows<f.cols ? f.rows : f.cols;
+	for(k=steps-1;k>=0;k--) reflect_rows(f.QR,k,f.tau[k],*Q,k,w);
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_qr_get_r(rc_qr_t f, rc_matrix_t* R)
+*
+* Copies the upper triangular factor R out of the factorization in f with
+* zeros below the diagonal. R has the same size as the factored matrix, is
+* only allocated if it is not already the right size, and may be a view.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_qr_get_r(rc_qr_t f, rc_matrix_t* R){
+	int i,j;
+	if(unlikely(!f.factored)){
+		fprintf(stderr,"ERROR in rc_qr_get_r, matrix not factored\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_matrix(R,f.rows,f.cols))){
+		fprintf(stderr,"ERROR in rc_qr_get_r, failed to allocate R\n");
+		return -1;
+	}
+	for(i=0;i<f.rows;i++){
+		for(j=0;j<f.cols;j++) AT(*R,i,j) = (j>=i) ? AT(f.QR,i,j) : 0.0f;
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_qr_solve(rc_qr_t f, rc_vector_t b, rc_vector_t* x)
+*
+* Finds the least-squares solution x minimizing norm(Ax-b) using the
+* factorization of A in f. A must have at least as many rows as columns and
+* full column rank. Q is never formed, the reflections are applied directly to
+* a copy of b on the stack then Rx=Q'b is solved by back substitution. x is
+* only allocated if it is not already the right length.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_qr_solve(rc_qr_t f, rc_vector_t b, rc_vector_t* x){
+	int i,k;
+	real_t s;
+	real_t* y;
+	rc_matrix_t Y;
+	if(unlikely(!f.factored)){
+		fprintf(stderr,"ERROR in rc_qr_solve, matrix not factored\n");
+		return -1;
+	}
+	if(unlikely(!b.initialized)){
+		fprintf(stderr,"ERROR in rc_qr_solve, vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(b.len!=f.rows)){
+		fprintf(stderr,"ERROR in rc_qr_solve, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(f.rows<f.cols)){
+		fprintf(stderr,"ERROR in rc_qr_solve, matrix must have at least as many rows as columns\n");
+		return -1;
+	}
+	for(k=0;k<f.cols;k++){
+		if(unlikely(fabs(AT(f.QR,k,k))<ZERO_TOLERANCE)){
+			fprintf(stderr,"ERROR in rc_qr_solve, matrix not full rank\n");
+			return -1;
+		}
+	}
+	y = alloca(f.rows*sizeof(real_t));
+	if(unlikely(y==NULL)){
+		fprintf(stderr,"ERROR in rc_qr_solve, alloca failed, stack overflow\n");
+		return -1;
+	}
+	// y=Q'b, treating y as a single column so the same reflection code is used
+	memcpy(y,b.d,f.rows*sizeof(real_t));
+	rc_matrix_view(&Y,y,f.rows,1,1);
+	for(k=0;k<f.cols;k++) reflect_rows(f.QR,k,f.tau[k],Y,0,&s);
+	if(unlikely(rc_alloc_vector(x,f.cols))){
+		fprintf(stderr,"ERROR in rc_qr_solve, failed to allocate x\n");
+		return -1;
+	}
+	// solve for x knowing R is upper triangular
+	for(k=f.cols-1;k>=0;k--){
+		s = y[k];
+		for(i=k+1;i<f.cols;i++) s -= AT(f.QR,k,i)*x->d[i];
+		x->d[k] = s/AT(f.QR,k,k);
+	}
+	return 0;
+}
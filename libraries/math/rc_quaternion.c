@@ -59,7 +59,7 @@ int rc_normalize_quaternion(rc_vector_t* q){
 		fprintf(stderr, "ERROR in rc_normalize_quaternion, unable to calculate norm\n");
 		return -1;
 	}
-	for(i=0;i<3;i++) q->d[i]/=len;
+	for(i=0;i<4;i++) q->d[i]/=len;
 	return 0;
 }
 
@@ -73,7 +73,7 @@ int rc_normalize_quaternion_array(float q[4]){
 	int i;
 	float len;
 	float sum=0.0f;
-	for(i=0;i<3;i++) sum+=q[i]*q[i];
+	for(i=0;i<4;i++) sum+=q[i]*q[i];
 	len = sqrtf(sum);
 
 	// can't check if length is below a constant value as q may be filled
@@ -82,7 +82,7 @@ int rc_normalize_quaternion_array(float q[4]){
 		fprintf(stderr, "ERROR in quaternion has 0 length\n");
 		return -1;
 	}
-	for(i=0;i<3;i++) q[i]=q[i]/len;
+	for(i=0;i<4;i++) q[i]=q[i]/len;
 	return 0;
 }
 
@@ -526,16 +526,17 @@ int rc_quaternion_to_rotation_matrix(rc_vector_t q, rc_matrix_t* m){
 	q2s = q.d[2]*q.d[2];
 	q3s = q.d[3]*q.d[3];
 	// compute diagonal entries
-	m->d[0][0] = q0s+q1s-q2s-q3s;
-	m->d[1][1] = q0s-q1s+q2s-q3s;
-	m->d[2][2] = q0s-q1s-q2s+q3s;
+	RC_MATRIX_ENTRY(*m,0,0) = q0s+q1s-q2s-q3s;
+	RC_MATRIX_ENTRY(*m,1,1) = q0s-q1s+q2s-q3s;
+	RC_MATRIX_ENTRY(*m,2,2) = q0s-q1s-q2s+q3s;
 	// compute upper triangle
-	m->d[0][1] = 2.0f * (q.d[1]*q.d[2] - q.d[0]*q.d[3]);
-	m->d[0][2] = 2.0f * (q.d[1]*q.d[3] + q.d[0]*q.d[2]);
-	m->d[1][2] = 2.0f * (q.d[2]*q.d[3] - q.d[0]*q.d[1]);
-	// mirror lower triangle
-	m->d[1][0] = m->d[0][1];
-	m->d[2][0] = m->d[0][2];
-	m->d[2][1] = m->d[1][2];
+	RC_MATRIX_ENTRY(*m,0,1) = 2.0f * (q.d[1]*q.d[2] - q.d[0]*q.d[3]);
+	RC_MATRIX_ENTRY(*m,0,2) = 2.0f * (q.d[1]*q.d[3] + q.d[0]*q.d[2]);
+	RC_MATRIX_ENTRY(*m,1,2) = 2.0f * (q.d[2]*q.d[3] - q.d[0]*q.d[1]);
+	// compute lower triangle, the rotation matrix is not symmetric so the
+	// terms in q0 change sign
+	RC_MATRIX_ENTRY(*m,1,0) = 2.0f * (q.d[1]*q.d[2] + q.d[0]*q.d[3]);
+	RC_MATRIX_ENTRY(*m,2,0) = 2.0f * (q.d[1]*q.d[3] - q.d[0]*q.d[2]);
+	RC_MATRIX_ENTRY(*m,2,1) = 2.0f * (q.d[2]*q.d[3] + q.d[0]*q.d[1]);
 	return 0;
 }
@@ -0,0 +1,202 @@
+/*******************************************************************************
+* rc_real.h
+*
+* Precision switch for the linear algebra sources. rc_vector.c, rc_matrix.c,
+* rc_linear_algebra.c, rc_blas.c, rc_lqr.c, rc_expm.c, the factorizations
+* and rc_polynomial.c are written with real_t instead of float but otherwise use
+* the normal float names for every type and function. Compiled on their own
+* they build the float API exactly as before. Each matching *_double.c file
+* defines RC_DOUBLE and includes the float source again, and the defines below
+* then turn every type and function name into its _d counterpart declared in
+* roboticscape.h. That way the double API comes from the same code rather than
+* a copy of it, and anything missing from this list fails to build with a
+* float/double type mismatch.
+*
+* Only included through rc_algebra_common.h, after roboticscape.h so the
+* header itself always declares both sets of names.
+*******************************************************************************/
+
+#ifndef RC_REAL_H
+#define RC_REAL_H
+
+#include <float.h> // for FLT_MAX, DBL_MAX etc
+
+#ifndef RC_DOUBLE
+
+typedef float real_t;
+#define REAL_MAX		FLT_MAX
+#define REAL_EPSILON	FLT_EPSILON
+
+#else
+
+typedef double real_t;
+#define REAL_MAX		DBL_MAX
+#define REAL_EPSILON	DBL_EPSILON
+
+// singular pivots are judged against double rounding, not float
+#undef  ZERO_TOLERANCE
+#define ZERO_TOLERANCE 1e-12
+
+// types
+#define rc_vector_t		rc_vector_d_t
+#define rc_matrix_t		rc_matrix_d_t
+#define rc_lu_t			rc_lu_d_t
+#define rc_qr_t			rc_qr_d_t
+#define rc_eig_t		rc_eig_d_t
+#define rc_svd_t		rc_svd_d_t
+
+// rc_vector.c
+#define rc_alloc_vector						rc_alloc_vector_d
+#define rc_free_vector						rc_free_vector_d
+#define rc_empty_vector						rc_empty_vector_d
+#define rc_vector_zeros						rc_vector_zeros_d
+#define rc_vector_ones						rc_vector_ones_d
+#define rc_random_vector					rc_random_vector_d
+#define rc_vector_fibonnaci					rc_vector_fibonnaci_d
+#define rc_vector_from_array				rc_vector_from_array_d
+#define rc_duplicate_vector					rc_duplicate_vector_d
+#define rc_set_vector_entry					rc_set_vector_entry_d
+#define rc_get_vector_entry					rc_get_vector_entry_d
+#define rc_print_vector						rc_print_vector_d
+#define rc_print_vector_sci					rc_print_vector_sci_d
+#define rc_vector_times_scalar				rc_vector_times_scalar_d
+#define rc_vector_norm						rc_vector_norm_d
+#define rc_vector_max						rc_vector_max_d
+#define rc_vector_min						rc_vector_min_d
+#define rc_std_dev							rc_std_dev_d
+#define rc_vector_mean						rc_vector_mean_d
+#define rc_vector_projection				rc_vector_projection_d
+#define rc_vector_dot_product				rc_vector_dot_product_d
+#define rc_vector_outer_product				rc_vector_outer_product_d
+#define rc_vector_cross_product				rc_vector_cross_product_d
+#define rc_vector_sum						rc_vector_sum_d
+#define rc_vector_sum_inplace				rc_vector_sum_inplace_d
+
+// rc_matrix.c
+#define rc_alloc_matrix						rc_alloc_matrix_d
+#define rc_free_matrix						rc_free_matrix_d
+#define rc_empty_matrix						rc_empty_matrix_d
+#define rc_matrix_zeros						rc_matrix_zeros_d
+#define rc_identity_matrix					rc_identity_matrix_d
+#define rc_random_matrix					rc_random_matrix_d
+#define rc_diag_matrix						rc_diag_matrix_d
+#define rc_duplicate_matrix					rc_duplicate_matrix_d
+#define rc_set_matrix_entry					rc_set_matrix_entry_d
+#define rc_get_matrix_entry					rc_get_matrix_entry_d
+#define rc_print_matrix						rc_print_matrix_d
+#define rc_print_matrix_sci					rc_print_matrix_sci_d
+#define rc_matrix_times_scalar				rc_matrix_times_scalar_d
+#define rc_multiply_matrices				rc_multiply_matrices_d
+#define rc_left_multiply_matrix_inplace		rc_left_multiply_matrix_inplace_d
+#define rc_multiply_matrices_ws				rc_multiply_matrices_ws_d
+#define rc_left_multiply_matrix_inplace_ws	rc_left_multiply_matrix_inplace_ws_d
+#define rc_right_multiply_matrix_inplace	rc_right_multiply_matrix_inplace_d
+#define rc_add_matrices						rc_add_matrices_d
+#define rc_add_matrices_inplace				rc_add_matrices_inplace_d
+#define rc_matrix_transpose					rc_matrix_transpose_d
+#define rc_matrix_transpose_inplace			rc_matrix_transpose_inplace_d
+#define rc_matrix_view						rc_matrix_view_d
+#define rc_matrix_slice						rc_matrix_slice_d
+#define rc_matrix_transpose_view			rc_matrix_transpose_view_d
+
+// rc_linear_algebra.c
+#define rc_matrix_times_col_vec				rc_matrix_times_col_vec_d
+#define rc_row_vec_times_matrix				rc_row_vec_times_matrix_d
+#define rc_matrix_determinant				rc_matrix_determinant_d
+#define rc_lup_decomp						rc_lup_decomp_d
+#define rc_lup_decomp_ws					rc_lup_decomp_ws_d
+#define rc_qr_decomp						rc_qr_decomp_d
+#define rc_qr_decomp_ws						rc_qr_decomp_ws_d
+#define rc_invert_matrix					rc_invert_matrix_d
+#define rc_invert_matrix_ws					rc_invert_matrix_ws_d
+#define rc_invert_matrix_inplace			rc_invert_matrix_inplace_d
+#define rc_lin_system_solve					rc_lin_system_solve_d
+#define rc_lin_system_solve_qr				rc_lin_system_solve_qr_d
+#define rc_fit_ellipsoid					rc_fit_ellipsoid_d
+#define rc_fit_ellipsoid_ws					rc_fit_ellipsoid_ws_d
+
+// rc_lu.c
+#define rc_empty_lu							rc_empty_lu_d
+#define rc_alloc_lu							rc_alloc_lu_d
+#define rc_free_lu							rc_free_lu_d
+#define rc_lu_factor						rc_lu_factor_d
+#define rc_lu_solve							rc_lu_solve_d
+#define rc_lu_solve_matrix					rc_lu_solve_matrix_d
+#define rc_lu_determinant					rc_lu_determinant_d
+#define rc_lu_invert						rc_lu_invert_d
+
+// rc_cholesky.c
+#define rc_cholesky_decomp					rc_cholesky_decomp_d
+#define rc_cholesky_solve					rc_cholesky_solve_d
+#define rc_cholesky_solve_matrix			rc_cholesky_solve_matrix_d
+#define rc_cholesky_update					rc_cholesky_update_d
+#define rc_cholesky_downdate				rc_cholesky_downdate_d
+#define rc_cholesky_log_det					rc_cholesky_log_det_d
+#define rc_ldl_decomp						rc_ldl_decomp_d
+#define rc_ldl_solve						rc_ldl_solve_d
+#define rc_ldl_solve_matrix					rc_ldl_solve_matrix_d
+#define rc_ldl_update						rc_ldl_update_d
+#define rc_ldl_downdate						rc_ldl_downdate_d
+#define rc_ldl_log_det						rc_ldl_log_det_d
+
+// rc_qr.c
+#define rc_empty_qr							rc_empty_qr_d
+#define rc_alloc_qr							rc_alloc_qr_d
+#define rc_free_qr							rc_free_qr_d
+#define rc_qr_factor						rc_qr_factor_d
+#define rc_qr_get_q							rc_qr_get_q_d
+#define rc_qr_get_r							rc_qr_get_r_d
+#define rc_qr_solve							rc_qr_solve_d
+
+// rc_jacobi.c
+#define rc_empty_eig						rc_empty_eig_d
+#define rc_alloc_eig						rc_alloc_eig_d
+#define rc_free_eig							rc_free_eig_d
+#define rc_eig_symmetric					rc_eig_symmetric_d
+#define rc_empty_svd						rc_empty_svd_d
+#define rc_alloc_svd						rc_alloc_svd_d
+#define rc_free_svd							rc_free_svd_d
+#define rc_svd_decomp						rc_svd_decomp_d
+#define rc_svd_pinv							rc_svd_pinv_d
+
+// rc_polynomial.c
+#define rc_print_poly						rc_print_poly_d
+#define rc_poly_conv						rc_poly_conv_d
+#define rc_poly_power						rc_poly_power_d
+#define rc_poly_add							rc_poly_add_d
+#define rc_poly_add_inplace					rc_poly_add_inplace_d
+#define rc_poly_subtract					rc_poly_subtract_d
+#define rc_poly_subtract_inplace			rc_poly_subtract_inplace_d
+#define rc_poly_differentiate				rc_poly_differentiate_d
+#define rc_poly_divide						rc_poly_divide_d
+#define rc_poly_butter						rc_poly_butter_d
+
+// rc_blas.c
+#define rc_gemv								rc_gemv_d
+#define rc_gemv_transpose					rc_gemv_transpose_d
+#define rc_axpy								rc_axpy_d
+#define rc_ger								rc_ger_d
+#define rc_syrk								rc_syrk_d
+
+// rc_lqr.c
+#define rc_dare								rc_dare_d
+#define rc_dlqr								rc_dlqr_d
+
+// rc_expm.c
+#define rc_expm_ws							rc_expm_ws_d
+#define rc_c2d_ss_ws						rc_c2d_ss_ws_d
+
+// rc_workspace.c, only the matrix function depends on precision
+#define rc_workspace_matrix					rc_workspace_matrix_d
+
+// internal helpers from rc_neon_functions.c and rc_gemm.c
+#define rc_mult_accumulate					rc_mult_accumulate_d
+#define rc_mult_accumulate_strided			rc_mult_accumulate_strided_d
+#define rc_sum_squares_strided				rc_sum_squares_strided_d
+#define rc_scale_accumulate					rc_scale_accumulate_d
+#define rc_gemm_work_size					rc_gemm_work_size_d
+#define rc_gemm								rc_gemm_d
+
+#endif // RC_DOUBLE
+
+#endif // RC_REAL_H
@@ -192,3 +192,283 @@ float rc_std_dev_ringbuf(rc_ringbuf_t buf){
 }
 
 
+
+/*******************************************************************************
+* rc_stats_ringbuf_t rc_empty_stats_ringbuf()
+*
+* Returns an rc_stats_ringbuf_t with no memory allocated. Use this to initialize
+* local statistics ring buffers before calling rc_alloc_stats_ringbuf, for the
+* same reason as rc_empty_ringbuf.
+*******************************************************************************/
+rc_stats_ringbuf_t rc_empty_stats_ringbuf(){
+	rc_stats_ringbuf_t out;
+	// zero-out piecemeal instead of with memset to avoid issues with padding
+	out.buf = rc_empty_ringbuf();
+	out.count = 0;
+	out.sum = 0.0;
+	out.sum_sqr = 0.0;
+	out.since_resum = 0;
+	out.min_q = NULL;
+	out.max_q = NULL;
+	out.min_head = 0;
+	out.min_len = 0;
+	out.max_head = 0;
+	out.max_len = 0;
+	out.initialized = 0;
+	return out;
+}
+
+/*******************************************************************************
+* int rc_alloc_stats_ringbuf(rc_stats_ringbuf_t* s, int size)
+*
+* Allocates memory for a statistics ring buffer holding the last 'size' values.
+* Any existing memory allocated for s is freed first.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_stats_ringbuf(rc_stats_ringbuf_t* s, int size){
+	// sanity checks
+	if(unlikely(s==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_stats_ringbuf, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(size<2)){
+		fprintf(stderr,"ERROR in rc_alloc_stats_ringbuf, size must be >=2\n");
+		return -1;
+	}
+	rc_free_stats_ringbuf(s);
+	if(unlikely(rc_alloc_ringbuf(&s->buf,size))){
+		fprintf(stderr,"ERROR in rc_alloc_stats_ringbuf, failed to allocate ring buffer\n");
+		return -1;
+	}
+	// the min and max queues share one allocation
+	s->min_q = (int*)malloc(2*size*sizeof(int));
+	if(unlikely(s->min_q==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_stats_ringbuf, failed to allocate memory\n");
+		rc_free_ringbuf(&s->buf);
+		return -1;
+	}
+	s->max_q = s->min_q+size;
+	s->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_stats_ringbuf(rc_stats_ringbuf_t* s)
+*
+* Frees the memory allocated for s and zeros out the struct.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_stats_ringbuf(rc_stats_ringbuf_t* s){
+	if(unlikely(s==NULL)){
+		fprintf(stderr,"ERROR in rc_free_stats_ringbuf, received NULL pointer\n");
+		return -1;
+	}
+	if(s->initialized){
+		rc_free_ringbuf(&s->buf);
+		free(s->min_q);
+	}
+	*s = rc_empty_stats_ringbuf();
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_reset_stats_ringbuf(rc_stats_ringbuf_t* s)
+*
+* Empties the buffer and resets all running statistics.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_reset_stats_ringbuf(rc_stats_ringbuf_t* s){
+	if(unlikely(s==NULL)){
+		fprintf(stderr,"ERROR in rc_reset_stats_ringbuf, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!s->initialized)){
+		fprintf(stderr,"ERROR in rc_reset_stats_ringbuf, ringbuf uninitialized\n");
+		return -1;
+	}
+	rc_reset_ringbuf(&s->buf);
+	s->count = 0;
+	s->sum = 0.0;
+	s->sum_sqr = 0.0;
+	s->since_resum = 0;
+	s->min_head = 0;
+	s->min_len = 0;
+	s->max_head = 0;
+	s->max_len = 0;
+	return 0;
+}
+
+/*******************************************************************************
+* void resum_stats_ringbuf(rc_stats_ringbuf_t* s)
+*
+* only for use in this file. Recomputes the running sums from scratch so the
+* rounding error from repeatedly adding and subtracting values can't build up.
+*******************************************************************************/
+static void resum_stats_ringbuf(rc_stats_ringbuf_t* s){
+	int i, idx;
+	double sum = 0.0;
+	double sum_sqr = 0.0;
+	for(i=0;i<s->count;i++){
+		idx = s->buf.index-i;
+		if(idx<0) idx+=s->buf.size;
+		sum += s->buf.d[idx];
+		sum_sqr += (double)s->buf.d[idx]*s->buf.d[idx];
+	}
+	s->sum = sum;
+	s->sum_sqr = sum_sqr;
+	s->since_resum = 0;
+	return;
+}
+
+/*******************************************************************************
+* int rc_insert_new_stats_ringbuf_value(rc_stats_ringbuf_t* s, float val)
+*
+* Puts a new value into the buffer, booting out the oldest value if the buffer
+* is full, and updates the running sums and the min/max queues. The min and max
+* are tracked with monotonic queues of buffer positions: each new value pops
+* every queued value it dominates off the back, so the front of each queue is
+* always the current extreme. Each value is pushed and popped at most once
+* making this O(1) on average. Once every 'size' insertions the running sums
+* are recomputed from the buffer contents to bound numerical drift.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_insert_new_stats_ringbuf_value(rc_stats_ringbuf_t* s, float val){
+	int idx, back;
+	const int size = s->buf.size;
+	float old;
+	if(unlikely(!s->initialized)){
+		fprintf(stderr,"ERROR in rc_insert_new_stats_ringbuf_value, ringbuf uninitialized\n");
+		return -1;
+	}
+	// position the new value will go, same as rc_insert_new_ringbuf_value
+	idx = s->buf.index+1;
+	if(idx>=size) idx=0;
+	// remove the value about to be overwritten from the sums and queues. If it
+	// is still in a queue it must be at the front since it is the oldest
+	if(s->count==size){
+		old = s->buf.d[idx];
+		s->sum -= old;
+		s->sum_sqr -= (double)old*old;
+		if(s->min_len>0 && s->min_q[s->min_head]==idx){
+			s->min_head++;
+			if(s->min_head>=size) s->min_head=0;
+			s->min_len--;
+		}
+		if(s->max_len>0 && s->max_q[s->max_head]==idx){
+			s->max_head++;
+			if(s->max_head>=size) s->max_head=0;
+			s->max_len--;
+		}
+	}
+	else s->count++;
+	// write out new value
+	s->buf.d[idx] = val;
+	s->buf.index = idx;
+	s->sum += val;
+	s->sum_sqr += (double)val*val;
+	// pop dominated values off the back of each queue, then push the new one
+	while(s->min_len>0){
+		back = s->min_head+s->min_len-1;
+		if(back>=size) back-=size;
+		if(s->buf.d[s->min_q[back]]<val) break;
+		s->min_len--;
+	}
+	back = s->min_head+s->min_len;
+	if(back>=size) back-=size;
+	s->min_q[back] = idx;
+	s->min_len++;
+	while(s->max_len>0){
+		back = s->max_head+s->max_len-1;
+		if(back>=size) back-=size;
+		if(s->buf.d[s->max_q[back]]>val) break;
+		s->max_len--;
+	}
+	back = s->max_head+s->max_len;
+	if(back>=size) back-=size;
+	s->max_q[back] = idx;
+	s->max_len++;
+	// periodic re-summation
+	s->since_resum++;
+	if(s->since_resum>=size) resum_stats_ringbuf(s);
+	return 0;
+}
+
+/*******************************************************************************
+* float rc_stats_ringbuf_mean(rc_stats_ringbuf_t* s)
+*
+* Returns the mean of the values currently in the buffer. Only values that
+* have actually been inserted are counted, so this is meaningful before the
+* buffer fills up. Returns 0 if the buffer is empty, -1.0f on error.
+*******************************************************************************/
+float rc_stats_ringbuf_mean(rc_stats_ringbuf_t* s){
+	if(unlikely(!s->initialized)){
+		fprintf(stderr,"ERROR in rc_stats_ringbuf_mean, ringbuf uninitialized\n");
+		return -1.0f;
+	}
+	if(s->count==0) return 0.0f;
+	return s->sum/s->count;
+}
+
+/*******************************************************************************
+* float rc_stats_ringbuf_variance(rc_stats_ringbuf_t* s)
+*
+* Returns the population variance of the values currently in the buffer.
+* Returns 0 if the buffer is empty, -1.0f on error.
+*******************************************************************************/
+float rc_stats_ringbuf_variance(rc_stats_ringbuf_t* s){
+	double mean, var;
+	if(unlikely(!s->initialized)){
+		fprintf(stderr,"ERROR in rc_stats_ringbuf_variance, ringbuf uninitialized\n");
+		return -1.0f;
+	}
+	if(s->count==0) return 0.0f;
+	mean = s->sum/s->count;
+	var = s->sum_sqr/s->count - mean*mean;
+	// rounding can make a constant signal's variance slightly negative
+	if(var<0.0) return 0.0f;
+	return var;
+}
+
+/*******************************************************************************
+* float rc_stats_ringbuf_std_dev(rc_stats_ringbuf_t* s)
+*
+* Returns the standard deviation of the values currently in the buffer. This
+* is the O(1) equivalent of rc_std_dev_ringbuf. Returns -1.0f on error.
+*******************************************************************************/
+float rc_stats_ringbuf_std_dev(rc_stats_ringbuf_t* s){
+	if(unlikely(!s->initialized)){
+		fprintf(stderr,"ERROR in rc_stats_ringbuf_std_dev, ringbuf uninitialized\n");
+		return -1.0f;
+	}
+	return sqrtf(rc_stats_ringbuf_variance(s));
+}
+
+/*******************************************************************************
+* float rc_stats_ringbuf_min(rc_stats_ringbuf_t* s)
+*
+* Returns the smallest value currently in the buffer, 0 if it is empty.
+* Returns -1.0f on error.
+*******************************************************************************/
+float rc_stats_ringbuf_min(rc_stats_ringbuf_t* s){
+	if(unlikely(!s->initialized)){
+		fprintf(stderr,"ERROR in rc_stats_ringbuf_min, ringbuf uninitialized\n");
+		return -1.0f;
+	}
+	if(s->min_len==0) return 0.0f;
+	return s->buf.d[s->min_q[s->min_head]];
+}
+
+/*******************************************************************************
+* float rc_stats_ringbuf_max(rc_stats_ringbuf_t* s)
+*
+* Returns the largest value currently in the buffer, 0 if it is empty.
+* Returns -1.0f on error.
+*******************************************************************************/
+float rc_stats_ringbuf_max(rc_stats_ringbuf_t* s){
+	if(unlikely(!s->initialized)){
+		fprintf(stderr,"ERROR in rc_stats_ringbuf_max, ringbuf uninitialized\n");
+		return -1.0f;
+	}
+	if(s->max_len==0) return 0.0f;
+	return s->buf.d[s->max_q[s->max_head]];
+}
@@ -0,0 +1,369 @@
+/*******************************************************************************
+* rc_sos_filter.c
+*
+* Discrete SISO filters implemented as a cascade of second order sections
+* (biquads). High order designs such as Butterworth filters above 4th order are
+* numerically fragile in single precision when expanded into one long transfer
+* function polynomial. Keeping them factored as biquads keeps every coefficient
+* well conditioned and costs 5 multiplies per section per step.
+*
+* Each section is evaluated in direct form I. Since the output of one section is
+* the input to the next, neighboring sections share the same two samples of
+* history so a filter with S sections keeps S+1 pairs of history values.
+*******************************************************************************/
+
+#include "../roboticscape.h"
+#include "../preprocessor_macros.h"
+#include <stdio.h>
+#include <math.h>
+#include <string.h> // for memset
+#include <stdlib.h>
+
+#define SOS_COEFS 5 // b0 b1 b2 a1 a2 stored per section
+
+/*******************************************************************************
+* int rc_alloc_sos_filter(rc_sos_filter_t* f, rc_matrix_t sos, float dt)
+*
+* Allocates memory for a cascade of second order sections. Each row of matrix
+* sos describes one section as [b0 b1 b2 a0 a1 a2] which is the same layout
+* used by MATLAB's sos matrices. Each row is normalized by its a0. First order
+* sections are described by setting b2 and a2 to 0. Any existing memory
+* allocated for f is freed first. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_sos_filter(rc_sos_filter_t* f, rc_matrix_t sos, float dt){
+	int i, S, order;
+	float* mem;
+	float* c;
+	// sanity checks
+	if(unlikely(f==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_sos_filter, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(dt<=0.0f)){
+		fprintf(stderr,"ERROR in rc_alloc_sos_filter, dt must be >0\n");
+		return -1;
+	}
+	if(unlikely(!sos.initialized)){
+		fprintf(stderr,"ERROR in rc_alloc_sos_filter, matrix uninitialized\n");
+		return -1;
+	}
+	if(unlikely(sos.cols!=6)){
+		fprintf(stderr,"ERROR in rc_alloc_sos_filter, sos matrix must have 6 columns\n");
+		return -1;
+	}
+	S = sos.rows;
+	order = 0;
+	for(i=0;i<S;i++){
+		if(unlikely(RC_MATRIX_ENTRY(sos,i,3)==0.0f)){
+			fprintf(stderr,"ERROR in rc_alloc_sos_filter, a0 of section %d is 0\n",i);
+			return -1;
+		}
+		if(RC_MATRIX_ENTRY(sos,i,5)!=0.0f) order+=2;
+		else if(RC_MATRIX_ENTRY(sos,i,4)!=0.0f) order+=1;
+	}
+	// free existing memory, this also zeros out all fields
+	rc_free_sos_filter(f);
+	// one block holds the coefficients followed by the signal history
+	mem = (float*)calloc(SOS_COEFS*S + 2*(S+1),sizeof(float));
+	if(unlikely(mem==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_sos_filter, failed to allocate memory\n");
+		return -1;
+	}
+	f->coef = mem;
+	f->w = mem + SOS_COEFS*S;
+	for(i=0;i<S;i++){
+		c = f->coef + SOS_COEFS*i;
+		c[0] = RC_MATRIX_ENTRY(sos,i,0)/RC_MATRIX_ENTRY(sos,i,3);
+		c[1] = RC_MATRIX_ENTRY(sos,i,1)/RC_MATRIX_ENTRY(sos,i,3);
+		c[2] = RC_MATRIX_ENTRY(sos,i,2)/RC_MATRIX_ENTRY(sos,i,3);
+		c[3] = RC_MATRIX_ENTRY(sos,i,4)/RC_MATRIX_ENTRY(sos,i,3);
+		c[4] = RC_MATRIX_ENTRY(sos,i,5)/RC_MATRIX_ENTRY(sos,i,3);
+	}
+	f->sections = S;
+	f->order = order;
+	f->dt = dt;
+	f->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_sos_filter(rc_sos_filter_t* f)
+*
+* Frees the memory allocated by the filter and zeros out all properties.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_sos_filter(rc_sos_filter_t* f){
+	if(unlikely(f==NULL)){
+		fprintf(stderr,"ERROR in rc_free_sos_filter, received NULL pointer\n");
+		return -1;
+	}
+	// coef is the start of the single block holding coefficients and history
+	if(f->initialized) free(f->coef);
+	*f = rc_empty_sos_filter();
+	return 0;
+}
+
+/*******************************************************************************
+* rc_sos_filter_t rc_empty_sos_filter()
+*
+* Returns an rc_sos_filter_t with no allocated memory. Use this to initialize
+* local filters before calling any other function, just like rc_empty_filter.
+*******************************************************************************/
+rc_sos_filter_t rc_empty_sos_filter(){
+	rc_sos_filter_t f;
+	f.order			= 0;
+	f.sections		= 0;
+	f.dt			= 0.0f;
+	f.gain			= 1.0f;
+	f.coef			= NULL;
+	f.w				= NULL;
+	f.newest_input	= 0.0f;
+	f.newest_output	= 0.0f;
+	f.step			= 0;
+	f.initialized	= 0;
+	return f;
+}
+
+/*******************************************************************************
+* float rc_march_sos_filter(rc_sos_filter_t* f, float new_input)
+*
+* March the filter forward one step with new input provided as an argument.
+* Returns the new output which could also be accessed with f->newest_output.
+*******************************************************************************/
+float rc_march_sos_filter(rc_sos_filter_t* f, float new_input){
+	int i;
+	float x, y;
+	const float* c;
+	float* w;
+	// sanity checks
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_march_sos_filter, filter uninitialized\n");
+		return -1.0f;
+	}
+	x = f->gain*new_input;
+	c = f->coef;
+	w = f->w;
+	for(i=0;i<f->sections;i++){
+		// w[0],w[1] are the history of this section's input
+		// w[2],w[3] are the history of this section's output
+		y = c[0]*x + c[1]*w[0] + c[2]*w[1] - c[3]*w[2] - c[4]*w[3];
+		w[1] = w[0];
+		w[0] = x;
+		x = y;
+		c += SOS_COEFS;
+		w += 2;
+	}
+	// record history of the final output
+	w[1] = w[0];
+	w[0] = x;
+	f->newest_input = new_input;
+	f->newest_output = x;
+	f->step++;
+	return x;
+}
+
+/*******************************************************************************
+* int rc_reset_sos_filter(rc_sos_filter_t* f)
+*
+* Resets all previous inputs and outputs of every section to 0 and resets the
+* step counter. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_reset_sos_filter(rc_sos_filter_t* f){
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_reset_sos_filter, filter uninitialized\n");
+		return -1;
+	}
+	memset(f->w,0,2*(f->sections+1)*sizeof(float));
+	f->newest_input = 0.0f;
+	f->newest_output = 0.0f;
+	f->step = 0;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_prefill_sos_filter_inputs(rc_sos_filter_t* f, float in)
+*
+* Fills all previous inputs to the filter as if they had been equal to 'in'.
+* Like rc_prefill_filter_inputs this is most useful when starting high-pass
+* filters with a non-zero input. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_prefill_sos_filter_inputs(rc_sos_filter_t* f, float in){
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_prefill_sos_filter_inputs, filter uninitialized\n");
+		return -1;
+	}
+	f->w[0] = f->gain*in;
+	f->w[1] = f->gain*in;
+	f->newest_input = in;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_prefill_sos_filter_outputs(rc_sos_filter_t* f, float out)
+*
+* Fills all previous outputs of the filter as if they had been equal to 'out'.
+* The outputs of the intermediate sections are filled with their steady-state
+* values found by working back through the DC gain of each section, so a low
+* pass cascade starts with no settling at all. Intermediate signals behind a
+* section with zero DC gain are set to 0. Like rc_prefill_filter_outputs the
+* filter inputs are left untouched. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_prefill_sos_filter_outputs(rc_sos_filter_t* f, float out){
+	int i;
+	float v, dc;
+	const float* c;
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_prefill_sos_filter_outputs, filter uninitialized\n");
+		return -1;
+	}
+	v = out;
+	for(i=f->sections-1;i>=0;i--){
+		// signal i+1 is the output of section i
+		f->w[2*(i+1)]   = v;
+		f->w[2*(i+1)+1] = v;
+		// find what input to section i would produce v in steady state
+		c = f->coef + SOS_COEFS*i;
+		dc = (c[0]+c[1]+c[2])/(1.0f+c[3]+c[4]);
+		if(fabs(dc)>1e-6f) v = v/dc;
+		else v = 0.0f;
+	}
+	f->newest_output = out;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_print_sos_filter(rc_sos_filter_t f)
+*
+* Prints the coefficients of each section to the screen, one section per line
+* in the same [b0 b1 b2 a0 a1 a2] layout accepted by rc_alloc_sos_filter.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_print_sos_filter(rc_sos_filter_t f){
+	int i;
+	const float* c;
+	if(unlikely(!f.initialized)){
+		fprintf(stderr,"ERROR in rc_print_sos_filter, filter not initialized yet\n");
+		return -1;
+	}
+	printf("order: %d\n", f.order);
+	printf("sections: %d\n", f.sections);
+	printf("timestep dt: %0.4f\n", f.dt);
+	for(i=0;i<f.sections;i++){
+		c = f.coef + SOS_COEFS*i;
+		printf("%7.4f  %7.4f  %7.4f  %7.4f  %7.4f  %7.4f\n",\
+								c[0],c[1],c[2],1.0f,c[3],c[4]);
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int butterworth_sos(rc_sos_filter_t* f, int order, float dt, float wc, int hp)
+*
+* only for use in this file. Builds the sos matrix for a Butterworth low pass
+* (hp==0) or high pass (hp==1) filter. Each pair of analog poles is discretized
+* on its own with tustin's method prewarped about wc, which is equivalent to
+* what rc_c2d_tustin does to the expanded polynomial. Every section has unity
+* gain at DC (low pass) or nyquist (high pass).
+*******************************************************************************/
+static int butterworth_sos(rc_sos_filter_t* f, int order, float dt, float wc, int hp){
+	int i, S;
+	double c, c2, w2, a1, d0;
+	rc_matrix_t sos = rc_empty_matrix();
+	if(unlikely(order<1)){
+		fprintf(stderr,"ERROR in butterworth_sos, order must be >=1\n");
+		return -1;
+	}
+	if(unlikely(dt<=0.0f)){
+		fprintf(stderr,"ERROR in butterworth_sos, dt must be positive\n");
+		return -1;
+	}
+	if(unlikely(wc<=0.0f || wc>=(M_PI/dt))){
+		fprintf(stderr,"ERROR in butterworth_sos, wc must be between 0 and nyquist\n");
+		return -1;
+	}
+	S = (order+1)/2;
+	if(unlikely(rc_matrix_zeros(&sos,S,6))){
+		fprintf(stderr,"ERROR in butterworth_sos, failed to alloc matrix\n");
+		return -1;
+	}
+	// tustin's substitution s = c(z-1)/(z+1) with prewarping about wc
+	c  = wc/tan(wc*dt/2.0);
+	c2 = c*c;
+	w2 = (double)wc*wc;
+	// complex pole pairs s^2 + a1*s + wc^2
+	for(i=0;i<order/2;i++){
+		a1 = 2.0*wc*sin((2.0*i+1.0)*M_PI/(2.0*order));
+		d0 = c2 + a1*c + w2;
+		sos.d[i][3] = 1.0f;
+		sos.d[i][4] = (2.0*w2 - 2.0*c2)/d0;
+		sos.d[i][5] = (c2 - a1*c + w2)/d0;
+		if(hp){ // s^2/(s^2+a1*s+wc^2)
+			sos.d[i][0] = c2/d0;
+			sos.d[i][1] = -2.0*c2/d0;
+			sos.d[i][2] = c2/d0;
+		}
+		else{	// wc^2/(s^2+a1*s+wc^2)
+			sos.d[i][0] = w2/d0;
+			sos.d[i][1] = 2.0*w2/d0;
+			sos.d[i][2] = w2/d0;
+		}
+	}
+	// odd orders have one real pole s+wc
+	if(order%2){
+		i = S-1;
+		d0 = c + wc;
+		sos.d[i][3] = 1.0f;
+		sos.d[i][4] = (wc - c)/d0;
+		if(hp){
+			sos.d[i][0] = c/d0;
+			sos.d[i][1] = -c/d0;
+		}
+		else{
+			sos.d[i][0] = wc/d0;
+			sos.d[i][1] = wc/d0;
+		}
+	}
+	if(unlikely(rc_alloc_sos_filter(f,sos,dt))){
+		fprintf(stderr,"ERROR in butterworth_sos, failed to alloc filter\n");
+		rc_free_matrix(&sos);
+		return -1;
+	}
+	rc_free_matrix(&sos);
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_butterworth_lowpass_sos(rc_sos_filter_t* f, int order, float dt, float wc)
+*
+* Creates a Butterworth low pass filter of specified order and cutoff frequency
+* wc in rad/s as a cascade of second order sections. This has the same transfer
+* function as rc_butterworth_lowpass but remains accurate at high orders.
+* Any existing memory allocated for f is freed safely.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_butterworth_lowpass_sos(rc_sos_filter_t* f, int order, float dt, float wc){
+	if(unlikely(butterworth_sos(f,order,dt,wc,0))){
+		fprintf(stderr,"ERROR in rc_butterworth_lowpass_sos, failed to make filter\n");
+		return -1;
+	}
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_butterworth_highpass_sos(rc_sos_filter_t* f, int order, float dt, float wc)
+*
+* Creates a Butterworth high pass filter of specified order and cutoff frequency
+* wc in rad/s as a cascade of second order sections with unity gain in the
+* pass band. Note rc_butterworth_highpass keeps the s^n/butter(s) numerator
+* unscaled so its high frequency gain is wc^order instead, this one has the
+* same shape but not the same gain and remains accurate at high orders.
+* Any existing memory allocated for f is freed safely.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_butterworth_highpass_sos(rc_sos_filter_t* f, int order, float dt, float wc){
+	if(unlikely(butterworth_sos(f,order,dt,wc,1))){
+		fprintf(stderr,"ERROR in rc_butterworth_highpass_sos, failed to make filter\n");
+		return -1;
+	}
+	return 0;
+}
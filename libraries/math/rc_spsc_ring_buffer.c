@@ -0,0 +1,212 @@
+/*******************************************************************************
+* rc_spsc_ring_buffer.c
+*
+* Lock-free single-producer single-consumer ring buffers for handing samples of
+* any type from one thread to another, for example from the IMU interrupt
+* thread to a logging thread, without taking a mutex. Only the producer writes
+* the head index and only the consumer writes the tail index. Each side
+* publishes its index with a release store after touching the data and reads
+* the other side's index with an acquire load before touching the data, which
+* is all the synchronization needed when there is exactly one of each.
+*
+* The head and tail live on separate cache lines so the two threads don't
+* bounce one line back and forth on every push and pop. Each side also keeps a
+* cached copy of the other's index and only re-reads the shared one when the
+* cached value says the buffer looks full (producer) or empty (consumer).
+*******************************************************************************/
+
+#include "../roboticscape.h"
+#include "../preprocessor_macros.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*******************************************************************************
+* rc_spsc_ringbuf_t rc_empty_spsc_ringbuf()
+*
+* Returns an rc_spsc_ringbuf_t with no memory allocated. Use this to initialize
+* local buffers before calling rc_alloc_spsc_ringbuf.
+*******************************************************************************/
+rc_spsc_ringbuf_t rc_empty_spsc_ringbuf(){
+	rc_spsc_ringbuf_t out;
+	// zero-out piecemeal instead of with memset to avoid issues with padding
+	out.d			= NULL;
+	out.elem_size	= 0;
+	out.capacity	= 0;
+	out.mask		= 0;
+	out.initialized	= 0;
+	out.head		= 0;
+	out.cached_tail	= 0;
+	out.tail		= 0;
+	out.cached_head	= 0;
+	return out;
+}
+
+/*******************************************************************************
+* int rc_alloc_spsc_ringbuf(rc_spsc_ringbuf_t* r, int capacity, size_t elem_size)
+*
+* Allocates a buffer for up to 'capacity' elements of 'elem_size' bytes each.
+* The capacity is rounded up to the next power of two so indices can wrap with
+* a mask instead of a division. Any existing memory allocated for r is freed
+* first. This must be done before the producer and consumer threads start.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_spsc_ringbuf(rc_spsc_ringbuf_t* r, int capacity, size_t elem_size){
+	unsigned int cap;
+	// sanity checks
+	if(unlikely(r==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_spsc_ringbuf, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(capacity<2 || capacity>(1<<30))){
+		fprintf(stderr,"ERROR in rc_alloc_spsc_ringbuf, capacity must be between 2 and 2^30\n");
+		return -1;
+	}
+	if(unlikely(elem_size==0)){
+		fprintf(stderr,"ERROR in rc_alloc_spsc_ringbuf, elem_size must be >0\n");
+		return -1;
+	}
+	rc_free_spsc_ringbuf(r);
+	// round up to a power of two
+	cap = 2;
+	while(cap<(unsigned int)capacity) cap<<=1;
+	r->d = (char*)malloc(cap*elem_size);
+	if(unlikely(r->d==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_spsc_ringbuf, failed to allocate memory\n");
+		return -1;
+	}
+	r->elem_size = elem_size;
+	r->capacity = cap;
+	r->mask = cap-1;
+	r->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_spsc_ringbuf(rc_spsc_ringbuf_t* r)
+*
+* Frees the memory allocated for r and zeros out the struct. Both threads must
+* be finished with the buffer first. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_spsc_ringbuf(rc_spsc_ringbuf_t* r){
+	if(unlikely(r==NULL)){
+		fprintf(stderr,"ERROR in rc_free_spsc_ringbuf, received NULL pointer\n");
+		return -1;
+	}
+	if(r->initialized) free(r->d);
+	*r = rc_empty_spsc_ringbuf();
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_spsc_ringbuf_push(rc_spsc_ringbuf_t* r, const void* elem)
+*
+* Producer side. Copies one element into the buffer. Returns 0 on success or
+* -1 if the buffer is full. No error message is printed when full so this can
+* be called from time-critical threads, the caller decides what to do.
+*******************************************************************************/
+int rc_spsc_ringbuf_push(rc_spsc_ringbuf_t* r, const void* elem){
+	unsigned int head = r->head; // only this thread writes head
+	if(head-r->cached_tail==r->capacity){
+		r->cached_tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+		if(head-r->cached_tail==r->capacity) return -1;
+	}
+	memcpy(r->d+(head&r->mask)*r->elem_size, elem, r->elem_size);
+	__atomic_store_n(&r->head, head+1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_spsc_ringbuf_pop(rc_spsc_ringbuf_t* r, void* elem)
+*
+* Consumer side. Copies the oldest element out of the buffer into 'elem'.
+* Returns 0 on success or -1 if the buffer is empty.
+*******************************************************************************/
+int rc_spsc_ringbuf_pop(rc_spsc_ringbuf_t* r, void* elem){
+	unsigned int tail = r->tail; // only this thread writes tail
+	if(tail==r->cached_head){
+		r->cached_head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		if(tail==r->cached_head) return -1;
+	}
+	memcpy(elem, r->d+(tail&r->mask)*r->elem_size, r->elem_size);
+	__atomic_store_n(&r->tail, tail+1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_spsc_ringbuf_push_batch(rc_spsc_ringbuf_t* r, const void* elems, int n)
+*
+* Producer side. Copies up to n consecutive elements from array 'elems' into
+* the buffer with at most two memcpy calls and a single release store.
+* Returns the number of elements actually pushed, which is less than n if the
+* buffer filled up, or -1 on error.
+*******************************************************************************/
+int rc_spsc_ringbuf_push_batch(rc_spsc_ringbuf_t* r, const void* elems, int n){
+	unsigned int head, space, start, first;
+	if(unlikely(n<0 || (n>0 && elems==NULL))){
+		fprintf(stderr,"ERROR in rc_spsc_ringbuf_push_batch, invalid arguments\n");
+		return -1;
+	}
+	head = r->head;
+	space = r->capacity-(head-r->cached_tail);
+	if(space<(unsigned int)n){
+		r->cached_tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+		space = r->capacity-(head-r->cached_tail);
+	}
+	if((unsigned int)n>space) n=space;
+	if(n==0) return 0;
+	// copy up to the end of the array, then wrap around to the start
+	start = head&r->mask;
+	first = r->capacity-start;
+	if(first>(unsigned int)n) first=n;
+	memcpy(r->d+start*r->elem_size, elems, first*r->elem_size);
+	memcpy(r->d, (const char*)elems+first*r->elem_size, (n-first)*r->elem_size);
+	__atomic_store_n(&r->head, head+n, __ATOMIC_RELEASE);
+	return n;
+}
+
+/*******************************************************************************
+* int rc_spsc_ringbuf_pop_batch(rc_spsc_ringbuf_t* r, void* elems, int max)
+*
+* Consumer side. Copies up to 'max' of the oldest elements out of the buffer
+* into array 'elems' with at most two memcpy calls and a single release store.
+* Returns the number of elements popped, 0 if the buffer was empty, or -1 on
+* error.
+*******************************************************************************/
+int rc_spsc_ringbuf_pop_batch(rc_spsc_ringbuf_t* r, void* elems, int max){
+	unsigned int tail, avail, start, first;
+	int n;
+	if(unlikely(max<0 || (max>0 && elems==NULL))){
+		fprintf(stderr,"ERROR in rc_spsc_ringbuf_pop_batch, invalid arguments\n");
+		return -1;
+	}
+	tail = r->tail;
+	avail = r->cached_head-tail;
+	if(avail<(unsigned int)max){
+		r->cached_head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		avail = r->cached_head-tail;
+	}
+	n = max;
+	if((unsigned int)n>avail) n=avail;
+	if(n==0) return 0;
+	start = tail&r->mask;
+	first = r->capacity-start;
+	if(first>(unsigned int)n) first=n;
+	memcpy(elems, r->d+start*r->elem_size, first*r->elem_size);
+	memcpy((char*)elems+first*r->elem_size, r->d, (n-first)*r->elem_size);
+	__atomic_store_n(&r->tail, tail+n, __ATOMIC_RELEASE);
+	return n;
+}
+
+/*******************************************************************************
+* int rc_spsc_ringbuf_count(rc_spsc_ringbuf_t* r)
+*
+* Returns the number of elements currently in the buffer. May be called from
+* either thread, but the other thread may change it immediately afterwards so
+* treat it as a snapshot.
+*******************************************************************************/
+int rc_spsc_ringbuf_count(rc_spsc_ringbuf_t* r){
+	unsigned int tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	unsigned int head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	return head-tail;
+}
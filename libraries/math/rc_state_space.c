@@ -0,0 +1,580 @@
+/*******************************************************************************
+* rc_state_space.c
+*
+* Discrete-time MIMO state-space systems x[k+1]=Ax+Bu, y=Cx+Du for controllers
+* and filters with more than one input or output. A, B, C and D are stored as
+* blocks of one matrix M=[C D; A B] and the state and input share one vector
+* z=[x; u], so each step is a single rc_gemv w=Mz giving w=[y; x[k+1]]. All of
+* that memory is allocated when the system is set up so rc_march_ss makes no
+* allocations.
+*
+* Each output can be saturated and soft started just like an rc_filter_t. To
+* keep the states from winding up while an output is held at its limit, the
+* difference between the saturated and unsaturated output is fed back to the
+* states through an anti-windup gain L, x[k+1]=Ax+Bu+L(y_sat-y). Systems made
+* from transfer functions with rc_ss_from_filters get the L that makes them
+* saturate exactly like the original rc_filter_t, which feeds its saturated
+* output back into the difference equation.
+*
+* Those systems are block diagonal, each filter only sees its own input and
+* states, so they also keep the offsets of every block and rc_march_ss steps
+* the blocks one at a time instead of running rc_gemv over all the zeros
+* between them.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+/*******************************************************************************
+* rc_ss_t rc_empty_ss()
+*
+* Returns an rc_ss_t with no allocated memory and the initialized flag set to
+* 0. Use this to initialize local systems before any other function.
+*******************************************************************************/
+rc_ss_t rc_empty_ss(){
+	rc_ss_t ss;
+	// zero-out piecemeal instead of with memset to avoid issues with padding
+	ss.nx			= 0;
+	ss.nu			= 0;
+	ss.ny			= 0;
+	ss.dt			= 0.0f;
+	ss.M			= rc_empty_matrix();
+	ss.A			= rc_empty_matrix();
+	ss.B			= rc_empty_matrix();
+	ss.C			= rc_empty_matrix();
+	ss.D			= rc_empty_matrix();
+	ss.L			= rc_empty_matrix();
+	ss.z			= rc_empty_vector();
+	ss.w			= rc_empty_vector();
+	ss.x			= rc_empty_vector();
+	ss.x_next		= rc_empty_vector();
+	ss.y			= rc_empty_vector();
+	ss.y_err		= rc_empty_vector();
+	ss.aw_en		= 0;
+	ss.sat_en		= 0;
+	ss.sat_min		= rc_empty_vector();
+	ss.sat_max		= rc_empty_vector();
+	ss.sat_flag		= NULL;
+	ss.ss_steps		= rc_empty_vector();
+	ss.blocks		= 0;
+	ss.blk_x		= NULL;
+	ss.step			= 0;
+	ss.initialized	= 0;
+	return ss;
+}
+
+/*******************************************************************************
+* int alloc_ss(rc_ss_t* ss, int nx, int nu, int ny, float dt, const char* fn)
+*
+* only for use in this file. Frees anything ss owned, then allocates the
+* stacked matrix and vectors for a system of the given size and points A, B,
+* C, D, x, x_next and y into them. Everything starts at zero with saturation
+* off.
+*******************************************************************************/
+static int alloc_ss(rc_ss_t* ss, int nx, int nu, int ny, real_t dt, const char* fn){
+	if(unlikely(nx<1 || nu<1 || ny<1)){
+		fprintf(stderr,"ERROR in %s, system must have at least one state, input and output\n", fn);
+		return -1;
+	}
+	if(unlikely(dt<=0.0f)){
+		fprintf(stderr,"ERROR in %s, dt must be >0\n", fn);
+		return -1;
+	}
+	rc_free_ss(ss);
+	if(unlikely(rc_matrix_zeros(&ss->M,ny+nx,nx+nu)	|| \
+				rc_matrix_zeros(&ss->L,nx,ny)		|| \
+				rc_vector_zeros(&ss->z,nx+nu)		|| \
+				rc_vector_zeros(&ss->w,ny+nx)		|| \
+				rc_vector_zeros(&ss->y_err,ny)		|| \
+				rc_alloc_vector(&ss->sat_min,ny)	|| \
+				rc_alloc_vector(&ss->sat_max,ny)	|| \
+				rc_vector_zeros(&ss->ss_steps,ny))){
+		fprintf(stderr,"ERROR in %s, failed to allocate memory\n", fn);
+		rc_free_ss(ss);
+		return -1;
+	}
+	// the system matrices are views of the blocks of M=[C D; A B]
+	rc_matrix_slice(ss->M,0,0,ny,nx,&ss->C);
+	rc_matrix_slice(ss->M,0,nx,ny,nu,&ss->D);
+	rc_matrix_slice(ss->M,ny,0,nx,nx,&ss->A);
+	rc_matrix_slice(ss->M,ny,nx,nx,nu,&ss->B);
+	// and the vectors point into z=[x; u] and w=[y; x_next]
+	ss->x.len = nx;
+	ss->x.d = ss->z.d;
+	ss->x.initialized = 1;
+	ss->y.len = ny;
+	ss->y.d = ss->w.d;
+	ss->y.initialized = 1;
+	ss->x_next.len = nx;
+	ss->x_next.d = ss->w.d+ny;
+	ss->x_next.initialized = 1;
+	ss->sat_flag = (int*)calloc(ny,sizeof(int));
+	if(unlikely(ss->sat_flag==NULL)){
+		fprintf(stderr,"ERROR in %s, failed to allocate memory\n", fn);
+		rc_free_ss(ss);
+		return -1;
+	}
+	ss->nx = nx;
+	ss->nu = nu;
+	ss->ny = ny;
+	ss->dt = dt;
+	ss->blocks = 1;
+	ss->initialized = 1;
+	rc_disable_ss_saturation(ss);
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_alloc_ss(rc_ss_t* ss, rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, rc_matrix_t D, float dt)
+*
+* Sets up ss as the system x[k+1]=Ax+Bu, y=Cx+Du with timestep dt in seconds.
+* D may be an empty matrix if the system has no feedthrough. The matrices are
+* copied so the originals may be freed afterwards. The state starts at zero
+* with saturation and anti-windup off. Any memory already owned by ss is freed
+* first. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_ss(rc_ss_t* ss, rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, rc_matrix_t D, real_t dt){
+	if(unlikely(ss==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_ss, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized || !B.initialized || !C.initialized)){
+		fprintf(stderr,"ERROR in rc_alloc_ss, A, B or C uninitialized\n");
+		return -1;
+	}
+	if(unlikely(A.cols!=A.rows || B.rows!=A.rows || C.cols!=A.rows || \
+			(D.initialized && (D.rows!=C.rows || D.cols!=B.cols)))){
+		fprintf(stderr,"ERROR in rc_alloc_ss, dimension mismatch\n");
+		return -1;
+	}
+	if(unlikely(alloc_ss(ss,A.rows,B.cols,C.rows,dt,"rc_alloc_ss"))) return -1;
+	rc_duplicate_matrix(A,&ss->A);
+	rc_duplicate_matrix(B,&ss->B);
+	rc_duplicate_matrix(C,&ss->C);
+	if(D.initialized) rc_duplicate_matrix(D,&ss->D);
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_ss(rc_ss_t* ss)
+*
+* Frees all memory owned by ss and resets it back to an empty struct.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_ss(rc_ss_t* ss){
+	if(unlikely(ss==NULL)){
+		fprintf(stderr,"ERROR in rc_free_ss, received NULL pointer\n");
+		return -1;
+	}
+	// A, B, C, D, x, x_next and y all point into M, z and w
+	rc_free_matrix(&ss->M);
+	rc_free_matrix(&ss->L);
+	rc_free_vector(&ss->z);
+	rc_free_vector(&ss->w);
+	rc_free_vector(&ss->y_err);
+	rc_free_vector(&ss->sat_min);
+	rc_free_vector(&ss->sat_max);
+	rc_free_vector(&ss->ss_steps);
+	free(ss->sat_flag);
+	free(ss->blk_x);
+	*ss = rc_empty_ss();
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_reset_ss(rc_ss_t* ss)
+*
+* Zeros the state, the last output and the saturation flags and sets the step
+* counter back to 0 so soft start begins again. The system matrices and
+* saturation settings are kept. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_reset_ss(rc_ss_t* ss){
+	int i;
+	if(unlikely(ss==NULL)){
+		fprintf(stderr,"ERROR in rc_reset_ss, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!ss->initialized)){
+		fprintf(stderr,"ERROR in rc_reset_ss, system uninitialized\n");
+		return -1;
+	}
+	for(i=0;i<ss->nx+ss->nu;i++) ss->z.d[i] = 0.0f;
+	for(i=0;i<ss->ny+ss->nx;i++) ss->w.d[i] = 0.0f;
+	for(i=0;i<ss->ny;i++){
+		ss->y_err.d[i] = 0.0f;
+		ss->sat_flag[i] = 0;
+	}
+	ss->step = 0;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_enable_ss_saturation(rc_ss_t* ss, int output, float min, float max)
+*
+* Limits output number 'output', counting from 0, to between min and max.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_enable_ss_saturation(rc_ss_t* ss, int output, real_t min, real_t max){
+	if(unlikely(ss==NULL)){
+		fprintf(stderr,"ERROR in rc_enable_ss_saturation, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!ss->initialized)){
+		fprintf(stderr,"ERROR in rc_enable_ss_saturation, system uninitialized\n");
+		return -1;
+	}
+	if(unlikely(output<0 || output>=ss->ny)){
+		fprintf(stderr,"ERROR in rc_enable_ss_saturation, output out of range\n");
+		return -1;
+	}
+	if(unlikely(min>=max)){
+		fprintf(stderr,"ERROR in rc_enable_ss_saturation, max must be > min\n");
+		return -1;
+	}
+	ss->sat_min.d[output] = min;
+	ss->sat_max.d[output] = max;
+	ss->sat_en = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_disable_ss_saturation(rc_ss_t* ss)
+*
+* Turns saturation and soft start off for every output.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_disable_ss_saturation(rc_ss_t* ss){
+	int i;
+	if(unlikely(ss==NULL)){
+		fprintf(stderr,"ERROR in rc_disable_ss_saturation, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!ss->initialized)){
+		fprintf(stderr,"ERROR in rc_disable_ss_saturation, system uninitialized\n");
+		return -1;
+	}
+	// -ffast-math assumes there are no infinities so use the largest float
+	for(i=0;i<ss->ny;i++){
+		ss->sat_min.d[i] = -REAL_MAX;
+		ss->sat_max.d[i] = REAL_MAX;
+		ss->ss_steps.d[i] = 0.0f;
+		ss->sat_flag[i] = 0;
+	}
+	ss->sat_en = 0;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_enable_ss_soft_start(rc_ss_t* ss, int output, float seconds)
+*
+* Ramps the saturation limits of one output up from zero over the given time
+* after each reset, the same as rc_enable_soft_start. Saturation must be
+* enabled on that output first. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_enable_ss_soft_start(rc_ss_t* ss, int output, real_t seconds){
+	if(unlikely(ss==NULL)){
+		fprintf(stderr,"ERROR in rc_enable_ss_soft_start, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!ss->initialized)){
+		fprintf(stderr,"ERROR in rc_enable_ss_soft_start, system uninitialized\n");
+		return -1;
+	}
+	if(unlikely(output<0 || output>=ss->ny)){
+		fprintf(stderr,"ERROR in rc_enable_ss_soft_start, output out of range\n");
+		return -1;
+	}
+	if(unlikely(seconds<=0.0f)){
+		fprintf(stderr,"ERROR in rc_enable_ss_soft_start, seconds must be >0\n");
+		return -1;
+	}
+	if(unlikely(ss->sat_max.d[output]==REAL_MAX)){
+		fprintf(stderr,"ERROR in rc_enable_ss_soft_start, saturation must be enabled first\n");
+		return -1;
+	}
+	ss->ss_steps.d[output] = seconds/ss->dt;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_set_ss_antiwindup(rc_ss_t* ss, rc_matrix_t L)
+*
+* Sets the nx by ny anti-windup gain L. Whenever an output is saturated its
+* clipped amount y_sat-y is fed back to the states through L. Pass an empty
+* matrix to turn anti-windup off. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_set_ss_antiwindup(rc_ss_t* ss, rc_matrix_t L){
+	if(unlikely(ss==NULL)){
+		fprintf(stderr,"ERROR in rc_set_ss_antiwindup, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!ss->initialized)){
+		fprintf(stderr,"ERROR in rc_set_ss_antiwindup, system uninitialized\n");
+		return -1;
+	}
+	if(!L.initialized){
+		ss->aw_en = 0;
+		return 0;
+	}
+	if(unlikely(L.rows!=ss->nx || L.cols!=ss->ny)){
+		fprintf(stderr,"ERROR in rc_set_ss_antiwindup, L must be %dx%d\n", ss->nx, ss->ny);
+		return -1;
+	}
+	rc_duplicate_matrix(L,&ss->L);
+	ss->aw_en = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* real_t saturate_output(rc_ss_t* ss, int i, real_t y, real_t step)
+*
+* only for use in this file. Applies soft start then saturation to output i in
+* the same order as rc_march_filter, sets its saturation flag and returns the
+* limited value. The limits are applied with conditional moves, which the
+* compiler turns into min and max instructions, so outputs that keep moving in
+* and out of their limits don't cost a mispredicted branch each.
+*******************************************************************************/
+static inline real_t saturate_output(rc_ss_t* ss, int i, real_t y, real_t step){
+	real_t frac, a, b;
+	const real_t hi = ss->sat_max.d[i];
+	const real_t lo = ss->sat_min.d[i];
+	// ss_steps is 0 when soft start is off so this never passes
+	if(step<ss->ss_steps.d[i]){
+		frac = step/ss->ss_steps.d[i];
+		a = hi*frac;
+		b = lo*frac;
+		y = y>a ? a : y;
+		y = y<b ? b : y;
+	}
+	ss->sat_flag[i] = (y>hi) | (y<lo);
+	y = y>hi ? hi : y;
+	return y<lo ? lo : y;
+}
+
+/*******************************************************************************
+* int march_blocks(rc_ss_t* ss, real_t* in, real_t* out)
+*
+* only for use in this file. Steps a block-diagonal system from
+* rc_ss_from_filters one block at a time, skipping the zeros between them.
+* Block b is one filter with input b, output b and states blk_x[b] up to
+* blk_x[b+1], so its output can be saturated and fed back to its own states
+* straight away and everything is done in one pass like rc_march_filter. The
+* loops only run one to a few times, too short for the vectorizer's setup to
+* ever pay off, so it is turned off here. Returns the number of outputs that
+* saturated.
+*******************************************************************************/
+__attribute__((optimize("no-tree-vectorize")))
+static int march_blocks(rc_ss_t* ss, real_t* in, real_t* out){
+	int b, r, j, x0, x1, saturated = 0;
+	real_t s, u, y, e;
+	const real_t* m;
+	const int nx = ss->nx;
+	const int ny = ss->ny;
+	const real_t step = ss->step;
+	real_t* z = ss->z.d;
+	real_t* w = ss->w.d;
+	for(b=0;b<ss->blocks;b++){
+		x0 = ss->blk_x[b];
+		x1 = ss->blk_x[b+1];
+		u = in[b];
+		z[nx+b] = u;
+		// output row b of [C D]
+		m = &AT(ss->M,b,0);
+		s = m[nx+b]*u;
+		for(j=x0;j<x1;j++) s += m[j]*z[j];
+		y = s;
+		if(ss->sat_en){
+			y = saturate_output(ss,b,s,step);
+			saturated += ss->sat_flag[b];
+		}
+		e = y-s;
+		ss->y_err.d[b] = e;
+		w[b] = y;
+		if(out!=NULL) out[b] = y;
+		// the block's rows of [A B] plus anti-windup, which is 0 unless clipped
+		if(!ss->aw_en) e = 0.0f;
+		for(r=x0;r<x1;r++){
+			m = &AT(ss->M,ny+r,0);
+			s = m[nx+b]*u + AT(ss->L,r,b)*e;
+			for(j=x0;j<x1;j++) s += m[j]*z[j];
+			w[ny+r] = s;
+		}
+		for(r=x0;r<x1;r++) z[r] = w[ny+r];
+	}
+	return saturated;
+}
+
+/*******************************************************************************
+* int rc_march_ss(rc_ss_t* ss, float* in, float* out)
+*
+* Steps the system forward once. in must hold nu inputs. The ny outputs,
+* after saturation, are written to out if it's not NULL and are also left in
+* ss->y. Makes no memory allocations. Returns the number of outputs that
+* saturated this step, or -1 on failure.
+*******************************************************************************/
+int rc_march_ss(rc_ss_t* ss, real_t* in, real_t* out){
+	int i, saturated = 0, clipped = 0;
+	real_t y;
+	if(unlikely(ss==NULL || in==NULL)){
+		fprintf(stderr,"ERROR in rc_march_ss, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!ss->initialized)){
+		fprintf(stderr,"ERROR in rc_march_ss, system uninitialized\n");
+		return -1;
+	}
+	// systems from rc_ss_from_filters step each filter's block on its own
+	if(ss->blocks>1){
+		saturated = march_blocks(ss,in,out);
+		ss->step++;
+		return saturated;
+	}
+	// [y; x_next] = [C D; A B][x; u] in one pass
+	memcpy(ss->z.d+ss->nx,in,ss->nu*sizeof(real_t));
+	rc_gemv(1.0f,ss->M,ss->z,0.0f,&ss->w);
+	// soft start then saturation
+	if(ss->sat_en){
+		for(i=0;i<ss->ny;i++){
+			y = saturate_output(ss,i,ss->y.d[i],ss->step);
+			saturated += ss->sat_flag[i];
+			ss->y_err.d[i] = y-ss->y.d[i];
+			if(ss->y_err.d[i]!=0.0f) clipped = 1;
+			ss->y.d[i] = y;
+		}
+	}
+	// anti-windup only matters once something was clipped
+	if(ss->aw_en && clipped) rc_gemv(1.0f,ss->L,ss->y_err,1.0f,&ss->x_next);
+	memcpy(ss->x.d,ss->x_next.d,ss->nx*sizeof(real_t));
+	if(out!=NULL) memcpy(out,ss->y.d,ss->ny*sizeof(real_t));
+	ss->step++;
+	return saturated;
+}
+
+/*******************************************************************************
+* int rc_ss_from_filters(rc_ss_t* ss, rc_filter_t* f, int n)
+*
+* Combines n SISO transfer functions into one system with n inputs and n
+* outputs where input i drives f[i] and output i is its output. Each filter
+* becomes a block in observer canonical form, with its gain folded in, and
+* brings its saturation and soft start settings to its output. The anti-windup
+* gain is set so a saturated output is fed back the same way rc_march_filter
+* feeds back its saturated output, so the system matches marching each filter
+* separately from reset. The offsets of each filter's block are kept so
+* rc_march_ss only steps the blocks. The new system starts at rest and the
+* filters themselves are not modified.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_ss_from_filters(rc_ss_t* ss, rc_filter_t* f, int n){
+	int i, k, nx, off, order, rel_deg;
+	real_t a0, b0, ai, bi, dt;
+	if(unlikely(ss==NULL || f==NULL)){
+		fprintf(stderr,"ERROR in rc_ss_from_filters, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(n<1)){
+		fprintf(stderr,"ERROR in rc_ss_from_filters, n must be >=1\n");
+		return -1;
+	}
+	// every filter needs at least one state so static gains still fit the
+	// same layout, they just get a state that stays at zero
+	nx = 0;
+	for(k=0;k<n;k++){
+		if(unlikely(!f[k].initialized)){
+			fprintf(stderr,"ERROR in rc_ss_from_filters, filter %d uninitialized\n", k);
+			return -1;
+		}
+		if(unlikely(f[k].ma_en)){
+			fprintf(stderr,"ERROR in rc_ss_from_filters, filter %d is a moving average\n", k);
+			return -1;
+		}
+		if(unlikely(f[k].dt!=f[0].dt)){
+			fprintf(stderr,"ERROR in rc_ss_from_filters, filters must have the same dt\n");
+			return -1;
+		}
+		nx += f[k].order>0 ? f[k].order : 1;
+	}
+	dt = f[0].dt;
+	if(unlikely(alloc_ss(ss,nx,n,n,dt,"rc_ss_from_filters"))) return -1;
+	ss->blk_x = (int*)malloc((n+1)*sizeof(int));
+	if(unlikely(ss->blk_x==NULL)){
+		fprintf(stderr,"ERROR in rc_ss_from_filters, failed to allocate memory\n");
+		rc_free_ss(ss);
+		return -1;
+	}
+	ss->blocks = n;
+	off = 0;
+	for(k=0;k<n;k++){
+		// filter k has input k, output k and the states from off onwards
+		ss->blk_x[k] = off;
+		order = f[k].order;
+		rel_deg = f[k].den.len-f[k].num.len;
+		a0 = f[k].den.d[0];
+		// numerator coefficient i with the leading zeros of a proper
+		// transfer function filled in, scaled by the gain and den[0]
+		#define NUM_COEF(i) (((i)<rel_deg) ? 0.0f : f[k].gain*f[k].num.d[(i)-rel_deg]/a0)
+		b0 = NUM_COEF(0);
+		AT(ss->D,k,k) = b0;
+		AT(ss->C,k,off) = 1.0f;
+		for(i=0;i<order;i++){
+			ai = f[k].den.d[i+1]/a0;
+			bi = NUM_COEF(i+1);
+			AT(ss->A,off+i,off) = -ai;
+			if(i<order-1) AT(ss->A,off+i,off+i+1) = 1.0f;
+			AT(ss->B,off+i,k) = bi-ai*b0;
+			// feeds back y_sat in place of y, exactly what the filter does
+			AT(ss->L,off+i,k) = -ai;
+		}
+		#undef NUM_COEF
+		if(f[k].sat_en){
+			rc_enable_ss_saturation(ss,k,f[k].sat_min,f[k].sat_max);
+			if(f[k].ss_en) ss->ss_steps.d[k] = f[k].ss_steps;
+		}
+		off += order>0 ? order : 1;
+	}
+	ss->blk_x[n] = nx;
+	ss->aw_en = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_ss_c2d_ws(rc_ss_t* ss, rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, rc_matrix_t D, float dt, rc_c2d_method_t method, rc_workspace_t* w)
+*
+* Sets up ss as the discretization of the continuous-time model x'=Ax+Bu,
+* y=Cx+Du with timestep dt using rc_c2d_ss_ws. If ss already has the same
+* dimensions the discrete matrices are written straight into its A, B, C and D
+* views and its state, saturation and anti-windup gain are kept, with soft
+* start rescaled to the new dt. Nothing is allocated in that case so the loop
+* rate can be changed while the system is running. A block-diagonal system
+* from rc_ss_from_filters becomes a dense one since the new matrices may couple
+* its blocks. Otherwise ss is allocated like rc_alloc_ss. Temporaries come from
+* workspace w.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_ss_c2d_ws(rc_ss_t* ss, rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, rc_matrix_t D, \
+			real_t dt, rc_c2d_method_t method, rc_workspace_t* w){
+	int i;
+	if(unlikely(ss==NULL)){
+		fprintf(stderr,"ERROR in rc_ss_c2d_ws, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(!A.initialized || !B.initialized || !C.initialized)){
+		fprintf(stderr,"ERROR in rc_ss_c2d_ws, A, B or C uninitialized\n");
+		return -1;
+	}
+	if(unlikely(dt<=0.0f)){
+		fprintf(stderr,"ERROR in rc_ss_c2d_ws, dt must be >0\n");
+		return -1;
+	}
+	if(ss->initialized && ss->nx==A.rows && ss->nu==B.cols && ss->ny==C.rows){
+		for(i=0;i<ss->ny;i++) ss->ss_steps.d[i] *= ss->dt/dt;
+		ss->dt = dt;
+		free(ss->blk_x);
+		ss->blk_x = NULL;
+		ss->blocks = 1;
+	}
+	else if(unlikely(alloc_ss(ss,A.rows,B.cols,C.rows,dt,"rc_ss_c2d_ws"))) return -1;
+	if(unlikely(rc_c2d_ss_ws(A,B,C,D,dt,method,&ss->A,&ss->B,&ss->C,&ss->D,w))){
+		fprintf(stderr,"ERROR in rc_ss_c2d_ws, failed to discretize\n");
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,292 @@
+/*******************************************************************************
+* rc_tdf2_filter.c
+*
+* Discrete SISO filters implemented in Transposed Direct Form II. These behave
+* like the rc_filter_t filters in rc_filter.c but keep a single flat state
+* vector instead of input and output ring buffers. Marching the filter is then
+* one multiply-accumulate sweep over contiguous memory with no function calls
+* or index wrapping per coefficient, which is what we want inside an IMU
+* interrupt routine.
+*******************************************************************************/
+
+#include "../roboticscape.h"
+#include "../preprocessor_macros.h"
+#include <stdio.h>
+#include <string.h> // for memset
+#include <stdlib.h>
+
+/*******************************************************************************
+* int rc_alloc_tdf2_filter(rc_tdf2_filter_t* f, rc_vector_t num, rc_vector_t den, float dt)
+*
+* Allocates memory for a TDF-II filter and populates it with the transfer
+* function coefficients provided in vectors num and den. Coefficients are
+* normalized by the leading denominator coefficient and the numerator is right
+* justified so filters with relative degree >=1 are handled just like
+* rc_alloc_filter. Coefficients and state live in a single allocation. Any
+* existing memory allocated for f is freed first.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_tdf2_filter(rc_tdf2_filter_t* f, rc_vector_t num, rc_vector_t den, float dt){
+	int i, n, rel_deg;
+	float* mem;
+	// sanity checks
+	if(unlikely(f==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_tdf2_filter, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(dt<=0.0f)){
+		fprintf(stderr,"ERROR in rc_alloc_tdf2_filter, dt must be >0\n");
+		return -1;
+	}
+	if(unlikely(!num.initialized||!den.initialized)){
+		fprintf(stderr,"ERROR in rc_alloc_tdf2_filter, vector uninitialized\n");
+		return -1;
+	}
+	if(unlikely(num.len>den.len)){
+		fprintf(stderr,"ERROR in rc_alloc_tdf2_filter, improper transfer function\n");
+		return -1;
+	}
+	if(unlikely(den.d[0]==0.0f)){
+		fprintf(stderr,"ERROR in rc_alloc_tdf2_filter, first coefficient in denominator is 0\n");
+		return -1;
+	}
+	// free existing memory, this also zeros out all fields
+	rc_free_tdf2_filter(f);
+	n = den.len-1;
+	// one block holds b[n+1], a[n+1], and the state s[n+1]. The last state
+	// entry is always zero so the march loop needs no special case at the end
+	mem = (float*)calloc(3*(n+1),sizeof(float));
+	if(unlikely(mem==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_tdf2_filter, failed to allocate memory\n");
+		return -1;
+	}
+	f->b = mem;
+	f->a = mem+(n+1);
+	f->s = mem+2*(n+1);
+	// normalize and right-justify the numerator
+	rel_deg = den.len-num.len;
+	for(i=0;i<num.len;i++) f->b[i+rel_deg] = num.d[i]/den.d[0];
+	for(i=0;i<=n;i++) f->a[i] = den.d[i]/den.d[0];
+	// populate remaining values, everything else zero'd by rc_free_tdf2_filter
+	f->order = n;
+	f->dt = dt;
+	f->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_tdf2_filter_from_filter(rc_tdf2_filter_t* t, rc_filter_t f)
+*
+* Builds a TDF-II filter with the same transfer function, gain, saturation and
+* soft start settings as an existing rc_filter_t. This lets any of the filter
+* design functions such as rc_pid_filter or rc_butterworth_lowpass be used to
+* create a TDF-II filter. The state of f is not copied, t starts out reset.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_tdf2_filter_from_filter(rc_tdf2_filter_t* t, rc_filter_t f){
+	if(unlikely(!f.initialized)){
+		fprintf(stderr,"ERROR in rc_tdf2_filter_from_filter, filter uninitialized\n");
+		return -1;
+	}
+	if(unlikely(f.ma_en)){
+		fprintf(stderr,"ERROR in rc_tdf2_filter_from_filter, moving averages are not supported\n");
+		return -1;
+	}
+	if(unlikely(rc_alloc_tdf2_filter(t,f.num,f.den,f.dt))){
+		fprintf(stderr,"ERROR in rc_tdf2_filter_from_filter, failed to alloc filter\n");
+		return -1;
+	}
+	t->gain		= f.gain;
+	t->sat_en	= f.sat_en;
+	t->sat_min	= f.sat_min;
+	t->sat_max	= f.sat_max;
+	t->ss_en	= f.ss_en;
+	t->ss_steps	= f.ss_steps;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_tdf2_filter(rc_tdf2_filter_t* f)
+*
+* Frees the memory allocated for the filter's coefficients and state. Also
+* resets all filter properties back to 0. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_tdf2_filter(rc_tdf2_filter_t* f){
+	if(unlikely(f==NULL)){
+		fprintf(stderr,"ERROR in rc_free_tdf2_filter, received NULL pointer\n");
+		return -1;
+	}
+	// b is the start of the single block holding coefficients and state
+	if(f->initialized) free(f->b);
+	*f = rc_empty_tdf2_filter();
+	return 0;
+}
+
+/*******************************************************************************
+* rc_tdf2_filter_t rc_empty_tdf2_filter()
+*
+* Returns an rc_tdf2_filter_t with no allocated memory and the initialized flag
+* set to 0. Serves the same purpose as rc_empty_filter and should be used to
+* initialize local rc_tdf2_filter_t structs before any other function.
+*******************************************************************************/
+rc_tdf2_filter_t rc_empty_tdf2_filter(){
+	rc_tdf2_filter_t f;
+	f.order			= 0;
+	f.dt			= 0.0f;
+	f.gain			= 1.0f;
+	f.b				= NULL;
+	f.a				= NULL;
+	f.s				= NULL;
+	f.sat_en		= 0;
+	f.sat_min		= 0.0f;
+	f.sat_max		= 0.0f;
+	f.sat_flag		= 0;
+	f.ss_en			= 0;
+	f.ss_steps		= 0;
+	f.newest_input	= 0.0f;
+	f.newest_output	= 0.0f;
+	f.step			= 0;
+	f.initialized	= 0;
+	return f;
+}
+
+/*******************************************************************************
+* float rc_march_tdf2_filter(rc_tdf2_filter_t* f, float new_input)
+*
+* March the filter forward one step with new input provided as an argument and
+* return the new output. Saturation and soft start behave exactly like they do
+* in rc_march_filter, and the saturated output is what gets fed back into the
+* state so the two forms produce the same sequence of outputs. Gain is applied
+* to the input as it enters the state, so changing the gain affects only
+* subsequent inputs.
+*******************************************************************************/
+float rc_march_tdf2_filter(rc_tdf2_filter_t* f, float new_input){
+	int i;
+	float x, y;
+	float* __restrict__ s;
+	const float* __restrict__ b;
+	const float* __restrict__ a;
+	// sanity checks
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_march_tdf2_filter, filter uninitialized\n");
+		return -1.0f;
+	}
+	s = f->s;
+	b = f->b;
+	a = f->a;
+	x = f->gain*new_input;
+	y = b[0]*x + s[0];
+	// soft start limits
+	if(f->ss_en && f->step<f->ss_steps){
+		float lim_max=f->sat_max*(f->step/f->ss_steps);
+		float lim_min=f->sat_min*(f->step/f->ss_steps);
+		if(y>lim_max) y=lim_max;
+		if(y<lim_min) y=lim_min;
+	}
+	// saturate and set flag
+	if(f->sat_en){
+		if(y>f->sat_max){
+			y=f->sat_max;
+			f->sat_flag=1;
+		}
+		else if(y<f->sat_min){
+			y=f->sat_min;
+			f->sat_flag=1;
+		}
+		else f->sat_flag=0;
+	}
+	// update the state with the bounded output. s[order] is always zero
+	for(i=0;i<f->order;i++) s[i] = s[i+1] + b[i+1]*x - a[i+1]*y;
+	f->newest_input = new_input;
+	f->newest_output = y;
+	f->step++;
+	return y;
+}
+
+/*******************************************************************************
+* int rc_reset_tdf2_filter(rc_tdf2_filter_t* f)
+*
+* Zeros the filter state and resets the step counter and saturation flag.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_reset_tdf2_filter(rc_tdf2_filter_t* f){
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_reset_tdf2_filter, filter uninitialized\n");
+		return -1;
+	}
+	memset(f->s,0,(f->order+1)*sizeof(float));
+	f->newest_input = 0.0f;
+	f->newest_output = 0.0f;
+	f->sat_flag = 0;
+	f->step = 0;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_enable_tdf2_saturation(rc_tdf2_filter_t* f, float min, float max)
+*
+* Bounds the filter output between min and max, same as rc_enable_saturation.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_enable_tdf2_saturation(rc_tdf2_filter_t* f, float min, float max){
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_enable_tdf2_saturation, filter uninitialized\n");
+		return -1;
+	}
+	if(unlikely(min>=max)){
+		fprintf(stderr,"ERROR in rc_enable_tdf2_saturation, max must be > min\n");
+		return -1;
+	}
+	f->sat_en	= 1;
+	f->sat_min	= min;
+	f->sat_max	= max;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_enable_tdf2_soft_start(rc_tdf2_filter_t* f, float seconds)
+*
+* Same as rc_enable_soft_start but for TDF-II filters. Saturation must already
+* be enabled. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_enable_tdf2_soft_start(rc_tdf2_filter_t* f, float seconds){
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_enable_tdf2_soft_start, filter uninitialized\n");
+		return -1;
+	}
+	if(unlikely(seconds<=0.0f)){
+		fprintf(stderr,"ERROR in rc_enable_tdf2_soft_start, seconds must be >=0\n");
+		return -1;
+	}
+	if(unlikely(!f->sat_en)){
+		fprintf(stderr,"ERROR in rc_enable_tdf2_soft_start, saturation must be enabled first\n");
+		return -1;
+	}
+	f->ss_en	= 1;
+	f->ss_steps	= seconds/f->dt;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_prefill_tdf2_filter(rc_tdf2_filter_t* f, float in, float out)
+*
+* Sets the state as if all previous inputs had been 'in' and all previous
+* outputs had been 'out'. This is the TDF-II equivalent of calling both
+* rc_prefill_filter_inputs and rc_prefill_filter_outputs on an rc_filter_t.
+* Since the state mixes inputs and outputs they cannot be prefilled separately.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_prefill_tdf2_filter(rc_tdf2_filter_t* f, float in, float out){
+	int i;
+	float x;
+	if(unlikely(!f->initialized)){
+		fprintf(stderr,"ERROR in rc_prefill_tdf2_filter, filter uninitialized\n");
+		return -1;
+	}
+	x = f->gain*in;
+	// work backwards from the always-zero last entry
+	for(i=f->order-1;i>=0;i--) f->s[i] = f->s[i+1] + f->b[i+1]*x - f->a[i+1]*out;
+	f->newest_input = in;
+	f->newest_output = out;
+	return 0;
+}
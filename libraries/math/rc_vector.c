@@ -32,7 +32,7 @@ int rc_alloc_vector(rc_vector_t* v, int length){
 	// free any old memory 
 	rc_free_vector(v);
 	// allocate contiguous memory for the vector
-	v->d = (float*)malloc(length*sizeof(float));
+	v->d = (real_t*)malloc(length*sizeof(real_t));
 	if(unlikely(v->d==NULL)){
 		fprintf(stderr,"ERROR in rc_alloc_vector, not enough memory\n");
 		return -1;
@@ -102,7 +102,7 @@ int rc_vector_zeros(rc_vector_t* v, int length){
 	// free any old memory 
 	rc_free_vector(v);
 	// allocate contiguous zeroed-out memory for the vector
-	v->d = (float*)calloc(length,sizeof(float));
+	v->d = (real_t*)calloc(length,sizeof(real_t));
 	if(unlikely(v->d==NULL)){
 		fprintf(stderr,"ERROR in rc_vector_zeros, not enough memory\n");
 		return -1;
@@ -177,7 +177,7 @@ int rc_vector_fibonnaci(rc_vector_t* v, int length){
 * ensures v is sized correctly. Existing data in v (if any) is freed and lost.
 * Returns 0 on success or -1 on failure.
 *******************************************************************************/
-int rc_vector_from_array(rc_vector_t* v, float* ptr, int length){
+int rc_vector_from_array(rc_vector_t* v, real_t* ptr, int length){
 	// sanity check pointer
 	if(unlikely(ptr==NULL)){
 		fprintf(stderr,"ERROR in rc_vector_from_array, received NULL pointer\n");
@@ -189,7 +189,7 @@ int rc_vector_from_array(rc_vector_t* v, float* ptr, int length){
 		return -1;
 	}
 	// duplicate memory over
-	memcpy(v->d, ptr, length*sizeof(float));
+	memcpy(v->d, ptr, length*sizeof(real_t));
 	return 0;
 }
 
@@ -215,7 +215,7 @@ int rc_duplicate_vector(rc_vector_t a, rc_vector_t* b){
 		return -1;
 	}
 	// copy memory over
-	memcpy(b->d, a.d, a.len*sizeof(float));
+	memcpy(b->d, a.d, a.len*sizeof(real_t));
 	return 0;
 }
 
@@ -238,7 +238,7 @@ int rc_duplicate_vector(rc_vector_t a, rc_vector_t* b){
 * by the function. 
 * Returns 0 on success or -1 on error.
 *******************************************************************************/
-int rc_set_vector_entry(rc_vector_t* v, int pos, float val){
+int rc_set_vector_entry(rc_vector_t* v, int pos, real_t val){
 	if(unlikely(v==NULL)){
 		fprintf(stderr,"ERROR in rc_set_vector_entry, received NULL pointer\n");
 		return -1;
@@ -268,7 +268,7 @@ int rc_set_vector_entry(rc_vector_t* v, int pos, float val){
 * However, we provide this function for completeness. It also provides sanity
 * checks to avoid possible segfaults.
 *******************************************************************************/
-float rc_get_vector_entry(rc_vector_t v, int pos){
+real_t rc_get_vector_entry(rc_vector_t v, int pos){
 	if(unlikely(!v.initialized)){
 		fprintf(stderr,"ERROR in rc_get_vector_entry, v not initialized yet\n");
 		return -1.0f;
@@ -330,7 +330,7 @@ int rc_print_vector_sci(rc_vector_t v){
 * by the function.
 * Returns 0 on success or -1 on failure.
 *******************************************************************************/
-int rc_vector_times_scalar(rc_vector_t* v, float s){
+int rc_vector_times_scalar(rc_vector_t* v, real_t s){
 	int i;
 	if(unlikely(!v->initialized)){
 		fprintf(stderr,"ERROR in rc_vector_times_scalar, vector uninitialized\n");
@@ -350,8 +350,8 @@ int rc_vector_times_scalar(rc_vector_t* v, float s){
 * 2-norm which is the square root of sum of squares.
 * for infinity and -infinity norms see vector_max and vector_min
 *******************************************************************************/
-float rc_vector_norm(rc_vector_t v, float p){
-	float norm = 0.0f;
+real_t rc_vector_norm(rc_vector_t v, real_t p){
+	real_t norm = 0.0f;
 	int i;
 	if(unlikely(!v.initialized)){
 		fprintf(stderr,"ERROR in rc_vector_norm, vector not initialized yet\n");
@@ -387,7 +387,7 @@ float rc_vector_norm(rc_vector_t v, float p){
 int rc_vector_max(rc_vector_t v){
 	int i;
 	int index = 0;
-	float tmp = -FLT_MAX;
+	real_t tmp = -REAL_MAX;
 	if(unlikely(!v.initialized)){
 		fprintf(stderr,"ERROR in rc_vector_max, vector not initialized yet\n");
 		return -1;
@@ -412,7 +412,7 @@ int rc_vector_max(rc_vector_t v){
 int rc_vector_min(rc_vector_t v){
 	int i;
 	int index = 0;
-	float tmp = FLT_MAX;
+	real_t tmp = REAL_MAX;
 	if(unlikely(!v.initialized)){
 		fprintf(stderr,"ERROR in rc_vector_min, vector not initialized yet\n");
 		return -1;
@@ -431,9 +431,9 @@ int rc_vector_min(rc_vector_t v){
 *
 * Returns the standard deviation of the values in a vector or -1.0f on failure.
 *******************************************************************************/
-float rc_std_dev(rc_vector_t v){
+real_t rc_std_dev(rc_vector_t v){
 	int i;
-	float mean, mean_sqr, diff;
+	real_t mean, mean_sqr, diff;
 	if(unlikely(!v.initialized)){
 		fprintf(stderr,"ERROR in rc_std_dev, vector not initialized yet\n");
 		return -1.0f;
@@ -443,14 +443,14 @@ float rc_std_dev(rc_vector_t v){
 	// calculate mean
 	mean = 0.0f;
 	for(i=0;i<v.len;i++) mean+=v.d[i];
-	mean = mean/(float)v.len;
+	mean = mean/(real_t)v.len;
 	// calculate mean square
 	mean_sqr = 0.0f;
 	for(i=0;i<v.len;i++){
 		diff = v.d[i]-mean;
 		mean_sqr += diff*diff;
 	}
-	return sqrt(mean_sqr/(float)v.len);
+	return sqrt(mean_sqr/(real_t)v.len);
 }
 
 /*******************************************************************************
@@ -458,16 +458,16 @@ float rc_std_dev(rc_vector_t v){
 *
 * Returns the mean (average) of all values in vector v or -1.0f on error.
 *******************************************************************************/
-float rc_vector_mean(rc_vector_t v){
+real_t rc_vector_mean(rc_vector_t v){
 	int i;
-	float sum = 0.0f;
+	real_t sum = 0.0f;
 	if(unlikely(!v.initialized)){
 		fprintf(stderr,"ERROR in rc_vector_mean, vector not initialized yet\n");
 		return -1.0f;
 	}
 	// calculate mean
 	for(i=0;i<v.len;i++) sum+=v.d[i];
-	return sum/(float)v.len;
+	return sum/(real_t)v.len;
 }
 
 /*******************************************************************************
@@ -478,7 +478,7 @@ float rc_vector_mean(rc_vector_t v){
 *******************************************************************************/
 int rc_vector_projection(rc_vector_t v, rc_vector_t e, rc_vector_t* p){
 	int i;
-	float factor;
+	real_t factor;
 	// sanity checks
 	if(unlikely(!v.initialized || !e.initialized)){
 		fprintf(stderr,"ERROR in rc_vector_projection, received uninitialized vector\n");
@@ -503,7 +503,7 @@ int rc_vector_projection(rc_vector_t v, rc_vector_t e, rc_vector_t* p){
 * Returns the dot product of two equal-length vectors or floating-point -1.0f
 * on error.
 *******************************************************************************/
-float rc_vector_dot_product(rc_vector_t v1, rc_vector_t v2){
+real_t rc_vector_dot_product(rc_vector_t v1, rc_vector_t v2){
 	if(unlikely(!v1.initialized || !v2.initialized)){
 		fprintf(stderr,"ERROR in rc_vector_dot_product, vector uninitialized\n");
 		return -1.0f;
@@ -536,9 +536,9 @@ int rc_vector_outer_product(rc_vector_t v1, rc_vector_t v2, rc_matrix_t* A){
 	// in the rows of 'out' in the inner loop so writes are continuous. Both the
 	// vectors are contiguous in memory and are just interpreted as a row or
 	// column vector.
-	for(j=0;j<v2.len;j++){
-		for(i=0;i<v1.len;i++){
-			A->d[j][i] = v1.d[i]*v2.d[j];
+	for(i=0;i<v1.len;i++){
+		for(j=0;j<v2.len;j++){
+			AT(*A,i,j) = v1.d[i]*v2.d[j];
 		}
 	}
 	return 0;
@@ -0,0 +1,159 @@
+/*******************************************************************************
+* rc_workspace.c
+*
+* Bump allocator for the temporaries used inside the linear algebra functions.
+* One block is allocated up front and handed out front to back, each request
+* rounded up to a cache line. Releasing memory is just moving the bump pointer
+* back to an earlier mark, so the _ws variants of the decompositions save the
+* mark on entry and rewind to it on exit and never call malloc or free. The
+* block never grows: a request that doesn't fit fails. The high water mark is
+* kept so the block can be sized from a trial run.
+*******************************************************************************/
+
+#include "rc_algebra_common.h"
+
+// the allocator itself doesn't depend on the value type so rc_workspace_double.c
+// only builds rc_workspace_matrix_d on top of the functions below
+#ifndef RC_DOUBLE
+
+// every request starts on its own cache line, same as the gemm packing buffers
+#define WORKSPACE_ALIGN 64
+
+/*******************************************************************************
+* rc_workspace_t rc_empty_workspace()
+*
+* Returns an rc_workspace_t with no allocated memory and the initialized flag
+* set to 0. Use this to initialize local workspaces before any other function.
+*******************************************************************************/
+rc_workspace_t rc_empty_workspace(){
+	rc_workspace_t out;
+	// zero-out piecemeal instead of with memset to avoid issues with padding
+	out.mem			= NULL;
+	out.size		= 0;
+	out.used		= 0;
+	out.peak		= 0;
+	out.initialized	= 0;
+	return out;
+}
+
+/*******************************************************************************
+* int rc_alloc_workspace(rc_workspace_t* w, size_t bytes)
+*
+* Allocates a block of at least the given number of bytes for w, rounded up to
+* a whole number of cache lines. If w already has a block that big nothing is
+* done and anything currently handed out stays valid. Otherwise the old block
+* is freed first. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_alloc_workspace(rc_workspace_t* w, size_t bytes){
+	void* ptr;
+	if(unlikely(w==NULL)){
+		fprintf(stderr,"ERROR in rc_alloc_workspace, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(bytes<1)){
+		fprintf(stderr,"ERROR in rc_alloc_workspace, bytes must be >=1\n");
+		return -1;
+	}
+	bytes = (bytes+WORKSPACE_ALIGN-1) & ~(size_t)(WORKSPACE_ALIGN-1);
+	if(w->initialized && w->size>=bytes) return 0;
+	rc_free_workspace(w);
+	if(unlikely(posix_memalign(&ptr, WORKSPACE_ALIGN, bytes))){
+		fprintf(stderr,"ERROR in rc_alloc_workspace, not enough memory\n");
+		return -1;
+	}
+	w->mem = (char*)ptr;
+	w->size = bytes;
+	w->used = 0;
+	w->initialized = 1;
+	return 0;
+}
+
+/*******************************************************************************
+* int rc_free_workspace(rc_workspace_t* w)
+*
+* Frees the block owned by w and resets it back to an empty struct. Any
+* matrices or pointers handed out from w are invalid afterwards.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_free_workspace(rc_workspace_t* w){
+	if(unlikely(w==NULL)){
+		fprintf(stderr,"ERROR in rc_free_workspace, received NULL pointer\n");
+		return -1;
+	}
+	if(w->initialized) free(w->mem);
+	*w = rc_empty_workspace();
+	return 0;
+}
+
+/*******************************************************************************
+* void* rc_workspace_push(rc_workspace_t* w, size_t bytes)
+*
+* Hands out the next bytes of w aligned to a cache line. The memory stays
+* valid until w is rewound to a mark taken before this call. Returns NULL if w
+* is uninitialized or doesn't have enough room left. w->peak is raised to
+* cover the request either way.
+*******************************************************************************/
+void* rc_workspace_push(rc_workspace_t* w, size_t bytes){
+	void* ptr;
+	size_t end;
+	if(unlikely(w==NULL)){
+		fprintf(stderr,"ERROR in rc_workspace_push, received NULL pointer\n");
+		return NULL;
+	}
+	end = w->used + ((bytes+WORKSPACE_ALIGN-1) & ~(size_t)(WORKSPACE_ALIGN-1));
+	if(end>w->peak) w->peak = end;
+	if(unlikely(!w->initialized || end>w->size)){
+		fprintf(stderr,"ERROR in rc_workspace_push, workspace too small, need at least %zu bytes\n", end);
+		return NULL;
+	}
+	ptr = w->mem + w->used;
+	w->used = end;
+	return ptr;
+}
+
+/*******************************************************************************
+* int rc_workspace_rewind(rc_workspace_t* w, size_t mark)
+*
+* Releases everything handed out from w since w->used was equal to mark. Pass
+* 0 to release everything. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_workspace_rewind(rc_workspace_t* w, size_t mark){
+	if(unlikely(w==NULL)){
+		fprintf(stderr,"ERROR in rc_workspace_rewind, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(mark>w->used)){
+		fprintf(stderr,"ERROR in rc_workspace_rewind, mark is past what has been used\n");
+		return -1;
+	}
+	w->used = mark;
+	return 0;
+}
+
+#endif // RC_DOUBLE
+
+/*******************************************************************************
+* int rc_workspace_matrix(rc_workspace_t* w, rc_matrix_t* M, int rows, int cols)
+*
+* Makes M a dense rows-by-cols view of memory taken from w. Since M is a view
+* it is safe to pass to rc_free_matrix, which does nothing, and every library
+* function that writes its output through rc_alloc_matrix will use it in place.
+* The contents are not initialized. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int rc_workspace_matrix(rc_workspace_t* w, rc_matrix_t* M, int rows, int cols){
+	real_t* ptr;
+	if(unlikely(M==NULL)){
+		fprintf(stderr,"ERROR in rc_workspace_matrix, received NULL pointer\n");
+		return -1;
+	}
+	if(unlikely(rows<1 || cols<1)){
+		fprintf(stderr,"ERROR in rc_workspace_matrix, rows and cols must be >=1\n");
+		return -1;
+	}
+	ptr = (real_t*)rc_workspace_push(w, (size_t)rows*cols*sizeof(real_t));
+	if(unlikely(ptr==NULL)){
+		fprintf(stderr,"ERROR in rc_workspace_matrix, failed to get memory from workspace\n");
+		return -1;
+	}
+	return rc_matrix_view(M,ptr,rows,cols,cols);
+}
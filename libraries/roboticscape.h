@@ -19,6 +19,9 @@
 
 // necessary types for function prototypes
 #include <stdint.h> // for uint8_t types etc
+#include <math.h> // for sqrtf in the fixed-size inline functions
+#include <stdio.h> // for fprintf in the fixed-size inverses
+#include <stddef.h> // for size_t
 typedef struct timespec	timespec;
 typedef struct timeval timeval;
 
@@ -1290,6 +1293,15 @@ const char* rc_version_string();
 * new vector or matrix. Then use rc_free_vector and rc_free_matrix to free the
 * memory when you are done using it. See the remaining vector, matrix, and
 * linear algebra functions for more details.
+*
+* Matrix entries are stored row-major from the base pointer 'data' with entry
+* (i,j) at data[i*row_stride + j*col_stride]. Matrices made by rc_alloc_matrix
+* own a dense block and also provide row pointers so A.d[i][j] works as it
+* always has. Views made with rc_matrix_view, rc_matrix_slice and
+* rc_matrix_transpose_view share memory with something else, have no row
+* pointers, and should be indexed with the RC_MATRIX_ENTRY macro. All the
+* vector, matrix and linear algebra functions accept views anywhere a matrix is
+* read, and write straight into a view passed as an output of the right size.
 *******************************************************************************/
 // vector type
 typedef struct rc_vector_t{
@@ -1302,10 +1314,17 @@ typedef struct rc_vector_t{
 typedef struct rc_matrix_t{
 	int rows;
 	int cols;
-	float** d;
+	float** d;			// row pointers, NULL for views
 	int initialized;
+	float* data;		// address of entry (0,0)
+	int row_stride;		// distance in floats from one row to the next
+	int col_stride;		// distance in floats from one column to the next
 } rc_matrix_t;
 
+// entry (row,col) of any matrix including views, can be assigned to
+#define RC_MATRIX_ENTRY(A,row,col) \
+	((A).data[(row)*(A).row_stride + (col)*(A).col_stride])
+
 /*******************************************************************************
 * Vectors
 *
@@ -1534,7 +1553,8 @@ int   rc_vector_sum_inplace(rc_vector_t* v1, rc_vector_t v2);
 * is preserved. If A is uninitialized or of the wrong size then any existing
 * memory is freed and new memory is allocated, helping to prevent accidental
 * memory leaks. The contents of the new matrix is not guaranteed to be anything
-* in particular.
+* in particular. A view of the right size is also left as it is, so functions
+* which allocate their output through here will write straight into a view.
 * Returns 0 on success, otherwise -1. Will only be unsuccessful if 
 * rows&cols are invalid or there is insufficient memory available.
 *
@@ -1544,6 +1564,8 @@ int   rc_vector_sum_inplace(rc_vector_t* v1, rc_vector_t v2);
 * and initialized flag of the rc_matrix_t struct to 0 to indicate to other
 * functions that A no longer points to allocated memory and cannot be used until
 * more memory is allocated such as with rc_alloc_matrix or rc_matrix_zeros.
+* Views don't own their memory so freeing one just empties the struct and leaves
+* the matrix it was taken from untouched.
 * Returns 0 on success. Will only fail and return -1 if it is passed a NULL
 * pointer.
 *
@@ -1560,7 +1582,8 @@ int   rc_vector_sum_inplace(rc_vector_t* v1, rc_vector_t v2);
 *
 * Resizes matrix A and allocates memory for a matrix with specified rows &
 * columns. The new memory is pre-filled with zeros. Any existing memory 
-* allocated for A is freed if necessary to avoid memory leaks.
+* allocated for A is freed if necessary to avoid memory leaks. If A is already
+* the right size, including a view, it is zeroed in place instead.
 * Returns 0 on success or -1 on error.
 *
 * @ int rc_identity_matrix(rc_matrix_t* A, int dim)
@@ -1589,7 +1612,8 @@ int   rc_vector_sum_inplace(rc_vector_t* v1, rc_vector_t v2);
 * Makes a duplicate of the data from matrix A and places into matrix B. If B is
 * already the right size then its contents are overwritten. If B is unallocated
 * or is of the wrong size then the memory is freed if necessary and new memory
-* is allocated to hold the duplicate of A.
+* is allocated to hold the duplicate of A. Either matrix may be a view, which
+* makes this the way to copy data into or out of part of another matrix.
 * Returns 0 on success or -1 on error.
 *
 * @ int rc_set_matrix_entry(rc_matrix_t* A, int row, int col, float val)
@@ -1600,6 +1624,8 @@ int   rc_vector_sum_inplace(rc_vector_t* v1, rc_vector_t v2);
 *
 * A.d[row][col]=val;
 *
+* or RC_MATRIX_ENTRY(A,row,col)=val; if A may be a view.
+*
 * However, we provide this function for completeness. It is not strictly
 * necessary for A to be provided as a pointer since a copy of the struct A
 * would also contain the correct pointer to the original matrix's allocated 
@@ -1617,6 +1643,8 @@ int   rc_vector_sum_inplace(rc_vector_t* v1, rc_vector_t v2);
 *
 * val = A.d[row][col];
 *
+* or val = RC_MATRIX_ENTRY(A,row,col); if A may be a view.
+*
 * However, we provide this function for completeness. It also provides sanity
 * checks to avoid possible segfaults.
 *
@@ -1645,18 +1673,22 @@ int   rc_vector_sum_inplace(rc_vector_t* v1, rc_vector_t v2);
 * @ int rc_multiply_matrices(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C)
 *
 * Multiplies A*B=C. C is resized and its original contents are freed if 
-* necessary to avoid memory leaks. Returns 0 on success or -1 on failure.
+* necessary to avoid memory leaks. Apart from very small products this uses the
+* cache-blocked kernel in rc_gemm.c, so C must not share memory with A or
+* B. Returns 0 on success or -1 on failure.
 *
 * @ int rc_left_multiply_matrix_inplace(rc_matrix_t A, rc_matrix_t* B)
 *
 * Multiplies A*B and puts the result back in the place of B. B is resized and
-* its original contents are freed if necessary to avoid memory leaks.
+* its original contents are freed if necessary to avoid memory leaks. If B is a
+* view and the result is the same size, it is written back through the view.
 * Returns 0 on success or -1 on failure.
 *
 * @ int rc_right_multiply_matrix_inplace(rc_matrix_t* A, rc_matrix_t B)
 *
 * Multiplies A*B and puts the result back in the place of A. A is resized and
-* its original contents are freed if necessary to avoid memory leaks.
+* its original contents are freed if necessary to avoid memory leaks. If A is a
+* view and the result is the same size, it is written back through the view.
 * Returns 0 on success or -1 on failure.
 *
 * @ int rc_add_matrices(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C)
@@ -1679,7 +1711,35 @@ int   rc_vector_sum_inplace(rc_vector_t* v1, rc_vector_t v2);
 * @ int rc_matrix_transpose_inplace(rc_matrix_t* A)
 *
 * Transposes matrix A in place. Use as an alternative to rc_matrix_transpose
-* if you no longer have need for the original contents of matrix A.
+* if you no longer have need for the original contents of matrix A. Square
+* matrices are transposed by swapping entries without allocating. Views must be
+* square since their shape is fixed by the matrix they were taken from.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_matrix_view(rc_matrix_t* V, float* data, int rows, int cols, int row_stride)
+*
+* Makes V a rows-by-cols matrix over memory the caller already has, such as a
+* static array, without allocating or copying anything. Entry (i,j) lives at
+* data[i*row_stride+j] so row_stride must be at least cols. Views have no row
+* pointers (V->d is NULL), use RC_MATRIX_ENTRY to index them. Any memory owned
+* by V is not freed, so only pass an empty matrix or another view.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_matrix_slice(rc_matrix_t A, int row, int col, int rows, int cols, rc_matrix_t* S)
+*
+* Makes S a view of the rows-by-cols block of A whose top left entry is
+* A(row,col). S shares A's memory so writing to S writes to A, and S must not
+* be used after A is freed. A may itself be a view, including a transposed one.
+* Any memory owned by S is not freed, so only pass an empty matrix or another
+* view. Returns 0 on success or -1 on failure.
+*
+* @ int rc_matrix_transpose_view(rc_matrix_t A, rc_matrix_t* T)
+*
+* Makes T a view of the transpose of A by swapping the dimensions and strides,
+* no data is moved. Rows of a transposed view are not contiguous so it is best
+* used as the right hand argument of rc_multiply_matrices or copied with
+* rc_duplicate_matrix when it will be read many times. Any memory owned by T is
+* not freed, so only pass an empty matrix or another view.
 * Returns 0 on success or -1 on failure.
 *******************************************************************************/
 int   rc_alloc_matrix(rc_matrix_t* A, int rows, int cols);
@@ -1702,6 +1762,9 @@ int   rc_add_matrices(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C);
 int   rc_add_matrices_inplace(rc_matrix_t* A, rc_matrix_t B);
 int   rc_matrix_transpose(rc_matrix_t A, rc_matrix_t* T);
 int   rc_matrix_transpose_inplace(rc_matrix_t* A);
+int   rc_matrix_view(rc_matrix_t* V, float* data, int rows, int cols, int row_stride);
+int   rc_matrix_slice(rc_matrix_t A, int row, int col, int rows, int cols, rc_matrix_t* S);
+int   rc_matrix_transpose_view(rc_matrix_t A, rc_matrix_t* T);
 
 /*******************************************************************************
 * Linear Algebra
@@ -1735,7 +1798,9 @@ int   rc_matrix_transpose_inplace(rc_matrix_t* A);
 *
 * @ int rc_qr_decomp(rc_matrix_t A, rc_matrix_t* Q, rc_matrix_t* R)
 *
-* Uses householder reflection method to find the QR decomposition of A.
+* Uses householder reflection method to find the QR decomposition of A. The
+* compact factorization from rc_qr_factor is formed into full Q and R here,
+* use rc_qr_factor directly if Q isn't actually needed.
 * Returns 0 on success or -1 on failure.
 *
 * @ int rc_invert_matrix(rc_matrix_t A, rc_matrix_t* Ainv)
@@ -1761,7 +1826,8 @@ int   rc_matrix_transpose_inplace(rc_matrix_t* A);
 * @ int rc_lin_system_solve_qr(rc_matrix_t A, rc_vector_t b, rc_vector_t* x)
 *
 * Finds a least-squares solution to the system Ax=b for non-square A using QR
-* decomposition method and places the solution in x. 
+* decomposition method and places the solution in x. A must have at least as
+* many rows as columns. Q is never formed, see rc_qr_solve.
 * Returns 0 on success or -1 on failure.
 *
 * @ int rc_fit_ellipsoid(rc_matrix_t pts, rc_vector_t* ctr, rc_vector_t* lens)
@@ -1794,6 +1860,483 @@ int   rc_lin_system_solve(rc_matrix_t A, rc_vector_t b, rc_vector_t* x);
 int   rc_lin_system_solve_qr(rc_matrix_t A, rc_vector_t b, rc_vector_t* x);
 int   rc_fit_ellipsoid(rc_matrix_t pts, rc_vector_t* ctr, rc_vector_t* lens);
 
+/*******************************************************************************
+* LU Factorization
+*
+* rc_lup_decomp and rc_lin_system_solve start from scratch on every call. When
+* the same matrix is solved against many times, factor it once into an rc_lu_t
+* and reuse that. The factors are packed into one square matrix, unit lower
+* triangular L below the diagonal and U on and above it, with the row swaps
+* kept as an index array. Memory is only allocated when a matrix of a new size
+* is factored so none of these functions touch the heap in steady state.
+*
+* @ rc_lu_t rc_empty_lu()
+*
+* Returns an rc_lu_t with no allocated memory and the initialized flag set to
+* 0. Use this to initialize local rc_lu_t structs before any other function.
+*
+* @ int rc_alloc_lu(rc_lu_t* f, int n)
+*
+* Allocates memory for the factorization of an n-by-n matrix. If f is already
+* the right size nothing is done. This is called automatically by
+* rc_lu_factor, calling it first just moves the allocation out of the loop.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_free_lu(rc_lu_t* f)
+*
+* Frees the memory allocated for the factorization and resets f back to an
+* empty struct. Returns 0 on success or -1 on failure.
+*
+* @ int rc_lu_factor(rc_matrix_t A, rc_lu_t* f)
+*
+* Factors square matrix A into PA=LU with partial pivoting and stores the
+* result in f. A is left untouched and may be a view. f is allocated on the
+* first call or if the size of A changes, otherwise no memory is allocated.
+* Returns 0 on success or -1 on failure, including when A is singular.
+*
+* @ int rc_lu_solve(rc_lu_t f, rc_vector_t b, rc_vector_t* x)
+*
+* Solves Ax=b using the factorization of A in f. x is only allocated if it is
+* not already the right length and may be the same vector as b.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_lu_solve_matrix(rc_lu_t f, rc_matrix_t B, rc_matrix_t* X)
+*
+* Solves AX=B for every column of B at once using the factorization of A in f.
+* X is only allocated if it is not already the right size. Either may be a view
+* and X may be the same matrix as B. Returns 0 on success or -1 on failure.
+*
+* @ float rc_lu_determinant(rc_lu_t f)
+*
+* Returns the determinant of the factored matrix, the product of the diagonal
+* of U with the sign flipped for every row swap, or -1.0f on failure.
+*
+* @ int rc_lu_invert(rc_lu_t f, rc_matrix_t* Ainv)
+*
+* Computes the inverse of the factored matrix one column at a time and places
+* it in Ainv, which is only allocated if it is not already the right size and
+* may be a view. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+typedef struct rc_lu_t{
+	int n;				// dimension of the factored matrix
+	rc_matrix_t LU;		// L below the diagonal, U on and above it
+	int* piv;			// row k was swapped with row piv[k] at step k
+	int factored;		// set once rc_lu_factor succeeds
+	int initialized;	// set once memory has been allocated
+} rc_lu_t;
+
+rc_lu_t rc_empty_lu();
+int   rc_alloc_lu(rc_lu_t* f, int n);
+int   rc_free_lu(rc_lu_t* f);
+int   rc_lu_factor(rc_matrix_t A, rc_lu_t* f);
+int   rc_lu_solve(rc_lu_t f, rc_vector_t b, rc_vector_t* x);
+int   rc_lu_solve_matrix(rc_lu_t f, rc_matrix_t B, rc_matrix_t* X);
+float rc_lu_determinant(rc_lu_t f);
+int   rc_lu_invert(rc_lu_t f, rc_matrix_t* Ainv);
+
+/*******************************************************************************
+* Cholesky and LDL' Factorizations
+*
+* Covariance matrices and the normal equations of least-squares problems are
+* symmetric positive definite. Cholesky (A=LL') and LDL' factorizations use
+* that symmetry to factor in half the work of LUP with no pivoting. Both work
+* in place on an rc_matrix_t, which may be a view. Only the lower triangle of A
+* is read, and afterwards A holds L with its upper triangle zeroed. For LDL'
+* the unit diagonal of L is implied and D sits on the diagonal instead. The
+* rank-1 update and downdate functions modify an existing factor in O(n^2)
+* instead of refactoring the modified matrix from scratch.
+*
+* @ int rc_cholesky_decomp(rc_matrix_t* A)
+*
+* Factors symmetric positive definite matrix A into LL' in place. On success A
+* holds lower triangular L. Returns 0 on success or -1 on failure. If A is not
+* positive definite -1 is returned and A is left partially factored.
+*
+* @ int rc_cholesky_solve(rc_matrix_t L, rc_vector_t b, rc_vector_t* x)
+*
+* Solves Ax=b where L is the Cholesky factor of A from rc_cholesky_decomp.
+* x is only allocated if it is not already the right length and may be the
+* same vector as b. Returns 0 on success or -1 on failure.
+*
+* @ int rc_cholesky_solve_matrix(rc_matrix_t L, rc_matrix_t B, rc_matrix_t* X)
+*
+* Solves AX=B for every column of B where L is the Cholesky factor of A.
+* X is only allocated if it is not already the right size. Either may be a view
+* and X may be the same matrix as B. Returns 0 on success or -1 on failure.
+*
+* @ int rc_cholesky_update(rc_matrix_t* L, rc_vector_t v)
+* @ int rc_cholesky_downdate(rc_matrix_t* L, rc_vector_t v)
+*
+* Modifies Cholesky factor L of A in place so it becomes the factor of A+vv'
+* or A-vv' respectively. Returns 0 on success or -1 on failure. If A-vv' would
+* not be positive definite the downdate returns -1 and leaves L untouched.
+*
+* @ float rc_cholesky_log_det(rc_matrix_t L)
+*
+* Returns the natural log of the determinant of A=LL'. This stays finite for
+* large and badly scaled covariances where the determinant itself would
+* overflow or underflow. Returns -1.0f on failure.
+*
+* @ int rc_ldl_decomp(rc_matrix_t* A)
+*
+* Factors symmetric matrix A into LDL' in place. No square roots are taken and
+* D may have negative entries, but there is no pivoting so every leading
+* submatrix of A must be nonsingular as it is for positive definite matrices.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_ldl_solve(rc_matrix_t LD, rc_vector_t b, rc_vector_t* x)
+* @ int rc_ldl_solve_matrix(rc_matrix_t LD, rc_matrix_t B, rc_matrix_t* X)
+*
+* Same as the Cholesky solves but using an LDL' factorization from
+* rc_ldl_decomp. Returns 0 on success or -1 on failure.
+*
+* @ int rc_ldl_update(rc_matrix_t* LD, rc_vector_t v)
+* @ int rc_ldl_downdate(rc_matrix_t* LD, rc_vector_t v)
+*
+* Modifies LDL' factorization LD of A in place so it becomes the factorization
+* of A+vv' or A-vv' respectively. A must be positive definite for the
+* downdate, which returns -1 and leaves LD untouched if A-vv' would not be.
+* Returns 0 on success or -1 on failure.
+*
+* @ float rc_ldl_log_det(rc_matrix_t LD)
+*
+* Returns the natural log of the determinant of positive definite A=LDL', or
+* -1.0f on failure.
+*******************************************************************************/
+int   rc_cholesky_decomp(rc_matrix_t* A);
+int   rc_cholesky_solve(rc_matrix_t L, rc_vector_t b, rc_vector_t* x);
+int   rc_cholesky_solve_matrix(rc_matrix_t L, rc_matrix_t B, rc_matrix_t* X);
+int   rc_cholesky_update(rc_matrix_t* L, rc_vector_t v);
+int   rc_cholesky_downdate(rc_matrix_t* L, rc_vector_t v);
+float rc_cholesky_log_det(rc_matrix_t L);
+int   rc_ldl_decomp(rc_matrix_t* A);
+int   rc_ldl_solve(rc_matrix_t LD, rc_vector_t b, rc_vector_t* x);
+int   rc_ldl_solve_matrix(rc_matrix_t LD, rc_matrix_t B, rc_matrix_t* X);
+int   rc_ldl_update(rc_matrix_t* LD, rc_vector_t v);
+int   rc_ldl_downdate(rc_matrix_t* LD, rc_vector_t v);
+float rc_ldl_log_det(rc_matrix_t LD);
+
+/*******************************************************************************
+* QR Factorization
+*
+* Compact Householder QR. Each reflection H=I-tau*v*v' is kept as its vector v
+* below the diagonal of the column it zeroed, with the leading 1 implied and
+* tau kept in a separate array, while R sits on and above the diagonal. This is
+* the same layout as LAPACK's geqrf. No Householder matrices are ever built and
+* Q is only formed when asked for, so least-squares problems can be solved
+* without the O(m^3) cost of Q. Like rc_lu_t the memory is only allocated when a
+* matrix of a new size is factored.
+*
+* @ rc_qr_t rc_empty_qr()
+*
+* Returns an rc_qr_t with no allocated memory and the initialized flag set to
+* 0. Use this to initialize local rc_qr_t structs before any other function.
+*
+* @ int rc_alloc_qr(rc_qr_t* f, int rows, int cols)
+*
+* Allocates memory for the factorization of a rows-by-cols matrix. If f is
+* already the right size nothing is done. Returns 0 on success or -1 on failure.
+*
+* @ int rc_free_qr(rc_qr_t* f)
+*
+* Frees the memory allocated for the factorization and resets f back to an
+* empty struct. Returns 0 on success or -1 on failure.
+*
+* @ int rc_qr_factor(rc_matrix_t A, rc_qr_t* f)
+*
+* Factors A into QR and stores the compact result in f. A may be any shape and
+* may be a view, it is left untouched. To factor without copying, allocate f
+* with rc_alloc_qr, fill in f->QR and pass f->QR as A.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_qr_solve(rc_qr_t f, rc_vector_t b, rc_vector_t* x)
+*
+* Finds the least-squares solution x minimizing norm(Ax-b) using the
+* factorization of A in f. A must have at least as many rows as columns and
+* full column rank. The reflections are applied directly to a copy of b so Q is
+* never formed. x is only allocated if it is not already the right length.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_qr_get_q(rc_qr_t f, rc_matrix_t* Q)
+*
+* Forms the full square orthogonal matrix Q. Q is only allocated if it is not
+* already the right size and may be a view. Returns 0 on success or -1 on
+* failure.
+*
+* @ int rc_qr_get_r(rc_qr_t f, rc_matrix_t* R)
+*
+* Copies the upper triangular factor R, the same size as the factored matrix,
+* out of f. R is only allocated if it is not already the right size and may be
+* a view. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+typedef struct rc_qr_t{
+	int rows;			// rows of the factored matrix
+	int cols;			// columns of the factored matrix
+	rc_matrix_t QR;		// R on and above the diagonal, reflectors below it
+	float* tau;			// scale of each reflector, min(rows,cols) long
+	int factored;		// set once rc_qr_factor succeeds
+	int initialized;	// set once memory has been allocated
+} rc_qr_t;
+
+rc_qr_t rc_empty_qr();
+int   rc_alloc_qr(rc_qr_t* f, int rows, int cols);
+int   rc_free_qr(rc_qr_t* f);
+int   rc_qr_factor(rc_matrix_t A, rc_qr_t* f);
+int   rc_qr_solve(rc_qr_t f, rc_vector_t b, rc_vector_t* x);
+int   rc_qr_get_q(rc_qr_t f, rc_matrix_t* Q);
+int   rc_qr_get_r(rc_qr_t f, rc_matrix_t* R);
+
+/*******************************************************************************
+* Eigenvalues and Singular Value Decomposition
+*
+* Jacobi methods for the symmetric eigenvalue problem and the SVD. These are
+* meant for the small matrices seen on board such as covariances, inertia
+* tensors and the 3x3 to 12x12 systems used for PCA, condition number checks
+* and pseudo-inverses. All working memory lives in the rc_eig_t and rc_svd_t
+* structs and is only allocated when a matrix of a new size is passed in, so
+* repeated calls inside a control loop don't touch the heap.
+*
+* @ rc_eig_t rc_empty_eig()
+* @ rc_svd_t rc_empty_svd()
+*
+* Return structs with no allocated memory and the initialized flag set to 0.
+* Use these to initialize local structs before any other function.
+*
+* @ int rc_alloc_eig(rc_eig_t* e, int n)
+* @ int rc_alloc_svd(rc_svd_t* d, int rows, int cols)
+*
+* Allocate memory for decomposing a matrix of the given size. Nothing is done
+* if the struct is already the right size. This is done automatically by
+* rc_eig_symmetric and rc_svd_decomp, calling these first just moves the
+* allocation out of the loop. Return 0 on success or -1 on failure.
+*
+* @ int rc_free_eig(rc_eig_t* e)
+* @ int rc_free_svd(rc_svd_t* d)
+*
+* Free the allocated memory and reset the struct back to empty.
+* Return 0 on success or -1 on failure.
+*
+* @ int rc_eig_symmetric(rc_matrix_t A, rc_eig_t* e)
+*
+* Finds the eigenvalues and eigenvectors of symmetric matrix A with the cyclic
+* Jacobi method. Only the lower triangle of A is read and A may be a view. The
+* eigenvalues are placed in e->values in descending order and the matching
+* unit eigenvectors in the columns of e->vectors so that A=V*diag(values)*V'.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_svd_decomp(rc_matrix_t A, rc_svd_t* d)
+*
+* Finds the thin singular value decomposition A=U*diag(S)*V' of any m-by-n
+* matrix A with the one-sided Jacobi method. With k=min(m,n), U is m-by-k, S
+* holds the k singular values in descending order and V is n-by-k. A may be a
+* view. Columns of U for singular values that are exactly zero are left as
+* zeros. The condition number of A is S.d[0]/S.d[k-1].
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_svd_pinv(rc_svd_t d, rc_matrix_t* Ainv)
+*
+* Forms the Moore-Penrose pseudo-inverse of the decomposed matrix. Singular
+* values below max(rows,cols)*S[0]*FLT_EPSILON are treated as zero, the same
+* default tolerance as MATLAB's pinv. Ainv is only allocated if it is not
+* already the right size and may be a view. Returns 0 on success or -1 on
+* failure.
+*******************************************************************************/
+typedef struct rc_eig_t{
+	int n;					// dimension of the decomposed matrix
+	rc_vector_t values;		// eigenvalues in descending order
+	rc_matrix_t vectors;	// unit eigenvectors in matching columns
+	rc_matrix_t work;		// working copy of the matrix
+	int sweeps;				// Jacobi sweeps taken by the last call
+	int initialized;		// set once memory has been allocated
+} rc_eig_t;
+
+typedef struct rc_svd_t{
+	int rows;			// rows of the decomposed matrix
+	int cols;			// columns of the decomposed matrix
+	rc_matrix_t U;		// rows x min(rows,cols) left singular vectors
+	rc_vector_t S;		// singular values in descending order
+	rc_matrix_t V;		// cols x min(rows,cols) right singular vectors
+	int sweeps;			// Jacobi sweeps taken by the last call
+	int initialized;	// set once memory has been allocated
+} rc_svd_t;
+
+rc_eig_t rc_empty_eig();
+int   rc_alloc_eig(rc_eig_t* e, int n);
+int   rc_free_eig(rc_eig_t* e);
+int   rc_eig_symmetric(rc_matrix_t A, rc_eig_t* e);
+rc_svd_t rc_empty_svd();
+int   rc_alloc_svd(rc_svd_t* d, int rows, int cols);
+int   rc_free_svd(rc_svd_t* d);
+int   rc_svd_decomp(rc_matrix_t A, rc_svd_t* d);
+int   rc_svd_pinv(rc_svd_t d, rc_matrix_t* Ainv);
+
+/*******************************************************************************
+* Linear Algebra Workspace
+*
+* rc_lup_decomp, rc_invert_matrix, rc_left_multiply_matrix_inplace,
+* rc_qr_decomp and rc_fit_ellipsoid malloc and free their temporaries on every
+* call, which is fine in setup code but causes allocator jitter in a real-time
+* loop. An rc_workspace_t is a single block allocated once up front that the
+* _ws variants of those functions carve their temporaries out of with a bump
+* pointer. Each one rewinds the workspace to where it found it before
+* returning, so one workspace can be shared by any number of calls. When their
+* outputs are already the right size they never touch the heap.
+*
+* The workspace never grows, a call that runs out of room just fails. w.peak
+* keeps the most bytes ever in use at once, so the simplest way to size a
+* workspace is to make the calls once with a generous one and read w.peak.
+* Roughly, a function needs a little more than the size of the temporary
+* matrices it would otherwise allocate, plus the rc_gemm packing buffer for
+* products bigger than 8x8x8.
+*
+* @ rc_workspace_t rc_empty_workspace()
+*
+* Returns an rc_workspace_t with no allocated memory and the initialized flag
+* set to 0. Use this to initialize local workspaces before any other function.
+*
+* @ int rc_alloc_workspace(rc_workspace_t* w, size_t bytes)
+*
+* Allocates a block of at least the given number of bytes for w. If w already
+* has a block that big nothing is done. Returns 0 on success or -1 on failure.
+*
+* @ int rc_free_workspace(rc_workspace_t* w)
+*
+* Frees the block owned by w and resets it back to an empty struct. Returns 0
+* on success or -1 on failure.
+*
+* @ void* rc_workspace_push(rc_workspace_t* w, size_t bytes)
+* @ int rc_workspace_rewind(rc_workspace_t* w, size_t mark)
+*
+* rc_workspace_push hands out the next bytes of w aligned to a cache line, or
+* returns NULL if there isn't enough room left. Save w->used as a mark before
+* pushing and pass it to rc_workspace_rewind to release everything pushed
+* since, or pass 0 to release everything.
+*
+* @ int rc_workspace_matrix(rc_workspace_t* w, rc_matrix_t* M, int rows, int cols)
+*
+* Makes M a dense rows-by-cols view of memory pushed onto w. Being a view it
+* can be used as the output of any function that allocates through
+* rc_alloc_matrix and rc_free_matrix does nothing to it.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_lup_decomp_ws(rc_matrix_t A, rc_matrix_t* L, rc_matrix_t* U, rc_matrix_t* P, rc_workspace_t* w)
+* @ int rc_invert_matrix_ws(rc_matrix_t A, rc_matrix_t* Ainv, rc_workspace_t* w)
+* @ int rc_multiply_matrices_ws(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C, rc_workspace_t* w)
+* @ int rc_left_multiply_matrix_inplace_ws(rc_matrix_t A, rc_matrix_t* B, rc_workspace_t* w)
+* @ int rc_qr_decomp_ws(rc_matrix_t A, rc_matrix_t* Q, rc_matrix_t* R, rc_workspace_t* w)
+* @ int rc_fit_ellipsoid_ws(rc_matrix_t pts, rc_vector_t* ctr, rc_vector_t* lens, rc_workspace_t* w)
+*
+* Same as the functions without _ws but all temporaries are taken from w.
+* Outputs are only allocated if they are not already the right size and may be
+* views. rc_invert_matrix_ws uses the packed LU factorization of rc_lu_factor
+* rather than building L, U and P. rc_left_multiply_matrix_inplace_ws copies
+* the product back into B so B is only reallocated if A is not square.
+* Return 0 on success or -1 on failure.
+*******************************************************************************/
+typedef struct rc_workspace_t{
+	char* mem;			// start of the block
+	size_t size;		// size of the block in bytes
+	size_t used;		// bytes currently handed out
+	size_t peak;		// most bytes ever needed at once, including failed pushes
+	int initialized;	// set once memory has been allocated
+} rc_workspace_t;
+
+rc_workspace_t rc_empty_workspace();
+int   rc_alloc_workspace(rc_workspace_t* w, size_t bytes);
+int   rc_free_workspace(rc_workspace_t* w);
+void* rc_workspace_push(rc_workspace_t* w, size_t bytes);
+int   rc_workspace_rewind(rc_workspace_t* w, size_t mark);
+int   rc_workspace_matrix(rc_workspace_t* w, rc_matrix_t* M, int rows, int cols);
+int   rc_lup_decomp_ws(rc_matrix_t A, rc_matrix_t* L, rc_matrix_t* U, rc_matrix_t* P, rc_workspace_t* w);
+int   rc_invert_matrix_ws(rc_matrix_t A, rc_matrix_t* Ainv, rc_workspace_t* w);
+int   rc_multiply_matrices_ws(rc_matrix_t A, rc_matrix_t B, rc_matrix_t* C, rc_workspace_t* w);
+int   rc_left_multiply_matrix_inplace_ws(rc_matrix_t A, rc_matrix_t* B, rc_workspace_t* w);
+int   rc_qr_decomp_ws(rc_matrix_t A, rc_matrix_t* Q, rc_matrix_t* R, rc_workspace_t* w);
+int   rc_fit_ellipsoid_ws(rc_matrix_t pts, rc_vector_t* ctr, rc_vector_t* lens, rc_workspace_t* w);
+
+/*******************************************************************************
+* BLAS Level 2 Kernels
+*
+* In-place matrix-vector kernels for update loops such as state-space models,
+* observers and filters. None of these allocate memory: every output must
+* already be allocated with the right dimensions and is updated where it is,
+* so a chain of them can replace several calls that each make a new vector or
+* matrix. Inputs and outputs may be views but an output must not share memory
+* with any input. When beta is 0 the old contents of the output are never read.
+* To scale a vector or matrix in place use rc_vector_times_scalar or
+* rc_matrix_times_scalar.
+*
+* @ int rc_gemv(float alpha, rc_matrix_t A, rc_vector_t x, float beta, rc_vector_t* y)
+*
+* Computes y=alpha*A*x+beta*y. y must have A.rows entries.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_gemv_transpose(float alpha, rc_matrix_t A, rc_vector_t x, float beta, rc_vector_t* y)
+*
+* Computes y=alpha*A'*x+beta*y without forming A'. y must have A.cols entries.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_axpy(float alpha, rc_vector_t x, rc_vector_t* y)
+*
+* Computes y=alpha*x+y. Returns 0 on success or -1 on failure.
+*
+* @ int rc_ger(float alpha, rc_vector_t x, rc_vector_t y, rc_matrix_t* A)
+*
+* Rank-1 update A=A+alpha*x*y'. A must be x.len by y.len.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_syrk(float alpha, rc_matrix_t A, float beta, rc_matrix_t* C)
+*
+* Symmetric rank-k update C=alpha*A*A'+beta*C where C is square with A.rows
+* rows. Only the lower triangle of C is read and the result is written to both
+* triangles so C stays exactly symmetric. Pass rc_matrix_transpose_view of A to
+* get alpha*A'*A+beta*C. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+int   rc_gemv(float alpha, rc_matrix_t A, rc_vector_t x, float beta, rc_vector_t* y);
+int   rc_gemv_transpose(float alpha, rc_matrix_t A, rc_vector_t x, float beta, rc_vector_t* y);
+int   rc_axpy(float alpha, rc_vector_t x, rc_vector_t* y);
+int   rc_ger(float alpha, rc_vector_t x, rc_vector_t y, rc_matrix_t* A);
+int   rc_syrk(float alpha, rc_matrix_t A, float beta, rc_matrix_t* C);
+
+/*******************************************************************************
+* Matrix Exponential and Discretization
+*
+* Exact conversion of continuous-time models to discrete time. The matrix
+* exponential uses a (6,6) Pade approximant with scaling and squaring, and the
+* hold equivalents come from exponentiating a single block matrix, so unlike
+* Tustin's method the discrete poles are exactly e^(p*dt) at any sample rate.
+* These take every temporary from an rc_workspace_t and write into outputs
+* that are already the right size, so a controller can be re-discretized from
+* the control loop when its rate changes without touching the heap. Also built
+* in double as rc_expm_ws_d and rc_c2d_ss_ws_d. Transfer functions are
+* discretized with rc_c2d_ws in the Discrete SISO Filters section and
+* state-space systems with rc_ss_c2d_ws.
+*
+* @ int rc_expm_ws(rc_matrix_t A, rc_matrix_t* E, rc_workspace_t* w)
+*
+* Computes the matrix exponential E=e^A. E is only allocated if it is not
+* already the right size, may be a view, and must not share memory with A.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_c2d_ss_ws(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, rc_matrix_t D, float dt, rc_c2d_method_t method, rc_matrix_t* Ad, rc_matrix_t* Bd, rc_matrix_t* Cd, rc_matrix_t* Dd, rc_workspace_t* w)
+*
+* Discretizes x'=Ax+Bu, y=Cx+Du with timestep dt in seconds. RC_C2D_ZOH holds
+* the input constant over each step and RC_C2D_FOH interpolates it linearly
+* between samples, which adds a feedthrough term to Dd. RC_C2D_MATCHED is only
+* defined for SISO transfer functions and is rejected here. D may be an empty
+* matrix for no feedthrough. Outputs are only allocated if they are not
+* already the right size and may be views. Returns 0 on success or -1 on
+* failure.
+*******************************************************************************/
+typedef enum rc_c2d_method_t{
+	RC_C2D_ZOH,		// zero-order hold, input constant between samples
+	RC_C2D_FOH,		// first-order hold, input linear between samples
+	RC_C2D_MATCHED	// matched pole-zero, transfer functions only
+} rc_c2d_method_t;
+
+int   rc_expm_ws(rc_matrix_t A, rc_matrix_t* E, rc_workspace_t* w);
+int   rc_c2d_ss_ws(rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, rc_matrix_t D, float dt, rc_c2d_method_t method, rc_matrix_t* Ad, rc_matrix_t* Bd, rc_matrix_t* Cd, rc_matrix_t* Dd, rc_workspace_t* w);
+
 
 /*******************************************************************************
 * polynomial Manipulation
@@ -1873,6 +2416,224 @@ int rc_poly_differentiate(rc_vector_t a, int d, rc_vector_t* b);
 int rc_poly_divide(rc_vector_t n, rc_vector_t d, rc_vector_t* div, rc_vector_t* rem);
 int rc_poly_butter(int N, float wc, rc_vector_t* b);
 
+/*******************************************************************************
+* Double Precision Linear Algebra
+*
+* Every vector, matrix, factorization and polynomial function above is also
+* built in double precision under the same name with a _d suffix, taking and
+* returning the _d types below in place of their float counterparts. Both sets
+* are compiled from the same source so they always behave identically, see
+* math/rc_real.h. The double types have the same fields as the float ones so
+* RC_MATRIX_ENTRY and row pointers work the same way, and rc_workspace_t is
+* shared between the two. Note that rc_gemm only has hand written SIMD kernels
+* for float on x86, and the NEON unit on the BeagleBone doesn't support double
+* at all, so double is best kept for the places that need it: badly
+* conditioned solves, high order polynomials and long running covariance
+* updates. Run
+* rc_benchmark_algebra -p to see the cost on your own hardware.
+*
+* @ int rc_vector_float_to_double(rc_vector_t v, rc_vector_d_t* out)
+* @ int rc_vector_double_to_float(rc_vector_d_t v, rc_vector_t* out)
+*
+* Copies v into out converting each entry. out is only allocated if it is not
+* already the right length. Returns 0 on success or -1 on failure.
+*
+* @ int rc_matrix_float_to_double(rc_matrix_t A, rc_matrix_d_t* out)
+* @ int rc_matrix_double_to_float(rc_matrix_d_t A, rc_matrix_t* out)
+*
+* Copies A into out converting each entry. A may be a view. out is only
+* allocated if it is not already the right size and may be a view.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+typedef struct rc_vector_d_t{
+	int len;
+	double* d;
+	int initialized;
+} rc_vector_d_t;
+
+typedef struct rc_matrix_d_t{
+	int rows;
+	int cols;
+	double** d;			// row pointers, NULL for views
+	int initialized;
+	double* data;		// address of entry (0,0)
+	int row_stride;		// distance in doubles from one row to the next
+	int col_stride;		// distance in doubles from one column to the next
+} rc_matrix_d_t;
+
+typedef struct rc_lu_d_t{
+	int n;				// dimension of the factored matrix
+	rc_matrix_d_t LU;	// L below the diagonal, U on and above it
+	int* piv;			// row k was swapped with row piv[k] at step k
+	int factored;		// set once rc_lu_factor_d succeeds
+	int initialized;	// set once memory has been allocated
+} rc_lu_d_t;
+
+typedef struct rc_qr_d_t{
+	int rows;			// rows of the factored matrix
+	int cols;			// columns of the factored matrix
+	rc_matrix_d_t QR;	// R on and above the diagonal, reflectors below it
+	double* tau;		// scale of each reflector, min(rows,cols) long
+	int factored;		// set once rc_qr_factor_d succeeds
+	int initialized;	// set once memory has been allocated
+} rc_qr_d_t;
+
+typedef struct rc_eig_d_t{
+	int n;					// dimension of the decomposed matrix
+	rc_vector_d_t values;	// eigenvalues in descending order
+	rc_matrix_d_t vectors;	// unit eigenvectors in matching columns
+	rc_matrix_d_t work;		// working copy of the matrix
+	int sweeps;				// Jacobi sweeps taken by the last call
+	int initialized;		// set once memory has been allocated
+} rc_eig_d_t;
+
+typedef struct rc_svd_d_t{
+	int rows;			// rows of the decomposed matrix
+	int cols;			// columns of the decomposed matrix
+	rc_matrix_d_t U;	// rows x min(rows,cols) left singular vectors
+	rc_vector_d_t S;	// singular values in descending order
+	rc_matrix_d_t V;	// cols x min(rows,cols) right singular vectors
+	int sweeps;			// Jacobi sweeps taken by the last call
+	int initialized;	// set once memory has been allocated
+} rc_svd_d_t;
+
+int   rc_vector_float_to_double(rc_vector_t v, rc_vector_d_t* out);
+int   rc_vector_double_to_float(rc_vector_d_t v, rc_vector_t* out);
+int   rc_matrix_float_to_double(rc_matrix_t A, rc_matrix_d_t* out);
+int   rc_matrix_double_to_float(rc_matrix_d_t A, rc_matrix_t* out);
+
+int   rc_alloc_vector_d(rc_vector_d_t* v, int length);
+int   rc_free_vector_d(rc_vector_d_t* v);
+rc_vector_d_t rc_empty_vector_d();
+int   rc_vector_zeros_d(rc_vector_d_t* v, int length);
+int   rc_vector_ones_d(rc_vector_d_t* v, int length);
+int   rc_random_vector_d(rc_vector_d_t* v, int length);
+int   rc_vector_fibonnaci_d(rc_vector_d_t* v, int length);
+int   rc_vector_from_array_d(rc_vector_d_t* v, double* ptr, int length);
+int   rc_duplicate_vector_d(rc_vector_d_t a, rc_vector_d_t* b);
+int   rc_set_vector_entry_d(rc_vector_d_t* v, int pos, double val);
+double rc_get_vector_entry_d(rc_vector_d_t v, int pos);
+int   rc_print_vector_d(rc_vector_d_t v);
+int   rc_print_vector_sci_d(rc_vector_d_t v);
+int   rc_vector_times_scalar_d(rc_vector_d_t* v, double s);
+double rc_vector_norm_d(rc_vector_d_t v, double p);
+int   rc_vector_max_d(rc_vector_d_t v);
+int   rc_vector_min_d(rc_vector_d_t v);
+double rc_std_dev_d(rc_vector_d_t v);
+double rc_vector_mean_d(rc_vector_d_t v);
+int   rc_vector_projection_d(rc_vector_d_t v, rc_vector_d_t e, rc_vector_d_t* p);
+double rc_vector_dot_product_d(rc_vector_d_t v1, rc_vector_d_t v2);
+int   rc_vector_outer_product_d(rc_vector_d_t v1, rc_vector_d_t v2, rc_matrix_d_t* A);
+int   rc_vector_cross_product_d(rc_vector_d_t v1, rc_vector_d_t v2, rc_vector_d_t* p);
+int   rc_vector_sum_d(rc_vector_d_t v1, rc_vector_d_t v2, rc_vector_d_t* s);
+int   rc_vector_sum_inplace_d(rc_vector_d_t* v1, rc_vector_d_t v2);
+
+int   rc_alloc_matrix_d(rc_matrix_d_t* A, int rows, int cols);
+int   rc_free_matrix_d(rc_matrix_d_t* A);
+rc_matrix_d_t rc_empty_matrix_d();
+int   rc_matrix_zeros_d(rc_matrix_d_t* A, int rows, int cols);
+int   rc_identity_matrix_d(rc_matrix_d_t* A, int dim);
+int   rc_random_matrix_d(rc_matrix_d_t* A, int rows, int cols);
+int   rc_diag_matrix_d(rc_matrix_d_t* A, rc_vector_d_t v);
+int   rc_duplicate_matrix_d(rc_matrix_d_t A, rc_matrix_d_t* B);
+int   rc_set_matrix_entry_d(rc_matrix_d_t* A, int row, int col, double val);
+double rc_get_matrix_entry_d(rc_matrix_d_t A, int row, int col);
+int   rc_print_matrix_d(rc_matrix_d_t A);
+void  rc_print_matrix_sci_d(rc_matrix_d_t A);
+int   rc_matrix_times_scalar_d(rc_matrix_d_t* A, double s);
+int   rc_multiply_matrices_d(rc_matrix_d_t A, rc_matrix_d_t B, rc_matrix_d_t* C);
+int   rc_left_multiply_matrix_inplace_d(rc_matrix_d_t A, rc_matrix_d_t* B);
+int   rc_right_multiply_matrix_inplace_d(rc_matrix_d_t* A, rc_matrix_d_t B);
+int   rc_add_matrices_d(rc_matrix_d_t A, rc_matrix_d_t B, rc_matrix_d_t* C);
+int   rc_add_matrices_inplace_d(rc_matrix_d_t* A, rc_matrix_d_t B);
+int   rc_matrix_transpose_d(rc_matrix_d_t A, rc_matrix_d_t* T);
+int   rc_matrix_transpose_inplace_d(rc_matrix_d_t* A);
+int   rc_matrix_view_d(rc_matrix_d_t* V, double* data, int rows, int cols, int row_stride);
+int   rc_matrix_slice_d(rc_matrix_d_t A, int row, int col, int rows, int cols, rc_matrix_d_t* S);
+int   rc_matrix_transpose_view_d(rc_matrix_d_t A, rc_matrix_d_t* T);
+
+int   rc_matrix_times_col_vec_d(rc_matrix_d_t A, rc_vector_d_t v, rc_vector_d_t* c);
+int   rc_row_vec_times_matrix_d(rc_vector_d_t v, rc_matrix_d_t A, rc_vector_d_t* c);
+double rc_matrix_determinant_d(rc_matrix_d_t A);
+int   rc_lup_decomp_d(rc_matrix_d_t A, rc_matrix_d_t* L, rc_matrix_d_t* U, rc_matrix_d_t* P);
+int   rc_qr_decomp_d(rc_matrix_d_t A, rc_matrix_d_t* Q, rc_matrix_d_t* R);
+int   rc_invert_matrix_d(rc_matrix_d_t A, rc_matrix_d_t* Ainv);
+int   rc_invert_matrix_inplace_d(rc_matrix_d_t* A);
+int   rc_lin_system_solve_d(rc_matrix_d_t A, rc_vector_d_t b, rc_vector_d_t* x);
+int   rc_lin_system_solve_qr_d(rc_matrix_d_t A, rc_vector_d_t b, rc_vector_d_t* x);
+int   rc_fit_ellipsoid_d(rc_matrix_d_t pts, rc_vector_d_t* ctr, rc_vector_d_t* lens);
+
+rc_lu_d_t rc_empty_lu_d();
+int   rc_alloc_lu_d(rc_lu_d_t* f, int n);
+int   rc_free_lu_d(rc_lu_d_t* f);
+int   rc_lu_factor_d(rc_matrix_d_t A, rc_lu_d_t* f);
+int   rc_lu_solve_d(rc_lu_d_t f, rc_vector_d_t b, rc_vector_d_t* x);
+int   rc_lu_solve_matrix_d(rc_lu_d_t f, rc_matrix_d_t B, rc_matrix_d_t* X);
+double rc_lu_determinant_d(rc_lu_d_t f);
+int   rc_lu_invert_d(rc_lu_d_t f, rc_matrix_d_t* Ainv);
+
+int   rc_cholesky_decomp_d(rc_matrix_d_t* A);
+int   rc_cholesky_solve_d(rc_matrix_d_t L, rc_vector_d_t b, rc_vector_d_t* x);
+int   rc_cholesky_solve_matrix_d(rc_matrix_d_t L, rc_matrix_d_t B, rc_matrix_d_t* X);
+int   rc_cholesky_update_d(rc_matrix_d_t* L, rc_vector_d_t v);
+int   rc_cholesky_downdate_d(rc_matrix_d_t* L, rc_vector_d_t v);
+double rc_cholesky_log_det_d(rc_matrix_d_t L);
+int   rc_ldl_decomp_d(rc_matrix_d_t* A);
+int   rc_ldl_solve_d(rc_matrix_d_t LD, rc_vector_d_t b, rc_vector_d_t* x);
+int   rc_ldl_solve_matrix_d(rc_matrix_d_t LD, rc_matrix_d_t B, rc_matrix_d_t* X);
+int   rc_ldl_update_d(rc_matrix_d_t* LD, rc_vector_d_t v);
+int   rc_ldl_downdate_d(rc_matrix_d_t* LD, rc_vector_d_t v);
+double rc_ldl_log_det_d(rc_matrix_d_t LD);
+
+rc_qr_d_t rc_empty_qr_d();
+int   rc_alloc_qr_d(rc_qr_d_t* f, int rows, int cols);
+int   rc_free_qr_d(rc_qr_d_t* f);
+int   rc_qr_factor_d(rc_matrix_d_t A, rc_qr_d_t* f);
+int   rc_qr_solve_d(rc_qr_d_t f, rc_vector_d_t b, rc_vector_d_t* x);
+int   rc_qr_get_q_d(rc_qr_d_t f, rc_matrix_d_t* Q);
+int   rc_qr_get_r_d(rc_qr_d_t f, rc_matrix_d_t* R);
+
+rc_eig_d_t rc_empty_eig_d();
+int   rc_alloc_eig_d(rc_eig_d_t* e, int n);
+int   rc_free_eig_d(rc_eig_d_t* e);
+int   rc_eig_symmetric_d(rc_matrix_d_t A, rc_eig_d_t* e);
+rc_svd_d_t rc_empty_svd_d();
+int   rc_alloc_svd_d(rc_svd_d_t* d, int rows, int cols);
+int   rc_free_svd_d(rc_svd_d_t* d);
+int   rc_svd_decomp_d(rc_matrix_d_t A, rc_svd_d_t* d);
+int   rc_svd_pinv_d(rc_svd_d_t d, rc_matrix_d_t* Ainv);
+
+int   rc_workspace_matrix_d(rc_workspace_t* w, rc_matrix_d_t* M, int rows, int cols);
+int   rc_lup_decomp_ws_d(rc_matrix_d_t A, rc_matrix_d_t* L, rc_matrix_d_t* U, rc_matrix_d_t* P, rc_workspace_t* w);
+int   rc_invert_matrix_ws_d(rc_matrix_d_t A, rc_matrix_d_t* Ainv, rc_workspace_t* w);
+int   rc_multiply_matrices_ws_d(rc_matrix_d_t A, rc_matrix_d_t B, rc_matrix_d_t* C, rc_workspace_t* w);
+int   rc_left_multiply_matrix_inplace_ws_d(rc_matrix_d_t A, rc_matrix_d_t* B, rc_workspace_t* w);
+int   rc_qr_decomp_ws_d(rc_matrix_d_t A, rc_matrix_d_t* Q, rc_matrix_d_t* R, rc_workspace_t* w);
+int   rc_fit_ellipsoid_ws_d(rc_matrix_d_t pts, rc_vector_d_t* ctr, rc_vector_d_t* lens, rc_workspace_t* w);
+
+int   rc_gemv_d(double alpha, rc_matrix_d_t A, rc_vector_d_t x, double beta, rc_vector_d_t* y);
+int   rc_gemv_transpose_d(double alpha, rc_matrix_d_t A, rc_vector_d_t x, double beta, rc_vector_d_t* y);
+int   rc_axpy_d(double alpha, rc_vector_d_t x, rc_vector_d_t* y);
+int   rc_ger_d(double alpha, rc_vector_d_t x, rc_vector_d_t y, rc_matrix_d_t* A);
+int   rc_syrk_d(double alpha, rc_matrix_d_t A, double beta, rc_matrix_d_t* C);
+
+int rc_print_poly_d(rc_vector_d_t v);
+int rc_poly_conv_d(rc_vector_d_t a, rc_vector_d_t b, rc_vector_d_t* c);
+int rc_poly_power_d(rc_vector_d_t a, int n, rc_vector_d_t* b);
+int rc_poly_add_d(rc_vector_d_t a, rc_vector_d_t b, rc_vector_d_t* c);
+int rc_poly_add_inplace_d(rc_vector_d_t* a, rc_vector_d_t b);
+int rc_poly_subtract_d(rc_vector_d_t a, rc_vector_d_t b, rc_vector_d_t* c);
+int rc_poly_subtract_inplace_d(rc_vector_d_t* a, rc_vector_d_t b);
+int rc_poly_differentiate_d(rc_vector_d_t a, int d, rc_vector_d_t* b);
+int rc_poly_divide_d(rc_vector_d_t n, rc_vector_d_t d, rc_vector_d_t* div, rc_vector_d_t* rem);
+int rc_poly_butter_d(int N, double wc, rc_vector_d_t* b);
+
+int   rc_dare_d(rc_matrix_d_t A, rc_matrix_d_t B, rc_matrix_d_t Q, rc_matrix_d_t R, rc_matrix_d_t* P);
+int   rc_dlqr_d(rc_matrix_d_t A, rc_matrix_d_t B, rc_matrix_d_t Q, rc_matrix_d_t R, rc_matrix_d_t* K, rc_matrix_d_t* P);
+
+int   rc_expm_ws_d(rc_matrix_d_t A, rc_matrix_d_t* E, rc_workspace_t* w);
+int   rc_c2d_ss_ws_d(rc_matrix_d_t A, rc_matrix_d_t B, rc_matrix_d_t C, rc_matrix_d_t D, double dt, rc_c2d_method_t method, rc_matrix_d_t* Ad, rc_matrix_d_t* Bd, rc_matrix_d_t* Cd, rc_matrix_d_t* Dd, rc_workspace_t* w);
+
 /*******************************************************************************
 * Quaternion Math
 *
@@ -2012,6 +2773,353 @@ int   rc_quaternion_rotate_vector(rc_vector_t* v, rc_vector_t q);
 void  rc_quaternion_rotate_vector_array(float v[3], float q[4]);
 int   rc_quaternion_to_rotation_matrix(rc_vector_t q, rc_matrix_t* m);
 
+/*******************************************************************************
+* Fixed-Size Vectors and Matrices
+*
+* Most of the math on a robot is 3D: rotations, cross products, magnetometer
+* and accelerometer vectors. rc_vector_t and rc_matrix_t always live on the
+* heap, which is wasteful for three floats. The types below hold their data
+* inline so they sit on the stack and are passed and returned by value. Every
+* operation is a static inline function with its loops written out by hand so
+* it compiles down to a few straight-line instructions, and none of them ever
+* allocate memory. Matrices are row-major, m.d[row][col].
+*
+* Conversion functions to and from the dynamic types are provided for handing
+* results to the rest of the library.
+*
+* @ rc_vec3_t rc_vec3(float x, float y, float z)
+* @ rc_vec4_t rc_vec4(float w, float x, float y, float z)
+*
+* Build a vector from its components. An rc_vec4_t holding a quaternion uses
+* the same w,x,y,z order as the quaternion functions above.
+*
+* @ rc_vecN_t rc_vecN_add(rc_vecN_t a, rc_vecN_t b)
+* @ rc_vecN_t rc_vecN_sub(rc_vecN_t a, rc_vecN_t b)
+* @ rc_vecN_t rc_vecN_scale(rc_vecN_t a, float s)
+* @ float rc_vecN_dot(rc_vecN_t a, rc_vecN_t b)
+* @ float rc_vecN_norm(rc_vecN_t a)
+*
+* Element-wise sum and difference, multiplication by a scalar, dot product and
+* 2-norm, for N of 3 or 4.
+*
+* @ rc_vec3_t rc_vec3_cross(rc_vec3_t a, rc_vec3_t b)
+*
+* Returns the cross product axb.
+*
+* @ rc_matN_t rc_matN_identity()
+* @ rc_matN_t rc_matN_add(rc_matN_t a, rc_matN_t b)
+* @ rc_matN_t rc_matN_scale(rc_matN_t a, float s)
+* @ rc_matN_t rc_matN_transpose(rc_matN_t a)
+* @ rc_matN_t rc_matN_mul(rc_matN_t a, rc_matN_t b)
+* @ rc_vecN_t rc_matN_mul_vec(rc_matN_t a, rc_vecN_t v)
+* @ float rc_matN_det(rc_matN_t a)
+*
+* Identity matrix, sum, multiplication by a scalar, transpose, matrix product
+* ab, matrix-vector product av and determinant, for N of 3 or 4.
+*
+* @ int rc_matN_inverse(rc_matN_t a, rc_matN_t* inv)
+*
+* Inverts a by its adjugate over its determinant and places the result in inv.
+* Returns 0 on success or -1 if a is singular, in which case inv is untouched.
+*
+* @ rc_mat3_t rc_mat3_from_quaternion(rc_vec4_t q)
+*
+* Returns the rotation matrix equivalent to rotating by unit quaternion q, the
+* same matrix rc_quaternion_to_rotation_matrix gives.
+*
+* @ int rc_vec3_to_vector(rc_vec3_t a, rc_vector_t* v)
+* @ int rc_vec4_to_vector(rc_vec4_t a, rc_vector_t* v)
+* @ int rc_mat3_to_matrix(rc_mat3_t a, rc_matrix_t* m)
+* @ int rc_mat4_to_matrix(rc_mat4_t a, rc_matrix_t* m)
+*
+* Copy a fixed-size type into a dynamic one, which is only allocated if it is
+* not already the right size. m may be a view.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_vector_to_vec3(rc_vector_t v, rc_vec3_t* a)
+* @ int rc_vector_to_vec4(rc_vector_t v, rc_vec4_t* a)
+* @ int rc_matrix_to_mat3(rc_matrix_t m, rc_mat3_t* a)
+* @ int rc_matrix_to_mat4(rc_matrix_t m, rc_mat4_t* a)
+*
+* Copy a dynamic vector or matrix of matching size, which may be a view, into a
+* fixed-size type. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+typedef struct rc_vec3_t{
+	float d[3];
+} rc_vec3_t;
+
+typedef struct rc_vec4_t{
+	float d[4];
+} rc_vec4_t;
+
+typedef struct rc_mat3_t{
+	float d[3][3];		// row-major
+} rc_mat3_t;
+
+typedef struct rc_mat4_t{
+	float d[4][4];		// row-major
+} rc_mat4_t;
+
+static inline rc_vec3_t rc_vec3(float x, float y, float z){
+	rc_vec3_t out = {{x, y, z}};
+	return out;
+}
+
+static inline rc_vec3_t rc_vec3_add(rc_vec3_t a, rc_vec3_t b){
+	rc_vec3_t out = {{a.d[0]+b.d[0], a.d[1]+b.d[1], a.d[2]+b.d[2]}};
+	return out;
+}
+
+static inline rc_vec3_t rc_vec3_sub(rc_vec3_t a, rc_vec3_t b){
+	rc_vec3_t out = {{a.d[0]-b.d[0], a.d[1]-b.d[1], a.d[2]-b.d[2]}};
+	return out;
+}
+
+static inline rc_vec3_t rc_vec3_scale(rc_vec3_t a, float s){
+	rc_vec3_t out = {{a.d[0]*s, a.d[1]*s, a.d[2]*s}};
+	return out;
+}
+
+static inline float rc_vec3_dot(rc_vec3_t a, rc_vec3_t b){
+	return a.d[0]*b.d[0] + a.d[1]*b.d[1] + a.d[2]*b.d[2];
+}
+
+static inline float rc_vec3_norm(rc_vec3_t a){
+	return sqrtf(rc_vec3_dot(a,a));
+}
+
+static inline rc_vec3_t rc_vec3_cross(rc_vec3_t a, rc_vec3_t b){
+	rc_vec3_t out = {{	a.d[1]*b.d[2] - a.d[2]*b.d[1],
+						a.d[2]*b.d[0] - a.d[0]*b.d[2],
+						a.d[0]*b.d[1] - a.d[1]*b.d[0]}};
+	return out;
+}
+
+static inline rc_vec4_t rc_vec4(float w, float x, float y, float z){
+	rc_vec4_t out = {{w, x, y, z}};
+	return out;
+}
+
+static inline rc_vec4_t rc_vec4_add(rc_vec4_t a, rc_vec4_t b){
+	rc_vec4_t out = {{a.d[0]+b.d[0], a.d[1]+b.d[1], a.d[2]+b.d[2], a.d[3]+b.d[3]}};
+	return out;
+}
+
+static inline rc_vec4_t rc_vec4_sub(rc_vec4_t a, rc_vec4_t b){
+	rc_vec4_t out = {{a.d[0]-b.d[0], a.d[1]-b.d[1], a.d[2]-b.d[2], a.d[3]-b.d[3]}};
+	return out;
+}
+
+static inline rc_vec4_t rc_vec4_scale(rc_vec4_t a, float s){
+	rc_vec4_t out = {{a.d[0]*s, a.d[1]*s, a.d[2]*s, a.d[3]*s}};
+	return out;
+}
+
+static inline float rc_vec4_dot(rc_vec4_t a, rc_vec4_t b){
+	return a.d[0]*b.d[0] + a.d[1]*b.d[1] + a.d[2]*b.d[2] + a.d[3]*b.d[3];
+}
+
+static inline float rc_vec4_norm(rc_vec4_t a){
+	return sqrtf(rc_vec4_dot(a,a));
+}
+
+static inline rc_mat3_t rc_mat3_identity(){
+	rc_mat3_t out = {{{1.0f, 0.0f, 0.0f},
+					{0.0f, 1.0f, 0.0f},
+					{0.0f, 0.0f, 1.0f}}};
+	return out;
+}
+
+static inline rc_mat3_t rc_mat3_add(rc_mat3_t a, rc_mat3_t b){
+	rc_mat3_t out = {{{a.d[0][0]+b.d[0][0], a.d[0][1]+b.d[0][1], a.d[0][2]+b.d[0][2]},
+					{a.d[1][0]+b.d[1][0], a.d[1][1]+b.d[1][1], a.d[1][2]+b.d[1][2]},
+					{a.d[2][0]+b.d[2][0], a.d[2][1]+b.d[2][1], a.d[2][2]+b.d[2][2]}}};
+	return out;
+}
+
+static inline rc_mat3_t rc_mat3_scale(rc_mat3_t a, float s){
+	rc_mat3_t out = {{{a.d[0][0]*s, a.d[0][1]*s, a.d[0][2]*s},
+					{a.d[1][0]*s, a.d[1][1]*s, a.d[1][2]*s},
+					{a.d[2][0]*s, a.d[2][1]*s, a.d[2][2]*s}}};
+	return out;
+}
+
+static inline rc_mat3_t rc_mat3_transpose(rc_mat3_t a){
+	rc_mat3_t out = {{{a.d[0][0], a.d[1][0], a.d[2][0]},
+					{a.d[0][1], a.d[1][1], a.d[2][1]},
+					{a.d[0][2], a.d[1][2], a.d[2][2]}}};
+	return out;
+}
+
+// entry (i,j) of the product of 3x3 matrices a and b
+#define RC_MAT3_DOT(a,b,i,j) \
+	((a).d[i][0]*(b).d[0][j] + (a).d[i][1]*(b).d[1][j] + (a).d[i][2]*(b).d[2][j])
+
+static inline rc_mat3_t rc_mat3_mul(rc_mat3_t a, rc_mat3_t b){
+	rc_mat3_t out = {{{RC_MAT3_DOT(a,b,0,0), RC_MAT3_DOT(a,b,0,1), RC_MAT3_DOT(a,b,0,2)},
+					{RC_MAT3_DOT(a,b,1,0), RC_MAT3_DOT(a,b,1,1), RC_MAT3_DOT(a,b,1,2)},
+					{RC_MAT3_DOT(a,b,2,0), RC_MAT3_DOT(a,b,2,1), RC_MAT3_DOT(a,b,2,2)}}};
+	return out;
+}
+
+static inline rc_vec3_t rc_mat3_mul_vec(rc_mat3_t a, rc_vec3_t v){
+	rc_vec3_t out = {{	a.d[0][0]*v.d[0] + a.d[0][1]*v.d[1] + a.d[0][2]*v.d[2],
+						a.d[1][0]*v.d[0] + a.d[1][1]*v.d[1] + a.d[1][2]*v.d[2],
+						a.d[2][0]*v.d[0] + a.d[2][1]*v.d[1] + a.d[2][2]*v.d[2]}};
+	return out;
+}
+
+static inline float rc_mat3_det(rc_mat3_t a){
+	return	a.d[0][0]*(a.d[1][1]*a.d[2][2] - a.d[1][2]*a.d[2][1]) -
+			a.d[0][1]*(a.d[1][0]*a.d[2][2] - a.d[1][2]*a.d[2][0]) +
+			a.d[0][2]*(a.d[1][0]*a.d[2][1] - a.d[1][1]*a.d[2][0]);
+}
+
+static inline int rc_mat3_inverse(rc_mat3_t a, rc_mat3_t* inv){
+	float c00, c01, c02, det, s;
+	// cofactors of the first row, reused for the determinant
+	c00 = a.d[1][1]*a.d[2][2] - a.d[1][2]*a.d[2][1];
+	c01 = a.d[1][2]*a.d[2][0] - a.d[1][0]*a.d[2][2];
+	c02 = a.d[1][0]*a.d[2][1] - a.d[1][1]*a.d[2][0];
+	det = a.d[0][0]*c00 + a.d[0][1]*c01 + a.d[0][2]*c02;
+	if(__builtin_expect(det==0.0f, 0)){
+		fprintf(stderr,"ERROR in rc_mat3_inverse, matrix is singular\n");
+		return -1;
+	}
+	s = 1.0f/det;
+	inv->d[0][0] = c00*s;
+	inv->d[0][1] = (a.d[0][2]*a.d[2][1] - a.d[0][1]*a.d[2][2])*s;
+	inv->d[0][2] = (a.d[0][1]*a.d[1][2] - a.d[0][2]*a.d[1][1])*s;
+	inv->d[1][0] = c01*s;
+	inv->d[1][1] = (a.d[0][0]*a.d[2][2] - a.d[0][2]*a.d[2][0])*s;
+	inv->d[1][2] = (a.d[0][2]*a.d[1][0] - a.d[0][0]*a.d[1][2])*s;
+	inv->d[2][0] = c02*s;
+	inv->d[2][1] = (a.d[0][1]*a.d[2][0] - a.d[0][0]*a.d[2][1])*s;
+	inv->d[2][2] = (a.d[0][0]*a.d[1][1] - a.d[0][1]*a.d[1][0])*s;
+	return 0;
+}
+
+static inline rc_mat3_t rc_mat3_from_quaternion(rc_vec4_t q){
+	const float w=q.d[0], x=q.d[1], y=q.d[2], z=q.d[3];
+	rc_mat3_t out = {{	{w*w+x*x-y*y-z*z, 2.0f*(x*y-w*z), 2.0f*(x*z+w*y)},
+						{2.0f*(x*y+w*z), w*w-x*x+y*y-z*z, 2.0f*(y*z-w*x)},
+						{2.0f*(x*z-w*y), 2.0f*(y*z+w*x), w*w-x*x-y*y+z*z}}};
+	return out;
+}
+
+static inline rc_mat4_t rc_mat4_identity(){
+	rc_mat4_t out = {{{1.0f, 0.0f, 0.0f, 0.0f},
+					{0.0f, 1.0f, 0.0f, 0.0f},
+					{0.0f, 0.0f, 1.0f, 0.0f},
+					{0.0f, 0.0f, 0.0f, 1.0f}}};
+	return out;
+}
+
+static inline rc_mat4_t rc_mat4_add(rc_mat4_t a, rc_mat4_t b){
+	rc_mat4_t out = {{	{a.d[0][0]+b.d[0][0], a.d[0][1]+b.d[0][1], a.d[0][2]+b.d[0][2], a.d[0][3]+b.d[0][3]},
+						{a.d[1][0]+b.d[1][0], a.d[1][1]+b.d[1][1], a.d[1][2]+b.d[1][2], a.d[1][3]+b.d[1][3]},
+						{a.d[2][0]+b.d[2][0], a.d[2][1]+b.d[2][1], a.d[2][2]+b.d[2][2], a.d[2][3]+b.d[2][3]},
+						{a.d[3][0]+b.d[3][0], a.d[3][1]+b.d[3][1], a.d[3][2]+b.d[3][2], a.d[3][3]+b.d[3][3]}}};
+	return out;
+}
+
+static inline rc_mat4_t rc_mat4_scale(rc_mat4_t a, float s){
+	rc_mat4_t out = {{	{a.d[0][0]*s, a.d[0][1]*s, a.d[0][2]*s, a.d[0][3]*s},
+						{a.d[1][0]*s, a.d[1][1]*s, a.d[1][2]*s, a.d[1][3]*s},
+						{a.d[2][0]*s, a.d[2][1]*s, a.d[2][2]*s, a.d[2][3]*s},
+						{a.d[3][0]*s, a.d[3][1]*s, a.d[3][2]*s, a.d[3][3]*s}}};
+	return out;
+}
+
+static inline rc_mat4_t rc_mat4_transpose(rc_mat4_t a){
+	rc_mat4_t out = {{	{a.d[0][0], a.d[1][0], a.d[2][0], a.d[3][0]},
+						{a.d[0][1], a.d[1][1], a.d[2][1], a.d[3][1]},
+						{a.d[0][2], a.d[1][2], a.d[2][2], a.d[3][2]},
+						{a.d[0][3], a.d[1][3], a.d[2][3], a.d[3][3]}}};
+	return out;
+}
+
+// entry (i,j) of the product of 4x4 matrices a and b
+#define RC_MAT4_DOT(a,b,i,j) \
+	((a).d[i][0]*(b).d[0][j] + (a).d[i][1]*(b).d[1][j] + \
+	 (a).d[i][2]*(b).d[2][j] + (a).d[i][3]*(b).d[3][j])
+
+static inline rc_mat4_t rc_mat4_mul(rc_mat4_t a, rc_mat4_t b){
+	rc_mat4_t out = {{
+		{RC_MAT4_DOT(a,b,0,0), RC_MAT4_DOT(a,b,0,1), RC_MAT4_DOT(a,b,0,2), RC_MAT4_DOT(a,b,0,3)},
+		{RC_MAT4_DOT(a,b,1,0), RC_MAT4_DOT(a,b,1,1), RC_MAT4_DOT(a,b,1,2), RC_MAT4_DOT(a,b,1,3)},
+		{RC_MAT4_DOT(a,b,2,0), RC_MAT4_DOT(a,b,2,1), RC_MAT4_DOT(a,b,2,2), RC_MAT4_DOT(a,b,2,3)},
+		{RC_MAT4_DOT(a,b,3,0), RC_MAT4_DOT(a,b,3,1), RC_MAT4_DOT(a,b,3,2), RC_MAT4_DOT(a,b,3,3)}}};
+	return out;
+}
+
+static inline rc_vec4_t rc_mat4_mul_vec(rc_mat4_t a, rc_vec4_t v){
+	rc_vec4_t out = {{
+		a.d[0][0]*v.d[0] + a.d[0][1]*v.d[1] + a.d[0][2]*v.d[2] + a.d[0][3]*v.d[3],
+		a.d[1][0]*v.d[0] + a.d[1][1]*v.d[1] + a.d[1][2]*v.d[2] + a.d[1][3]*v.d[3],
+		a.d[2][0]*v.d[0] + a.d[2][1]*v.d[1] + a.d[2][2]*v.d[2] + a.d[2][3]*v.d[3],
+		a.d[3][0]*v.d[0] + a.d[3][1]*v.d[1] + a.d[3][2]*v.d[2] + a.d[3][3]*v.d[3]}};
+	return out;
+}
+
+// 2x2 minors from the top two rows (s) and bottom two rows (c) of a 4x4
+// matrix, shared by rc_mat4_det and rc_mat4_inverse
+#define RC_MAT4_MINORS(a)										\
+	const float s0 = a.d[0][0]*a.d[1][1] - a.d[1][0]*a.d[0][1];	\
+	const float s1 = a.d[0][0]*a.d[1][2] - a.d[1][0]*a.d[0][2];	\
+	const float s2 = a.d[0][0]*a.d[1][3] - a.d[1][0]*a.d[0][3];	\
+	const float s3 = a.d[0][1]*a.d[1][2] - a.d[1][1]*a.d[0][2];	\
+	const float s4 = a.d[0][1]*a.d[1][3] - a.d[1][1]*a.d[0][3];	\
+	const float s5 = a.d[0][2]*a.d[1][3] - a.d[1][2]*a.d[0][3];	\
+	const float c5 = a.d[2][2]*a.d[3][3] - a.d[3][2]*a.d[2][3];	\
+	const float c4 = a.d[2][1]*a.d[3][3] - a.d[3][1]*a.d[2][3];	\
+	const float c3 = a.d[2][1]*a.d[3][2] - a.d[3][1]*a.d[2][2];	\
+	const float c2 = a.d[2][0]*a.d[3][3] - a.d[3][0]*a.d[2][3];	\
+	const float c1 = a.d[2][0]*a.d[3][2] - a.d[3][0]*a.d[2][2];	\
+	const float c0 = a.d[2][0]*a.d[3][1] - a.d[3][0]*a.d[2][1];
+
+static inline float rc_mat4_det(rc_mat4_t a){
+	RC_MAT4_MINORS(a)
+	return s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+}
+
+static inline int rc_mat4_inverse(rc_mat4_t a, rc_mat4_t* inv){
+	float det, s;
+	RC_MAT4_MINORS(a)
+	det = s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+	if(__builtin_expect(det==0.0f, 0)){
+		fprintf(stderr,"ERROR in rc_mat4_inverse, matrix is singular\n");
+		return -1;
+	}
+	s = 1.0f/det;
+	inv->d[0][0] = ( a.d[1][1]*c5 - a.d[1][2]*c4 + a.d[1][3]*c3)*s;
+	inv->d[0][1] = (-a.d[0][1]*c5 + a.d[0][2]*c4 - a.d[0][3]*c3)*s;
+	inv->d[0][2] = ( a.d[3][1]*s5 - a.d[3][2]*s4 + a.d[3][3]*s3)*s;
+	inv->d[0][3] = (-a.d[2][1]*s5 + a.d[2][2]*s4 - a.d[2][3]*s3)*s;
+	inv->d[1][0] = (-a.d[1][0]*c5 + a.d[1][2]*c2 - a.d[1][3]*c1)*s;
+	inv->d[1][1] = ( a.d[0][0]*c5 - a.d[0][2]*c2 + a.d[0][3]*c1)*s;
+	inv->d[1][2] = (-a.d[3][0]*s5 + a.d[3][2]*s2 - a.d[3][3]*s1)*s;
+	inv->d[1][3] = ( a.d[2][0]*s5 - a.d[2][2]*s2 + a.d[2][3]*s1)*s;
+	inv->d[2][0] = ( a.d[1][0]*c4 - a.d[1][1]*c2 + a.d[1][3]*c0)*s;
+	inv->d[2][1] = (-a.d[0][0]*c4 + a.d[0][1]*c2 - a.d[0][3]*c0)*s;
+	inv->d[2][2] = ( a.d[3][0]*s4 - a.d[3][1]*s2 + a.d[3][3]*s0)*s;
+	inv->d[2][3] = (-a.d[2][0]*s4 + a.d[2][1]*s2 - a.d[2][3]*s0)*s;
+	inv->d[3][0] = (-a.d[1][0]*c3 + a.d[1][1]*c1 - a.d[1][2]*c0)*s;
+	inv->d[3][1] = ( a.d[0][0]*c3 - a.d[0][1]*c1 + a.d[0][2]*c0)*s;
+	inv->d[3][2] = (-a.d[3][0]*s3 + a.d[3][1]*s1 - a.d[3][2]*s0)*s;
+	inv->d[3][3] = ( a.d[2][0]*s3 - a.d[2][1]*s1 + a.d[2][2]*s0)*s;
+	return 0;
+}
+
+int   rc_vec3_to_vector(rc_vec3_t a, rc_vector_t* v);
+int   rc_vec4_to_vector(rc_vec4_t a, rc_vector_t* v);
+int   rc_mat3_to_matrix(rc_mat3_t a, rc_matrix_t* m);
+int   rc_mat4_to_matrix(rc_mat4_t a, rc_matrix_t* m);
+int   rc_vector_to_vec3(rc_vector_t v, rc_vec3_t* a);
+int   rc_vector_to_vec4(rc_vector_t v, rc_vec4_t* a);
+int   rc_matrix_to_mat3(rc_matrix_t m, rc_mat3_t* a);
+int   rc_matrix_to_mat4(rc_matrix_t m, rc_mat4_t* a);
+
 /*******************************************************************************
 * Ring Buffer
 *
@@ -2081,40 +3189,209 @@ float rc_get_ringbuf_value(rc_ringbuf_t* buf, int position);
 float rc_std_dev_ringbuf(rc_ringbuf_t buf);
 
 /*******************************************************************************
-* Discrete SISO Filters
+* Statistics Ring Buffer
+*
+* rc_stats_ringbuf_t keeps the last n values of a signal like a normal ring
+* buffer, but also maintains a running sum, sum of squares, and monotonic
+* queues of the smallest and largest values as each new value is inserted.
+* The mean, variance, standard deviation, min, and max of the window can then
+* be read in constant time instead of sweeping the whole buffer like
+* rc_std_dev_ringbuf does. The running sums are kept in double precision and
+* recomputed from scratch once every n insertions so numerical drift stays
+* bounded no matter how long the buffer runs. Statistics only include values
+* actually inserted since the buffer was allocated or reset.
+*
+* @ int rc_alloc_stats_ringbuf(rc_stats_ringbuf_t* s, int size)
+*
+* Allocates memory for a statistics ring buffer holding the last 'size' values.
+* Any existing memory allocated for s is freed first.
+* Returns 0 on success or -1 on failure.
 *
-* This is a collection of functions for generating and implementing discrete 
-* SISO filters for arbitrary transfer functions. 
+* @ rc_stats_ringbuf_t rc_empty_stats_ringbuf()
 *
-* @ int rc_alloc_filter(rc_filter_t* f, rc_vector_t num, rc_vector_t den, float dt)
+* Returns an rc_stats_ringbuf_t with no memory allocated. Use this to
+* initialize local buffers before calling rc_alloc_stats_ringbuf.
 *
-* Allocate memory for a discrete-time filter & populates it with the transfer
-* function coefficients provided in vectors num and den. The memory in num and
-* den is duplicated so those vectors can be reused or freed after allocating a 
-* filter without fear of disturbing the function of the filter. Argument dt is
-* the timestep in seconds at which the user expects to operate the filter.
-* The length of demonimator den must be at least as large as numerator num to
-* avoid describing an improper transfer function. If rc_filter_t pointer f
-* points to an existing filter then the old filter's contents are freed safely
-* to avoid memory leaks. We suggest initializing filter f with rc_empty_filter
-* before calling this function if it is not a global variable to ensure it does
-* not accidentally contain invlaid contents such as null pointers. The filter's
-* order is derived from the length of the denominator polynomial.
-* Returns 0 on success or -1 on failure.
+* @ int rc_free_stats_ringbuf(rc_stats_ringbuf_t* s)
 *
-* @ int rc_alloc_filter_from_arrays(rc_filter_t* f,int order,float dt,float* num,float* den)
+* Frees the memory allocated for s and zeros out the struct.
 *
-* Like rc_alloc_filter(), but takes arrays for the numerator and denominator
-* coefficients instead of vectors. Arrays num and denmust be the same length
-* (order+1) like a semi-proper transfer function. Proper transfer functions with
-* relative degree >=1 can still be used but the numerator must be filled with
-* leading zeros. This function will throw a segmentation fault if your arrays
-* are not both of length order+1. It is safer to use the rc_alloc_filter.
-* Returns 0 on success or -1 on failure.
+* @ int rc_reset_stats_ringbuf(rc_stats_ringbuf_t* s)
 *
-* @ int rc_free_filter(rc_filter_t* f)
+* Empties the buffer and resets all running statistics.
 *
-* Frees the memory allocated by a filter's buffers and coefficient vectors. Also
+* @ int rc_insert_new_stats_ringbuf_value(rc_stats_ringbuf_t* s, float val)
+*
+* Puts a new value into the buffer, booting out the oldest value if it is full,
+* and updates the running statistics. Takes constant time on average.
+* Returns 0 on success or -1 on failure.
+*
+* @ float rc_stats_ringbuf_mean(rc_stats_ringbuf_t* s)
+* @ float rc_stats_ringbuf_variance(rc_stats_ringbuf_t* s)
+* @ float rc_stats_ringbuf_std_dev(rc_stats_ringbuf_t* s)
+* @ float rc_stats_ringbuf_min(rc_stats_ringbuf_t* s)
+* @ float rc_stats_ringbuf_max(rc_stats_ringbuf_t* s)
+*
+* Return the mean, population variance, standard deviation, smallest and
+* largest of the values currently in the buffer. All return 0 if the buffer is
+* empty and -1.0f on error.
+*******************************************************************************/
+typedef struct rc_stats_ringbuf_t {
+	rc_ringbuf_t buf;	// the values themselves
+	int count;			// number of values in the buffer, at most buf.size
+	double sum;			// running sum of the values in the buffer
+	double sum_sqr;		// running sum of their squares
+	int since_resum;	// insertions since the sums were last recomputed
+	int* min_q;			// queue of buffer positions with increasing values
+	int* max_q;			// queue of buffer positions with decreasing values
+	int min_head;		// front of min_q
+	int min_len;		// entries in min_q
+	int max_head;		// front of max_q
+	int max_len;		// entries in max_q
+	int initialized;
+} rc_stats_ringbuf_t;
+
+int   rc_alloc_stats_ringbuf(rc_stats_ringbuf_t* s, int size);
+rc_stats_ringbuf_t rc_empty_stats_ringbuf();
+int   rc_free_stats_ringbuf(rc_stats_ringbuf_t* s);
+int   rc_reset_stats_ringbuf(rc_stats_ringbuf_t* s);
+int   rc_insert_new_stats_ringbuf_value(rc_stats_ringbuf_t* s, float val);
+float rc_stats_ringbuf_mean(rc_stats_ringbuf_t* s);
+float rc_stats_ringbuf_variance(rc_stats_ringbuf_t* s);
+float rc_stats_ringbuf_std_dev(rc_stats_ringbuf_t* s);
+float rc_stats_ringbuf_min(rc_stats_ringbuf_t* s);
+float rc_stats_ringbuf_max(rc_stats_ringbuf_t* s);
+
+/*******************************************************************************
+* Lock-Free SPSC Ring Buffer
+*
+* rc_spsc_ringbuf_t passes elements of any type from exactly one producer
+* thread to exactly one consumer thread without a mutex, for example IMU
+* samples from the interrupt thread to a logging thread. The capacity is a
+* power of two, the producer and consumer indices sit on separate cache lines,
+* and each side publishes its progress with an acquire/release atomic so
+* neither thread ever blocks. Elements are copied in and out by value.
+*
+* Allocation and freeing must happen while neither thread is using the buffer.
+* The push functions may only be called from the producer thread and the pop
+* functions only from the consumer thread.
+*
+* @ int rc_alloc_spsc_ringbuf(rc_spsc_ringbuf_t* r, int capacity, size_t elem_size)
+*
+* Allocates a buffer for up to 'capacity' elements of 'elem_size' bytes each,
+* for example rc_alloc_spsc_ringbuf(&r, 256, sizeof(rc_imu_data_t)). The
+* capacity is rounded up to the next power of two. Any existing memory
+* allocated for r is freed first. Returns 0 on success or -1 on failure.
+*
+* @ rc_spsc_ringbuf_t rc_empty_spsc_ringbuf()
+*
+* Returns an rc_spsc_ringbuf_t with no memory allocated. Use this to
+* initialize local buffers before calling rc_alloc_spsc_ringbuf.
+*
+* @ int rc_free_spsc_ringbuf(rc_spsc_ringbuf_t* r)
+*
+* Frees the memory allocated for r and zeros out the struct.
+*
+* @ int rc_spsc_ringbuf_push(rc_spsc_ringbuf_t* r, const void* elem)
+*
+* Copies one element into the buffer. Returns 0 on success or -1 if the buffer
+* is full. Nothing is printed when full so it is safe to call from time
+* critical threads.
+*
+* @ int rc_spsc_ringbuf_pop(rc_spsc_ringbuf_t* r, void* elem)
+*
+* Copies the oldest element out of the buffer into 'elem'. Returns 0 on
+* success or -1 if the buffer is empty.
+*
+* @ int rc_spsc_ringbuf_push_batch(rc_spsc_ringbuf_t* r, const void* elems, int n)
+* @ int rc_spsc_ringbuf_pop_batch(rc_spsc_ringbuf_t* r, void* elems, int max)
+*
+* Push up to n elements from array 'elems' or pop up to 'max' elements into it
+* with a single atomic index update. Both return the number of elements
+* actually transferred or -1 on error.
+*
+* @ int rc_spsc_ringbuf_count(rc_spsc_ringbuf_t* r)
+*
+* Returns a snapshot of the number of elements in the buffer.
+*******************************************************************************/
+typedef struct rc_spsc_ringbuf_t {
+	// set up once by rc_alloc_spsc_ringbuf, then read only
+	char* d;					// capacity*elem_size bytes of storage
+	size_t elem_size;			// size of one element in bytes
+	unsigned int capacity;		// max number of elements, a power of two
+	unsigned int mask;			// capacity-1
+	int initialized;
+	// producer's cache line
+	unsigned int head __attribute__((aligned(64)));	// elements ever pushed
+	unsigned int cached_tail;	// producer's last view of tail
+	// consumer's cache line
+	unsigned int tail __attribute__((aligned(64)));	// elements ever popped
+	unsigned int cached_head;	// consumer's last view of head
+} rc_spsc_ringbuf_t;
+
+int   rc_alloc_spsc_ringbuf(rc_spsc_ringbuf_t* r, int capacity, size_t elem_size);
+rc_spsc_ringbuf_t rc_empty_spsc_ringbuf();
+int   rc_free_spsc_ringbuf(rc_spsc_ringbuf_t* r);
+int   rc_spsc_ringbuf_push(rc_spsc_ringbuf_t* r, const void* elem);
+int   rc_spsc_ringbuf_pop(rc_spsc_ringbuf_t* r, void* elem);
+int   rc_spsc_ringbuf_push_batch(rc_spsc_ringbuf_t* r, const void* elems, int n);
+int   rc_spsc_ringbuf_pop_batch(rc_spsc_ringbuf_t* r, void* elems, int max);
+int   rc_spsc_ringbuf_count(rc_spsc_ringbuf_t* r);
+
+/*******************************************************************************
+* Discrete SISO Filters
+*
+* This is a collection of functions for generating and implementing discrete 
+* SISO filters for arbitrary transfer functions. 
+*
+* @ int rc_alloc_filter(rc_filter_t* f, rc_vector_t num, rc_vector_t den, float dt)
+*
+* Allocate memory for a discrete-time filter & populates it with the transfer
+* function coefficients provided in vectors num and den. The memory in num and
+* den is duplicated so those vectors can be reused or freed after allocating a 
+* filter without fear of disturbing the function of the filter. Argument dt is
+* the timestep in seconds at which the user expects to operate the filter.
+* The length of demonimator den must be at least as large as numerator num to
+* avoid describing an improper transfer function. If rc_filter_t pointer f
+* points to an existing filter then the old filter's contents are freed safely
+* to avoid memory leaks. We suggest initializing filter f with rc_empty_filter
+* before calling this function if it is not a global variable to ensure it does
+* not accidentally contain invlaid contents such as null pointers. The filter's
+* order is derived from the length of the denominator polynomial.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_alloc_filter_from_arrays(rc_filter_t* f,int order,float dt,float* num,float* den)
+*
+* Like rc_alloc_filter(), but takes arrays for the numerator and denominator
+* coefficients instead of vectors. Arrays num and denmust be the same length
+* (order+1) like a semi-proper transfer function. Proper transfer functions with
+* relative degree >=1 can still be used but the numerator must be filled with
+* leading zeros. This function will throw a segmentation fault if your arrays
+* are not both of length order+1. It is safer to use the rc_alloc_filter.
+* Returns 0 on success or -1 on failure.
+*
+* Both of the above make a single cache-aligned allocation which holds the
+* coefficients and the input/output ring buffers so everything the filter
+* touches when marching is kept together in memory.
+*
+* @ int rc_filter_from_storage(rc_filter_t* f, int order, float dt, float* num, float* den, float* storage)
+*
+* Like rc_alloc_filter_from_arrays() but no memory is allocated. Instead the
+* coefficients and ring buffers are placed in the caller-supplied array
+* 'storage' which must hold at least RC_FILTER_STORAGE_SIZE(order) floats and
+* must stay valid for as long as the filter is used. This lets real-time
+* programs declare their controllers with static storage and never call malloc,
+* for example:
+*
+*	static float D1_storage[RC_FILTER_STORAGE_SIZE(D1_ORDER)];
+*	rc_filter_from_storage(&D1, D1_ORDER, DT, num, den, D1_storage);
+*
+* rc_free_filter may still be called on the filter, it only zeros out the
+* struct. Returns 0 on success or -1 on failure.
+*
+* @ int rc_free_filter(rc_filter_t* f)
+*
+* Frees the memory allocated by a filter's buffers and coefficient vectors. Also
 * resets all filter properties back to 0. Returns 0 on success or -1 on failure.
 *
 * @ rc_filter_t rc_empty_filter()
@@ -2141,6 +3418,16 @@ float rc_std_dev_ringbuf(rc_ringbuf_t buf);
 * ring buffers are updated accordingly. Once a filter is created, this is
 * typically the only function required afterwards.
 *
+* @ int rc_march_filter_block(rc_filter_t* f, float* in, float* out, int n)
+*
+* Marches a filter forward n steps, one for each entry in array 'in', and
+* places the n outputs in array 'out'. The results, saturation flag, soft start
+* behavior and step counter are exactly the same as calling rc_march_filter n
+* times in a loop, but the sanity checks are only done once for the whole
+* block. Useful for draining several samples from a FIFO at once or for post
+* processing logged data. 'in' and 'out' may point to the same array to filter
+* in place. Returns 0 on success or -1 on failure.
+*
 * @ int rc_reset_filter(rc_filter_t* f)
 *
 * Resets all previous inputs and outputs to 0 and resets the step counter
@@ -2186,7 +3473,8 @@ float rc_std_dev_ringbuf(rc_ringbuf_t buf);
 *
 * Returns the input 'steps' back in time. Steps = 0 returns most recent input.
 * 'steps' must be between 0 and order inclusively as those are the
-* only steps retained in memory for normal filter operation. To record values
+* only steps retained in memory for normal filter operation. Moving averages
+* only keep their newest output so for them steps must be 0. To record values
 * further back in time we suggest creating your own rc_ringbuf_t ring buffer.
 * Returns -1.0f and prints an error message if there is an issue.
 *
@@ -2218,7 +3506,8 @@ float rc_std_dev_ringbuf(rc_ringbuf_t buf);
 * @ int rc_multiply_filters(rc_filter_t f1, rc_filter_t f2, rc_filter_t* f3)
 *
 * Creates a new filter f3 by multiplying f1*f2. The contents of f3 are freed
-* safely if necessary and new memory is allocated to avoid memory leaks.
+* safely if necessary and new memory is allocated to avoid memory leaks. Moving
+* averages from rc_moving_average are not supported.
 * Returns 0 on success or -1 on failure.
 *
 * @ int rc_c2d_tustin(rc_filter_t* f,rc_vector_t num,rc_vector_t den,float dt,float w)
@@ -2236,6 +3525,20 @@ float rc_std_dev_ringbuf(rc_ringbuf_t buf);
 * Any existing memory allocated for f is freed is necessary to prevent memory
 * leaks. Returns 0 on success or -1 on failure.
 *
+* @ int rc_c2d_ws(rc_filter_t* f, rc_vector_t num, rc_vector_t den, float dt, rc_c2d_method_t method, rc_workspace_t* w)
+*
+* Discretizes the same kind of proper continuous time transfer function
+* exactly instead of approximately. RC_C2D_ZOH and RC_C2D_FOH give the
+* zero-order and first-order hold equivalents through the matrix exponential,
+* and RC_C2D_MATCHED maps every pole and zero with z=e^(s*dt) and matches the
+* gain at DC, or at s=0 after removing any poles or zeros there. Unlike
+* rc_c2d_tustin the discrete poles don't warp near the Nyquist frequency. If f
+* is already a filter of the same order its coefficients and dt are replaced
+* in place, keeping its state, gain, saturation and soft start, so nothing is
+* allocated and the loop rate can be changed while running. Otherwise f is
+* freed and allocated like rc_c2d_tustin. Temporaries come from workspace w.
+* Returns 0 on success or -1 on failure.
+*
 * @ int rc_first_order_lowpass(rc_filter_t* f, float dt, float time_constant)
 *
 * Creates a first order low pass filter. Any existing memory allocated for f is 
@@ -2275,7 +3578,14 @@ float rc_std_dev_ringbuf(rc_ringbuf_t buf);
 * Makes a FIR moving average filter that averages over 'samples' which must be
 * greater than or equal to 2 otherwise no averaging would be performed. Any
 * existing memory allocated for f is freed safely to avoid memory leaks and new
-* memory is allocated for the new filter. Returns 0 on success or -1 on failure.
+* memory is allocated for the new filter. The filter is marched by keeping a
+* running sum of its inputs, so each step costs the same no matter how many
+* samples are averaged. The sum is recomputed exactly every 'samples' steps to
+* cancel floating point drift. Only the input history of 'samples' floats is
+* allocated, the coefficients are all the same so num and den hold just one
+* each and the output buffer only the newest output. Because of that moving
+* averages can't be converted to the other filter types or multiplied with
+* rc_multiply_filters. Returns 0 on success or -1 on failure.
 *
 * @ int rc_integrator(rc_filter_t *f, float dt)
 *
@@ -2319,7 +3629,7 @@ typedef struct rc_filter_t{
 	// soft start settings
 	int ss_en;			// set to 1 by enbale_soft_start()
 	float ss_steps;		// steps before full output allowed
-	// dynamically allocated ring buffers
+	// ring buffers, these point into the same block as num and den
 	rc_ringbuf_t in_buf;
 	rc_ringbuf_t out_buf;
 	// newest input and output for quick reference
@@ -2327,15 +3637,25 @@ typedef struct rc_filter_t{
 	float newest_output;// shortcut for the most recent output
 	// other
 	uint64_t step;		// steps since last reset
+	// running sum used by rc_moving_average filters
+	int ma_en;			// set to 1 by rc_moving_average()
+	double ma_sum;		// sum of all values in in_buf
+	int ma_resum;		// steps until ma_sum is recomputed from scratch
+	float* mem;			// block holding coefs & buffers, NULL if caller owned
 	int initialized;	// initialization flag
 } rc_filter_t;
 
+// floats of storage needed by rc_filter_from_storage for a given filter order
+#define RC_FILTER_STORAGE_SIZE(order) (4*((order)+1))
+
 int   rc_alloc_filter(rc_filter_t* f, rc_vector_t num, rc_vector_t den, float dt);
 int   rc_alloc_filter_from_arrays(rc_filter_t* f,int order,float dt,float* num,float* den);
+int   rc_filter_from_storage(rc_filter_t* f, int order, float dt, float* num, float* den, float* storage);
 int   rc_free_filter(rc_filter_t* f);
 rc_filter_t rc_empty_filter();
 int   rc_print_filter(rc_filter_t f);
 float rc_march_filter(rc_filter_t* f, float new_input);
+int   rc_march_filter_block(rc_filter_t* f, float* in, float* out, int n);
 int   rc_reset_filter(rc_filter_t* f);
 int   rc_enable_saturation(rc_filter_t* f, float min, float max);
 int   rc_did_filter_saturate(rc_filter_t* f);
@@ -2348,6 +3668,7 @@ int   rc_prefill_filter_inputs(rc_filter_t* f, float in);
 int   rc_prefill_filter_outputs(rc_filter_t* f, float out);
 int   rc_multiply_filters(rc_filter_t f1, rc_filter_t f2, rc_filter_t* f3);
 int   rc_c2d_tustin(rc_filter_t* f,rc_vector_t num,rc_vector_t den,float dt,float w);
+int   rc_c2d_ws(rc_filter_t* f, rc_vector_t num, rc_vector_t den, float dt, rc_c2d_method_t method, rc_workspace_t* w);
 int   rc_first_order_lowpass(rc_filter_t* f, float dt, float time_constant);
 int   rc_first_order_highpass(rc_filter_t* f, float dt, float time_constant);
 int   rc_butterworth_lowpass(rc_filter_t* f, int order, float dt, float wc);
@@ -2357,6 +3678,945 @@ int   rc_integrator(rc_filter_t *f, float dt);
 int   rc_double_integrator(rc_filter_t* f, float dt);
 int   rc_pid_filter(rc_filter_t* f,float kp,float ki,float kd,float Tf,float dt);
 
+/*******************************************************************************
+* Compile-Time Filters
+*
+* When a filter's order and coefficients are known at compile time, such as the
+* D1_NUM and D1_DEN controllers in rc_balance's balance_config.h, the macro
+* below generates a march function specialized for them. The coefficients
+* become constants and the loops have a fixed length so the compiler can fully
+* unroll and constant-fold the difference equation instead of walking the
+* coefficient vectors and ring buffers generically like rc_march_filter does.
+*
+* The generated function marches a normal rc_filter_t, so the filter is still
+* created with rc_alloc_filter_from_arrays or rc_filter_from_storage using the
+* same coefficients, and saturation, soft start, gain, reset, prefill and the
+* previous input/output accessors all keep working. The arithmetic is done in
+* the same order as rc_march_filter so the outputs match it. Moving average
+* filters from rc_moving_average march with a running sum instead and are not
+* supported, the generated function prints an error and returns -1 for them.
+*
+* The coefficients in f->num and f->den are never read, only the compiled in
+* ones are used. Re-discretizing the filter at run time, for example with
+* rc_c2d_ws after changing the loop rate, has no effect on the generated
+* function which keeps marching the original design. Use rc_march_filter for
+* filters whose coefficients change. When the file using the macro is compiled
+* with DEBUG defined, as by the library's 'make debug', every step also checks
+* that f->num and f->den still equal the compiled in coefficients and prints
+* an error and returns -1 if they don't.
+*
+* @ RC_STATIC_FILTER(name, order, num, den)
+*
+* Defines 'static inline float name(rc_filter_t* f, float new_input)' which is
+* a drop in replacement for rc_march_filter. 'num' and 'den' must be macros
+* expanding to brace-enclosed lists of order+1 coefficients each, just like the
+* arrays given to rc_alloc_filter_from_arrays, and 'order' must match the order
+* of the filter it is used with. Use it at file scope, for example:
+*
+*	RC_STATIC_FILTER(D1_march, D1_ORDER, D1_NUM, D1_DEN)
+*	...
+*	u = D1_march(&D1, error);
+*******************************************************************************/
+// The next three are only for use by rc_march_filter and RC_STATIC_FILTER so
+// both share the same ring buffer, soft start and saturation bookkeeping.
+// size is the length of the ring buffers, order+1.
+
+// logs a new input and returns the old value it replaced in the ring buffer
+static inline __attribute__((always_inline)) float rc_filter_log_input( \
+		rc_filter_t* f, float new_input, const int size){
+	float oldest;
+	int idx = f->in_buf.index+1;
+	if(idx>=size) idx=0;
+	oldest = f->in_buf.d[idx];
+	f->in_buf.d[idx] = new_input;
+	f->in_buf.index = idx;
+	f->newest_input = new_input;
+	return oldest;
+}
+
+// applies soft start and saturation to a new output, logs it in the ring
+// buffer and increments the step counter. Returns the limited output.
+static inline __attribute__((always_inline)) float rc_filter_log_output( \
+		rc_filter_t* f, float new_out, const int size){
+	int idx;
+	// soft start limits
+	if(f->ss_en && f->step<f->ss_steps){
+		float a=f->sat_max*(f->step/f->ss_steps);
+		float b=f->sat_min*(f->step/f->ss_steps);
+		if(new_out>a) new_out=a;
+		if(new_out<b) new_out=b;
+	}
+	// saturate and set flag
+	if(f->sat_en){
+		if(new_out>f->sat_max){
+			new_out=f->sat_max;
+			f->sat_flag=1;
+		}
+		else if(new_out<f->sat_min){
+			new_out=f->sat_min;
+			f->sat_flag=1;
+		}
+		else f->sat_flag=0;
+	}
+	// record the output to filter struct and ring buffer
+	f->newest_output = new_out;
+	idx = f->out_buf.index+1;
+	if(idx>=size) idx=0;
+	f->out_buf.d[idx] = new_out;
+	f->out_buf.index = idx;
+	f->step++;
+	return new_out;
+}
+
+// prints why filter f can't be marched by RC_STATIC_FILTER 'name' and
+// returns -1, kept out of line so the inline march stays small
+float rc_static_filter_error(rc_filter_t* f, int order, const char* name);
+
+// DEBUG builds only, returns -1 and prints an error if f's coefficients are
+// not the ones compiled into RC_STATIC_FILTER 'name', 0 otherwise
+int rc_static_filter_check(rc_filter_t* f, int order, const float* num, \
+				const float* den, const char* name);
+
+// only for use by RC_STATIC_FILTER, inlined so order, num and den are constants
+static inline __attribute__((always_inline)) float rc_march_static_filter( \
+		rc_filter_t* f, float new_input, const int order, const float* num, \
+		const float* den, const char* name){
+	int i, idx;
+	float new_out = 0.0f;
+	if(__builtin_expect(!f->initialized || f->ma_en || f->order!=order || \
+					f->in_buf.size!=order+1, 0)){
+		return rc_static_filter_error(f, order, name);
+	}
+#ifdef DEBUG
+	if(rc_static_filter_check(f, order, num, den, name)) return -1.0f;
+#endif
+	rc_filter_log_input(f, new_input, order+1);
+	// evaluate the difference equation in the same order as rc_march_filter
+	for(i=0; i<=order; i++){
+		idx = f->in_buf.index-i;
+		if(idx<0) idx+=order+1;
+		new_out+=f->gain*num[i]*f->in_buf.d[idx];
+	}
+	for(i=0; i<order; i++){
+		idx = f->out_buf.index-i;
+		if(idx<0) idx+=order+1;
+		new_out-=den[i+1]*f->out_buf.d[idx];
+	}
+	new_out /= den[0];
+	return rc_filter_log_output(f, new_out, order+1);
+}
+
+#define RC_STATIC_FILTER(name, order, num, den)								\
+static inline float name(rc_filter_t* f, float new_input){					\
+	static const float name##_num[(order)+1] = num;							\
+	static const float name##_den[(order)+1] = den;							\
+	return rc_march_static_filter(f, new_input, (order), name##_num,		\
+											name##_den, #name);				\
+}
+
+/*******************************************************************************
+* Fixed-Point Filters
+*
+* rc_fixed_filter_t runs a discrete SISO filter entirely in integer arithmetic
+* so raw sensor counts, such as the raw_gyro and raw_accel values from the IMU
+* or raw ADC readings, can be filtered deterministically without the FPU. A
+* filter is designed as a normal floating point rc_filter_t and converted with
+* rc_fixed_filter_from_filter. Coefficients are stored as 32-bit integers with
+* as many fractional bits as the largest coefficient allows, products are
+* accumulated in 64 bits with saturating addition, and the output is
+* saturated to the int16_t or int32_t range. The fraction dropped when
+* converting the accumulator to an integer output is carried into the next
+* step so low frequency signals are not biased by rounding.
+*
+* Signals are plain integers, not Q1.15 or Q1.31 fractions of full scale. They
+* keep the same integer units going in and out, so a low pass filter on raw
+* gyro counts outputs filtered gyro counts, and 'bits' of 15 or 31 only picks
+* the int16_t or int32_t output range. These filters are for bit-exact
+* integer results, not for speed. On an x86 host they are slightly slower
+* than the float filters and they have not been timed on the BeagleBone, run
+* rc_benchmark_filters to compare on your own hardware.
+*
+* @ int rc_fixed_filter_from_filter(rc_fixed_filter_t* q, rc_filter_t f, int bits)
+*
+* Converts a filter made with any rc_filter_t design function, for example
+* rc_butterworth_lowpass or rc_pid_filter, into a fixed point filter. The gain
+* is folded into the numerator. 'bits' must be 15 or 31 and selects the output
+* range. Saturation limits on f are carried over, rounded to integers. Soft
+* start and moving averages from rc_moving_average are not supported.
+* Returns 0 on success or -1 on failure.
+*
+* @ rc_fixed_filter_t rc_empty_fixed_filter()
+*
+* Returns an rc_fixed_filter_t with no allocated memory. Use this to initialize
+* local filters before calling any other function.
+*
+* @ int rc_free_fixed_filter(rc_fixed_filter_t* f)
+*
+* Frees the memory allocated by the filter and zeros out all properties.
+*
+* @ int32_t rc_march_fixed_filter(rc_fixed_filter_t* f, int32_t new_input)
+*
+* March the filter forward one step and return the new integer output,
+* saturated to the filter's output range. Filters made with bits=15 expect
+* inputs within the int16_t range.
+*
+* @ int rc_reset_fixed_filter(rc_fixed_filter_t* f)
+*
+* Resets all previous inputs and outputs to 0 and resets the step counter.
+*
+* @ int rc_enable_fixed_saturation(rc_fixed_filter_t* f, int32_t min, int32_t max)
+*
+* Bounds the filter output between min and max, within the int16_t or int32_t
+* output range.
+*
+* @ int rc_prefill_fixed_filter_inputs(rc_fixed_filter_t* f, int32_t in)
+* @ int rc_prefill_fixed_filter_outputs(rc_fixed_filter_t* f, int32_t out)
+*
+* Fill all previous inputs or outputs as if they had been equal to 'in' or
+* 'out', same as rc_prefill_filter_inputs and rc_prefill_filter_outputs.
+*******************************************************************************/
+typedef struct rc_fixed_filter_t{
+	int order;			// transfer function order
+	float dt;			// timestep in seconds
+	int bits;			// 15 or 31, int16_t or int32_t output range
+	int frac_bits;		// fractional bits of the coefficients
+	int32_t* num;		// order+1 numerator coefficients including gain
+	int32_t* den;		// order+1 denominator coefficients
+	int32_t* in;		// circular history of inputs
+	int32_t* out;		// circular history of outputs
+	int index;			// position of the newest input and output
+	int64_t residue;	// fractional part dropped from the last output
+	int32_t sat_min;	// lower output limit
+	int32_t sat_max;	// upper output limit
+	int sat_flag;		// 1 if saturated on the last step
+	int32_t newest_input;	// shortcut for the most recent input
+	int32_t newest_output;	// shortcut for the most recent output
+	uint64_t step;		// steps since last reset
+	int initialized;	// initialization flag
+} rc_fixed_filter_t;
+
+int   rc_fixed_filter_from_filter(rc_fixed_filter_t* q, rc_filter_t f, int bits);
+rc_fixed_filter_t rc_empty_fixed_filter();
+int   rc_free_fixed_filter(rc_fixed_filter_t* f);
+int32_t rc_march_fixed_filter(rc_fixed_filter_t* f, int32_t new_input);
+int   rc_reset_fixed_filter(rc_fixed_filter_t* f);
+int   rc_enable_fixed_saturation(rc_fixed_filter_t* f, int32_t min, int32_t max);
+int   rc_prefill_fixed_filter_inputs(rc_fixed_filter_t* f, int32_t in);
+int   rc_prefill_fixed_filter_outputs(rc_fixed_filter_t* f, int32_t out);
+
+/*******************************************************************************
+* Transposed Direct Form II Filters
+*
+* rc_tdf2_filter_t is an alternate representation of the same discrete SISO
+* transfer functions as rc_filter_t. Instead of ring buffers of previous inputs
+* and outputs it keeps one flat state vector, so marching it is a single
+* multiply-accumulate sweep with no per-coefficient function calls. Use it for
+* filters and controllers marched inside time-critical loops. Designs are made
+* with the normal rc_filter_t functions and converted with
+* rc_tdf2_filter_from_filter. The state does not retain previous inputs and
+* outputs so there are no equivalents to rc_previous_filter_input/output.
+*
+* @ int rc_alloc_tdf2_filter(rc_tdf2_filter_t* f, rc_vector_t num, rc_vector_t den, float dt)
+*
+* Allocates memory for a TDF-II filter and populates it with the transfer
+* function coefficients provided in vectors num and den. Coefficients are
+* normalized by the leading denominator coefficient. Same rules for num and den
+* as rc_alloc_filter. Coefficients and state share a single allocation.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_tdf2_filter_from_filter(rc_tdf2_filter_t* t, rc_filter_t f)
+*
+* Builds a TDF-II filter with the same transfer function, gain, saturation and
+* soft start settings as filter f. t starts out in the reset state. Moving
+* averages from rc_moving_average don't keep their coefficients and are not
+* supported. Returns 0 on success or -1 on failure.
+*
+* @ int rc_free_tdf2_filter(rc_tdf2_filter_t* f)
+*
+* Frees the memory allocated by the filter and zeros out all properties.
+* Returns 0 on success or -1 on failure.
+*
+* @ rc_tdf2_filter_t rc_empty_tdf2_filter()
+*
+* Returns an rc_tdf2_filter_t with no allocated memory. Use this to initialize
+* local filters before calling any other function, just like rc_empty_filter.
+*
+* @ float rc_march_tdf2_filter(rc_tdf2_filter_t* f, float new_input)
+*
+* March the filter forward one step and return the new output. Saturation and
+* soft start behave exactly as in rc_march_filter. The gain is applied to the
+* input as it enters the state, so changes to the gain only affect subsequent
+* inputs rather than scaling the whole input history.
+*
+* @ int rc_reset_tdf2_filter(rc_tdf2_filter_t* f)
+*
+* Zeros the state and resets the step counter and saturation flag.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_enable_tdf2_saturation(rc_tdf2_filter_t* f, float min, float max)
+* @ int rc_enable_tdf2_soft_start(rc_tdf2_filter_t* f, float seconds)
+*
+* Same as rc_enable_saturation and rc_enable_soft_start for rc_filter_t.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_prefill_tdf2_filter(rc_tdf2_filter_t* f, float in, float out)
+*
+* Sets the state as if all previous inputs had been 'in' and all previous
+* outputs had been 'out'. Equivalent to calling both rc_prefill_filter_inputs
+* and rc_prefill_filter_outputs on an rc_filter_t.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+typedef struct rc_tdf2_filter_t{
+	// transfer function properties
+	int order;			// transfer function order
+	float dt;			// timestep in seconds
+	float gain;			// gain usually 1.0
+	float* b;			// normalized numerator coefficients, length order+1
+	float* a;			// normalized denominator coefficients, length order+1
+	float* s;			// state vector, length order+1, last entry always 0
+	// saturation settings
+	int sat_en;			// set to 1 by rc_enable_tdf2_saturation()
+	float sat_min;		// lower saturation limit
+	float sat_max;		// upper saturation limit
+	int sat_flag;		// 1 if saturated on the last step
+	// soft start settings
+	int ss_en;			// set to 1 by rc_enable_tdf2_soft_start()
+	float ss_steps;		// steps before full output allowed
+	// newest input and output for quick reference
+	float newest_input;	// shortcut for the most recent input
+	float newest_output;// shortcut for the most recent output
+	// other
+	uint64_t step;		// steps since last reset
+	int initialized;	// initialization flag
+} rc_tdf2_filter_t;
+
+int   rc_alloc_tdf2_filter(rc_tdf2_filter_t* f, rc_vector_t num, rc_vector_t den, float dt);
+int   rc_tdf2_filter_from_filter(rc_tdf2_filter_t* t, rc_filter_t f);
+int   rc_free_tdf2_filter(rc_tdf2_filter_t* f);
+rc_tdf2_filter_t rc_empty_tdf2_filter();
+float rc_march_tdf2_filter(rc_tdf2_filter_t* f, float new_input);
+int   rc_reset_tdf2_filter(rc_tdf2_filter_t* f);
+int   rc_enable_tdf2_saturation(rc_tdf2_filter_t* f, float min, float max);
+int   rc_enable_tdf2_soft_start(rc_tdf2_filter_t* f, float seconds);
+int   rc_prefill_tdf2_filter(rc_tdf2_filter_t* f, float in, float out);
+
+/*******************************************************************************
+* Second Order Section Filters
+*
+* rc_sos_filter_t implements a discrete SISO filter as a cascade of second
+* order sections (biquads). Expanding a high order design into one long
+* numerator and denominator polynomial, as rc_butterworth_lowpass does, loses
+* accuracy quickly in single precision above about 4th order. Keeping the
+* design factored into biquads stays accurate at orders 6-10 and costs 5
+* multiplies per section per step.
+*
+* @ int rc_alloc_sos_filter(rc_sos_filter_t* f, rc_matrix_t sos, float dt)
+*
+* Allocates a filter from a matrix with one row per section laid out as
+* [b0 b1 b2 a0 a1 a2], the same layout as MATLAB's sos matrices. First order
+* sections are described by setting b2 and a2 to 0. Any existing memory
+* allocated for f is freed safely. Returns 0 on success or -1 on failure.
+*
+* @ int rc_free_sos_filter(rc_sos_filter_t* f)
+*
+* Frees the memory allocated by the filter and zeros out all properties.
+* Returns 0 on success or -1 on failure.
+*
+* @ rc_sos_filter_t rc_empty_sos_filter()
+*
+* Returns an rc_sos_filter_t with no allocated memory. Use this to initialize
+* local filters before calling any other function, just like rc_empty_filter.
+*
+* @ float rc_march_sos_filter(rc_sos_filter_t* f, float new_input)
+*
+* March the filter forward one step and return the new output which could also
+* be accessed with f->newest_output. The step counter is incremented by one.
+*
+* @ int rc_reset_sos_filter(rc_sos_filter_t* f)
+*
+* Resets all previous inputs and outputs of every section to 0 and resets the
+* step counter. Returns 0 on success or -1 on failure.
+*
+* @ int rc_prefill_sos_filter_inputs(rc_sos_filter_t* f, float in)
+*
+* Fills all previous inputs to the filter as if they had been equal to 'in'.
+* Most useful when starting high-pass filters with non-zero input.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_prefill_sos_filter_outputs(rc_sos_filter_t* f, float out)
+*
+* Fills all previous outputs of the filter as if they had been equal to 'out'.
+* The intermediate signals between sections are set to their steady-state
+* values so low-pass filters start without any settling time. The inputs are
+* left untouched. Returns 0 on success or -1 on failure.
+*
+* @ int rc_print_sos_filter(rc_sos_filter_t f)
+*
+* Prints the coefficients of each section, one per line.
+*
+* @ int rc_butterworth_lowpass_sos(rc_sos_filter_t* f, int order, float dt, float wc)
+* @ int rc_butterworth_highpass_sos(rc_sos_filter_t* f, int order, float dt, float wc)
+*
+* Creates a Butterworth low or high pass filter of specified order and cutoff
+* frequency wc in rad/s as a cascade of second order sections with unity gain
+* in the pass band. The low pass matches rc_butterworth_lowpass. The high pass
+* has the shape of rc_butterworth_highpass but that one has a high frequency
+* gain of wc^order, not 1. Any existing memory allocated for f is freed safely.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+typedef struct rc_sos_filter_t{
+	int order;			// overall order of the cascade
+	int sections;		// number of second order sections
+	float dt;			// timestep in seconds
+	float gain;			// gain usually 1.0
+	float* coef;		// b0 b1 b2 a1 a2 for each section, normalized by a0
+	float* w;			// 2 history values for each of the sections+1 signals
+	float newest_input;	// shortcut for the most recent input
+	float newest_output;// shortcut for the most recent output
+	uint64_t step;		// steps since last reset
+	int initialized;	// initialization flag
+} rc_sos_filter_t;
+
+int   rc_alloc_sos_filter(rc_sos_filter_t* f, rc_matrix_t sos, float dt);
+int   rc_free_sos_filter(rc_sos_filter_t* f);
+rc_sos_filter_t rc_empty_sos_filter();
+float rc_march_sos_filter(rc_sos_filter_t* f, float new_input);
+int   rc_reset_sos_filter(rc_sos_filter_t* f);
+int   rc_prefill_sos_filter_inputs(rc_sos_filter_t* f, float in);
+int   rc_prefill_sos_filter_outputs(rc_sos_filter_t* f, float out);
+int   rc_print_sos_filter(rc_sos_filter_t f);
+int   rc_butterworth_lowpass_sos(rc_sos_filter_t* f, int order, float dt, float wc);
+int   rc_butterworth_highpass_sos(rc_sos_filter_t* f, int order, float dt, float wc);
+
+
+
+/*******************************************************************************
+* Filter Banks
+*
+* rc_filter_bank_t holds N filters which all share one transfer function, for
+* example a low pass filter applied to each axis of the accelerometer, gyro and
+* magnetometer. Instead of N separate rc_filter_t structs, each with their own
+* ring buffers, the Transposed Direct Form II state of every channel is stored
+* interleaved so all channels are marched together with NEON (or SSE/AVX when
+* compiled on a PC) vector instructions.
+*
+* @ int rc_alloc_filter_bank(rc_filter_bank_t* f, int channels, rc_vector_t num, rc_vector_t den, float dt)
+*
+* Allocates memory for a bank of 'channels' filters which all share the
+* transfer function given by num and den. Any existing memory allocated for f
+* is freed safely. Returns 0 on success or -1 on failure.
+*
+* @ int rc_filter_bank_from_filter(rc_filter_bank_t* bank, int channels, rc_filter_t f)
+*
+* Builds a filter bank with 'channels' copies of the transfer function and gain
+* of an existing rc_filter_t so any of the filter design functions such as
+* rc_butterworth_lowpass can be used, except rc_moving_average which doesn't
+* keep its coefficients. The bank starts out reset.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_free_filter_bank(rc_filter_bank_t* f)
+*
+* Frees the memory allocated by the bank and zeros out all properties.
+* Returns 0 on success or -1 on failure.
+*
+* @ rc_filter_bank_t rc_empty_filter_bank()
+*
+* Returns an rc_filter_bank_t with no allocated memory. Use this to initialize
+* local filter banks before calling any other function.
+*
+* @ int rc_march_filter_bank(rc_filter_bank_t* f, float* in, float* out)
+*
+* Marches every channel forward one step. 'in' holds one new input per channel
+* and the new outputs are written to 'out'. They may be the same array.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_reset_filter_bank(rc_filter_bank_t* f)
+*
+* Zeros the state of every channel and resets the step counter.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_prefill_filter_bank(rc_filter_bank_t* f, float* in, float* out)
+*
+* Sets the state of each channel as if all of its previous inputs had been
+* in[channel] and all previous outputs had been out[channel].
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+typedef struct rc_filter_bank_t{
+	int order;			// transfer function order
+	int channels;		// number of channels
+	int stride;			// channels rounded up to a multiple of the SIMD width
+	float dt;			// timestep in seconds
+	float gain;			// gain usually 1.0
+	float* b;			// order+1 normalized numerator coefficients
+	float* a;			// order+1 normalized denominator coefficients
+	float* s;			// (order+1)*stride interleaved state
+	float* x;			// scratch for the newest inputs times gain
+	float* y;			// newest output of each channel
+	uint64_t step;		// steps since last reset
+	int initialized;	// initialization flag
+} rc_filter_bank_t;
+
+int   rc_alloc_filter_bank(rc_filter_bank_t* f, int channels, rc_vector_t num, rc_vector_t den, float dt);
+int   rc_filter_bank_from_filter(rc_filter_bank_t* bank, int channels, rc_filter_t f);
+int   rc_free_filter_bank(rc_filter_bank_t* f);
+rc_filter_bank_t rc_empty_filter_bank();
+int   rc_march_filter_bank(rc_filter_bank_t* f, float* in, float* out);
+int   rc_reset_filter_bank(rc_filter_bank_t* f);
+int   rc_prefill_filter_bank(rc_filter_bank_t* f, float* in, float* out);
+
+/*******************************************************************************
+* Kalman Filter
+*
+* Discrete-time state estimator for a model x[k+1]=Fx[k]+Gu[k]+w, y=Hx+v where
+* w and v are zero-mean noise with covariances Q and R. The extended filter
+* takes the model as two callbacks instead, which evaluate the nonlinear
+* functions and fill in their Jacobians. Every matrix the filter needs is
+* allocated when it is set up, so once that's done rc_kalman_predict and
+* rc_kalman_update make no memory allocations and are safe to call from the IMU
+* interrupt. Call rc_kalman_predict every step and rc_kalman_update whenever a
+* measurement arrives, which may be less often. The covariance is kept exactly
+* symmetric and updated in Joseph form for stability in float.
+*
+* @ rc_kalman_t rc_empty_kalman()
+*
+* Returns an rc_kalman_t with no allocated memory and the initialized flag set
+* to 0. Use this to initialize local filters before any other function.
+*
+* @ int rc_alloc_kalman_lin(rc_kalman_t* kf, rc_matrix_t F, rc_matrix_t G, rc_matrix_t H, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t Pi)
+*
+* Sets up a linear filter. Pi is the covariance of the initial estimate, which
+* starts at zero. Pass an empty matrix for G if the model has no inputs. All
+* matrices are copied. Returns 0 on success or -1 on failure.
+*
+* @ int rc_alloc_kalman_ekf(rc_kalman_t* kf, int nx, int nu, int ny, rc_kalman_f_t f, rc_kalman_h_t h, void* ctx, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t Pi)
+*
+* Sets up an extended filter with nx states, nu inputs and ny measurements.
+* f and h are passed ctx on every call. Q, R and Pi are copied.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_free_kalman(rc_kalman_t* kf)
+*
+* Frees all memory owned by kf. Returns 0 on success or -1 on failure.
+*
+* @ int rc_reset_kalman(rc_kalman_t* kf)
+*
+* Zeros the estimate and sets the covariance back to Pi. Write to kf->x_est
+* afterwards to start from somewhere else. Returns 0 on success or -1 on
+* failure.
+*
+* @ int rc_kalman_predict(rc_kalman_t* kf, rc_vector_t u)
+*
+* Time update, propagates the estimate and covariance one step through the
+* model. u is ignored if the model has no inputs.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_kalman_update(rc_kalman_t* kf, rc_vector_t y)
+*
+* Measurement update with measurement vector y. If the innovation covariance
+* isn't positive definite nothing is changed and -1 is returned.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+// EKF model x[k+1]=f(x,u), writes f(x,u) to x_next and its Jacobian df/dx to
+// F, both already the right size. Returns 0 on success or -1 on failure.
+typedef int (*rc_kalman_f_t)(rc_vector_t x, rc_vector_t u, rc_vector_t* x_next, \
+				rc_matrix_t* F, void* ctx);
+
+// EKF measurement y=h(x), writes h(x) to y and its Jacobian dh/dx to H, both
+// already the right size. Returns 0 on success or -1 on failure.
+typedef int (*rc_kalman_h_t)(rc_vector_t x, rc_vector_t* y, rc_matrix_t* H, void* ctx);
+
+typedef struct rc_kalman_t{
+	int nx;				// number of states
+	int nu;				// number of inputs, may be 0
+	int ny;				// number of measurements
+	int ekf;			// 1 for an extended filter using f and h
+	rc_kalman_f_t f;	// EKF model callback
+	rc_kalman_h_t h;	// EKF measurement callback
+	void* ctx;			// passed to f and h
+	rc_matrix_t F;		// state transition, or its latest Jacobian for an EKF
+	rc_matrix_t G;		// input matrix, unused for an EKF
+	rc_matrix_t H;		// measurement matrix, or its latest Jacobian for an EKF
+	rc_matrix_t Q;		// process noise covariance
+	rc_matrix_t R;		// measurement noise covariance
+	rc_matrix_t P;		// covariance of the current estimate
+	rc_matrix_t Pi;		// initial covariance restored by rc_reset_kalman
+	rc_vector_t x_est;	// current estimate
+	rc_vector_t x_pre;	// model output from the last prediction
+	rc_vector_t innov;	// latest innovation y-Hx
+	// scratch space, preallocated so the filter steps never allocate
+	rc_matrix_t S;		// innovation covariance, then its Cholesky factor
+	rc_matrix_t K;		// Kalman gain
+	rc_matrix_t Kt;		// transpose of the gain as solved for
+	rc_matrix_t PHt;	// PH'
+	rc_matrix_t KR;		// KR for the Joseph form
+	rc_matrix_t M;		// I-KH
+	rc_matrix_t T;		// FP or (I-KH)P
+	rc_workspace_t ws;	// rc_gemm packing buffer
+	uint64_t step;		// predictions since the last reset
+	int initialized;	// set once memory has been allocated
+} rc_kalman_t;
+
+rc_kalman_t rc_empty_kalman();
+int   rc_alloc_kalman_lin(rc_kalman_t* kf, rc_matrix_t F, rc_matrix_t G, rc_matrix_t H, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t Pi);
+int   rc_alloc_kalman_ekf(rc_kalman_t* kf, int nx, int nu, int ny, rc_kalman_f_t f, rc_kalman_h_t h, void* ctx, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t Pi);
+int   rc_free_kalman(rc_kalman_t* kf);
+int   rc_reset_kalman(rc_kalman_t* kf);
+int   rc_kalman_predict(rc_kalman_t* kf, rc_vector_t u);
+int   rc_kalman_update(rc_kalman_t* kf, rc_vector_t y);
+
+/*******************************************************************************
+* State-Space Systems
+*
+* Discrete-time MIMO systems x[k+1]=Ax+Bu, y=Cx+Du for controllers with more
+* than one input or output. A, B, C and D are kept as blocks of one matrix
+* [C D; A B] so each step is a single call to the vectorized rc_gemv kernel,
+* and everything is allocated when the system is set up so rc_march_ss makes
+* no memory allocations. Write to the entries of A, B, C and D to change the
+* system in place but never free them or resize them. Each output can be
+* saturated and soft started just like an rc_filter_t. While an output is held
+* at a limit the clipped amount y_sat-y is fed back to the states through an
+* anti-windup gain L so they don't wind up: x[k+1]=Ax+Bu+L(y_sat-y).
+*
+* Existing transfer function designs, for example the three controllers in
+* rc_balance, can be combined into one system with rc_ss_from_filters and then
+* stepped with a single call. The result matches marching each filter on its
+* own, saturation and soft start included. Such a system remembers where each
+* filter's block on the diagonal of M lies and only steps those blocks, so it
+* costs no more than the separate filters. Entries of A, B, C, D or L that
+* would couple two filters are ignored. To change a filter's gain at runtime,
+* scale its input instead.
+*
+* @ rc_ss_t rc_empty_ss()
+*
+* Returns an rc_ss_t with no allocated memory and the initialized flag set to
+* 0. Use this to initialize local systems before any other function.
+*
+* @ int rc_alloc_ss(rc_ss_t* ss, rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, rc_matrix_t D, float dt)
+*
+* Sets up ss with the given matrices, which are copied, and timestep dt in
+* seconds. D may be an empty matrix if there is no feedthrough. The state
+* starts at zero with saturation and anti-windup off.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_ss_from_filters(rc_ss_t* ss, rc_filter_t* f, int n)
+*
+* Combines n transfer functions with the same dt into one system where input i
+* drives f[i] and output i is its output. Saturation, soft start and gain are
+* carried over and the anti-windup gain is set to match rc_march_filter. The
+* system starts at rest. Moving average filters are not supported.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_ss_c2d_ws(rc_ss_t* ss, rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, rc_matrix_t D, float dt, rc_c2d_method_t method, rc_workspace_t* w)
+*
+* Sets up ss as the RC_C2D_ZOH or RC_C2D_FOH discretization of the continuous
+* model x'=Ax+Bu, y=Cx+Du, see rc_c2d_ss_ws. If ss already has the same
+* dimensions the new matrices are written in place and its state, limits and
+* anti-windup gain are kept, so the timestep can be changed while running
+* without allocating. Returns 0 on success or -1 on failure.
+*
+* @ int rc_free_ss(rc_ss_t* ss)
+*
+* Frees all memory owned by ss. Returns 0 on success or -1 on failure.
+*
+* @ int rc_reset_ss(rc_ss_t* ss)
+*
+* Zeros the state and output and restarts soft start. The matrices and limits
+* are kept. Returns 0 on success or -1 on failure.
+*
+* @ int rc_enable_ss_saturation(rc_ss_t* ss, int output, float min, float max)
+*
+* Limits one output, counting from 0, to between min and max.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_disable_ss_saturation(rc_ss_t* ss)
+*
+* Turns saturation and soft start off for every output.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_enable_ss_soft_start(rc_ss_t* ss, int output, float seconds)
+*
+* Ramps the limits of a saturated output up from zero over the given time
+* after each reset. Returns 0 on success or -1 on failure.
+*
+* @ int rc_set_ss_antiwindup(rc_ss_t* ss, rc_matrix_t L)
+*
+* Sets the nx by ny anti-windup gain, which is copied. Pass an empty matrix to
+* turn anti-windup off. Returns 0 on success or -1 on failure.
+*
+* @ int rc_march_ss(rc_ss_t* ss, float* in, float* out)
+*
+* Steps the system once with nu inputs from 'in'. The ny saturated outputs are
+* written to 'out' if it isn't NULL and are also left in ss->y. Returns the
+* number of outputs that saturated this step or -1 on failure.
+*******************************************************************************/
+typedef struct rc_ss_t{
+	int nx;				// number of states
+	int nu;				// number of inputs
+	int ny;				// number of outputs
+	float dt;			// timestep in seconds
+	rc_matrix_t M;		// stacked system matrix [C D; A B]
+	rc_matrix_t A;		// state matrix, view of M
+	rc_matrix_t B;		// input matrix, view of M
+	rc_matrix_t C;		// output matrix, view of M
+	rc_matrix_t D;		// feedthrough matrix, view of M
+	rc_matrix_t L;		// anti-windup gain
+	rc_vector_t z;		// state followed by the newest input, [x; u]
+	rc_vector_t w;		// M*z, the output followed by the next state
+	rc_vector_t x;		// current state, points into z
+	rc_vector_t x_next;	// next state, points into w
+	rc_vector_t y;		// newest output after saturation, points into w
+	rc_vector_t y_err;	// amount each output was clipped by, y_sat-y
+	int aw_en;			// 1 if anti-windup is on
+	// saturation settings
+	int sat_en;			// 1 if any output is saturated
+	rc_vector_t sat_min;// lower limit of each output
+	rc_vector_t sat_max;// upper limit of each output
+	int* sat_flag;		// 1 for each output saturated on the last step
+	rc_vector_t ss_steps;// soft start steps for each output, 0 if off
+	// block-diagonal structure, only set by rc_ss_from_filters
+	int blocks;			// independent blocks on the diagonal, 1 if dense
+	int* blk_x;			// first state of each block then nx, NULL if dense
+	// other
+	uint64_t step;		// steps since last reset
+	int initialized;	// set once memory has been allocated
+} rc_ss_t;
+
+rc_ss_t rc_empty_ss();
+int   rc_alloc_ss(rc_ss_t* ss, rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, rc_matrix_t D, float dt);
+int   rc_ss_from_filters(rc_ss_t* ss, rc_filter_t* f, int n);
+int   rc_ss_c2d_ws(rc_ss_t* ss, rc_matrix_t A, rc_matrix_t B, rc_matrix_t C, rc_matrix_t D, float dt, rc_c2d_method_t method, rc_workspace_t* w);
+int   rc_free_ss(rc_ss_t* ss);
+int   rc_reset_ss(rc_ss_t* ss);
+int   rc_enable_ss_saturation(rc_ss_t* ss, int output, float min, float max);
+int   rc_disable_ss_saturation(rc_ss_t* ss);
+int   rc_enable_ss_soft_start(rc_ss_t* ss, int output, float seconds);
+int   rc_set_ss_antiwindup(rc_ss_t* ss, rc_matrix_t L);
+int   rc_march_ss(rc_ss_t* ss, float* in, float* out);
+
+/*******************************************************************************
+* LQR and Gain Scheduling
+*
+* Controllers like the ones in rc_balance can be designed on the device
+* itself instead of pasting in coefficients tuned elsewhere. rc_dare solves
+* the discrete algebraic Riccati equation by structure-preserving doubling,
+* and rc_dlqr turns the solution into the state feedback gain u=-Kx. Both are
+* also built in double as rc_dare_d and rc_dlqr_d. They allocate temporaries
+* so call them at startup or from a background thread.
+*
+* When the plant changes with an operating point, such as battery voltage or
+* speed, rc_gain_table_from_lqr designs a gain at every point of a uniform grid
+* over up to RC_GAIN_TABLE_MAX_DIMS variables, solving each in double. The
+* control loop then only calls rc_gain_table_lookup, which interpolates between
+* the neighbouring grid points in constant time without allocating. Run
+* rc_benchmark_lqr to see the solve and lookup times.
+*
+* @ int rc_dare(rc_matrix_t A, rc_matrix_t B, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t* P)
+*
+* Solves P = A'PA - A'PB(R+B'PB)^-1 B'PA + Q for the stabilizing solution P.
+* Q must be symmetric positive semidefinite and R symmetric positive definite.
+* (A,B) must be stabilizable and (A,Q) detectable. P is only allocated if it
+* is not already the right size. Returns 0 on success or -1 on failure.
+*
+* @ int rc_dlqr(rc_matrix_t A, rc_matrix_t B, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t* K, rc_matrix_t* P)
+*
+* Designs the gain K for the control law u=-Kx which minimizes the sum of
+* x'Qx+u'Ru for the system x[k+1]=Ax+Bu. The Riccati solution is also written
+* to P unless it is NULL. Returns 0 on success or -1 on failure.
+*
+* @ rc_gain_table_t rc_empty_gain_table()
+*
+* Returns an rc_gain_table_t with no allocated memory. Use this to initialize
+* local tables before any other function.
+*
+* @ int rc_alloc_gain_table(rc_gain_table_t* t, int dims, int* points, float* min, float* max, int rows, int cols)
+*
+* Allocates a table of rows by cols gains, all zero, on a grid with points[i]
+* evenly spaced points from min[i] to max[i] along each of the dims
+* dimensions. Every dimension needs at least 2 points.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_free_gain_table(rc_gain_table_t* t)
+*
+* Frees the memory owned by t. Returns 0 on success or -1 on failure.
+*
+* @ int rc_set_gain_table_entry(rc_gain_table_t* t, int* idx, rc_matrix_t K)
+*
+* Copies K into the grid point whose index along dimension i is idx[i], for
+* filling a table with gains designed some other way.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_gain_table_from_lqr(rc_gain_table_t* t, int dims, int* points, float* min, float* max, int nx, int nu, rc_gain_table_model_t model, void* ctx)
+*
+* Allocates a table as rc_alloc_gain_table does with nu by nx gains and fills
+* it with rc_dlqr_d designs for the model returned by the callback at every
+* grid point. Returns 0 on success or -1 on failure.
+*
+* @ int rc_gain_table_lookup(rc_gain_table_t* t, float* op, rc_matrix_t* K)
+*
+* Interpolates the gain at operating point op, which holds one value per
+* dimension, into K. Points outside the grid are clamped to its edge. K is
+* only allocated on the first call. Returns 0 on success or -1 on failure.
+*******************************************************************************/
+#define RC_GAIN_TABLE_MAX_DIMS 4
+
+// linearized model at operating point op for rc_gain_table_from_lqr. Fills in
+// A, B, Q and R which are already the right size and keep their contents from
+// the previous grid point. Returns 0 on success or -1 on failure.
+typedef int (*rc_gain_table_model_t)(float* op, rc_matrix_t* A, rc_matrix_t* B, \
+				rc_matrix_t* Q, rc_matrix_t* R, void* ctx);
+
+typedef struct rc_gain_table_t{
+	int dims;			// number of operating point variables
+	int points[RC_GAIN_TABLE_MAX_DIMS];	// grid points along each dimension
+	int stride[RC_GAIN_TABLE_MAX_DIMS];	// floats between neighbouring points
+	float min[RC_GAIN_TABLE_MAX_DIMS];	// first grid point of each dimension
+	float max[RC_GAIN_TABLE_MAX_DIMS];	// last grid point of each dimension
+	float scale[RC_GAIN_TABLE_MAX_DIMS];// grid points per unit of each variable
+	int rows;			// rows of each gain matrix
+	int cols;			// columns of each gain matrix
+	int entries;		// total number of grid points
+	float* gains;		// every gain, row-major, first dimension fastest
+	int initialized;	// set once memory has been allocated
+} rc_gain_table_t;
+
+int   rc_dare(rc_matrix_t A, rc_matrix_t B, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t* P);
+int   rc_dlqr(rc_matrix_t A, rc_matrix_t B, rc_matrix_t Q, rc_matrix_t R, rc_matrix_t* K, rc_matrix_t* P);
+rc_gain_table_t rc_empty_gain_table();
+int   rc_alloc_gain_table(rc_gain_table_t* t, int dims, int* points, float* min, float* max, int rows, int cols);
+int   rc_free_gain_table(rc_gain_table_t* t);
+int   rc_set_gain_table_entry(rc_gain_table_t* t, int* idx, rc_matrix_t K);
+int   rc_gain_table_from_lqr(rc_gain_table_t* t, int dims, int* points, float* min, float* max, int nx, int nu, rc_gain_table_model_t model, void* ctx);
+int   rc_gain_table_lookup(rc_gain_table_t* t, float* op, rc_matrix_t* K);
+
+/*******************************************************************************
+* FFT and Spectral Analysis
+*
+* In-place real FFT and a streaming Welch power spectral density estimate for
+* finding motor and propeller vibration in IMU data without dumping it to a
+* file first. Transform sizes are powers of two. A plan holds the twiddle
+* factors and bit-reversal table for one size so the transforms never call
+* sin, cos or malloc, and the butterflies use NEON on the BeagleBone and SSE
+* on x86.
+*
+* The estimator splits its work between two threads. The control loop calls
+* rc_psd_push once per sample which only copies it into a lock-free
+* rc_spsc_ringbuf_t. A background thread calls rc_psd_process to do the
+* transforms and rc_psd_get to read the result.
+*
+* @ rc_fft_plan_t rc_empty_fft_plan()
+*
+* Returns an rc_fft_plan_t with no allocated memory. Use this to initialize
+* plans before calling rc_alloc_fft_plan.
+*
+* @ int rc_alloc_fft_plan(rc_fft_plan_t* p, int n)
+*
+* Precomputes everything needed to transform n real samples where n is a power
+* of two and at least 4. Any existing memory allocated for p is freed first.
+* Returns 0 on success or -1 on failure.
+*
+* @ int rc_free_fft_plan(rc_fft_plan_t* p)
+*
+* Frees the memory allocated for a plan. Returns 0 on success or -1 on failure.
+*
+* @ int rc_fft_real(const rc_fft_plan_t* p, float* x)
+*
+* Replaces the n real samples in x with their unnormalized discrete Fourier
+* transform X[k] for k=0..n/2 in packed format. x[0] holds X[0], x[1] holds
+* X[n/2], both of which are real, and x[2k] and x[2k+1] hold the real and
+* imaginary parts of X[k] for 0<k<n/2. Bin k is at k/(n*dt) hz. A plan may be
+* shared by any number of threads. Returns 0 on success or -1 on failure.
+*
+* @ int rc_fft_real_inverse(const rc_fft_plan_t* p, float* x)
+*
+* Turns a spectrum in the packed format back into the n real samples it came
+* from, including the 1/n scaling. Returns 0 on success or -1 on failure.
+*
+* @ rc_psd_t rc_empty_psd()
+*
+* Returns an rc_psd_t with no allocated memory. Use this to initialize
+* estimators before calling rc_alloc_psd.
+*
+* @ int rc_alloc_psd(rc_psd_t* p, int channels, int n, int overlap, float fs, int capacity)
+*
+* Sets up an estimator for 'channels' signals, for example 3 for a gyro,
+* sampled at fs hz. Segments of n samples overlapping by 'overlap' samples are
+* averaged, n/2 being the usual overlap. The ring buffer holds 'capacity'
+* samples which must cover the longest gap between rc_psd_process calls. Must
+* be called before either thread uses p. Returns 0 on success or -1 on
+* failure.
+*
+* @ int rc_free_psd(rc_psd_t* p)
+*
+* Frees the memory allocated for an estimator once both threads are done with
+* it. Returns 0 on success or -1 on failure.
+*
+* @ int rc_psd_push(rc_psd_t* p, const float* sample)
+*
+* Producer thread only. Queues one sample holding one value per channel. If
+* the ring buffer is full the sample is dropped and counted in p->dropped
+* instead of waiting. Returns 0 on success or -1 if the sample was dropped.
+*
+* @ int rc_psd_process(rc_psd_t* p)
+*
+* Consumer thread only. Drains the ring buffer and averages in every segment
+* that completes, removing each segment's mean and applying a Hann window
+* first. Returns the number of new segments or -1 on failure.
+*
+* @ int rc_psd_get(rc_psd_t* p, int channel, float* out)
+*
+* Consumer thread only. Writes the one-sided power spectral density of one
+* channel to out, which needs room for n/2+1 values, in units of the input
+* squared per hz with bin k at k*fs/n hz. Matches scipy.signal.welch with its
+* defaults. Returns the number of segments averaged or -1 on failure.
+*
+* @ int rc_psd_reset(rc_psd_t* p)
+*
+* Consumer thread only. Clears the average to start a new one.
+* Returns 0 on success or -1 on failure.
+*******************************************************************************/
+typedef struct rc_fft_plan_t{
+	int n;				// number of real samples, a power of two
+	float* tw;			// butterfly twiddle factors, one block per pass
+	float* rtw;			// twiddles for splitting out the real spectrum
+	int* swap;			// index pairs swapped into bit-reversed order
+	int swaps;			// number of pairs in swap
+	int initialized;	// set once memory has been allocated
+} rc_fft_plan_t;
+
+typedef struct rc_psd_t{
+	rc_fft_plan_t plan;		// plan for one segment
+	rc_spsc_ringbuf_t ring;	// samples on their way from the producer
+	int n;					// samples per segment
+	int hop;				// new samples between segments, n minus overlap
+	int channels;			// values per sample
+	float fs;				// sample rate in hz
+	float scale;			// 1/(fs*sum(w^2)) for density units
+	float* seg;				// segment being transformed, n values
+	float* window;			// hann window, n values
+	float* hist;			// last n samples of each channel
+	double* acc;			// sum of |X[k]|^2 for each channel, n/2+1 each
+	int fill;				// samples currently in hist
+	int segments;			// segments averaged into acc
+	unsigned int dropped;	// samples lost to a full ring buffer
+	int initialized;		// set once memory has been allocated
+} rc_psd_t;
+
+rc_fft_plan_t rc_empty_fft_plan();
+int   rc_alloc_fft_plan(rc_fft_plan_t* p, int n);
+int   rc_free_fft_plan(rc_fft_plan_t* p);
+int   rc_fft_real(const rc_fft_plan_t* p, float* x);
+int   rc_fft_real_inverse(const rc_fft_plan_t* p, float* x);
+rc_psd_t rc_empty_psd();
+int   rc_alloc_psd(rc_psd_t* p, int channels, int n, int overlap, float fs, int capacity);
+int   rc_free_psd(rc_psd_t* p);
+int   rc_psd_push(rc_psd_t* p, const float* sample);
+int   rc_psd_process(rc_psd_t* p);
+int   rc_psd_get(rc_psd_t* p, int channel, float* out);
+int   rc_psd_reset(rc_psd_t* p);
+
+
+
+
 
 
 #endif //ROBOTICS_CAPE